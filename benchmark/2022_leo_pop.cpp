@@ -9,7 +9,6 @@
 #include <array>
 #include <cmath>
 #include <cstdint>
-#include <fstream>
 #include <initializer_list>
 #include <iostream>
 #include <random>
@@ -33,35 +32,20 @@
 #include <heyoka/math/sum_sq.hpp>
 #include <heyoka/math/time.hpp>
 
+#include <cascade/io.hpp>
 #include <cascade/logging.hpp>
 #include <cascade/sim.hpp>
 
+#if !defined(CASCADE_WITH_HDF5)
+
 #include "highfive/H5Easy.hpp"
 
+#endif
+
 using namespace cascade;
 
 constexpr double pi = boost::math::constants::pi<double>();
 
-// Helper to read a file into an std vector. Assumes file formatted in one column
-std::vector<double> read_file(std::string filename)
-{
-    std::vector<double> retval;
-    std::string line;
-    std::ifstream file_in;
-    file_in.open(filename);
-    if (file_in.is_open()) {
-        while (std::getline(file_in, line)) {
-            double value = 0;
-            std::stringstream ss(line);
-            ss >> value;
-            retval.push_back(value);
-        }
-    } else {
-        std::cout << " unable to open file test_ic_19647.txt" << std::endl;
-    }
-    return retval;
-}
-
 // Helper to remove from state and pars all the particles ids contained in a list.
 void remove_particles(std::vector<double> &state, std::vector<double> &pars,
                       const std::vector<cascade::sim::size_type> &idxs)
@@ -188,17 +172,24 @@ int main(int ac, char *av[])
     std::vector<double> state, pars;
     double drag_factor;
     if (large_dataset) {
+#if defined(CASCADE_WITH_HDF5)
+        state = io::load_hdf5("test_ic_612813.hdf5", "/state");
+        pars = io::load_hdf5("test_par_612813.hdf5", "/par");
+#else
+        // NOTE: io::load_hdf5() is not available if cascade
+        // is built without HDF5 support, fall back to HighFive.
         H5Easy::File ic_file("test_ic_612813.hdf5", H5Easy::File::ReadOnly);
         ic_file.getDataSet("/state").read(state);
 
         H5Easy::File par_file("test_par_612813.hdf5", H5Easy::File::ReadOnly);
         par_file.getDataSet("/par").read(pars);
+#endif
 
         // We switch off drag as to avoid to see too many reentries (in connection to the event reentry_radius being halved)
         drag_factor = 0.;
     } else {
-        state = read_file("test_ic_19647.txt");
-        pars = read_file("test_par_19647.txt");
+        state = io::load_text("test_ic_19647.txt");
+        pars = io::load_text("test_par_19647.txt");
         drag_factor = 1;
     }
     // Account for factors
@@ -208,8 +199,7 @@ int main(int ac, char *av[])
     for (decltype(pars.size()) i = 0; i < pars.size(); ++i) {
         pars[i] = pars[i] * drag_factor;
     }
-    std::vector<double> best_x;
-    best_x = read_file("best_fit_density.txt");
+    const auto best_x = io::load_text("best_fit_density.txt");
 
     // Create the dynamics
     // ------------------------------------------------------------------------------------------------------
@@ -299,8 +289,8 @@ int main(int ac, char *av[])
     } else {
         c_rad = min_radius;
     }
-    sim s(state, c_timestep, kw::dyn = dyn, kw::pars = pars, kw::reentry_radius = c_rad, kw::n_par_ct = n_par_ct,
-          kw::conj_thresh = conj_thresh);
+    sim s(std::move(state), c_timestep, kw::dyn = dyn, kw::pars = std::move(pars), kw::reentry_radius = c_rad,
+          kw::n_par_ct = n_par_ct, kw::conj_thresh = conj_thresh);
     // Perform steps of the simulation.
     // ------------------------------------------------------------------------------------------------------
     outcome oc;
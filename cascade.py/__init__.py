@@ -18,6 +18,38 @@ Classes
 
     sim
     outcome
+    conj_aggr_mode
+    screening_volume
+    conj_sink
+    memory_conj_sink
+    file_conj_sink
+    counting_conj_sink
+    ring_conj_sink
+    conj_log_sink
+    conj_store
+    snapshot_writer
+    checkpointer
+    ephemeris_writer
+    ephemeris_reader
+    ensemble
+
+Functions
+---------
+
+.. autosummary::
+    :toctree: generated/
+
+    read_conj_log
+    load_text
+    load_hdf5
+    set_jit_cache_dir
+    get_jit_cache_dir
+    set_jit_cache_max_size
+    get_jit_cache_max_size
+    set_jit_cache_precompiled_dir
+    get_jit_cache_precompiled_dir
+    get_jit_cache_size
+    clear_jit_cache
 
 """
 
@@ -32,6 +64,17 @@ import heyoka as _hy
 # We import core into the root namespace.
 from .core import *
 
+# Pure python symbols.
+from ._conj_log import read_conj_log
+
+# Asynchronous stepping.
+from ._async import _sim_step_async, _sim_propagate_until_async
+
+sim.step_async = _sim_step_async
+sim.propagate_until_async = _sim_propagate_until_async
+
+del _sim_step_async, _sim_propagate_until_async
+
 del _hy
 
 # We import the sub-modules.
@@ -0,0 +1,65 @@
+# Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+#
+# This file is part of the cascade.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+
+def _wrap_async_op(launch):
+    # Launch an asynchronous operation via the launch function
+    # and wrap it into an asyncio future.
+    # NOTE: the event loop is fetched before launching the
+    # operation, so that no operation is left running on the simulation
+    # if there is no running event loop. Once launched, the executor thread
+    # just waits for the completion of the operation (with the GIL released).
+    import asyncio
+
+    loop = asyncio.get_running_loop()
+
+    return loop.run_in_executor(None, launch().wait)
+
+
+def _sim_step_async(self):
+    """Perform a single step asynchronously
+
+    This method launches :meth:`~cascade.sim.step()` in a separate thread and returns
+    immediately an :class:`asyncio.Future` which resolves to the outcome of the step.
+    It must be invoked while an :mod:`asyncio` event loop is running (e.g., from a coroutine).
+
+    While the step is running, the simulation must not be accessed, except via the
+    ``async_running`` and ``async_snapshot`` properties and the ``wait_async()`` method.
+    The methods and property setters modifying the simulation, as well as the properties
+    returning the data modified by the step (``time``, ``state``, ``pars``, ``conjunctions``,
+    ``interrupt_info``, etc.), raise an error while the step is running. The arrays returned
+    by the ``state`` and ``pars`` properties before the launch of the step are
+    updated in place by the step, while the arrays in ``async_snapshot`` are read-only copies
+    taken at the launch of the step. The arrays of conjunctions fetched before the launch
+    of the step remain valid.
+
+    :return: the outcome of the step.
+    :rtype: asyncio.Future
+
+    :raises ValueError: if another asynchronous operation is running on the simulation.
+    :raises RuntimeError: if no :mod:`asyncio` event loop is running.
+    """
+    return _wrap_async_op(self._step_async)
+
+
+def _sim_propagate_until_async(self, t):
+    """Propagate until a time asynchronously
+
+    This is the asynchronous counterpart of :meth:`~cascade.sim.propagate_until()`
+    (see :meth:`~cascade.sim.step_async()`).
+
+    :param t: the final time.
+    :type t: float
+
+    :return: the outcome of the propagation.
+    :rtype: asyncio.Future
+
+    :raises ValueError: if another asynchronous operation is running on the simulation.
+    :raises RuntimeError: if no :mod:`asyncio` event loop is running.
+    """
+    return _wrap_async_op(lambda: self._propagate_until_async(t))
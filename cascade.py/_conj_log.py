@@ -0,0 +1,108 @@
+# Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+#
+# This file is part of the cascade.py library.
+#
+# This Source Code Form is subject to the terms of the Mozilla
+# Public License v. 2.0. If a copy of the MPL was not distributed
+# with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+
+def read_conj_log(path, t_begin=None, t_end=None):
+    """Read a conjunction log
+
+    This function will open the conjunction log file written by a
+    :class:`~cascade.conj_log_sink` as a read-only :class:`numpy.memmap`, without
+    copying the data into memory. The returned array has the same
+    dtype as :attr:`cascade.sim.conjunctions`.
+
+    If ``t_begin`` and/or ``t_end`` are provided, only the conjunctions
+    whose time coordinate is in the :math:`\\left[ t_{begin}, t_{end} \\right)` range
+    are returned. The range is located with the help of the index file
+    written alongside the log file, so that only a small portion of the log
+    file needs to be read.
+
+    :param path: the path of the log file.
+    :type path: str
+    :param t_begin: the beginning of the time range.
+    :type t_begin: typing.Optional[float]
+    :param t_end: the end of the time range.
+    :type t_end: typing.Optional[float]
+
+    :returns: the conjunctions in the log file.
+    :rtype: numpy.memmap
+
+    :raises ValueError: if the file is not a valid conjunction log file.
+    """
+    import numpy as np
+    import struct
+    import os
+    from .core import _conj_dtype, _conj_log_header_size
+
+    with open(path, "rb") as f:
+        hdr = f.read(32)
+
+    if len(hdr) != 32:
+        raise ValueError(f"The file '{path}' is not a valid conjunction log file")
+
+    magic, version, rec_size, hdr_size, n_records = struct.unpack("<8sIIQQ", hdr)
+
+    if magic != b"CSCDCLOG":
+        raise ValueError(f"The file '{path}' is not a valid conjunction log file")
+
+    if (
+        version != 2
+        or rec_size != _conj_dtype.itemsize
+        or hdr_size != _conj_log_header_size
+    ):
+        raise ValueError(
+            f"The conjunction log file '{path}' has version {version} and record size {rec_size}, but version 2 and record size {_conj_dtype.itemsize} are expected"
+        )
+
+    if n_records == 0:
+        return np.zeros(0, dtype=_conj_dtype)
+
+    # NOTE: the log file may contain preallocated
+    # space after the last record, thus we need to
+    # specify the shape explicitly.
+    ret = np.memmap(
+        path, dtype=_conj_dtype, mode="r", offset=hdr_size, shape=(n_records,)
+    )
+
+    if t_begin is None and t_end is None:
+        return ret
+
+    # Load the index, if available.
+    idx_path = path + ".idx"
+    if os.path.exists(idx_path):
+        idx = np.fromfile(idx_path, dtype=[("time", "<f8"), ("idx", "<u8")])
+        # NOTE: the index may contain entries for records
+        # not yet accounted for in the header.
+        idx = idx[idx["idx"] < n_records]
+    else:
+        idx = np.zeros(0, dtype=[("time", "<f8"), ("idx", "<u8")])
+
+    # Determine, via the index, the range of records
+    # which may contain the requested time range.
+    begin, end = 0, n_records
+
+    if t_begin is not None:
+        # NOTE: the last index entry with time strictly
+        # less than t_begin is a safe lower bound.
+        p = np.searchsorted(idx["time"], t_begin, side="left")
+        if p > 0:
+            begin = int(idx["idx"][p - 1])
+
+    if t_end is not None:
+        # NOTE: the first index entry with time greater
+        # than or equal to t_end is a safe upper bound.
+        p = np.searchsorted(idx["time"], t_end, side="left")
+        if p < len(idx):
+            end = int(idx["idx"][p])
+
+    ret = ret[begin:end]
+
+    # Refine within the records.
+    lb = 0 if t_begin is None else np.searchsorted(ret["time"], t_begin, side="left")
+    ub = len(ret) if t_end is None else np.searchsorted(ret["time"], t_end, side="left")
+
+    return ret[lb:max(lb, ub)]
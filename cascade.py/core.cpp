@@ -6,18 +6,23 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <variant>
 #include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
 
 #include <fmt/core.h>
 
@@ -29,7 +34,14 @@
 
 #include <heyoka/expression.hpp>
 
+#include <cascade/checkpointer.hpp>
+#include <cascade/conj_sink.hpp>
+#include <cascade/ensemble.hpp>
+#include <cascade/ephemeris.hpp>
+#include <cascade/io.hpp>
+#include <cascade/jit_cache.hpp>
 #include <cascade/sim.hpp>
+#include <cascade/snapshot_writer.hpp>
 
 #include "docstrings.hpp"
 #include "logging.hpp"
@@ -40,8 +52,141 @@ namespace cascade_py::detail
 namespace
 {
 
+// NOTE: the arrays of state vectors and parameter values received from
+// Python are requested as C-contiguous float64 arrays. Inputs which are
+// already in this format are accessed without copying via the buffer protocol,
+// while the other inputs (e.g., lists, non-contiguous views or arrays with
+// a different dtype) are converted by pybind11.
+using c_array_t = pybind11::array_t<double, pybind11::array::c_style | pybind11::array::forcecast>;
+
 std::optional<oneapi::tbb::global_control> tbb_gc;
 
+// Create a read-only NumPy view on the [begin, begin + size) range of
+// the vector managed by ptr. The view will keep ptr alive.
+template <typename T>
+auto make_ro_view(std::shared_ptr<std::vector<T>> ptr, std::size_t begin, std::size_t size)
+{
+    namespace py = pybind11;
+
+    assert(begin + size <= ptr->size());
+
+    auto *data = ptr->data() + begin;
+
+    // NOTE: same idea as in the state getter of the sim class.
+    auto uptr = std::make_unique<decltype(ptr)>(std::move(ptr));
+
+    py::capsule caps(uptr.get(), [](void *p) { std::unique_ptr<decltype(ptr)> vptr(static_cast<decltype(ptr) *>(p)); });
+
+    uptr.release();
+
+    auto ret = py::array_t<T>(py::array::ShapeContainer{boost::numeric_cast<py::ssize_t>(size)}, data, std::move(caps));
+
+    ret.attr("flags").attr("writeable") = false;
+
+    return ret;
+}
+
+// Move v into a 1D NumPy array, without copying the data.
+auto vector_to_array(std::vector<double> v)
+{
+    namespace py = pybind11;
+
+    auto uptr = std::make_unique<std::vector<double>>(std::move(v));
+
+    auto *data = uptr->data();
+    const auto size = uptr->size();
+
+    // NOTE: same idea as in the state getter of the sim class.
+    py::capsule caps(uptr.get(),
+                     [](void *p) { std::unique_ptr<std::vector<double>> vptr(static_cast<std::vector<double> *>(p)); });
+
+    uptr.release();
+
+    return py::array_t<double>(py::array::ShapeContainer{boost::numeric_cast<py::ssize_t>(size)}, data,
+                               std::move(caps));
+}
+
+// Copy the content of the C-contiguous array arr into a vector.
+// NOTE: this is a single memcpy(), which is much faster than the
+// element-wise conversion performed by py::cast() and it does not
+// require the materialisation of a flattened copy of arr.
+std::vector<double> array_to_vector(const c_array_t &arr)
+{
+    const auto *data = arr.data();
+
+    return std::vector<double>(data, data + arr.size());
+}
+
+// Flatten the 2D array arr with ncols columns into a vector.
+// NOTE: name is used in the error messages.
+std::vector<double> flatten_2d_array(const c_array_t &arr, pybind11::ssize_t ncols, const char *name)
+{
+    namespace py = pybind11;
+
+    if (arr.ndim() != 2) {
+        throw std::invalid_argument(fmt::format(
+            "The input {} must have 2 dimensions, but instead an array with {} dimension(s) was provided", name,
+            arr.ndim()));
+    }
+
+    if (arr.shape(1) != ncols) {
+        throw std::invalid_argument(fmt::format(
+            "An input {} with {} column(s) is expected, but the number of columns is instead {}", name, ncols,
+            arr.shape(1)));
+    }
+
+    return array_to_vector(arr);
+}
+
+// Check that no asynchronous operation is running on s.
+// NOTE: while an asynchronous operation is running, the
+// simulation is owned by the operation and it cannot be modified.
+void check_no_async(const cascade::sim &s)
+{
+    if (s.async_running()) {
+        throw std::invalid_argument(
+            "Cannot modify a simulation while an asynchronous operation is running on it");
+    }
+}
+
+// Wrap the mutating member function f of the sim
+// class into a function invoking check_no_async() first.
+template <typename R, typename... Args>
+auto no_async(R (cascade::sim::*f)(Args...))
+{
+    return [f](cascade::sim &s, Args... args) -> R {
+        check_no_async(s);
+
+        return (s.*f)(std::forward<Args>(args)...);
+    };
+}
+
+// Check that no asynchronous operation is running on s
+// before reading the data modified by the operation (time
+// coordinate, state, detected conjunctions, etc.).
+// NOTE: the data at the launch of the operation is
+// available via the async_snapshot property.
+void check_no_async_read(const cascade::sim &s)
+{
+    if (s.async_running()) {
+        throw std::invalid_argument(
+            "Cannot access the dynamical data of a simulation while an asynchronous operation is running on it "
+            "(the data at the launch of the operation is available via async_snapshot)");
+    }
+}
+
+// Wrap the getter f of the sim class into a
+// function invoking check_no_async_read() first.
+template <typename R>
+auto no_async_read(R (cascade::sim::*f)() const)
+{
+    return [f](const cascade::sim &s) -> R {
+        check_no_async_read(s);
+
+        return (s.*f)();
+    };
+}
+
 } // namespace
 
 } // namespace cascade_py::detail
@@ -65,6 +210,11 @@ PYBIND11_MODULE(core, m)
     // imported in the dynamics submodule.
     m.def("_kepler", &dynamics::kepler, "mu"_a = 1., docstrings::dynamics_kepler_docstring().c_str());
 
+    // NOTE: the Earth dynamics is wrapped (and documented)
+    // by the pure Python function dynamics.simple_earth().
+    m.def("_simple_earth", &dynamics::simple_earth, "J2"_a = true, "J3"_a = false, "C22S22"_a = true, "sun"_a = false,
+          "moon"_a = false, "SRP"_a = false, "drag"_a = true);
+
     // Expose the logging setter functions.
     cpy::expose_logging_setters(m);
 
@@ -77,19 +227,247 @@ PYBIND11_MODULE(core, m)
         .value("exit", outcome::exit)
         .value("err_nf_state", outcome::err_nf_state);
 
+    // conj_aggr_mode enum.
+    py::enum_<conj_aggr_mode>(m, "conj_aggr_mode", docstrings::conj_aggr_mode_docstring().c_str())
+        .value("none", conj_aggr_mode::none)
+        .value("superstep", conj_aggr_mode::superstep)
+        .value("window", conj_aggr_mode::window);
+
+    // screening_volume class.
+    py::class_<screening_volume>(m, "screening_volume", docstrings::screening_volume_docstring().c_str())
+        .def(py::init<std::vector<hy::expression>, double>(), "predicates"_a, "bounding_radius"_a)
+        .def_static("ric_ellipsoid", &screening_volume::ric_ellipsoid, "r"_a, "i"_a, "c"_a,
+                    docstrings::screening_volume_ric_ellipsoid_docstring().c_str())
+        .def_static("ric_box", &screening_volume::ric_box, "r"_a, "i"_a, "c"_a,
+                    docstrings::screening_volume_ric_box_docstring().c_str())
+        .def_property_readonly("predicates", &screening_volume::get_predicates)
+        .def_property_readonly("bounding_radius", &screening_volume::get_bounding_radius)
+        .def("__copy__", [](const screening_volume &sv) { return sv; })
+        .def("__deepcopy__", [](const screening_volume &sv, py::dict) { return sv; }, "memo"_a);
+
     // Conjunction structure.
-    PYBIND11_NUMPY_DTYPE(sim::conjunction, i, j, time, dist, state_i, state_j);
+    PYBIND11_NUMPY_DTYPE(sim::conjunction, i, j, id_i, id_j, time, dist, state_i, state_j, tier, n_min, time_under);
+
+    // Conjunction sinks.
+    py::class_<conj_sink, std::shared_ptr<conj_sink>>(m, "conj_sink", docstrings::conj_sink_docstring().c_str());
+
+    py::class_<memory_conj_sink, conj_sink, std::shared_ptr<memory_conj_sink>>(m, "memory_conj_sink")
+        .def(py::init<>())
+        .def_property_readonly("conjunctions",
+                               [](const memory_conj_sink &cs) {
+                                   const auto &cv = cs.get_conjunctions();
+
+                                   // NOTE: return a copy, as the content of the sink
+                                   // can change when the simulation is stepped.
+                                   return py::array_t<sim::conjunction>(
+                                       py::array::ShapeContainer{boost::numeric_cast<py::ssize_t>(cv.size())}, cv.data());
+                               })
+        .def("clear", &memory_conj_sink::clear);
+
+    py::class_<file_conj_sink, conj_sink, std::shared_ptr<file_conj_sink>>(m, "file_conj_sink")
+        .def(py::init<std::string>(), "path"_a)
+        .def_property_readonly("path", &file_conj_sink::get_path)
+        .def_property_readonly("n_conj", &file_conj_sink::get_n_conj)
+        .def("flush", &file_conj_sink::flush);
+
+    py::class_<counting_conj_sink, conj_sink, std::shared_ptr<counting_conj_sink>>(m, "counting_conj_sink")
+        .def(py::init<>())
+        .def_property_readonly("n_conj", &counting_conj_sink::get_n_conj)
+        .def_property_readonly("tier_counts", &counting_conj_sink::get_tier_counts)
+        .def("reset", &counting_conj_sink::reset);
+
+    py::class_<ring_conj_sink, conj_sink, std::shared_ptr<ring_conj_sink>>(m, "ring_conj_sink")
+        .def(py::init<std::size_t>(), "capacity"_a)
+        .def(
+            "pop_all",
+            [](ring_conj_sink &cs) {
+                auto cv = cs.pop_all();
+
+                return py::array_t<sim::conjunction>(
+                    py::array::ShapeContainer{boost::numeric_cast<py::ssize_t>(cv.size())}, cv.data());
+            })
+        .def_property_readonly("capacity", &ring_conj_sink::get_capacity)
+        .def_property_readonly("size", &ring_conj_sink::get_size)
+        .def_property_readonly("n_dropped", &ring_conj_sink::get_n_dropped);
+
+    py::class_<conj_log_sink, conj_sink, std::shared_ptr<conj_log_sink>>(m, "conj_log_sink",
+                                                                         docstrings::conj_log_sink_docstring().c_str())
+        .def(py::init<std::string, bool>(), "path"_a, "append"_a = false)
+        .def_property_readonly("path", &conj_log_sink::get_path)
+        .def_property_readonly("n_records", &conj_log_sink::get_n_records)
+        .def("flush", &conj_log_sink::flush, py::call_guard<py::gil_scoped_release>())
+        .def("close", &conj_log_sink::close, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<conj_store, conj_sink, std::shared_ptr<conj_store>>(m, "conj_store",
+                                                                   docstrings::conj_store_docstring().c_str())
+        .def(py::init<double>(), "bucket_width"_a = 1.)
+        .def_property_readonly("bucket_width", &conj_store::get_bucket_width)
+        .def_property_readonly("conjunctions",
+                               [](const conj_store &cs) {
+                                   auto ptr = cs._get_conj_ptr();
+                                   const auto size = ptr->size();
+
+                                   return cpy::detail::make_ro_view(std::move(ptr), 0, size);
+                               })
+        .def(
+            "particle_conj_ids",
+            [](conj_store &cs, std::uint64_t key) {
+                auto ptr = cs._get_adj_ids_ptr(key);
+                if (!ptr) {
+                    ptr = std::make_shared<std::vector<sim::size_type>>();
+                }
+                const auto size = ptr->size();
+
+                return cpy::detail::make_ro_view(std::move(ptr), 0, size);
+            },
+            "key"_a)
+        .def(
+            "pair_conj_ids",
+            [](conj_store &cs, std::uint64_t key_a, std::uint64_t key_b) {
+                auto ids = cs.get_pair_conj_ids(key_a, key_b);
+
+                return py::array_t<sim::size_type>(
+                    py::array::ShapeContainer{boost::numeric_cast<py::ssize_t>(ids.size())}, ids.data());
+            },
+            "key_a"_a, "key_b"_a)
+        .def(
+            "time_range",
+            [](const conj_store &cs, double t_begin, double t_end) {
+                const auto [lb, ub] = cs.get_time_range_ids(t_begin, t_end);
+
+                return cpy::detail::make_ro_view(cs._get_conj_ptr(), lb, ub - lb);
+            },
+            "t_begin"_a, "t_end"_a);
+
+    // snapshot_writer class.
+    py::class_<snapshot_writer, std::shared_ptr<snapshot_writer>>(m, "snapshot_writer",
+                                                                   docstrings::snapshot_writer_docstring().c_str())
+        .def(py::init([](std::string path, std::uint64_t snap_every, std::vector<double> snap_times,
+                         unsigned compression, std::size_t queue_size) {
+                 return std::make_shared<snapshot_writer>(std::move(path), kw::snap_every = snap_every,
+                                                          kw::snap_times = std::move(snap_times),
+                                                          kw::compression = compression, kw::queue_size = queue_size);
+             }),
+             "path"_a, "snap_every"_a = 1, "snap_times"_a = py::list{}, "compression"_a = 0, "queue_size"_a = 2)
+        .def_property_readonly("path", &snapshot_writer::get_path)
+        .def_property_readonly("snap_every", &snapshot_writer::get_snap_every)
+        .def_property_readonly("snap_times", &snapshot_writer::get_snap_times)
+        .def_property_readonly("compression", &snapshot_writer::get_compression)
+        .def_property_readonly("queue_size", &snapshot_writer::get_queue_size)
+        .def_property_readonly("n_snapshots", &snapshot_writer::get_n_snapshots)
+        .def("flush", &snapshot_writer::flush, py::call_guard<py::gil_scoped_release>())
+        .def("close", &snapshot_writer::close, py::call_guard<py::gil_scoped_release>());
+
+    // checkpointer class.
+    py::class_<checkpointer, std::shared_ptr<checkpointer>>(m, "checkpointer",
+                                                            docstrings::checkpointer_docstring().c_str())
+        .def(py::init([](std::string path, std::uint64_t ckpt_every, bool xor_delta) {
+                 return std::make_shared<checkpointer>(std::move(path), kw::ckpt_every = ckpt_every,
+                                                       kw::xor_delta = xor_delta);
+             }),
+             "path"_a, "ckpt_every"_a = 1, "xor_delta"_a = true)
+        .def_property_readonly("path", &checkpointer::get_path)
+        .def_property_readonly("ckpt_every", &checkpointer::get_ckpt_every)
+        .def_property_readonly("xor_delta", &checkpointer::get_xor_delta)
+        .def_property_readonly("n_records", &checkpointer::get_n_records)
+        .def_property_readonly("n_bytes", &checkpointer::get_n_bytes)
+        .def("write", &checkpointer::write, "sim"_a, py::call_guard<py::gil_scoped_release>())
+        .def("write_base", &checkpointer::write_base, "sim"_a, py::call_guard<py::gil_scoped_release>())
+        .def_static("restore", &checkpointer::restore, "path"_a, py::call_guard<py::gil_scoped_release>());
+
+    // ephemeris_writer class.
+    py::class_<ephemeris_writer, std::shared_ptr<ephemeris_writer>>(m, "ephemeris_writer",
+                                                                    docstrings::ephemeris_writer_docstring().c_str())
+        .def(py::init([](std::string path, double cheby_tol) {
+                 return std::make_shared<ephemeris_writer>(std::move(path), kw::cheby_tol = cheby_tol);
+             }),
+             "path"_a, "cheby_tol"_a = 0.)
+        .def_property_readonly("path", &ephemeris_writer::get_path)
+        .def_property_readonly("cheby_tol", &ephemeris_writer::get_cheby_tol)
+        .def_property_readonly("n_blocks", &ephemeris_writer::get_n_blocks)
+        .def_property_readonly("n_bytes", &ephemeris_writer::get_n_bytes);
+
+    // ephemeris_reader class.
+    py::class_<ephemeris_reader>(m, "ephemeris_reader", docstrings::ephemeris_reader_docstring().c_str())
+        .def(py::init<const std::string &>(), "path"_a, py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("n_blocks", &ephemeris_reader::get_n_blocks)
+        .def_property_readonly("time_range", &ephemeris_reader::get_time_range)
+        .def("nparts", &ephemeris_reader::get_nparts, "t"_a)
+        .def(
+            "ids",
+            [](const ephemeris_reader &r, double t) {
+                const auto ids = r.get_ids(t);
+
+                return py::array_t<std::uint64_t>(boost::numeric_cast<py::ssize_t>(ids.size()), ids.data());
+            },
+            "t"_a)
+        .def("id_to_index", &ephemeris_reader::id_to_index, "id"_a, "t"_a)
+        .def(
+            "state_by_id",
+            [](const ephemeris_reader &r, std::uint64_t id, double t) {
+                const auto st = r.get_state_by_id(id, t);
+
+                return py::array_t<double>(py::array::ShapeContainer{6}, st.data());
+            },
+            "id"_a, "t"_a)
+        .def(
+            "state",
+            [](const ephemeris_reader &r, sim::size_type pidx, double t) {
+                const auto st = r.get_state(pidx, t);
+
+                return py::array_t<double>(py::array::ShapeContainer{6}, st.data());
+            },
+            "pidx"_a, "t"_a)
+        .def(
+            "states",
+            [](const ephemeris_reader &r, double t) {
+                std::vector<double> ret;
+
+                {
+                    py::gil_scoped_release release;
+
+                    ret = r.get_states(t);
+                }
+
+                return cpy::detail::vector_to_array(std::move(ret)).attr("reshape")(-1, 6);
+            },
+            "t"_a)
+        .def(
+            "states",
+            [](const ephemeris_reader &r, const std::vector<sim::size_type> &pidxs, const std::vector<double> &times) {
+                std::vector<double> ret;
+
+                {
+                    py::gil_scoped_release release;
+
+                    using safe_size_t = boost::safe_numerics::safe<decltype(ret.size())>;
+                    ret.resize(static_cast<decltype(ret.size())>(safe_size_t(pidxs.size()) * 6));
+
+                    r.get_states(pidxs, times, ret);
+                }
+
+                return cpy::detail::vector_to_array(std::move(ret)).attr("reshape")(-1, 6);
+            },
+            "pidxs"_a, "times"_a);
+
+    // Expose the dtype of the conjunction structure and the layout
+    // parameters of the conjunction log files, for use
+    // in read_conj_log().
+    m.attr("_conj_dtype") = py::dtype::of<sim::conjunction>();
+    m.attr("_conj_log_header_size") = conj_log_header_size;
 
     // sim class.
     using whitelist_t = sim::whitelist_t;
     py::class_<sim>(m, "sim", docstrings::sim_docstring().c_str(), py::dynamic_attr{})
         .def(py::init<>())
-        .def(py::init([](const py::array_t<double> &state, double ct,
+        .def(py::init([](const cpy::detail::c_array_t &state, double ct,
                          std::optional<std::vector<std::pair<hy::expression, hy::expression>>> dyn_,
                          std::optional<std::variant<double, std::vector<double>>> reentry_radius_,
-                         std::optional<double> exit_radius_, const std::optional<py::array_t<double>> &pars_,
-                         std::optional<double> tol_, bool ha, std::uint32_t n_par_ct, double conj_thresh, double min_coll_radius,
-                         whitelist_t coll_whitelist, whitelist_t conj_whitelist) {
+                         std::optional<double> exit_radius_, const std::optional<cpy::detail::c_array_t> &pars_,
+                         std::optional<double> tol_, bool ha, std::uint32_t n_par_ct, std::variant<double, std::vector<double>> conj_thresh, double min_coll_radius,
+                         whitelist_t coll_whitelist, whitelist_t conj_whitelist, conj_aggr_mode conj_aggr, double conj_aggr_window,
+                         std::optional<screening_volume> svol_, std::uint32_t det_order,
+                         std::optional<sim::id_whitelist_t> coll_whitelist_ids, std::optional<sim::id_whitelist_t> conj_whitelist_ids) {
                  // Check the input state.
                  if (state.ndim() != 2) {
                      throw std::invalid_argument(fmt::format(
@@ -107,7 +485,7 @@ PYBIND11_MODULE(core, m)
                  const auto nparts = state.shape(0);
 
                  // Flatten out the state vector.
-                 auto state_vec = py::cast<std::vector<double>>(state.attr("flatten")());
+                 auto state_vec = cpy::detail::array_to_vector(state);
 
                  // Init the dynamics.
                  auto dyn = dyn_ ? std::move(*dyn_) : std::vector<std::pair<hy::expression, hy::expression>>{};
@@ -139,37 +517,94 @@ PYBIND11_MODULE(core, m)
                      }
 
                      // Flatten it out into pars_vec.
-                     pars_vec = py::cast<std::vector<double>>(pars.attr("flatten")());
+                     pars_vec = cpy::detail::array_to_vector(pars);
                  }
 
                  // Prepare the tolerance.
                  auto tol = tol_ ? *tol_ : 0.;
 
+                 // NOTE: the id-based whitelists are converted to indices
+                 // after construction, when the particle ids have been assigned.
+                 if (coll_whitelist_ids && !coll_whitelist.empty()) {
+                     throw std::invalid_argument(
+                         "The 'coll_whitelist' and 'coll_whitelist_ids' arguments cannot be used together");
+                 }
+                 if (conj_whitelist_ids && !conj_whitelist.empty()) {
+                     throw std::invalid_argument(
+                         "The 'conj_whitelist' and 'conj_whitelist_ids' arguments cannot be used together");
+                 }
+
+                 // NOTE: the screening volume is optional, and it is passed
+                 // to the constructor only if provided.
+                 auto make_sim = [&](auto &&cr_val, auto &&ct_val) {
+                     if (svol_) {
+                         return sim(std::move(state_vec), ct, kw::dyn = std::move(dyn),
+                                    kw::reentry_radius = std::forward<decltype(cr_val)>(cr_val), kw::exit_radius = exit_radius,
+                                    kw::pars = std::move(pars_vec), kw::tol = tol, kw::high_accuracy = ha, kw::n_par_ct = n_par_ct, kw::conj_thresh = std::forward<decltype(ct_val)>(ct_val),
+                                    kw::min_coll_radius = min_coll_radius, kw::coll_whitelist = std::move(coll_whitelist), kw::conj_whitelist = std::move(conj_whitelist),
+                                    kw::conj_aggr = conj_aggr, kw::conj_aggr_window = conj_aggr_window, kw::screening_volume = std::move(*svol_),
+                                    kw::det_order = det_order);
+                     } else {
+                         return sim(std::move(state_vec), ct, kw::dyn = std::move(dyn),
+                                    kw::reentry_radius = std::forward<decltype(cr_val)>(cr_val), kw::exit_radius = exit_radius,
+                                    kw::pars = std::move(pars_vec), kw::tol = tol, kw::high_accuracy = ha, kw::n_par_ct = n_par_ct, kw::conj_thresh = std::forward<decltype(ct_val)>(ct_val),
+                                    kw::min_coll_radius = min_coll_radius, kw::coll_whitelist = std::move(coll_whitelist), kw::conj_whitelist = std::move(conj_whitelist),
+                                    kw::conj_aggr = conj_aggr, kw::conj_aggr_window = conj_aggr_window, kw::det_order = det_order);
+                     }
+                 };
+
                  // NOTE: might have to re-check this if we ever offer the
                  // option to define event callbacks in the dynamics.
                  py::gil_scoped_release release;
 
-                 return std::visit(
-                     [&](auto &&cr_val) {
-                         return sim(std::move(state_vec), ct, kw::dyn = std::move(dyn),
-                                    kw::reentry_radius = std::forward<decltype(cr_val)>(cr_val), kw::exit_radius = exit_radius,
-                                    kw::pars = std::move(pars_vec), kw::tol = tol, kw::high_accuracy = ha, kw::n_par_ct = n_par_ct, kw::conj_thresh = conj_thresh,
-                                    kw::min_coll_radius = min_coll_radius, kw::coll_whitelist = std::move(coll_whitelist), kw::conj_whitelist = std::move(conj_whitelist));
-                     },
-                     std::move(reentry_radius));
+                 auto s = std::visit(make_sim, std::move(reentry_radius), std::move(conj_thresh));
+
+                 if (coll_whitelist_ids) {
+                     s.set_coll_whitelist_ids(*coll_whitelist_ids);
+                 }
+                 if (conj_whitelist_ids) {
+                     s.set_conj_whitelist_ids(*conj_whitelist_ids);
+                 }
+
+                 return s;
              }),
              "state"_a, "ct"_a, "dyn"_a = py::none{}, "reentry_radius"_a = py::none{}, "exit_radius"_a = py::none{},
              "pars"_a = py::none{}, "tol"_a = py::none{}, "high_accuracy"_a = false, "n_par_ct"_a = 1, "conj_thresh"_a = 0.,
-             "min_coll_radius"_a = 0., "coll_whitelist"_a = whitelist_t{}, "conj_whitelist"_a = whitelist_t{}, docstrings::sim_init_docstring().c_str())
-        .def_property_readonly("interrupt_info", &sim::get_interrupt_info, docstrings::sim_interrupt_info_docstring().c_str())
-        .def_property("time", &sim::get_time, &sim::set_time)
-        .def_property("ct", &sim::get_ct, &sim::set_ct)
-        .def_property("n_par_ct", &sim::get_n_par_ct, &sim::set_n_par_ct)
-        .def_property("conj_thresh", &sim::get_conj_thresh, &sim::set_conj_thresh)
-        .def_property("min_coll_radius", &sim::get_min_coll_radius, &sim::set_min_coll_radius)
-        .def_property("coll_whitelist", &sim::get_coll_whitelist, &sim::set_coll_whitelist)
-        .def_property("conj_whitelist", &sim::get_conj_whitelist, &sim::set_conj_whitelist, docstrings::sim_conj_whitelist_docstring().c_str())
+             "min_coll_radius"_a = 0., "coll_whitelist"_a = whitelist_t{}, "conj_whitelist"_a = whitelist_t{},
+             "conj_aggr"_a = conj_aggr_mode::none, "conj_aggr_window"_a = 0., "screening_volume"_a = py::none{},
+             "det_order"_a = 0u, "coll_whitelist_ids"_a = py::none{}, "conj_whitelist_ids"_a = py::none{},
+             docstrings::sim_init_docstring().c_str())
+        .def_property_readonly("interrupt_info", cpy::detail::no_async_read(&sim::get_interrupt_info), docstrings::sim_interrupt_info_docstring().c_str())
+        .def_property("time", cpy::detail::no_async_read(&sim::get_time), cpy::detail::no_async(&sim::set_time))
+        .def_property("ct", &sim::get_ct, cpy::detail::no_async(&sim::set_ct))
+        .def_property("n_par_ct", &sim::get_n_par_ct, cpy::detail::no_async(&sim::set_n_par_ct))
+        .def_property("conj_thresh", &sim::get_conj_thresh, cpy::detail::no_async(&sim::set_conj_thresh))
+        .def_property("conj_tiers", &sim::get_conj_tiers, cpy::detail::no_async(&sim::set_conj_tiers),
+                      docstrings::sim_conj_tiers_docstring().c_str())
+        .def_property_readonly("conj_tier_counts", cpy::detail::no_async_read(&sim::get_conj_tier_counts))
+        .def_property("min_coll_radius", &sim::get_min_coll_radius, cpy::detail::no_async(&sim::set_min_coll_radius))
+        .def_property("coll_whitelist", &sim::get_coll_whitelist, cpy::detail::no_async(&sim::set_coll_whitelist))
+        .def_property("conj_whitelist", &sim::get_conj_whitelist, cpy::detail::no_async(&sim::set_conj_whitelist),
+                      docstrings::sim_conj_whitelist_docstring().c_str())
+        .def_property("coll_whitelist_ids", &sim::get_coll_whitelist_ids,
+                      cpy::detail::no_async(&sim::set_coll_whitelist_ids),
+                      docstrings::sim_whitelist_ids_docstring().c_str())
+        .def_property("conj_whitelist_ids", &sim::get_conj_whitelist_ids,
+                      cpy::detail::no_async(&sim::set_conj_whitelist_ids),
+                      docstrings::sim_whitelist_ids_docstring().c_str())
         .def_property_readonly("nparts", &sim::get_nparts)
+        // Particle ids.
+        .def_property_readonly(
+            "ids",
+            [](const sim &s) {
+                const auto &ids = s.get_ids();
+
+                // NOTE: the ids are returned as a copy.
+                return py::array_t<std::uint64_t>(boost::numeric_cast<py::ssize_t>(ids.size()), ids.data());
+            },
+            docstrings::sim_ids_docstring().c_str())
+        .def("id_to_index", &sim::id_to_index, "id"_a)
+        .def_property_readonly("interrupt_ids", cpy::detail::no_async_read(&sim::get_interrupt_ids))
         .def_property_readonly("npars", &sim::get_npars)
         .def_property_readonly("tol", &sim::get_tol)
         .def_property_readonly("high_accuracy", &sim::get_high_accuracy)
@@ -178,6 +613,8 @@ PYBIND11_MODULE(core, m)
         .def(
             "step",
             [](sim &s) {
+                cpy::detail::check_no_async(s);
+
                 // NOTE: might have to re-check this if we ever offer the
                 // option to define event callbacks in the dynamics.
                 py::gil_scoped_release release;
@@ -187,6 +624,8 @@ PYBIND11_MODULE(core, m)
         .def(
             "propagate_until",
             [](sim &s, double t) {
+                cpy::detail::check_no_async(s);
+
                 // NOTE: might have to re-check this if we ever offer the
                 // option to define event callbacks in the dynamics.
                 py::gil_scoped_release release;
@@ -194,9 +633,42 @@ PYBIND11_MODULE(core, m)
                 return s.propagate_until(t);
             },
             "t"_a)
+        // Asynchronous stepping.
+        // NOTE: these are wrapped into asyncio-compatible
+        // methods on the Python side (see _async.py).
+        // NOTE: the GIL is released because the launch copies
+        // the state and parameters into the snapshot.
+        .def("_step_async", &sim::step_async, py::call_guard<py::gil_scoped_release>())
+        .def("_propagate_until_async", &sim::propagate_until_async, "t"_a,
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("async_running", &sim::async_running)
+        .def("wait_async", &sim::wait_async, py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly(
+            "async_snapshot",
+            [](const sim &s) -> py::object {
+                const auto &snap = s.get_async_snapshot();
+
+                if (!snap) {
+                    return py::none{};
+                }
+
+                const auto nparts = boost::numeric_cast<py::ssize_t>(snap->state->size() / 7u);
+
+                // NOTE: the views keep the snapshot vectors alive.
+                auto state = cpy::detail::make_ro_view(std::const_pointer_cast<std::vector<double>>(snap->state), 0,
+                                                       snap->state->size());
+                auto pars = cpy::detail::make_ro_view(std::const_pointer_cast<std::vector<double>>(snap->pars), 0,
+                                                      snap->pars->size());
+
+                return py::make_tuple(snap->time, state.attr("reshape")(nparts, 7),
+                                      pars.attr("reshape")(nparts, boost::numeric_cast<py::ssize_t>(s.get_npars())));
+            },
+            docstrings::sim_async_snapshot_docstring().c_str())
         // Expose the state getters.
         .def_property_readonly("state",
                                [](const sim &s) {
+                                   cpy::detail::check_no_async_read(s);
+
                                    // Fetch a shared ptr to the internal state vector.
                                    auto sptr = s._get_state_ptr();
 
@@ -229,6 +701,8 @@ PYBIND11_MODULE(core, m)
                                })
         .def_property_readonly("pars",
                                [](const sim &s) {
+                                   cpy::detail::check_no_async_read(s);
+
                                    // NOTE: same idea as in the state getter.
                                    auto pptr = s._get_pars_ptr();
 
@@ -249,7 +723,10 @@ PYBIND11_MODULE(core, m)
                                }, docstrings::sim_pars_docstring().c_str())
         .def(
             "set_new_state_pars",
-            [](sim &s, const py::array_t<double> &new_state, const std::optional<py::array_t<double>> &new_pars_) {
+            [](sim &s, const cpy::detail::c_array_t &new_state,
+               const std::optional<cpy::detail::c_array_t> &new_pars_) {
+                cpy::detail::check_no_async(s);
+
                 // Check the new state.
                 if (new_state.ndim() != 2) {
                     throw std::invalid_argument(fmt::format("The input state must have 2 dimensions, but instead an "
@@ -264,7 +741,7 @@ PYBIND11_MODULE(core, m)
                 }
 
                 // Flatten out.
-                auto state_vec = py::cast<std::vector<double>>(new_state.attr("flatten")());
+                auto state_vec = cpy::detail::array_to_vector(new_state);
 
                 // Prepare the pars vector.
                 std::vector<double> pars_vec;
@@ -287,7 +764,7 @@ PYBIND11_MODULE(core, m)
                     }
 
                     // Flatten out into pars_vec.
-                    pars_vec = py::cast<std::vector<double>>(new_pars.attr("flatten")());
+                    pars_vec = cpy::detail::array_to_vector(new_pars);
                 }
 
                 py::gil_scoped_release release;
@@ -298,6 +775,8 @@ PYBIND11_MODULE(core, m)
         // Conjunctions.
         .def_property_readonly("conjunctions",
                         [](const sim &s) {
+                            cpy::detail::check_no_async_read(s);
+
                             // NOTE: same idea as in the state getter.
                             auto cptr = s._get_conjunctions_ptr();
 
@@ -318,16 +797,241 @@ PYBIND11_MODULE(core, m)
 
                             return ret;
                         })
-        .def("reset_conjunctions", &sim::reset_conjunctions)
-        // Remove particles.
-        .def("remove_particles", &sim::remove_particles)
+        .def("reset_conjunctions", cpy::detail::no_async(&sim::reset_conjunctions))
+        // Conjunction aggregation.
+        .def_property("conj_aggr", &sim::get_conj_aggr, cpy::detail::no_async(&sim::set_conj_aggr),
+                      docstrings::sim_conj_aggr_docstring().c_str())
+        .def_property("conj_aggr_window", &sim::get_conj_aggr_window, cpy::detail::no_async(&sim::set_conj_aggr_window))
+        .def_property_readonly("n_pending_conjunctions", cpy::detail::no_async_read(&sim::get_n_pending_conjunctions))
+        .def_property("conj_sink", &sim::get_conj_sink, cpy::detail::no_async(&sim::set_conj_sink),
+                      docstrings::sim_conj_sink_docstring().c_str())
+        .def_property("snapshot_writer", &sim::get_snapshot_writer, cpy::detail::no_async(&sim::set_snapshot_writer),
+                      docstrings::sim_snapshot_writer_docstring().c_str())
+        .def_property("checkpointer", &sim::get_checkpointer, cpy::detail::no_async(&sim::set_checkpointer),
+                      docstrings::sim_checkpointer_docstring().c_str())
+        .def_property("ephemeris_writer", &sim::get_ephemeris_writer, cpy::detail::no_async(&sim::set_ephemeris_writer),
+                      docstrings::sim_ephemeris_writer_docstring().c_str())
+        .def_property_readonly(
+            "output_errors",
+            [](const sim &s) {
+                cpy::detail::check_no_async_read(s);
+
+                py::list ret;
+
+                for (const auto &oe : s.get_output_errors()) {
+                    ret.append(py::make_tuple(oe.component, oe.time, oe.message, oe.count));
+                }
+
+                return ret;
+            },
+            docstrings::sim_output_errors_docstring().c_str())
+        .def("clear_output_errors", cpy::detail::no_async(&sim::clear_output_errors),
+             docstrings::sim_clear_output_errors_docstring().c_str())
+        .def_property_readonly("screening_volume", &sim::get_screening_volume, docstrings::sim_screening_volume_docstring().c_str())
+        .def_property_readonly("det_order", &sim::get_det_order, docstrings::sim_det_order_docstring().c_str())
+        .def("flush_conjunctions", cpy::detail::no_async(&sim::flush_conjunctions), docstrings::sim_flush_conjunctions_docstring().c_str())
+        // Incremental modifications of the set of particles.
+        .def(
+            "add_particles",
+            [](sim &s, const cpy::detail::c_array_t &state, const std::optional<cpy::detail::c_array_t> &pars) {
+                cpy::detail::check_no_async(s);
+
+                const auto state_vec = cpy::detail::flatten_2d_array(state, 7, "state");
+
+                std::vector<double> pars_vec;
+                if (pars) {
+                    pars_vec = cpy::detail::flatten_2d_array(*pars, boost::numeric_cast<py::ssize_t>(s.get_npars()),
+                                                             "array of parameter values");
+                }
+
+                py::gil_scoped_release release;
+
+                s.add_particles(state_vec, pars_vec);
+            },
+            "state"_a, "pars"_a = py::none{}, docstrings::sim_add_particles_docstring().c_str())
+        .def("remove_particles", cpy::detail::no_async(&sim::remove_particles), "idxs"_a, docstrings::sim_remove_particles_docstring().c_str())
+        .def(
+            "update_particles",
+            [](sim &s, const std::vector<sim::size_type> &idxs, const cpy::detail::c_array_t &state,
+               const std::optional<cpy::detail::c_array_t> &pars) {
+                cpy::detail::check_no_async(s);
+
+                const auto state_vec = cpy::detail::flatten_2d_array(state, 7, "state");
+
+                std::vector<double> pars_vec;
+                if (pars) {
+                    pars_vec = cpy::detail::flatten_2d_array(*pars, boost::numeric_cast<py::ssize_t>(s.get_npars()),
+                                                             "array of parameter values");
+                }
+
+                py::gil_scoped_release release;
+
+                s.update_particles(idxs, state_vec, pars_vec);
+            },
+            "idxs"_a, "state"_a, "pars"_a = py::none{}, docstrings::sim_update_particles_docstring().c_str())
+        // Pickle support.
+        .def(py::pickle(
+            [](const py::object &o) {
+                const auto &s = py::cast<const sim &>(o);
+
+                cpy::detail::check_no_async_read(s);
+
+                std::ostringstream oss;
+                {
+                    py::gil_scoped_release release;
+
+                    s.save_checkpoint(oss);
+                }
+
+                return py::make_tuple(py::bytes(oss.str()), o.attr("__dict__"));
+            },
+            [](const py::tuple &state) {
+                if (py::len(state) != 2) {
+                    throw std::invalid_argument(fmt::format(
+                        "The state tuple passed to the deserialization wrapper must have 2 elements, but "
+                        "instead it has {} element(s)",
+                        py::len(state)));
+                }
+
+                std::istringstream iss(py::cast<std::string>(state[0]));
+
+                auto s = [&]() {
+                    py::gil_scoped_release release;
+
+                    return sim::load_checkpoint(iss);
+                }();
+
+                return std::make_pair(std::move(s), py::cast<py::dict>(state[1]));
+            }))
         // Repr.
         .def("__repr__", [](const sim &s) {
+            // NOTE: the representation contains the dynamical
+            // data, which cannot be accessed while an asynchronous
+            // operation is running.
+            if (s.async_running()) {
+                return std::string("cascade simulation (asynchronous operation running)");
+            }
+
             std::ostringstream oss;
             oss << s;
             return oss.str();
         });
 
+    // Handle to an asynchronous operation on a sim.
+    py::class_<std::shared_future<outcome>>(m, "_async_op")
+        .def("done",
+             [](const std::shared_future<outcome> &f) {
+                 return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+             })
+        .def(
+            "wait", [](const std::shared_future<outcome> &f) { return f.get(); },
+            py::call_guard<py::gil_scoped_release>());
+
+    // Ensemble.
+    py::class_<ensemble>(m, "ensemble", docstrings::ensemble_docstring().c_str())
+        .def(py::init([](const sim &proto, const std::vector<cpy::detail::c_array_t> &states,
+                         const std::optional<std::vector<cpy::detail::c_array_t>> &pars_) {
+                 std::vector<std::vector<double>> state_vecs, pars_vecs;
+
+                 for (const auto &st : states) {
+                     state_vecs.push_back(cpy::detail::flatten_2d_array(st, 7, "state"));
+                 }
+
+                 if (pars_) {
+                     for (const auto &p : *pars_) {
+                         pars_vecs.push_back(cpy::detail::flatten_2d_array(
+                             p, boost::numeric_cast<py::ssize_t>(proto.get_npars()), "array of parameter values"));
+                     }
+                 }
+
+                 py::gil_scoped_release release;
+
+                 return ensemble(proto, std::move(state_vecs), std::move(pars_vecs));
+             }),
+             "sim"_a, "states"_a, "pars"_a = py::none{})
+        .def("__len__", &ensemble::get_size)
+        .def(
+            "__getitem__",
+            [](ensemble &e, ensemble::size_type i) -> sim & { return e.get_member(i); },
+            "i"_a, py::return_value_policy::reference_internal)
+        .def(
+            "propagate_until",
+            [](ensemble &e, double t) {
+                py::gil_scoped_release release;
+
+                e.propagate_until(t);
+            },
+            "t"_a)
+        .def_property_readonly("summaries", [](const ensemble &e) {
+            const auto &sms = e.get_summaries();
+            const auto n = boost::numeric_cast<py::ssize_t>(sms.size());
+
+            py::list oc;
+            py::array_t<ensemble::size_type> n_collisions(n), n_reentries(n), n_exits(n), n_conjunctions(n);
+
+            for (py::ssize_t i = 0; i < n; ++i) {
+                const auto &sm = sms[static_cast<decltype(sms.size())>(i)];
+
+                oc.append(sm.oc);
+                n_collisions.mutable_at(i) = sm.n_collisions;
+                n_reentries.mutable_at(i) = sm.n_reentries;
+                n_exits.mutable_at(i) = sm.n_exits;
+                n_conjunctions.mutable_at(i) = sm.n_conjunctions;
+            }
+
+            py::dict ret;
+            ret["outcome"] = oc;
+            ret["n_collisions"] = n_collisions;
+            ret["n_reentries"] = n_reentries;
+            ret["n_exits"] = n_exits;
+            ret["n_conjunctions"] = n_conjunctions;
+
+            return ret;
+        });
+
+    // Loaders.
+    m.def(
+        "load_text",
+        [](const std::string &path) {
+            std::vector<double> ret;
+
+            {
+                py::gil_scoped_release release;
+
+                ret = io::load_text(path);
+            }
+
+            return cpy::detail::vector_to_array(std::move(ret));
+        },
+        "path"_a, docstrings::load_text_docstring().c_str());
+    m.def(
+        "load_hdf5",
+        [](const std::string &path, const std::string &dataset) {
+            std::vector<double> ret;
+
+            {
+                py::gil_scoped_release release;
+
+                ret = io::load_hdf5(path, dataset);
+            }
+
+            return cpy::detail::vector_to_array(std::move(ret));
+        },
+        "path"_a, "dataset"_a, docstrings::load_hdf5_docstring().c_str());
+
+    // JIT cache.
+    m.def("set_jit_cache_dir", &jit_cache::set_dir, "path"_a, docstrings::set_jit_cache_dir_docstring().c_str());
+    m.def("get_jit_cache_dir", &jit_cache::get_dir, docstrings::get_jit_cache_dir_docstring().c_str());
+    m.def("set_jit_cache_max_size", &jit_cache::set_max_size, "size"_a,
+          docstrings::set_jit_cache_max_size_docstring().c_str());
+    m.def("get_jit_cache_max_size", &jit_cache::get_max_size, docstrings::get_jit_cache_max_size_docstring().c_str());
+    m.def("set_jit_cache_precompiled_dir", &jit_cache::set_precompiled_dir, "path"_a,
+          docstrings::set_jit_cache_precompiled_dir_docstring().c_str());
+    m.def("get_jit_cache_precompiled_dir", &jit_cache::get_precompiled_dir,
+          docstrings::get_jit_cache_precompiled_dir_docstring().c_str());
+    m.def("get_jit_cache_size", &jit_cache::get_size, docstrings::get_jit_cache_size_docstring().c_str());
+    m.def("clear_jit_cache", &jit_cache::clear, docstrings::clear_jit_cache_docstring().c_str());
+
     m.def("set_nthreads", [](std::size_t n) {
         if (n == 0u) {
             cpy::detail::tbb_gc.reset();
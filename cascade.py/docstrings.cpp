@@ -48,6 +48,215 @@ typing.List[typing.Tuple[heyoka.expression, heyoka.expression]]
 )";
 }
 
+std::string load_text_docstring()
+{
+    return R"(load_text(path: str) -> numpy.ndarray
+
+Load floating-point values from a text file
+
+This function loads the whitespace-separated floating-point values contained in the text file
+at ``path`` (e.g., a file containing one value per line). The file is memory-mapped and parsed
+in parallel, and the values are returned in a one-dimensional array without further copies.
+
+The returned array can be reshaped into a state array via ``reshape(-1, 7)``.
+
+Parameters
+----------
+
+path: str
+    The path to the text file.
+
+Returns
+-------
+
+numpy.ndarray
+    The values contained in the file.
+
+Raises
+------
+
+ValueError
+    if the file cannot be opened or if it contains invalid values.
+
+)";
+}
+
+std::string load_hdf5_docstring()
+{
+    return R"(load_hdf5(path: str, dataset: str) -> numpy.ndarray
+
+Load a floating-point dataset from an HDF5 file
+
+This function loads the floating-point dataset named ``dataset`` from the HDF5 file
+at ``path``. The values are read directly into a one-dimensional array (in row-major order).
+
+This function is available only if cascade was built with HDF5 support.
+
+Parameters
+----------
+
+path: str
+    The path to the HDF5 file.
+dataset: str
+    The name of the dataset.
+
+Returns
+-------
+
+numpy.ndarray
+    The values of the dataset.
+
+Raises
+------
+
+ValueError
+    if the file cannot be opened, or if the dataset does not exist or does not contain floating-point values.
+RuntimeError
+    if cascade was built without HDF5 support.
+
+)";
+}
+
+std::string set_jit_cache_dir_docstring()
+{
+    return R"(set_jit_cache_dir(path: str) -> None
+
+Set the directory of the JIT cache
+
+The JIT cache stores on disk the integrators and the JIT-compiled functions
+created during the construction of a :class:`~cascade.sim`. The entries are keyed by the dynamics,
+the event equations, the integrator settings, the heyoka version and the features of the host CPU,
+so that the construction of a simulation with the same setup (possibly in a different process) loads
+the compiled code from the cache instead of compiling it again.
+
+The directory is created if it does not exist. An empty ``path`` disables the cache.
+The initial value of the cache directory is read from the ``CASCADE_JIT_CACHE_DIR``
+environment variable (if the variable is not set, the cache is disabled).
+
+Parameters
+----------
+
+path: str
+    The path to the cache directory.
+
+)";
+}
+
+std::string get_jit_cache_dir_docstring()
+{
+    return R"(get_jit_cache_dir() -> str
+
+Get the directory of the JIT cache
+
+See :func:`~cascade.set_jit_cache_dir()` for a description of the JIT cache.
+
+Returns
+-------
+
+str
+    The path to the cache directory (an empty string if the cache is disabled).
+
+)";
+}
+
+std::string set_jit_cache_max_size_docstring()
+{
+    return R"(set_jit_cache_max_size(size: int) -> None
+
+Set the maximum size of the JIT cache
+
+Whenever a new entry is added to the JIT cache, the least-recently used entries are removed
+until the total size of the cache does not exceed ``size``. The default maximum size is 1 GiB.
+
+Parameters
+----------
+
+size: int
+    The maximum size of the cache in bytes.
+
+)";
+}
+
+std::string get_jit_cache_max_size_docstring()
+{
+    return R"(get_jit_cache_max_size() -> int
+
+Get the maximum size of the JIT cache
+
+Returns
+-------
+
+int
+    The maximum size of the cache in bytes.
+
+)";
+}
+
+std::string set_jit_cache_precompiled_dir_docstring()
+{
+    return R"(set_jit_cache_precompiled_dir(path: str) -> None
+
+Set the directory of the precompiled JIT cache entries
+
+When cascade is built with the ``CASCADE_PRECOMPILE_JIT`` option, the compiled code for the
+standard Keplerian dynamics (see :func:`~cascade.dynamics.kepler()`) is generated at build time
+and installed alongside the library. The precompiled entries are looked up after the
+JIT cache directory (see :func:`~cascade.set_jit_cache_dir()`) and they are never modified.
+They are used only on machines with the same CPU features and heyoka version as the build machine.
+
+An empty ``path`` disables the lookup of the precompiled entries (this is the
+initial value if cascade was built without the ``CASCADE_PRECOMPILE_JIT`` option).
+
+Parameters
+----------
+
+path: str
+    The path to the directory of the precompiled entries.
+
+)";
+}
+
+std::string get_jit_cache_precompiled_dir_docstring()
+{
+    return R"(get_jit_cache_precompiled_dir() -> str
+
+Get the directory of the precompiled JIT cache entries
+
+See :func:`~cascade.set_jit_cache_precompiled_dir()`.
+
+Returns
+-------
+
+str
+    The path to the directory of the precompiled entries (an empty string if the lookup is disabled).
+
+)";
+}
+
+std::string get_jit_cache_size_docstring()
+{
+    return R"(get_jit_cache_size() -> int
+
+Get the current size of the JIT cache
+
+Returns
+-------
+
+int
+    The total size in bytes of the entries in the cache directory.
+
+)";
+}
+
+std::string clear_jit_cache_docstring()
+{
+    return R"(clear_jit_cache() -> None
+
+Remove all the entries from the JIT cache
+
+)";
+}
+
 std::string outcome_docstring()
 {
     return R"(The simulation outcome enum
@@ -68,6 +277,458 @@ The possible values for the enum are:
 )";
 }
 
+std::string conj_aggr_mode_docstring()
+{
+    return R"(The conjunction aggregation mode enum
+
+This enum is used to select how the conjunctions detected by a :class:`~cascade.sim`
+are recorded (see :attr:`cascade.sim.conj_aggr`).
+
+The possible values for the enum are:
+
+- ``none``, indicating that every minimum of the mutual distance below the conjunction
+  threshold is recorded as a separate conjunction (the default),
+- ``superstep``, indicating that, for each pair of particles, only the closest approach
+  within each superstep is recorded,
+- ``window``, indicating that, for each pair of particles, only the closest approach
+  within each aggregation window of length :attr:`cascade.sim.conj_aggr_window` is recorded.
+
+)";
+}
+
+std::string conj_sink_docstring()
+{
+    return R"(Base class for conjunction sinks
+
+A conjunction sink receives the conjunctions detected by a :class:`~cascade.sim`
+(see :attr:`cascade.sim.conj_sink`). The available sinks are:
+
+- :class:`~cascade.memory_conj_sink`, which stores the conjunctions in memory,
+- :class:`~cascade.file_conj_sink`, which writes the conjunctions to a binary file
+  that can be read back via :func:`numpy.fromfile()` using the dtype
+  of :attr:`cascade.sim.conjunctions`,
+- :class:`~cascade.counting_conj_sink`, which only counts the conjunctions,
+- :class:`~cascade.ring_conj_sink`, which stores the conjunctions in a fixed-size
+  lock-free ring buffer, from which they can be retrieved via ``pop_all()``. If the ring
+  buffer is full, the new conjunctions are discarded and counted in ``n_dropped``,
+- :class:`~cascade.conj_log_sink`, which appends the conjunctions to a memory-mapped log file,
+- :class:`~cascade.conj_store`, which stores the conjunctions in memory and indexes them
+  by particle and by time.
+
+)";
+}
+
+std::string conj_log_sink_docstring()
+{
+    return R"(__init__(path: str, append: bool = False)
+
+Memory-mapped conjunction log
+
+This sink appends the conjunctions to an on-disk log file via memory mapping. The log file
+contains a header (with the format version, the record size, the number of records and a
+description of the record layout) followed by the conjunction records, which use the same
+layout as the dtype of :attr:`cascade.sim.conjunctions`. An index file, whose path is
+``path`` with the ``.idx`` suffix, stores the time coordinate of one record every 1024.
+
+The flushing of the data to disk is performed by a background thread, so that it overlaps
+with the propagation of the simulation. The ``flush()`` method waits for the
+completion of the flushing, while ``close()`` also trims the space preallocated at the end of
+the log file. The log file can be opened for reading, also while it is being written, via
+:func:`~cascade.read_conj_log()`.
+
+Parameters
+----------
+
+path: str
+    The path of the log file.
+append: bool = False
+    If ``True`` and the log file exists, the new conjunctions will be appended to it.
+    Otherwise, the log file is created anew.
+
+Raises
+------
+
+ValueError
+    if the log file cannot be created, or if ``append`` is ``True`` and the existing
+    file is not a valid conjunction log.
+
+)";
+}
+
+std::string conj_store_docstring()
+{
+    return R"(__init__(bucket_width: float = 1.)
+
+Indexed conjunction store
+
+This sink stores the conjunctions in memory, in chronological order, together with
+indices which allow to efficiently query the conjunctions involving a particle,
+the conjunctions between a pair of particles and the conjunctions within a time range.
+
+In the store, the particles are identified by keys, which are the particle ids (see :attr:`~cascade.sim.ids`).
+Unlike the particle indices in a :class:`~cascade.sim`, the keys do not change when particles are removed
+from the simulation via :meth:`~cascade.sim.remove_particles()`. The conjunctions are stored unmodified:
+the keys of the particles are in the ``id_i`` and ``id_j`` fields, while the ``i`` and ``j`` fields contain
+the indices of the particles at the time the conjunction was detected. The conjunctions involving removed particles
+are kept in the store.
+
+The ids of the conjunctions (i.e., their positions in :attr:`~cascade.conj_store.conjunctions`)
+involving a particle are returned by ``particle_conj_ids(key)``, while the ids of the conjunctions
+between two particles are returned by ``pair_conj_ids(key_a, key_b)``. ``time_range(t_begin, t_end)``
+returns the conjunctions whose time coordinate is in the :math:`\left[ t_{begin}, t_{end} \right)` range.
+The time range queries use an index of time buckets of width ``bucket_width``.
+
+``conjunctions``, ``particle_conj_ids()`` and ``time_range()`` return read-only views on the data
+in the store, without copying it.
+
+Parameters
+----------
+
+bucket_width: float = 1.
+    The width of the time buckets.
+
+Raises
+------
+
+ValueError
+    if ``bucket_width`` is not finite and positive.
+
+)";
+}
+
+std::string snapshot_writer_docstring()
+{
+    return R"(__init__(path: str, snap_every: int = 1, snap_times: typing.List[float] = [], compression: int = 0, queue_size: int = 2)
+
+Asynchronous HDF5 snapshot writer
+
+When set as the :attr:`~cascade.sim.snapshot_writer` of a :class:`~cascade.sim`, this
+class writes snapshots of the time coordinate, of the state and of the parameters of the
+simulation to the HDF5 file at ``path``. A snapshot is taken at the end of every ``snap_every``
+steps (unless ``snap_every`` is zero) and at the time coordinates in ``snap_times``, using
+dense output. The snapshot times preceding the time coordinate of the simulation are ignored.
+
+The snapshots are copied into a pool of ``queue_size`` buffers (double buffering by default)
+and written to disk by a background thread, so that the writing overlaps with the propagation
+of the simulation. The propagation blocks only if all the buffers are in use.
+
+The HDF5 file contains the chunked, extendable datasets ``time`` (with shape ``(n,)``),
+``state`` (with shape ``(n, nparts, 7)``) and, if the simulation has parameters, ``pars``
+(with shape ``(n, nparts, npars)``), where ``n`` is the number of snapshots.
+The number of particles and parameters cannot change between snapshots. The ``flush()``
+method waits until all the queued snapshots have been written, while ``close()``
+also closes the HDF5 file.
+
+.. note::
+
+   This class is available only if cascade was built with HDF5 support.
+
+Parameters
+----------
+
+path: str
+    The path of the HDF5 file. An existing file will be overwritten.
+snap_every: int = 1
+    The number of steps between snapshots (zero disables the step-based snapshots).
+snap_times: typing.List[float] = []
+    The time coordinates of the additional snapshots.
+compression: int = 0
+    The deflate compression level, in the :math:`\left[ 0, 9 \right]` range (zero disables compression).
+queue_size: int = 2
+    The number of snapshot buffers.
+
+Raises
+------
+
+ValueError
+    if the HDF5 file cannot be created, or if the arguments are invalid.
+RuntimeError
+    if cascade was built without HDF5 support.
+
+)";
+}
+
+std::string checkpointer_docstring()
+{
+    return R"(__init__(path: str, ckpt_every: int = 1, xor_delta: bool = True)
+
+Incremental checkpoint writer
+
+This class writes a chain of checkpoint records of a :class:`~cascade.sim` to the file at ``path``.
+A *base* record is a full checkpoint of the simulation (equivalent to its pickled representation),
+while a *delta* record contains only the data which may change after the construction of
+a simulation:
+
+- the time coordinate, the interrupt info, the settings which can be changed after construction
+  (collisional timestep, conjunction thresholds, whitelists, etc.) and the pending aggregated
+  conjunctions,
+- the log of the particle removals since the previous record,
+- the state and parameters arrays,
+- the conjunctions detected since the previous record.
+
+If ``xor_delta`` is ``True``, the state and parameters arrays are stored as the bitwise XOR
+against the arrays of the previous record, with the leading zero bytes of each XORed value
+dropped. This considerably reduces the size of the quantities which change slowly or not at all
+(e.g., the particle sizes and the parameters).
+
+When set as the :attr:`~cascade.sim.checkpointer` of a :class:`~cascade.sim`, a record is written
+at the end of every ``ckpt_every`` steps (unless ``ckpt_every`` is zero). Records can also be written
+explicitly via the ``write()`` and ``write_base()`` methods. The first record is always a base record.
+
+The static method ``restore()`` rebuilds a simulation from a checkpoint file, replaying the
+chain of records starting from the last base record. An incomplete record at the end of the file
+(e.g., due to an interruption while writing) is ignored.
+
+Parameters
+----------
+
+path: str
+    The path of the checkpoint file. An existing file will be overwritten.
+ckpt_every: int = 1
+    The number of steps between records (zero disables the step-based records).
+xor_delta: bool = True
+    Whether to XOR-encode the state and parameters arrays in the delta records.
+
+Raises
+------
+
+ValueError
+    if the checkpoint file cannot be created.
+
+)";
+}
+
+std::string ephemeris_writer_docstring()
+{
+    return R"(__init__(path: str, cheby_tol: float = 0.)
+
+Ephemeris archive writer
+
+When set as the :attr:`~cascade.sim.ephemeris_writer` of a :class:`~cascade.sim`, this class appends
+to the file at ``path`` a block at the end of each step. A block contains the trajectories of the particles
+computed during the superstep as piecewise polynomials, which can later be evaluated at any time
+via an :class:`~cascade.ephemeris_reader` without re-propagating.
+
+If ``cheby_tol`` is zero, the Taylor polynomials of the position and velocity of the particles in each
+substep are stored, that is, the archive contains the exact trajectories computed by the simulation.
+Otherwise, the trajectories are re-fitted over each collisional timestep with Chebyshev series of the
+lowest degree meeting the tolerance ``cheby_tol`` on the positions (and the tolerance
+``cheby_tol / (dt / 2)`` on the velocities, where ``dt`` is the size of the fitting interval).
+This representation is usually much more compact.
+
+The blocks are not compressed, so that they can be evaluated directly from a memory
+mapping of the file. The particle indices in a block are the indices of the particles
+in the simulation at the time of the superstep.
+
+Parameters
+----------
+
+path: str
+    The path of the ephemeris file. An existing file will be overwritten.
+cheby_tol: float = 0.
+    The tolerance of the Chebyshev re-fitting (zero to store the Taylor polynomials).
+
+Raises
+------
+
+ValueError
+    if the ephemeris file cannot be created, or if ``cheby_tol`` is negative or not finite.
+
+)";
+}
+
+std::string ensemble_docstring()
+{
+    return R"(__init__(sim: cascade.sim, states: typing.List[numpy.ndarray], pars: typing.Optional[typing.List[numpy.ndarray]] = None)
+
+Ensemble of simulations
+
+An ensemble is a collection of simulations (the *members*) which differ only in the initial
+state and, optionally, in the values of the parameters, e.g., for Monte Carlo studies. The members
+are copies of the prototype simulation *sim* whose state and parameters are replaced with the
+arrays in *states* and *pars*. Thus, the members share the compiled code and the settings of the
+prototype. The conjunction sink, the snapshot writer, the checkpointer and the ephemeris writer
+of the prototype are not copied, but they can be set up on each member separately.
+
+The members can be accessed via the indexing operator. The ``propagate_until()`` method
+propagates all the members concurrently up to the time ``t``. The collisions, reentries and exits
+are handled within each member by removing the particles involved and resuming the propagation,
+while a member producing a non-finite state is stopped. The ``summaries`` property returns
+a dictionary with the per-member outcome of the last propagation (``"outcome"``)
+and the per-member counts of collisions, reentries, exits and conjunctions
+(``"n_collisions"``, ``"n_reentries"``, ``"n_exits"`` and ``"n_conjunctions"``).
+
+Parameters
+----------
+
+sim: cascade.sim
+    The prototype simulation.
+states: list[numpy.ndarray]
+    The initial states of the members.
+pars: typing.Optional[list[numpy.ndarray]] = None
+    The values of the parameters of the members.
+
+Raises
+------
+
+ValueError
+    if the number of arrays in *pars* differs from the number of arrays in *states*,
+    or if the shapes of the arrays are invalid.
+
+)";
+}
+
+std::string ephemeris_reader_docstring()
+{
+    return R"(__init__(path: str)
+
+Ephemeris archive reader
+
+This class memory-maps an ephemeris archive written by an :class:`~cascade.ephemeris_writer`
+and evaluates the state of the particles at arbitrary times. The state of a particle at the time ``t``
+is computed from the last block whose superstep begins at or before ``t``, via the evaluation of the
+polynomials of the block at ``t``. The ``state()`` method returns the state
+``[x, y, z, vx, vy, vz]`` of a single particle, while the ``states()`` method returns
+a 2D array with shape ``(n, 6)`` containing either the states of all the particles at a single time,
+or the states of the particles at the indices ``pidxs`` at the corresponding times ``times``.
+
+The particle indices refer to the particles in the simulation at the time of the query, and they
+change when particles are removed from the simulation. Each block of the archive also records the
+particle ids (see :attr:`~cascade.sim.ids`), which instead identify the particles across the whole archive.
+The ``ids(t)`` method returns the ids of the particles at the time ``t``, ``id_to_index(id, t)`` returns
+the index of the particle with the given id at the time ``t``, and ``state_by_id(id, t)`` returns
+the state of the particle with the given id at the time ``t``.
+
+Only the blocks which are complete at the time of construction are read.
+
+Parameters
+----------
+
+path: str
+    The path of the ephemeris file.
+
+Raises
+------
+
+ValueError
+    if the file cannot be opened or if it is not a valid ephemeris archive.
+
+)";
+}
+
+std::string screening_volume_docstring()
+{
+    return R"(__init__(predicates: typing.List[heyoka.expression], bounding_radius: float)
+
+Conjunction screening volume
+
+A screening volume is a region of space centred on the *primary* particle of a pair
+of particles. The volume is defined by a list of predicates, formulated via the
+`heyoka.py <https://github.com/bluescarni/heyoka.py>`__ expression system: the *secondary*
+particle is within the volume when all predicates evaluate to a negative value.
+
+The predicates can depend on the Cartesian state of the primary particle (via the variables
+``x``, ``y``, ``z``, ``vx``, ``vy``, ``vz``) and on the Cartesian state of the secondary particle
+relative to the primary (via the variables ``dx``, ``dy``, ``dz``, ``dvx``, ``dvy``, ``dvz``).
+The bounding radius is the radius of a sphere, centred on the primary, which fully
+contains the screening volume.
+
+If only one particle of a pair is in the conjunction whitelist, that particle is the primary.
+Otherwise, the primary is the particle with the lower index.
+
+When a screening volume is used, a conjunction is the point of closest approach
+while the secondary is within the volume: it is either a minimum of the mutual distance
+at which the secondary is within the volume, or the point at which the secondary enters
+the volume while the distance is increasing (or exits the volume while the distance is
+decreasing). In both cases, the distance must also be less than the conjunction threshold.
+
+Parameters
+----------
+
+predicates: typing.List[heyoka.expression]
+    The list of predicates.
+bounding_radius: float
+    The bounding radius.
+
+Raises
+------
+
+ValueError
+    if the list of predicates is empty, if the bounding radius is not finite and
+    positive, or if the predicates contain runtime parameters or variables
+    other than the ones listed above.
+
+)";
+}
+
+std::string screening_volume_ric_ellipsoid_docstring()
+{
+    return R"(ric_ellipsoid(r: float, i: float, c: float) -> cascade.screening_volume
+
+Ellipsoidal screening volume in the RIC frame
+
+This method will create an ellipsoidal screening volume whose semi-axes are aligned
+with the radial, in-track and cross-track directions of the primary particle.
+
+Parameters
+----------
+
+r: float
+    The radial semi-axis.
+i: float
+    The in-track semi-axis.
+c: float
+    The cross-track semi-axis.
+
+Returns
+-------
+
+cascade.screening_volume
+    The screening volume.
+
+Raises
+------
+
+ValueError
+    if any semi-axis is not finite and positive.
+
+)";
+}
+
+std::string screening_volume_ric_box_docstring()
+{
+    return R"(ric_box(r: float, i: float, c: float) -> cascade.screening_volume
+
+Box-shaped screening volume in the RIC frame
+
+This method will create a box-shaped screening volume whose sides are aligned
+with the radial, in-track and cross-track directions of the primary particle.
+
+Parameters
+----------
+
+r: float
+    The radial half-side.
+i: float
+    The in-track half-side.
+c: float
+    The cross-track half-side.
+
+Returns
+-------
+
+cascade.screening_volume
+    The screening volume.
+
+Raises
+------
+
+ValueError
+    if any half-side is not finite and positive.
+
+)";
+}
+
 std::string sim_docstring()
 {
     return R"(The simulation class
@@ -87,12 +748,16 @@ can be formulated via the `heyoka.py <https://github.com/bluescarni/heyoka.py>`_
 Alternatively, ready-made dynamical equations for a variety of use cases are available in the
 :mod:`cascade.dynamics` module.
 
+Simulations can be pickled. The pickled representation includes the compiled code
+of the dynamics, so that unpickling a simulation does not require any JIT compilation.
+Note that the conjunction sink and the snapshot writer (if any) are not pickled.
+
 )";
 }
 
 std::string sim_init_docstring()
 {
-    return R"(__init__(state: numpy.ndarray[numpy.double], ct: float, dyn: typing.Optional[typing.List[typing.Tuple[heyoka.expression, heyoka.expression]]] = None, reentry_radius: typing.Optional[float | typing.List[float]] = None, exit_radius: typing.Optional[float] = None, pars: typing.Optional[numpy.ndarray[numpy.double]] = None, tol: typing.Optional[float] = None, high_accuracy: bool = False, n_par_ct: int = 1, conj_thresh: float = 0.0, min_coll_radius: float = 0.0, coll_whitelist: typing.Set[int] = set(), conj_whitelist: typing.Set[int] = set())
+    return R"(__init__(state: numpy.ndarray[numpy.double], ct: float, dyn: typing.Optional[typing.List[typing.Tuple[heyoka.expression, heyoka.expression]]] = None, reentry_radius: typing.Optional[float | typing.List[float]] = None, exit_radius: typing.Optional[float] = None, pars: typing.Optional[numpy.ndarray[numpy.double]] = None, tol: typing.Optional[float] = None, high_accuracy: bool = False, n_par_ct: int = 1, conj_thresh: float | typing.List[float] = 0.0, min_coll_radius: float = 0.0, coll_whitelist: typing.Set[int] = set(), conj_whitelist: typing.Set[int] = set(), conj_aggr: cascade.conj_aggr_mode = cascade.conj_aggr_mode.none, conj_aggr_window: float = 0.0, screening_volume: typing.Optional[cascade.screening_volume] = None, det_order: int = 0, coll_whitelist_ids: typing.Optional[typing.Set[int]] = None, conj_whitelist_ids: typing.Optional[typing.Set[int]] = None)
 
 Constructor
 
@@ -109,6 +774,9 @@ state: numpy.ndarray[numpy.double]
     the first 6 columns contain the cartesian state variables :math:`\left( x,y,z,v_x,v_y,v_z \right)`
     of each particle, and the seventh column contains the particle sizes.
 
+    The array is copied into the simulation. C-contiguous arrays of double-precision values
+    are copied directly, while other inputs are converted first.
+
     After construction, the state vector can be accessed via the :attr:`state` attribute.
 ct: float
     The length in time units of the collisional timestep. Must be positive and finite.
@@ -157,11 +825,15 @@ n_par_ct: int = 1
     can greatly influence its performance. The optimal value of this parameter
     depends heavily on the specifics of the simulation, and thus users are advised
     to experiment with different values to determine which one works best.
-conj_thresh: float = 0.0
+conj_thresh: float | typing.List[float] = 0.0
     Conjunction threshold. Conjunctions are tracked only if the conjunction distance
     is less than this threshold. By default, this value is set to zero, which means
     that conjunction tracking is disabled. The conjunction threshold can be changed
     at any time via the ``conj_thresh`` attribute.
+
+    If a list of values is provided, then each value defines a conjunction tier
+    (see :attr:`conj_tiers`), and the conjunction threshold is the largest value
+    in the list.
 min_coll_radius: float = 0.0
     Minimum collisional radius. A collision between two particles is detected
     only if the radius of at least one particle is greater than this value. By default,
@@ -179,6 +851,29 @@ conj_whitelist: typing.Set[int] = set()
     detected only if at least one particle is in the whitelist. By default, the conjunction
     whitelist is empty, which means that the whitelisting mechanism is disabled. The
     conjunction whitelist can be changed at any time via the ``conj_whitelist`` attribute.
+conj_aggr: cascade.conj_aggr_mode = cascade.conj_aggr_mode.none
+    Conjunction aggregation mode. See :attr:`conj_aggr`.
+conj_aggr_window: float = 0.0
+    Conjunction aggregation window. This value must be positive if the aggregation
+    mode is ``window``. The aggregation window can be changed at any time via the
+    ``conj_aggr_window`` attribute.
+screening_volume: typing.Optional[cascade.screening_volume] = None
+    Conjunction screening volume. If provided, a conjunction is detected only if,
+    at the time of closest approach, the secondary particle is within the screening
+    volume centred on the primary particle. The screening volume cannot be changed
+    after construction.
+det_order: int = 0
+    Detection order. If nonzero and less than the order of the numerical integrator,
+    the trajectories are economised to polynomials of this degree, which are used to screen
+    the pairs of particles during collision and conjunction detection (see :attr:`det_order`).
+    The detection order must be either zero or at least 2, and it cannot be changed after
+    construction.
+coll_whitelist_ids: typing.Optional[typing.Set[int]] = None
+    Collision whitelist expressed via particle ids (see :attr:`ids`). If provided, it
+    is converted to the particle indices and it is used in place of *coll_whitelist*.
+conj_whitelist_ids: typing.Optional[typing.Set[int]] = None
+    Conjunction whitelist expressed via particle ids (see :attr:`ids`). If provided, it
+    is converted to the particle indices and it is used in place of *conj_whitelist*.
 
 )";
 }
@@ -209,11 +904,301 @@ the detection of conjunction events.
 )";
 }
 
+std::string sim_conj_tiers_docstring()
+{
+    return R"(Conjunction tiers
+
+This :class:`list` contains the conjunction thresholds of the conjunction tiers, sorted in
+strictly ascending order. The largest value in the list is the conjunction threshold
+(see the ``conj_thresh`` attribute), and an empty list means that conjunction tracking is
+disabled.
+
+All tiers are classified in a single pass: the ``tier`` field of each detected conjunction
+contains the index of the smallest threshold greater than the conjunction distance. The number
+of conjunctions recorded in each tier is available via the ``conj_tier_counts`` attribute.
+When conjunction aggregation is active (see :attr:`conj_aggr`), the closest approaches are
+aggregated separately for each tier, and the ``time_under`` field contains the time spent
+below the threshold of the conjunction's tier.
+
+Setting new conjunction tiers flushes the pending aggregated conjunctions and resets
+the per-tier counters.
+
+)";
+}
+
+std::string sim_conj_aggr_docstring()
+{
+    return R"(Conjunction aggregation mode
+
+In long simulations, pairs of particles flying in close formation can generate a distance
+minimum below the conjunction threshold at every orbit, flooding the list of :attr:`conjunctions`.
+When aggregation is active, for each pair of particles only the closest approach within each
+aggregation period (either a superstep or a time window of length :attr:`conj_aggr_window`)
+is recorded. The ``n_min`` and ``time_under`` fields of the recorded conjunction contain
+respectively the number of distance minima below the threshold and the total time spent below the
+threshold by the pair of particles within the aggregation period.
+
+The closest approaches are added to :attr:`conjunctions` only when the simulation time moves
+past the end of their aggregation period. The number of closest approaches not yet added is
+available via the ``n_pending_conjunctions`` attribute, and :meth:`flush_conjunctions()` can be
+used to add them immediately. Changing the aggregation mode or window flushes the
+pending closest approaches.
+
+)";
+}
+
+std::string sim_flush_conjunctions_docstring()
+{
+    return R"(flush_conjunctions() -> None
+
+Flush the pending aggregated conjunctions
+
+This method will append to :attr:`conjunctions` the closest approaches whose aggregation
+period is not yet closed (see :attr:`conj_aggr`).
+
+)";
+}
+
+std::string sim_screening_volume_docstring()
+{
+    return R"(Conjunction screening volume
+
+The screening volume passed to the constructor, or ``None`` if no screening
+volume was provided.
+
+)";
+}
+
+std::string sim_det_order_docstring()
+{
+    return R"(Detection order
+
+The polynomials used to detect collisions and conjunctions have by default the same degree as the
+numerical integrator, which is determined by the integration tolerance. When the detection order
+is nonzero and less than the order of the integrator, at the end of the numerical integration
+the trajectories are economised, via Chebyshev economisation, to polynomials of degree equal
+to the detection order, and a rigorous upper bound on the economisation error is computed.
+
+In the narrow phase, polynomial root finding is first run on the economised polynomials, with the
+collision and conjunction radiuses enlarged by the economisation error (and by a bound on the rounding
+errors). This determines, for each pair of particles, the time range (if any) in which the particles
+can get close enough to collide or to be involved in a conjunction. Collisions and conjunctions
+are then searched for via polynomial root finding on the full-order polynomials only within such time
+range. Thus, up to floating-point rounding, the detection order does not change the results of the
+simulation, and it improves performance when most of the candidate pairs are discarded or
+confined to short time ranges by the economised polynomials.
+
+A value of zero (the default) disables the economisation.
+
+)";
+}
+
+std::string sim_conj_sink_docstring()
+{
+    return R"(Conjunction sink
+
+If a :class:`~cascade.conj_sink` is set, at the end of each step the detected conjunctions
+are pushed to the sink in chronological order, and they are then removed from
+:attr:`conjunctions`. This allows to keep the memory usage bounded in long simulations.
+The conjunctions already present in :attr:`conjunctions` when the sink is set are
+pushed at the end of the next step.
+
+If the sink raises an exception, the exception is not propagated: the step is completed
+normally, the error is recorded in :attr:`output_errors`, and the conjunctions are kept
+in :attr:`conjunctions` and pushed again at the end of the next step.
+
+The sink is not copied when the simulation is copied. Setting this attribute to ``None``
+disables the sink.
+
+)";
+}
+
+std::string sim_snapshot_writer_docstring()
+{
+    return R"(Snapshot writer
+
+If a :class:`~cascade.snapshot_writer` is set, at the end of each step the snapshots of the
+state of the simulation which are due are handed over to the writer (see the documentation of
+:class:`~cascade.snapshot_writer`).
+
+The writer is not copied when the simulation is copied. Setting this attribute to ``None``
+disables the writer.
+
+)";
+}
+
+std::string sim_checkpointer_docstring()
+{
+    return R"(Checkpointer
+
+If a :class:`~cascade.checkpointer` is set, the simulation is checkpointed at the end of the
+steps requested by the checkpointer (see the documentation of :class:`~cascade.checkpointer`).
+The first record written after setting this attribute is a base record.
+
+The checkpointer is not copied when the simulation is copied. Setting this attribute to ``None``
+disables the checkpointer.
+
+)";
+}
+
+std::string sim_ephemeris_writer_docstring()
+{
+    return R"(Ephemeris writer
+
+If an :class:`~cascade.ephemeris_writer` is set, the trajectories of the particles computed in each
+step are appended to the ephemeris archive (see the documentation of :class:`~cascade.ephemeris_writer`).
+
+The writer is not copied when the simulation is copied. Setting this attribute to ``None``
+disables the writer.
+
+)";
+}
+
 std::string sim_interrupt_info_docstring()
 {
     return "Interrupt info";
 }
 
+std::string sim_async_snapshot_docstring()
+{
+    return R"(Snapshot taken at the launch of the last asynchronous operation
+
+This is a tuple ``(time, state, pars)`` containing the time coordinate, the state and the values of the parameters
+of the simulation at the launch of the last asynchronous operation (see :meth:`~cascade.sim.step_async()`), or
+``None`` if no asynchronous operation was ever launched. The arrays are read-only copies, which can be safely accessed
+while the operation is running (whereas the :attr:`~cascade.sim.time`, :attr:`~cascade.sim.state` and
+:attr:`~cascade.sim.pars` properties raise an error).
+
+)";
+}
+
+std::string sim_ids_docstring()
+{
+    return R"(Particle ids
+
+This is a read-only array containing the ids of the particles, in the same order as the rows of
+:attr:`~cascade.sim.state`. The ids are 64-bit unsigned integers assigned in ascending order when the particles
+are inserted in the simulation (i.e., on construction, via :meth:`~cascade.sim.add_particles()` and via
+:meth:`~cascade.sim.set_new_state_pars()`), and they are never reused. Unlike the indices, the ids are preserved
+when particles are removed via :meth:`~cascade.sim.remove_particles()`.
+
+The index of the particle with a given id can be fetched via :meth:`~cascade.sim.id_to_index()`. The ``id_i``
+and ``id_j`` fields of the detected conjunctions contain the ids of the two particles, and
+:attr:`~cascade.sim.interrupt_ids` contains the interrupt info expressed in terms of ids. The ids
+in :attr:`~cascade.sim.interrupt_ids` are recorded when the interrupt is raised, thus, unlike the indices in
+:attr:`~cascade.sim.interrupt_info`, they remain valid after the removal of particles.
+
+)";
+}
+
+std::string sim_whitelist_ids_docstring()
+{
+    return R"(Whitelist expressed via particle ids
+
+This :class:`set` contains the ids (see :attr:`~cascade.sim.ids`) of the particles in the corresponding
+index-based whitelist (i.e., :attr:`~cascade.sim.coll_whitelist` or :attr:`~cascade.sim.conj_whitelist`).
+The ids are converted to the particle indices when the whitelist is set, and the indices which do
+not refer to any particle are ignored when the whitelist is fetched.
+
+:raises IndexError: if, on assignment, any id does not refer to a particle in the simulation.
+
+)";
+}
+
+std::string sim_add_particles_docstring()
+{
+    return R"(add_particles(state: numpy.ndarray, pars: typing.Optional[numpy.ndarray] = None) -> None
+
+Append particles to the simulation.
+
+The new particles are appended at the end of the state vector. *state* must be an array of shape ``(n, 7)``
+and *pars*, if provided, an array of shape ``(n, npars)``. If *pars* is not provided, the parameter values of the new
+particles are set to zero.
+
+Only the new particles are validated. If a view of :attr:`~cascade.sim.state` or :attr:`~cascade.sim.pars` is
+alive, the view keeps on referring to the original data, otherwise the new particles are appended in-place.
+
+:param state: the state vectors of the new particles.
+:param pars: the parameter values of the new particles.
+
+:raises ValueError: if the new state vectors or parameter values are invalid.
+
+)";
+}
+
+std::string sim_remove_particles_docstring()
+{
+    return R"(remove_particles(idxs: list[int]) -> None
+
+Remove the particles at the indices *idxs*.
+
+Duplicate indices are ignored. The surviving particles are renumbered, preserving their order, and the collisional
+and conjunction whitelists and the pending aggregated conjunctions (see :attr:`~cascade.sim.conj_aggr`) are updated
+accordingly. If a pending aggregated conjunction involves a removed particle, all the pending aggregated conjunctions
+are flushed beforehand (see :meth:`~cascade.sim.flush_conjunctions()`).
+
+If a view of :attr:`~cascade.sim.state` or :attr:`~cascade.sim.pars` is alive, the view keeps on referring to the
+original data, otherwise the removal is performed in-place.
+
+:param idxs: the indices of the particles to be removed.
+
+:raises ValueError: if any index is out of range.
+
+)";
+}
+
+std::string sim_update_particles_docstring()
+{
+    return R"(update_particles(idxs: list[int], state: numpy.ndarray, pars: typing.Optional[numpy.ndarray] = None) -> None
+
+Overwrite the state vectors and, optionally, the parameter values of the particles at the indices *idxs*.
+
+*state* must be an array of shape ``(len(idxs), 7)`` and *pars*, if provided, an array of shape
+``(len(idxs), npars)``. If *pars* is not provided, the parameter values are left untouched. If an index appears
+multiple times, the last occurrence prevails.
+
+Only the updated rows are validated. The update is performed in-place, thus it is visible in the existing views
+of :attr:`~cascade.sim.state` and :attr:`~cascade.sim.pars`.
+
+:param idxs: the indices of the particles to be updated.
+:param state: the new state vectors.
+:param pars: the new parameter values.
+
+:raises ValueError: if any index is out of range, or if the new state vectors or parameter values are invalid.
+
+)";
+}
+
+std::string sim_output_errors_docstring()
+{
+    return R"(Errors raised by the output components
+
+The conjunction sink, the snapshot writer, the ephemeris writer and the checkpointer
+are invoked at the end of each step, after the simulation has been advanced in time.
+The exceptions they raise are not propagated by :meth:`step()` and :meth:`propagate_until()`,
+which return the outcome of the step normally. Instead, the errors are logged and
+recorded in this list, which contains one ``(component, time, message, count)`` tuple
+for each failing component:
+
+- *component* is the name of the component (e.g., ``"conjunction sink"``),
+- *time* is the time coordinate at the end of the last step in which the component failed,
+- *message* is the error message of the last failure,
+- *count* is the number of failures.
+
+The list is cleared by :meth:`clear_output_errors()`.
+
+)";
+}
+
+std::string sim_clear_output_errors_docstring()
+{
+    return R"(clear_output_errors() -> None
+
+Clear :attr:`output_errors`
+
+)";
+}
+
 std::string sim_step_docstring()
 {
     return R"(step() -> None
@@ -16,13 +16,57 @@ namespace cascade_py::docstrings
 
 std::string dynamics_kepler_docstring();
 
+std::string load_text_docstring();
+std::string load_hdf5_docstring();
+
+std::string set_jit_cache_dir_docstring();
+std::string get_jit_cache_dir_docstring();
+std::string set_jit_cache_max_size_docstring();
+std::string get_jit_cache_max_size_docstring();
+std::string set_jit_cache_precompiled_dir_docstring();
+std::string get_jit_cache_precompiled_dir_docstring();
+std::string get_jit_cache_size_docstring();
+std::string clear_jit_cache_docstring();
+
 std::string outcome_docstring();
 
+std::string conj_aggr_mode_docstring();
+
+std::string conj_sink_docstring();
+std::string conj_log_sink_docstring();
+std::string conj_store_docstring();
+std::string snapshot_writer_docstring();
+std::string checkpointer_docstring();
+std::string ephemeris_writer_docstring();
+std::string ephemeris_reader_docstring();
+std::string ensemble_docstring();
+
+std::string screening_volume_docstring();
+std::string screening_volume_ric_ellipsoid_docstring();
+std::string screening_volume_ric_box_docstring();
+
 std::string sim_docstring();
 std::string sim_init_docstring();
 std::string sim_pars_docstring();
 std::string sim_conj_whitelist_docstring();
+std::string sim_conj_tiers_docstring();
+std::string sim_conj_aggr_docstring();
+std::string sim_flush_conjunctions_docstring();
+std::string sim_screening_volume_docstring();
+std::string sim_det_order_docstring();
+std::string sim_conj_sink_docstring();
+std::string sim_snapshot_writer_docstring();
+std::string sim_checkpointer_docstring();
+std::string sim_ephemeris_writer_docstring();
+std::string sim_output_errors_docstring();
+std::string sim_clear_output_errors_docstring();
 std::string sim_interrupt_info_docstring();
+std::string sim_async_snapshot_docstring();
+std::string sim_ids_docstring();
+std::string sim_whitelist_ids_docstring();
+std::string sim_add_particles_docstring();
+std::string sim_remove_particles_docstring();
+std::string sim_update_particles_docstring();
 std::string sim_step_docstring();
 
 } // namespace cascade_py::docstrings
@@ -116,6 +116,881 @@ class sim_test_case(_ut.TestCase):
         self.test_set_new_state_pars()
         self.test_ct_api()
         self.test_conjunctions()
+        self.test_conj_aggr()
+        self.test_conj_tiers()
+        self.test_screening_volume()
+        self.test_conj_sink()
+        self.test_conj_log()
+        self.test_conj_store()
+        self.test_snapshot_writer()
+        self.test_pickle()
+        self.test_checkpointer()
+        self.test_io()
+        self.test_ephemeris()
+        self.test_det_order()
+        self.test_jit_cache()
+        self.test_ensemble()
+        self.test_step_async()
+        self.test_incremental_particles()
+        self.test_particle_ids()
+
+    def test_io(self):
+        from . import sim, snapshot_writer, load_text, load_hdf5
+        import tempfile
+        import os
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = np.array([list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]])
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "state.txt")
+
+            with self.assertRaises(ValueError) as cm:
+                load_text(path)
+
+            np.savetxt(path, state.reshape(-1))
+            arr = load_text(path)
+            self.assertEqual(arr.shape, (14,))
+            self.assertTrue(np.all(arr == state.reshape(-1)))
+            self.assertTrue(arr.flags.writeable)
+
+            s = sim(arr.reshape(-1, 7), 0.23)
+            self.assertTrue(np.all(s.state == state))
+
+            with open(path, "w") as f:
+                f.write("1 2 foo")
+            with self.assertRaises(ValueError) as cm:
+                load_text(path)
+
+            path = os.path.join(tmpdir, "snap.h5")
+
+            try:
+                sw = snapshot_writer(path)
+            except RuntimeError:
+                # NOTE: cascade was built without HDF5 support.
+                with self.assertRaises(RuntimeError) as cm:
+                    load_hdf5(path, "state")
+                return
+
+            s.snapshot_writer = sw
+            s.step()
+            sw.close()
+
+            self.assertTrue(np.all(load_hdf5(path, "state") == s.state.reshape(-1)))
+            with self.assertRaises(ValueError) as cm:
+                load_hdf5(path, "foo")
+
+    def test_ephemeris(self):
+        from . import sim, ephemeris_writer, ephemeris_reader
+        import tempfile
+        import os
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "sim.eph")
+
+            with self.assertRaises(ValueError) as cm:
+                ephemeris_reader(path)
+
+            ew = ephemeris_writer(path)
+            self.assertEqual(ew.path, path)
+            self.assertEqual(ew.n_blocks, 0)
+
+            s = sim(state, 0.23)
+            s.ephemeris_writer = ew
+            self.assertTrue(s.ephemeris_writer is ew)
+
+            s_ref = sim(state, 0.23)
+
+            for _ in range(3):
+                s.step()
+            self.assertEqual(ew.n_blocks, 3)
+
+            r = ephemeris_reader(path)
+            self.assertEqual(r.n_blocks, 3)
+            self.assertEqual(r.time_range, (0.0, s.time))
+            self.assertEqual(r.nparts(0.1), 2)
+            self.assertTrue(np.all(r.ids(0.1) == [0, 1]))
+            self.assertEqual(r.id_to_index(1, 0.1), 1)
+            self.assertTrue(np.all(r.state_by_id(1, 0.1) == r.state(1, 0.1)))
+            with self.assertRaises(IndexError) as cm:
+                r.id_to_index(2, 0.1)
+
+            # The states at the end of the propagation.
+            self.assertTrue(np.allclose(r.states(s.time), s.state[:, :6], rtol=0.0, atol=1e-13))
+            self.assertTrue(np.allclose(r.state(1, s.time), s.state[1, :6], rtol=0.0, atol=1e-13))
+
+            # The states at an intermediate time.
+            s_ref.propagate_until(0.5)
+            self.assertTrue(np.allclose(r.states(0.5), s_ref.state[:, :6], rtol=0.0, atol=1e-13))
+
+            # Batched queries.
+            st = r.states([1, 0], [0.5, s.time])
+            self.assertEqual(st.shape, (2, 6))
+            self.assertTrue(np.all(st[0] == r.state(1, 0.5)))
+            self.assertTrue(np.all(st[1] == r.state(0, s.time)))
+
+            with self.assertRaises(ValueError) as cm:
+                r.state(0, s.time + 1.0)
+            with self.assertRaises(ValueError) as cm:
+                r.state(2, 0.5)
+
+            s.ephemeris_writer = None
+
+            # Chebyshev re-fitting.
+            with self.assertRaises(ValueError) as cm:
+                ephemeris_writer(path, cheby_tol=-1.0)
+
+            cpath = os.path.join(tmpdir, "sim_cheby.eph")
+            ew_c = ephemeris_writer(cpath, cheby_tol=1e-10)
+            self.assertEqual(ew_c.cheby_tol, 1e-10)
+
+            s = sim(state, 0.23)
+            s.ephemeris_writer = ew_c
+            for _ in range(3):
+                s.step()
+            s.ephemeris_writer = None
+            self.assertLess(ew_c.n_bytes, ew.n_bytes)
+
+            r_c = ephemeris_reader(cpath)
+            self.assertTrue(np.allclose(r_c.states(0.5), r.states(0.5), rtol=0.0, atol=2e-10))
+
+    def test_det_order(self):
+        from . import sim
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        self.assertEqual(sim(state, 0.23).det_order, 0)
+
+        with self.assertRaises(ValueError) as cm:
+            sim(state, 0.23, det_order=1)
+
+        s_ref = sim(state, 0.23, conj_thresh=psize * 100)
+        s = sim(state, 0.23, conj_thresh=psize * 100, det_order=6)
+        self.assertEqual(s.det_order, 6)
+
+        s_ref.propagate_until(2.0)
+        s.propagate_until(2.0)
+
+        self.assertEqual(len(s.conjunctions), 1)
+        self.assertTrue(np.all(s.conjunctions == s_ref.conjunctions))
+
+    def test_jit_cache(self):
+        from . import (
+            sim,
+            set_jit_cache_dir,
+            get_jit_cache_dir,
+            set_jit_cache_max_size,
+            get_jit_cache_max_size,
+            get_jit_cache_size,
+            clear_jit_cache,
+            set_jit_cache_precompiled_dir,
+            get_jit_cache_precompiled_dir,
+        )
+        import tempfile
+        import os
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        orig_dir = get_jit_cache_dir()
+        orig_max_size = get_jit_cache_max_size()
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            cache_dir = os.path.join(tmpdir, "cache")
+
+            set_jit_cache_dir(cache_dir)
+            self.assertEqual(get_jit_cache_dir(), cache_dir)
+
+            s1 = sim(state, 0.23)
+            self.assertEqual(len(os.listdir(cache_dir)), 1)
+            size1 = get_jit_cache_size()
+            self.assertGreater(size1, 0)
+
+            s2 = sim(state, 0.23)
+            self.assertEqual(len(os.listdir(cache_dir)), 1)
+
+            s1.propagate_until(2.0)
+            s2.propagate_until(2.0)
+            self.assertTrue(np.all(s1.state == s2.state))
+
+            sim(state, 0.23, tol=1e-12)
+            self.assertEqual(len(os.listdir(cache_dir)), 2)
+
+            set_jit_cache_max_size(size1)
+            self.assertEqual(get_jit_cache_max_size(), size1)
+            sim(state, 0.23, high_accuracy=True)
+            self.assertLessEqual(get_jit_cache_size(), size1)
+
+            clear_jit_cache()
+            self.assertEqual(get_jit_cache_size(), 0)
+
+            set_jit_cache_max_size(orig_max_size)
+
+            # Precompiled entries.
+            # NOTE: destroy s1 and s2 so that the compiled
+            # data is not kept alive in the in-memory registry.
+            del s1, s2
+            sim(state, 0.23)
+            self.assertEqual(len(os.listdir(cache_dir)), 1)
+            set_jit_cache_dir("")
+            orig_pdir = get_jit_cache_precompiled_dir()
+            set_jit_cache_precompiled_dir(cache_dir)
+            self.assertEqual(get_jit_cache_precompiled_dir(), cache_dir)
+            s3 = sim(state, 0.23)
+            s3.propagate_until(2.0)
+            self.assertEqual(len(os.listdir(cache_dir)), 1)
+            set_jit_cache_precompiled_dir(orig_pdir)
+
+            set_jit_cache_dir(orig_dir)
+
+    def test_ensemble(self):
+        from . import sim, ensemble, outcome
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = np.array([list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]])
+
+        # Variant in which the particles collide.
+        coll_state = state.copy()
+        coll_state[:, 6] = 1e-5
+
+        proto = sim(np.zeros((0, 7)), 0.23, conj_thresh=psize * 100)
+
+        with self.assertRaises(ValueError):
+            ensemble(proto, [state, state], [np.zeros((2, 0))])
+        with self.assertRaises(ValueError):
+            ensemble(proto, [state[:, :6]])
+
+        ens = ensemble(proto, [state, coll_state])
+        self.assertEqual(len(ens), 2)
+        self.assertTrue(np.all(ens[0].state == state))
+
+        ens.propagate_until(2.0)
+
+        ref = sim(state, 0.23, conj_thresh=psize * 100)
+        ref.propagate_until(2.0)
+        self.assertTrue(np.all(ens[0].state == ref.state))
+        self.assertEqual(ens[1].nparts, 0)
+
+        sms = ens.summaries
+        self.assertEqual(sms["outcome"], [outcome.time_limit, outcome.time_limit])
+        self.assertEqual(list(sms["n_collisions"]), [0, 1])
+        self.assertEqual(list(sms["n_reentries"]), [0, 0])
+        self.assertEqual(list(sms["n_exits"]), [0, 0])
+        self.assertEqual(sms["n_conjunctions"][0], 1)
+
+    def test_step_async(self):
+        from . import sim, outcome
+        import asyncio
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = np.array([list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]])
+
+        s = sim(state, 0.23, conj_thresh=psize * 100)
+        ref = sim(state, 0.23, conj_thresh=psize * 100)
+        self.assertIsNone(s.async_snapshot)
+
+        async def run():
+            fut = s.step_async()
+
+            # The snapshot is read-only and it contains
+            # the data at the launch of the step.
+            t, st, pars = s.async_snapshot
+            self.assertEqual(t, 0.0)
+            self.assertTrue(np.all(st == state))
+            self.assertEqual(pars.shape, (2, 0))
+            self.assertFalse(st.flags.writeable)
+
+            self.assertEqual(await fut, ref.step())
+
+            # Two sims stepped concurrently.
+            s2 = sim(state, 0.23, conj_thresh=psize * 100)
+            return await asyncio.gather(s.propagate_until_async(2.0), s2.propagate_until_async(2.0))
+
+        oc1, oc2 = asyncio.run(run())
+        self.assertEqual(oc1, outcome.time_limit)
+        self.assertEqual(oc2, outcome.time_limit)
+        self.assertFalse(s.async_running)
+
+        ref.propagate_until(2.0)
+        self.assertTrue(np.all(s.state == ref.state))
+        self.assertEqual(len(s.conjunctions), len(ref.conjunctions))
+
+        # Errors are reported via the future.
+        async def run_err():
+            return await s.propagate_until_async(1.0)
+
+        with self.assertRaises(ValueError):
+            asyncio.run(run_err())
+
+        # Without a running event loop, no operation is launched.
+        with self.assertRaises(RuntimeError):
+            s.step_async()
+        self.assertFalse(s.async_running)
+        self.assertEqual(s.time, 2.0)
+
+        # The simulation cannot be modified while
+        # an asynchronous operation is running.
+        async def run_mod():
+            fut = s.propagate_until_async(1000.0)
+
+            with self.assertRaises(ValueError):
+                s.time = 0.0
+            with self.assertRaises(ValueError):
+                s.step()
+            with self.assertRaises(ValueError):
+                s.remove_particles([0])
+            with self.assertRaises(ValueError):
+                s.conj_thresh = 1.0
+
+            # The data modified by the operation cannot be read either,
+            # while the snapshot and the settings remain accessible.
+            with self.assertRaises(ValueError):
+                s.time
+            with self.assertRaises(ValueError):
+                s.state
+            with self.assertRaises(ValueError):
+                s.conjunctions
+            with self.assertRaises(ValueError):
+                s.interrupt_info
+            self.assertEqual(s.async_snapshot[0], 2.0)
+            self.assertEqual(s.ct, 0.23)
+
+            return await fut
+
+        asyncio.run(run_mod())
+        self.assertFalse(s.async_running)
+        self.assertEqual(s.nparts, 2)
+
+    def test_checkpointer(self):
+        from . import sim, checkpointer
+        import tempfile
+        import os
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "sim.ckpt")
+
+            with self.assertRaises(ValueError) as cm:
+                checkpointer.restore(path)
+
+            ckpt = checkpointer(path, ckpt_every=2)
+            self.assertEqual(ckpt.path, path)
+            self.assertEqual(ckpt.ckpt_every, 2)
+            self.assertTrue(ckpt.xor_delta)
+            self.assertEqual(ckpt.n_records, 0)
+
+            s = sim(state, 0.23, conj_thresh=psize * 100000000)
+            s.checkpointer = ckpt
+            self.assertTrue(s.checkpointer is ckpt)
+
+            for _ in range(4):
+                s.step()
+            self.assertEqual(ckpt.n_records, 2)
+
+            s.propagate_until(10.0)
+            ckpt.write(s)
+
+            s2 = checkpointer.restore(path)
+            self.assertTrue(np.all(s2.state == s.state))
+            self.assertEqual(s2.time, s.time)
+            self.assertTrue(np.all(s2.conjunctions["time"] == s.conjunctions["time"]))
+
+            s.checkpointer = None
+
+    def test_pickle(self):
+        from . import sim, conj_aggr_mode, counting_conj_sink
+        import pickle
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+
+        s = sim(
+            [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]],
+            0.23,
+            conj_thresh=psize * 100000000,
+            conj_aggr=conj_aggr_mode.window,
+            conj_aggr_window=5.0,
+            coll_whitelist={1},
+        )
+        s.propagate_until(7.0)
+        s.foo = "hello"
+
+        # The conjunction sink is not pickled.
+        s.conj_sink = counting_conj_sink()
+
+        s2 = pickle.loads(pickle.dumps(s))
+        self.assertEqual(s2.foo, "hello")
+        self.assertTrue(s2.conj_sink is None)
+        self.assertTrue(np.all(s2.state == s.state))
+        self.assertEqual(s2.time, s.time)
+        self.assertEqual(s2.ct, s.ct)
+        self.assertEqual(s2.conj_aggr, conj_aggr_mode.window)
+        self.assertEqual(s2.conj_aggr_window, 5.0)
+        self.assertEqual(s2.coll_whitelist, {1})
+        self.assertEqual(s2.n_pending_conjunctions, s.n_pending_conjunctions)
+        self.assertEqual(len(s2.conjunctions), len(s.conjunctions))
+
+        # The unpickled simulation evolves exactly as the original one.
+        s.conj_sink = None
+        s.propagate_until(20.0)
+        s2.propagate_until(20.0)
+        self.assertTrue(np.all(s2.state == s.state))
+        self.assertTrue(np.all(s2.conjunctions["time"] == s.conjunctions["time"]))
+
+    def test_snapshot_writer(self):
+        from . import sim, snapshot_writer
+        import tempfile
+        import os
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "snap.h5")
+
+            try:
+                sw = snapshot_writer(path, snap_every=2, snap_times=[0.5, 0.1])
+            except RuntimeError:
+                # NOTE: cascade was built without HDF5 support.
+                return
+
+            self.assertEqual(sw.path, path)
+            self.assertEqual(sw.snap_every, 2)
+            self.assertEqual(sw.snap_times, [0.1, 0.5])
+            self.assertEqual(sw.compression, 0)
+            self.assertEqual(sw.queue_size, 2)
+
+            with self.assertRaises(ValueError) as cm:
+                snapshot_writer(path, compression=10)
+            with self.assertRaises(ValueError) as cm:
+                snapshot_writer(path, queue_size=0)
+
+            s = sim(state, 0.23)
+            s.snapshot_writer = sw
+            self.assertTrue(s.snapshot_writer is sw)
+
+            for _ in range(4):
+                s.step()
+
+            sw.close()
+
+            # Two step-based snapshots plus the
+            # snapshots at the requested times.
+            n_times = len([t for t in [0.1, 0.5] if t <= s.time])
+            self.assertEqual(sw.n_snapshots, 2 + n_times)
+
+            try:
+                import h5py
+            except ImportError:
+                return
+
+            with h5py.File(path, "r") as f:
+                self.assertEqual(f["time"].shape, (2 + n_times,))
+                self.assertEqual(f["state"].shape, (2 + n_times, 2, 7))
+                self.assertFalse("pars" in f)
+
+    def test_conj_store(self):
+        from . import sim, conj_store
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions(), with
+        # an additional particle on a far away circular orbit.
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        ct = psize * 100000000
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        s_ref = sim(state, 0.23, conj_thresh=ct)
+        s_ref.propagate_until(20.0)
+        ref = s_ref.conjunctions
+
+        with self.assertRaises(ValueError) as cm:
+            conj_store(bucket_width=0.0)
+
+        far = [[10.0, 0.0, 0.0, 0.0, 0.1**0.5, 0.0, psize]]
+
+        s = sim(far + state, 0.23, conj_thresh=ct)
+        cs = conj_store(bucket_width=0.5)
+        self.assertEqual(cs.bucket_width, 0.5)
+        s.conj_sink = cs
+        s.propagate_until(10.0)
+
+        # Remove the far away particle: the keys (i.e., the
+        # ids) of the other particles do not change.
+        s.remove_particles([0])
+        self.assertTrue(np.all(s.ids == [1, 2]))
+        s.propagate_until(20.0)
+
+        conj = cs.conjunctions
+        self.assertEqual(len(conj), len(ref))
+        self.assertFalse(conj.flags.writeable)
+        self.assertTrue(np.all(conj["id_i"] == 1))
+        self.assertTrue(np.all(conj["id_j"] == 2))
+        self.assertTrue(np.allclose(conj["time"], ref["time"], rtol=1e-12, atol=0.0))
+
+        # Per-particle and per-pair queries.
+        ids = cs.particle_conj_ids(1)
+        self.assertFalse(ids.flags.writeable)
+        self.assertTrue(np.all(ids == np.arange(len(ref))))
+        self.assertTrue(np.all(cs.particle_conj_ids(2) == ids))
+        self.assertEqual(len(cs.particle_conj_ids(0)), 0)
+        self.assertEqual(len(cs.particle_conj_ids(100)), 0)
+        self.assertTrue(np.all(cs.pair_conj_ids(2, 1) == ids))
+        self.assertEqual(len(cs.pair_conj_ids(0, 1)), 0)
+
+        # Time range queries.
+        t_mid = conj["time"][2]
+        self.assertTrue(np.all(cs.time_range(t_mid, 100.0)["time"] == conj["time"][2:]))
+        self.assertTrue(np.all(cs.time_range(-100.0, t_mid)["time"] == conj["time"][:2]))
+        self.assertEqual(len(cs.time_range(t_mid, t_mid)), 0)
+        self.assertEqual(len(cs.time_range(t_mid, 0.0)), 0)
+        self.assertEqual(len(cs.time_range(-float("inf"), float("inf"))), len(ref))
+
+        # The views remain valid after the store
+        # and the sim are destroyed.
+        del s
+        del cs
+        self.assertEqual(len(conj), len(ref))
+        self.assertTrue(np.all(ids == np.arange(len(ref))))
+
+    def test_conj_log(self):
+        from . import sim, conj_log_sink, read_conj_log
+        import numpy as np
+        import tempfile
+        import os
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        ct = psize * 100000000
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        s_ref = sim(state, 0.23, conj_thresh=ct)
+        s_ref.propagate_until(20.0)
+        ref = s_ref.conjunctions
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "conj.log")
+
+            s = sim(state, 0.23, conj_thresh=ct)
+            ls = conj_log_sink(path)
+            s.conj_sink = ls
+            s.propagate_until(20.0)
+            self.assertEqual(ls.n_records, len(ref))
+
+            # Read while the log is open.
+            ls.flush()
+            cl = read_conj_log(path)
+            self.assertEqual(cl.dtype, ref.dtype)
+            self.assertTrue(np.all(cl["time"] == ref["time"]))
+            del cl
+
+            ls.close()
+            cl = read_conj_log(path)
+            self.assertTrue(np.all(cl["dist"] == ref["dist"]))
+
+            # Time slicing.
+            t_mid = ref["time"][2]
+            cl = read_conj_log(path, t_begin=t_mid)
+            self.assertTrue(np.all(cl["time"] == ref["time"][2:]))
+            cl = read_conj_log(path, t_end=t_mid)
+            self.assertTrue(np.all(cl["time"] == ref["time"][:2]))
+            cl = read_conj_log(path, t_begin=t_mid, t_end=t_mid)
+            self.assertEqual(len(cl), 0)
+            del cl
+
+            with open(os.path.join(tmpdir, "foo"), "wb") as f:
+                f.write(b"hello world")
+            with self.assertRaises(ValueError) as cm:
+                read_conj_log(os.path.join(tmpdir, "foo"))
+            with self.assertRaises(ValueError) as cm:
+                conj_log_sink(os.path.join(tmpdir, "foo"), append=True)
+
+            s.conj_sink = None
+            del ls
+
+    def test_conj_sink(self):
+        from . import (
+            sim,
+            memory_conj_sink,
+            file_conj_sink,
+            counting_conj_sink,
+            ring_conj_sink,
+        )
+        import numpy as np
+        import tempfile
+        import os
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        ct = psize * 100000000
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        s_ref = sim(state, 0.23, conj_thresh=ct)
+        s_ref.propagate_until(20.0)
+        ref = s_ref.conjunctions
+        self.assertEqual(len(ref), 6)
+
+        s = sim(state, 0.23, conj_thresh=ct)
+        self.assertTrue(s.conj_sink is None)
+        ms = memory_conj_sink()
+        s.conj_sink = ms
+        s.propagate_until(20.0)
+        self.assertEqual(len(s.conjunctions), 0)
+        self.assertTrue(np.all(ms.conjunctions["time"] == ref["time"]))
+        ms.clear()
+        self.assertEqual(len(ms.conjunctions), 0)
+
+        s = sim(state, 0.23, conj_thresh=ct)
+        cs = counting_conj_sink()
+        s.conj_sink = cs
+        s.propagate_until(20.0)
+        self.assertEqual(cs.n_conj, 6)
+        self.assertEqual(cs.tier_counts, [6])
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, "conj.bin")
+            s = sim(state, 0.23, conj_thresh=ct)
+            fs = file_conj_sink(path)
+            s.conj_sink = fs
+            s.propagate_until(20.0)
+            fs.flush()
+            self.assertEqual(fs.n_conj, 6)
+
+            fc = np.fromfile(path, dtype=ref.dtype)
+            self.assertTrue(np.all(fc["time"] == ref["time"]))
+            self.assertTrue(np.all(fc["dist"] == ref["dist"]))
+
+            s.conj_sink = None
+            del fs
+
+        s = sim(state, 0.23, conj_thresh=ct)
+        rs = ring_conj_sink(4)
+        s.conj_sink = rs
+        s.propagate_until(20.0)
+        self.assertEqual(rs.size, 4)
+        self.assertEqual(rs.n_dropped, 2)
+        rc = rs.pop_all()
+        self.assertTrue(np.all(rc["time"] == ref["time"][:4]))
+        self.assertEqual(rs.size, 0)
+
+    def test_screening_volume(self):
+        from . import sim, screening_volume
+        import heyoka as hy
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        ct = psize * 100000000
+
+        dx, dy, dz, hx = hy.make_vars("dx", "dy", "dz", "hx")
+
+        with self.assertRaises(ValueError) as cm:
+            screening_volume([], 1.0)
+        with self.assertRaises(ValueError) as cm:
+            screening_volume([dx - 1.0], -1.0)
+        with self.assertRaises(ValueError) as cm:
+            screening_volume([dx - hx], 1.0)
+        with self.assertRaises(ValueError) as cm:
+            screening_volume.ric_box(1.0, 0.0, 1.0)
+
+        sv = screening_volume.ric_box(1.0, 2.0, 3.0)
+        self.assertEqual(len(sv.predicates), 3)
+        self.assertEqual(sv.bounding_radius, np.sqrt(14.0))
+
+        state = [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]]
+
+        s_ref = sim(state, 0.23, conj_thresh=ct)
+        self.assertTrue(s_ref.screening_volume is None)
+        s_ref.propagate_until(20.0)
+
+        for sv in [
+            screening_volume.ric_ellipsoid(ct, ct, ct),
+            screening_volume([dx**2 + dy**2 + dz**2 - ct**2], ct),
+        ]:
+            s = sim(state, 0.23, conj_thresh=2 * ct, screening_volume=sv)
+            self.assertEqual(s.screening_volume.bounding_radius, ct)
+            s.propagate_until(20.0)
+
+            self.assertEqual(len(s.conjunctions), len(s_ref.conjunctions))
+            self.assertTrue(
+                np.all(s.conjunctions["time"] == s_ref.conjunctions["time"])
+            )
+            self.assertTrue(
+                np.all(s.conjunctions["dist"] == s_ref.conjunctions["dist"])
+            )
+
+    def test_conj_tiers(self):
+        from . import sim
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+        ct = psize * 100000000
+        tiers = [ct / 10, ct / 2, ct]
+
+        s = sim(
+            [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]],
+            0.23,
+            conj_thresh=tiers,
+        )
+        self.assertEqual(s.conj_tiers, tiers)
+        self.assertEqual(s.conj_thresh, ct)
+        self.assertEqual(s.conj_tier_counts, [0, 0, 0])
+
+        s.propagate_until(20.0)
+        cv = s.conjunctions
+        self.assertEqual(len(cv), 6)
+        self.assertEqual(sum(s.conj_tier_counts), 6)
+        for t in range(3):
+            self.assertEqual(np.sum(cv["tier"] == t), s.conj_tier_counts[t])
+        self.assertTrue(np.all(cv["dist"] < np.array(tiers)[cv["tier"]]))
+
+        with self.assertRaises(ValueError) as cm:
+            s.conj_tiers = [ct, ct / 2]
+
+        s.conj_thresh = ct
+        self.assertEqual(s.conj_tiers, [ct])
+        self.assertEqual(s.conj_tier_counts, [0])
+
+    def test_conj_aggr(self):
+        from . import sim, conj_aggr_mode
+        import numpy as np
+
+        # NOTE: same setup as in test_conjunctions().
+        r1 = (0.3342377271241684, 0.942488801930755, 0.0)
+        v1 = (0.009424730938644767, -0.003342321565239028, 0.9999500004176654)
+        r2 = (-0.15179985849820377, -0.988411251938142, 0.0)
+        v2 = (6.052273379648475e-17, -9.295060541060909e-18, 1.000000000001)
+
+        psize = 1.57e-8
+
+        s = sim(
+            [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]],
+            0.23,
+            conj_thresh=psize * 100000000,
+        )
+        self.assertEqual(s.conj_aggr, conj_aggr_mode.none)
+        self.assertEqual(s.conj_aggr_window, 0.0)
+
+        with self.assertRaises(ValueError) as cm:
+            s.conj_aggr = conj_aggr_mode.window
+        with self.assertRaises(ValueError) as cm:
+            s.conj_aggr_window = -1.0
+
+        s.conj_aggr_window = 10.0
+        s.conj_aggr = conj_aggr_mode.window
+
+        s.propagate_until(20.0)
+        s.flush_conjunctions()
+        self.assertEqual(s.n_pending_conjunctions, 0)
+
+        cv = s.conjunctions
+        self.assertEqual(len(cv), 2)
+        self.assertEqual(np.sum(cv["n_min"]), 6)
+        self.assertTrue(np.all(cv["time_under"] > 0))
+
+        s = sim(
+            [list(r1) + list(v1) + [psize], list(r2) + list(v2) + [psize]],
+            0.23,
+            conj_thresh=psize * 100000000,
+            conj_aggr=conj_aggr_mode.superstep,
+        )
+        s.propagate_until(20.0)
+
+        cv = s.conjunctions
+        self.assertEqual(len(cv), 6)
+        self.assertTrue(np.all(cv["n_min"] == 1))
 
     def test_conjunctions(self):
         from . import sim
@@ -393,6 +1268,128 @@ class sim_test_case(_ut.TestCase):
         self.assertTrue(np.all(s.state == st[::2]))
         self.assertTrue(np.all(s.pars == pars[::2]))
 
+        # Inputs which are not C-contiguous float64 arrays are converted.
+        s.set_new_state_pars(new_pars=np.asfortranarray(pars), new_state=np.asfortranarray(st))
+        self.assertTrue(np.all(s.state == st))
+        self.assertTrue(np.all(s.pars == pars))
+
+        s.set_new_state_pars(new_state=st.astype(int).tolist(), new_pars=[[1], [2], [3]])
+        self.assertTrue(np.all(s.state == st))
+        self.assertTrue(np.all(s.pars[:, 0] == [1, 2, 3]))
+
+        s = sim(st.astype(np.float32), 0.5, pars=np.asfortranarray(pars), dyn=dyn)
+        self.assertTrue(np.all(s.state == st))
+        self.assertTrue(np.all(s.pars == pars))
+
+        # The input arrays are copied.
+        st2 = st.copy()
+        s.set_new_state_pars(new_state=st2)
+        st2[0, 0] = 42.0
+        self.assertEqual(s.state[0, 0], 0.0)
+
+    def test_particle_ids(self):
+        from . import sim
+        import numpy as np
+
+        st = np.vstack([np.full((1, 7), 0.1), np.full((1, 7), 0.2), np.full((1, 7), 0.3)])
+
+        s = sim(st, 0.5)
+        self.assertEqual(s.ids.dtype, np.uint64)
+        self.assertTrue(np.all(s.ids == [0, 1, 2]))
+
+        # The ids are preserved across removals.
+        s.remove_particles([1])
+        self.assertTrue(np.all(s.ids == [0, 2]))
+        self.assertEqual(s.id_to_index(2), 1)
+
+        with self.assertRaises(IndexError) as cm:
+            s.id_to_index(1)
+        self.assertTrue("No particle with id 1 exists in the simulation" in str(cm.exception))
+
+        # The ids are never reused.
+        s.add_particles(np.full((2, 7), 0.4))
+        self.assertTrue(np.all(s.ids == [0, 2, 3, 4]))
+
+        # The returned array is a copy.
+        ids = s.ids
+        ids[0] = 42
+        self.assertEqual(s.ids[0], 0)
+
+        self.assertTrue(s.interrupt_ids is None)
+
+        # The conjunctions contain the ids.
+        self.assertTrue("id_i" in s.conjunctions.dtype.names)
+        self.assertTrue("id_j" in s.conjunctions.dtype.names)
+
+        # Whitelists expressed via ids.
+        s = sim(st, 0.5, coll_whitelist_ids={0, 2}, conj_whitelist_ids={1})
+        self.assertEqual(s.coll_whitelist, {0, 2})
+        self.assertEqual(s.conj_whitelist, {1})
+
+        s.remove_particles([0])
+        self.assertEqual(s.coll_whitelist, {1})
+        self.assertEqual(s.coll_whitelist_ids, {2})
+        self.assertEqual(s.conj_whitelist_ids, {1})
+
+        s.coll_whitelist_ids = {1, 2}
+        self.assertEqual(s.coll_whitelist, {0, 1})
+
+        with self.assertRaises(IndexError) as cm:
+            s.conj_whitelist_ids = {0}
+        self.assertEqual(s.conj_whitelist, {0})
+
+        with self.assertRaises(IndexError) as cm:
+            sim(st, 0.5, coll_whitelist_ids={3})
+
+        with self.assertRaises(ValueError) as cm:
+            sim(st, 0.5, conj_whitelist={0}, conj_whitelist_ids={0})
+        self.assertTrue("cannot be used together" in str(cm.exception))
+
+    def test_incremental_particles(self):
+        from . import sim, dynamics
+        import heyoka as hy
+        import numpy as np
+
+        dyn = dynamics.kepler()
+        dyn[0] = (dyn[0][0], dyn[0][1] + hy.par[0])
+
+        st = np.vstack([np.full((1, 7), 0.1), np.full((1, 7), 0.2)])
+        pars = np.array([0.1, 0.2]).reshape((2, 1))
+
+        s = sim(st, 0.5, pars=pars, dyn=dyn, exit_radius=10.0)
+
+        # Addition.
+        s.add_particles(np.full((2, 7), 0.3), np.array([[0.3], [0.4]]))
+        self.assertEqual(s.nparts, 4)
+        self.assertTrue(np.all(s.state[2:] == 0.3))
+        self.assertTrue(np.all(s.pars[:, 0] == [0.1, 0.2, 0.3, 0.4]))
+
+        s.add_particles(np.full((1, 7), 0.4))
+        self.assertEqual(s.pars[4, 0], 0.0)
+
+        with self.assertRaises(ValueError) as cm:
+            s.add_particles(np.full((1, 7), 20.0))
+        self.assertTrue("The particle at index 5 is outside the exit radius" in str(cm.exception))
+        self.assertEqual(s.nparts, 5)
+
+        # Update, visible from the existing views.
+        view = s.state
+        s.update_particles([4, 0], np.vstack([np.full((1, 7), 0.5), np.full((1, 7), 0.6)]), np.array([[5.0], [6.0]]))
+        self.assertTrue(np.all(view[4] == 0.5))
+        self.assertTrue(np.all(view[0] == 0.6))
+        self.assertTrue(np.all(s.pars[:, 0] == [6.0, 0.2, 0.3, 0.4, 5.0]))
+
+        with self.assertRaises(ValueError) as cm:
+            s.update_particles([5], np.full((1, 7), 0.1))
+        self.assertTrue("Cannot update the particle at index 5" in str(cm.exception))
+
+        # Removal, the existing views keep on referring to the original data.
+        s.remove_particles([1, 3])
+        self.assertEqual(view.shape, (5, 7))
+        self.assertTrue(np.all(view[1] == 0.2))
+        self.assertTrue(np.all(s.state[:, 0] == [0.6, 0.3, 0.5]))
+        self.assertTrue(np.all(s.pars[:, 0] == [6.0, 0.3, 5.0]))
+
     def test_remove_particles(self):
         from . import sim, dynamics
         import heyoka as hy
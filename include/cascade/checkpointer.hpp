@@ -0,0 +1,152 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_CHECKPOINTER_HPP
+#define CASCADE_CHECKPOINTER_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <heyoka/detail/igor.hpp>
+
+#include <cascade/detail/visibility.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(ckpt_every);
+IGOR_MAKE_NAMED_ARGUMENT(xor_delta);
+
+} // namespace kw
+
+// Writer of incremental checkpoints.
+//
+// A checkpoint file contains a chain of records. A base record is a full
+// checkpoint of a sim (see sim::save_checkpoint()), while a delta record
+// contains only the data which may change after the construction of a sim:
+// - the time coordinate, the interrupt info, the settings which can be
+//   changed via setters (collisional timestep, conjunction tiers, whitelists, etc.)
+//   and the pending aggregated conjunctions,
+// - the log of the particle removals since the previous record,
+// - the state and parameters vectors,
+// - the conjunctions detected since the previous record.
+// If xor_delta is true, the state and parameters vectors are stored
+// as the bitwise XOR against the vectors of the previous record (after the
+// removals), dropping the leading zero bytes of each XORed value. This
+// significantly reduces the size of the quantities which change slowly
+// or not at all between records (e.g., particle sizes and parameters).
+//
+// The first record written by a checkpointer is always a base record, and
+// a new base record can be requested via write_base(). When the checkpointer
+// is set on a sim via sim::set_checkpointer(), a record is written automatically
+// every ckpt_every steps (if ckpt_every is not zero). Records can also
+// be written explicitly via write(), which must always be invoked
+// on the same sim between two base records.
+//
+// restore() rebuilds a sim by replaying the chain of records starting from the
+// last base record of a checkpoint file. An incomplete record at the end of
+// the file (e.g., due to an interruption while writing) is ignored.
+class CASCADE_DLL_PUBLIC checkpointer
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+    void finalise_ctor(std::string, std::uint64_t, bool);
+    void write_record(const sim &, bool);
+
+    // NOTE: private delegating constructor, used so that
+    // the generic constructor does not need the complete
+    // definition of impl (see the analogous machinery in sim).
+    struct ptag_t {
+    };
+    explicit checkpointer(ptag_t);
+
+public:
+    template <typename... KwArgs>
+    explicit checkpointer(std::string path, KwArgs &&...kw_args) : checkpointer(ptag_t{})
+    {
+        igor::parser p{kw_args...};
+
+        // LCOV_EXCL_START
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of a checkpointer "
+                          "contain unnamed arguments.");
+            throw;
+        }
+        // LCOV_EXCL_STOP
+
+        // Checkpoint every n steps (defaults to 1).
+        std::uint64_t ckpt_every = 1;
+        if constexpr (p.has(kw::ckpt_every)) {
+            if constexpr (std::integral<std::remove_cvref_t<decltype(p(kw::ckpt_every))>>) {
+                ckpt_every = boost::numeric_cast<std::uint64_t>(p(kw::ckpt_every));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'ckpt_every' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // XOR-delta encoding (defaults to true).
+        bool xor_delta = true;
+        if constexpr (p.has(kw::xor_delta)) {
+            if constexpr (std::is_convertible_v<decltype(p(kw::xor_delta)), bool>) {
+                xor_delta = static_cast<bool>(p(kw::xor_delta));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'xor_delta' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        finalise_ctor(std::move(path), ckpt_every, xor_delta);
+    }
+    checkpointer(const checkpointer &) = delete;
+    checkpointer(checkpointer &&) = delete;
+    checkpointer &operator=(const checkpointer &) = delete;
+    checkpointer &operator=(checkpointer &&) = delete;
+    ~checkpointer();
+
+    [[nodiscard]] const std::string &get_path() const;
+    [[nodiscard]] std::uint64_t get_ckpt_every() const;
+    [[nodiscard]] bool get_xor_delta() const;
+    [[nodiscard]] std::uint64_t get_n_records() const;
+    [[nodiscard]] std::uint64_t get_n_bytes() const;
+
+    void write(const sim &);
+    void write_base(const sim &);
+
+    static sim restore(const std::string &);
+
+    // NOTE: these are used by the sim class to notify
+    // the checkpointer of the relevant events.
+    bool step_done();
+    void sim_attached();
+    void particles_removed(sim::size_type, std::span<const sim::size_type>) noexcept;
+    void particles_replaced() noexcept;
+    void conjunctions_reset() noexcept;
+};
+
+} // namespace cascade
+
+#endif
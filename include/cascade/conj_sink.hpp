@@ -0,0 +1,260 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_CONJ_SINK_HPP
+#define CASCADE_CONJ_SINK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cascade/detail/visibility.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+// Base class for conjunction sinks.
+//
+// When a sink is set on a sim (see sim::set_conj_sink()), at the end
+// of each step the detected conjunctions are passed to the sink in
+// chronological order via push(), and they are then removed from
+// the list of conjunctions of the sim. This allows to keep the memory
+// usage bounded in long simulations.
+//
+// If push() throws, the conjunctions are kept in the sim and they are
+// pushed again at the end of the next step. Thus, push() should provide
+// the strong exception safety guarantee (i.e., if it throws, the sink
+// must not retain any of the conjunctions), otherwise the sink may
+// end up containing duplicate records.
+class CASCADE_DLL_PUBLIC conj_sink
+{
+public:
+    conj_sink();
+    conj_sink(const conj_sink &) = delete;
+    conj_sink(conj_sink &&) = delete;
+    conj_sink &operator=(const conj_sink &) = delete;
+    conj_sink &operator=(conj_sink &&) = delete;
+    virtual ~conj_sink();
+
+    virtual void push(std::span<const sim::conjunction>) = 0;
+};
+
+// Sink storing the conjunctions in memory.
+class CASCADE_DLL_PUBLIC memory_conj_sink final : public conj_sink
+{
+    std::vector<sim::conjunction> m_conj;
+
+public:
+    memory_conj_sink();
+    ~memory_conj_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    [[nodiscard]] const std::vector<sim::conjunction> &get_conjunctions() const;
+    void clear();
+};
+
+// Sink writing the conjunctions to a binary file.
+//
+// The conjunctions are written one after the other
+// using the in-memory layout of sim::conjunction, so
+// that the file can be read back, e.g., via NumPy's
+// fromfile() using the dtype of sim.conjunctions.
+class CASCADE_DLL_PUBLIC file_conj_sink final : public conj_sink
+{
+    std::string m_path;
+    std::ofstream m_file;
+    std::uint64_t m_n_conj = 0;
+
+public:
+    explicit file_conj_sink(std::string);
+    ~file_conj_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    [[nodiscard]] const std::string &get_path() const;
+    [[nodiscard]] std::uint64_t get_n_conj() const;
+    void flush();
+};
+
+// Sink counting the conjunctions, overall
+// and for each conjunction tier.
+class CASCADE_DLL_PUBLIC counting_conj_sink final : public conj_sink
+{
+    std::uint64_t m_n_conj = 0;
+    std::vector<std::uint64_t> m_tier_counts;
+
+public:
+    counting_conj_sink();
+    ~counting_conj_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    [[nodiscard]] std::uint64_t get_n_conj() const;
+    [[nodiscard]] const std::vector<std::uint64_t> &get_tier_counts() const;
+    void reset();
+};
+
+// Sink invoking a user-provided callback.
+class CASCADE_DLL_PUBLIC callback_conj_sink final : public conj_sink
+{
+public:
+    using callback_t = std::function<void(std::span<const sim::conjunction>)>;
+
+private:
+    callback_t m_cb;
+
+public:
+    explicit callback_conj_sink(callback_t);
+    ~callback_conj_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+};
+
+// Sink storing the conjunctions in a fixed-size, lock-free
+// single-producer/single-consumer ring buffer.
+//
+// The producer is the sim the sink is attached to, while the consumer
+// can be another thread retrieving the conjunctions via pop(). If the
+// ring buffer is full, the new conjunctions are discarded and
+// accounted for in the counter returned by get_n_dropped().
+class CASCADE_DLL_PUBLIC ring_conj_sink final : public conj_sink
+{
+    // NOTE: the buffer contains one extra slot
+    // in order to distinguish between full and
+    // empty ring buffers.
+    std::vector<sim::conjunction> m_buffer;
+    // NOTE: m_head is written only by the consumer,
+    // m_tail is written only by the producer. Put them
+    // in separate cache lines in order to avoid false sharing.
+    alignas(64) std::atomic<std::size_t> m_head = 0;
+    alignas(64) std::atomic<std::size_t> m_tail = 0;
+    std::atomic<std::uint64_t> m_n_dropped = 0;
+
+public:
+    explicit ring_conj_sink(std::size_t);
+    ~ring_conj_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    std::size_t pop(std::span<sim::conjunction>);
+    std::vector<sim::conjunction> pop_all();
+
+    [[nodiscard]] std::size_t get_capacity() const;
+    [[nodiscard]] std::size_t get_size() const;
+    [[nodiscard]] std::uint64_t get_n_dropped() const;
+};
+
+// Size of the header of a conjunction log file
+// and stride of the entries in the index file.
+inline constexpr std::size_t conj_log_header_size = 4096;
+inline constexpr std::uint64_t conj_log_index_stride = 1024;
+
+// Sink appending the conjunctions to a memory-mapped binary log file.
+//
+// The log file begins with a header of conj_log_header_size bytes containing
+// a magic string, the format version, the record size, the number
+// of records and a textual description of the record layout. The header is
+// followed by the records, which use the in-memory layout of
+// sim::conjunction. Every conj_log_index_stride records, an entry
+// containing the time coordinate and the index of the record is appended
+// to an index file (whose path is the path of the log file with the
+// ".idx" suffix), so that time ranges can be located without scanning the log.
+//
+// The records are copied into the memory-mapped file by push(), while
+// the flushing of the written data to disk is performed by a background
+// thread, so that it overlaps with the next steps of the simulation.
+class CASCADE_DLL_PUBLIC conj_log_sink final : public conj_sink
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+public:
+    explicit conj_log_sink(std::string, bool = false);
+    ~conj_log_sink() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    [[nodiscard]] const std::string &get_path() const;
+    [[nodiscard]] std::uint64_t get_n_records() const;
+    void flush();
+    void close();
+};
+
+// Sink storing the conjunctions in memory together with
+// indices for per-particle and time-range queries.
+//
+// The particles are identified in the store via their ids (see sim::get_ids()),
+// which, unlike the particle indices in a sim, do not change when particles are
+// removed from the sim. In the queries, the particle ids are referred to as keys.
+//
+// The conjunctions are stored in chronological order, unmodified. The per-particle
+// index contains, for each particle key, a separate sorted list of the ids (i.e.,
+// the positions in the store) of the conjunctions involving the particle. The
+// time-range index is a list of time buckets of fixed width, containing for each
+// bucket the id of the first conjunction in the bucket.
+//
+// The per-particle index is updated lazily at the first query following
+// the insertion of new conjunctions. Because the new ids are appended
+// to the per-particle lists, the cost of an update is proportional
+// (in amortised terms) to the number of new conjunctions.
+class CASCADE_DLL_PUBLIC conj_store final : public conj_sink
+{
+    double m_bucket_width = 0;
+    // NOTE: the conjunctions and the per-particle lists are stored in shared
+    // pointers for the same reasons explained in the sim class. Because the
+    // store is append-only, the existing elements are never modified, and new
+    // vectors are created when the storage needs to grow.
+    std::shared_ptr<std::vector<sim::conjunction>> m_conj;
+    // The time-bucket index.
+    double m_bucket_origin = 0;
+    std::vector<sim::size_type> m_bucket_offsets;
+    // The per-particle index. The list of a key without
+    // conjunctions may be represented by a null pointer.
+    std::vector<std::shared_ptr<std::vector<sim::size_type>>> m_adj;
+    // Number of conjunctions accounted for in the per-particle index.
+    sim::size_type m_n_indexed = 0;
+
+    void update_adj_index();
+
+public:
+    explicit conj_store(double = 1.);
+    ~conj_store() override;
+
+    void push(std::span<const sim::conjunction>) override;
+
+    [[nodiscard]] double get_bucket_width() const;
+    [[nodiscard]] const std::vector<sim::conjunction> &get_conjunctions() const;
+
+    std::span<const sim::size_type> get_particle_conj_ids(std::uint64_t);
+    std::vector<sim::size_type> get_pair_conj_ids(std::uint64_t, std::uint64_t);
+    [[nodiscard]] std::span<const sim::conjunction> get_time_range(double, double) const;
+    [[nodiscard]] std::pair<sim::size_type, sim::size_type> get_time_range_ids(double, double) const;
+
+    // NOTE: these are implementation details
+    // used in the Python bindings (see the analogous
+    // functions in the sim class).
+    [[nodiscard]] auto _get_conj_ptr() const
+    {
+        return m_conj;
+    }
+    std::shared_ptr<std::vector<sim::size_type>> _get_adj_ids_ptr(std::uint64_t);
+};
+
+} // namespace cascade
+
+#endif
@@ -12,16 +12,22 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
+#include <oneapi/tbb/concurrent_hash_map.h>
 #include <oneapi/tbb/concurrent_queue.h>
 #include <oneapi/tbb/concurrent_vector.h>
 
 #include <heyoka/detail/dfloat.hpp>
+#include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -85,21 +91,30 @@ inline bool operator!=(const no_init_alloc<T> &, const no_init_alloc<U> &)
     return false;
 }
 
-} // namespace detail
-
-struct sim::sim_data {
+// The compiled data of a simulation, that is, the integrator templates, the
+// llvm state holding the JIT-compiled functions and the pointers to the
+// compiled functions. This data depends only on the setup of the simulation
+// (dynamics, events, tolerance, etc.) and it is immutable after construction,
+// thus it is shared (via std::shared_ptr<const sim_jit_data>) among the copies
+// of a simulation and among the simulations with the same setup (see
+// the in-memory registry in jit_cache.cpp).
+struct sim_jit_data {
     // The adaptive integrators.
     // NOTE: these are never used directly,
     // we just copy them as necessary to setup
-    // the integrator caches below.
+    // the integrator caches in sim_data.
     heyoka::taylor_adaptive<double> s_ta;
     heyoka::taylor_adaptive_batch<double> b_ta;
 
     // The state used to store the JIT compiled functions.
     heyoka::llvm_state state;
-
-    // The time coordinate.
-    heyoka::detail::dfloat<double> time;
+    // The state used to store the JIT compiled functions operating
+    // on the economised polynomials. This is empty if the detection
+    // order is not in use.
+    // NOTE: a separate state is needed because the root finding
+    // functions have fixed names, and they are needed here for
+    // a polynomial degree different from the one in state.
+    heyoka::llvm_state det_state;
 
     // The JIT-compiled functions.
     using pta_cfunc_t = void (*)(double *, const double *, const double *) noexcept;
@@ -112,6 +127,87 @@ struct sim::sim_data {
     rtscc_t rtscc = nullptr;
     using pt1_t = void (*)(double *, const double *) noexcept;
     pt1_t pt1 = nullptr;
+    // NOTE: this is available only if a screening volume was defined.
+    using svol_cfunc_t = void (*)(double *, const double *, const double *) noexcept;
+    svol_cfunc_t svol_cfunc = nullptr;
+    // NOTE: these are the translation, distance square and root finding
+    // functions for the economised polynomials, available only if the detection
+    // order is in use. det_pssdiff3_cfunc computes the square of the polynomials
+    // without truncation, thus the root finding functions operate on polynomials
+    // of degree twice the detection order.
+    pta_cfunc_t det_pta_cfunc = nullptr;
+    pssdiff3_cfunc_t det_pssdiff3_cfunc = nullptr;
+    fex_check_t det_fex_check = nullptr;
+    rtscc_t det_rtscc = nullptr;
+    pt1_t det_pt1 = nullptr;
+
+    // The dynamics of the integrators (including the equation for r).
+    // NOTE: this is used to rebuild the compiled data when a simulation
+    // is deserialised on a different host (see sim::load()).
+    std::vector<std::pair<heyoka::expression, heyoka::expression>> dyn;
+
+    // Assign the pointers to the JIT-compiled functions
+    // by looking them up in the (compiled) llvm states.
+    void lookup_jit_functions(bool, bool);
+};
+
+// Check if the narrow phase of a simulation with detection order det_order
+// screens the trajectories via the economised polynomials (see sim::compute_det_tcs()).
+// This happens if the detection order is nonzero and less than the order
+// of the integrator.
+inline bool use_det_order(std::uint32_t det_order, std::uint32_t order)
+{
+    return det_order != 0u && det_order < order;
+}
+
+// Predict the order of the Taylor integrators from the tolerance.
+// Zero is returned if the order cannot be predicted.
+std::uint32_t taylor_order_from_tol(double);
+
+// Add to the input llvm states the narrow-phase functions for integrators of
+// the given order, the screening volume and the detection order, and compile them.
+// The functions operating on the economised polynomials are added to the second state.
+// NOTE: the pointers to the compiled functions are then
+// assigned via sim_jit_data::lookup_jit_functions().
+void add_jit_functions(heyoka::llvm_state &, heyoka::llvm_state &, std::uint32_t,
+                       const std::optional<screening_volume> &, std::uint32_t);
+
+// Setup the compiled data of a simulation with the given dynamics (including
+// the equation for r), reentry/exit radii, tolerance, high accuracy flag,
+// screening volume and detection order. The data is looked up first in the
+// in-memory registry and then in the JIT cache, and it is compiled (and
+// stored in the cache) if not found. The last argument is invoked
+// concurrently with the lookup.
+std::shared_ptr<const sim_jit_data>
+make_sim_jit_data(std::vector<std::pair<heyoka::expression, heyoka::expression>>,
+                  const std::variant<double, std::vector<double>> &, double, double, bool,
+                  const std::optional<screening_volume> &, std::uint32_t, const std::function<void()> &);
+
+} // namespace detail
+
+struct sim::sim_data {
+    // The compiled data.
+    std::shared_ptr<const detail::sim_jit_data> jit;
+
+    // The time coordinate.
+    heyoka::detail::dfloat<double> time;
+
+    // The pending aggregated conjunctions (see conj_aggr_mode), grouped
+    // by aggregation window. For each window, a concurrent hash map
+    // associates a (sorted) pair of particle indices and a conjunction tier
+    // to the closest-approach conjunction detected so far in that tier, whose
+    // n_min/time_under members accumulate the data of all the other minima
+    // in the same tier within the window. A window is
+    // flushed into m_det_conj as soon as the simulation time moves past its end.
+    // NOTE: in superstep aggregation mode, there is a single window
+    // (with index 0) which is flushed at the end of every superstep.
+    using conj_aggr_key_t = std::tuple<size_type, size_type, size_type>;
+    struct conj_aggr_hc {
+        static std::size_t hash(const conj_aggr_key_t &);
+        static bool equal(const conj_aggr_key_t &, const conj_aggr_key_t &);
+    };
+    using conj_aggr_map_t = oneapi::tbb::concurrent_hash_map<conj_aggr_key_t, conjunction, conj_aggr_hc>;
+    std::map<std::int64_t, conj_aggr_map_t> conj_aggr_windows;
 
     // NOTE: IMPORTANT! past this point, all the remaining data members
     // are set up automatically at the beginning of each integration
@@ -130,6 +226,10 @@ struct sim::sim_data {
     //   (see dense_propagate()).
     std::vector<double> final_state;
 
+    // Buffer used to assemble the state snapshots
+    // computed via dense output (see write_snapshots()).
+    std::vector<double> snap_state;
+
     // The integrator caches.
     // NOTE: the integrators in the caches are those
     // actually used in numerical propagations.
@@ -137,6 +237,9 @@ struct sim::sim_data {
     struct batch_data {
         heyoka::taylor_adaptive_batch<double> ta;
         std::vector<double> pfor_ts;
+        // Scratch buffer for the economisation
+        // of the trajectories (see compute_det_tcs()).
+        std::vector<double> det_work;
     };
     oneapi::tbb::concurrent_queue<std::unique_ptr<batch_data>> b_ta_cache;
 
@@ -155,6 +258,15 @@ struct sim::sim_data {
         std::vector<double, detail::no_init_alloc<double>> tcs;
         // Time coordinates of the end of each substep.
         std::vector<heyoka::detail::dfloat<double>> tcoords;
+        // Economised polynomials of the positions, used in the narrow
+        // phase if the detection order is in use (see sim::compute_det_tcs()).
+        // The layout is the same as in tcs, with dimensions
+        // (n_substeps, 3, det_order + 1).
+        std::vector<double, detail::no_init_alloc<double>> det_tcs;
+        // Upper bounds on the distance between the positions computed
+        // via the economised polynomials and via the Taylor
+        // polynomials, one for each substep.
+        std::vector<double> det_err;
     };
     std::vector<step_data> s_data;
 
@@ -291,6 +403,34 @@ struct sim::sim_data {
         // Local list of detected conjunctions (same role as the bp
         // member in bp_data).
         std::vector<conjunction> local_conj_vec;
+        // Sorted list of threshold crossing times, used to compute the time
+        // spent below the conjunction thresholds in aggregation mode.
+        std::vector<double> tu_crossings;
+        // Local list of time intervals spent below the conjunction
+        // thresholds (see conj_tu_vecs).
+        std::vector<std::tuple<size_type, size_type, size_type, double, double>> local_tu_vec;
+        // Buffers used to compute the polynomials of the screening volume
+        // predicates: input/output of the compiled predicates, values
+        // of the predicates at the interpolation nodes and coefficients
+        // of the interpolating polynomials.
+        std::vector<double> svol_input, svol_output, svol_vals, svol_polys;
+        // Estimates of the interpolation errors of the predicate polynomials.
+        std::vector<double> svol_errs;
+        // Times at which the secondary crosses the boundaries
+        // of the screening volume.
+        std::vector<double> svol_crossings;
+        // Buffers used to screen the trajectories via the economised
+        // polynomials: the input for det_pssdiff3_cfunc (i.e., the
+        // translated polynomials of the positions) and its output.
+        std::vector<double> det_diff_input, det_ss_diff;
+        // Polynomial cache, working list and list of isolating intervals
+        // for the real root isolation on the economised polynomials.
+        // NOTE: same ordering requirements as r_iso_cache/wlist.
+        std::vector<std::vector<double>> det_r_iso_cache;
+        wlist_t det_wlist;
+        isol_t det_isol;
+        // The roots of the economised polynomials.
+        std::vector<std::tuple<size_type, size_type, double>> det_roots;
     };
     // NOTE: indirect through a unique_ptr, because for some reason a std::vector of
     // concurrent_queue requires copy ctability of np_data, which is not available due to
@@ -304,6 +444,16 @@ struct sim::sim_data {
     oneapi::tbb::concurrent_vector<std::tuple<size_type, size_type, double>> coll_vec;
     // Chunk-local vectors of detected conjunctions.
     std::vector<oneapi::tbb::concurrent_vector<conjunction>> conj_vecs;
+    // Offsets in m_det_conj at which the content of the
+    // chunk-local vectors of detected conjunctions is placed.
+    std::vector<size_type> conj_offsets;
+    // Chunk-local vectors of time intervals within which pairs of
+    // particles are closer than the threshold of a conjunction tier. The tuple
+    // contains the indices of the 2 particles, the tier index and the begin/end
+    // of the time interval, relative to the beginning of the superstep.
+    // NOTE: these are filled in only if conjunction aggregation is active.
+    std::vector<oneapi::tbb::concurrent_vector<std::tuple<size_type, size_type, size_type, double, double>>>
+        conj_tu_vecs;
 
     // Structures to record terminal events and nf_error conditions.
     // NOTE: these cannot be chunk-local because they are written to
@@ -0,0 +1,80 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_ENSEMBLE_HPP
+#define CASCADE_ENSEMBLE_HPP
+
+#include <vector>
+
+#include <cascade/detail/visibility.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+// Ensemble of simulations differing only in the initial
+// state (and, optionally, in the values of the parameters),
+// e.g., for Monte Carlo studies.
+//
+// The members of the ensemble are copies of a prototype simulation, thus
+// they share its compiled code and its settings (dynamics, collisional
+// timestep, reentry/exit radii, conjunction threshold, etc.). The conjunction
+// sink, the snapshot writer, the checkpointer and the ephemeris writer of the
+// prototype are not copied, but they can be set up on each member separately.
+//
+// propagate_until() propagates all the members concurrently. The collisions,
+// reentries and exits are handled within each member by removing the
+// particles involved and resuming the propagation, while a member producing
+// a non-finite state is stopped. The outcome is recorded in a compact
+// per-member summary.
+class CASCADE_DLL_PUBLIC ensemble
+{
+public:
+    using size_type = sim::size_type;
+
+    struct summary {
+        // The outcome of the last propagation (err_nf_state
+        // if the member was stopped).
+        outcome oc = outcome::time_limit;
+        // Number of collisions, reentries and exits.
+        size_type n_collisions = 0;
+        size_type n_reentries = 0;
+        size_type n_exits = 0;
+        // Number of conjunctions detected during the propagations.
+        size_type n_conjunctions = 0;
+    };
+
+private:
+    std::vector<sim> m_members;
+    std::vector<summary> m_summaries;
+
+    CASCADE_DLL_LOCAL void propagate_member(size_type, double);
+
+public:
+    ensemble();
+    explicit ensemble(const sim &, std::vector<std::vector<double>>, std::vector<std::vector<double>> = {});
+
+    [[nodiscard]] size_type get_size() const
+    {
+        return m_members.size();
+    }
+
+    [[nodiscard]] const sim &get_member(size_type) const;
+    sim &get_member(size_type);
+
+    [[nodiscard]] const auto &get_summaries() const
+    {
+        return m_summaries;
+    }
+
+    void propagate_until(double);
+};
+
+} // namespace cascade
+
+#endif
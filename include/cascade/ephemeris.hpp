@@ -0,0 +1,184 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_EPHEMERIS_HPP
+#define CASCADE_EPHEMERIS_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/igor.hpp>
+
+#include <cascade/detail/visibility.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(cheby_tol);
+
+} // namespace kw
+
+// Writer of ephemeris archives.
+//
+// When set on a sim via sim::set_ephemeris_writer(), the writer appends
+// to the archive file a block at the end of each step. A block contains
+// the trajectories of the particles during the superstep as piecewise polynomials,
+// from which the state of the particles can be reconstructed at any time via
+// an ephemeris_reader without re-propagating. The trajectories are stored either as:
+// - the Taylor polynomials of the position and velocity of the particles
+//   in each substep (if cheby_tol is zero, the default), that is, the exact
+//   trajectories computed by the sim, or
+// - Chebyshev series re-fitted to the Taylor polynomials over each
+//   collisional timestep (or a fraction thereof), with the lowest degree
+//   meeting the position tolerance cheby_tol (and the tolerance
+//   cheby_tol / (dt / 2) on the velocities, dt being the size of the fitting
+//   interval). This is usually much more compact than the Taylor representation.
+//
+// The file begins with a 16-byte header containing a magic string
+// and the format version. Each block is made of:
+// - a header of 9 64-bit values: the size in bytes of the block, the number of
+//   particles, the kind of block (0 for Taylor, 1 for Chebyshev), the Taylor order
+//   (or the maximum degree of the Chebyshev series), the total number of segments, the
+//   time coordinate of the beginning of the superstep (as a double-length float) and the time
+//   coordinate of the end of the validity range of the block (idem),
+// - the per-particle index, i.e., the offsets of the segments
+//   of each particle (nparts + 1 unsigned 64-bit integers),
+// - the ids of the particles (nparts unsigned 64-bit integers, see sim::get_ids()),
+// - the time coordinates of the end of each segment relative to the
+//   beginning of the superstep (as double-length floats),
+// - for Taylor blocks, the Taylor coefficients of each segment, stored as a
+//   row-major 3D array of doubles with dimensions (n_segments, order + 1, 6),
+// - for Chebyshev blocks, the offsets of the coefficients of each segment
+//   (n_segments + 1 unsigned 64-bit integers) followed by the coefficients. The
+//   coefficients of a segment are stored as a row-major 2D array of doubles
+//   with dimensions (6, n), n being the number of coefficients of the series.
+// NOTE: the particle indices in each block are the indices of the particles
+// in the sim at the time of the superstep, which change
+// when particles are removed from the sim. The particle ids
+// instead identify the particles across all the blocks.
+// NOTE: the blocks are written in the native byte order and they
+// are not compressed, so that they can be evaluated in place
+// from a memory mapping of the file.
+class CASCADE_DLL_PUBLIC ephemeris_writer
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+    void finalise_ctor(std::string, double);
+    std::uint64_t write_taylor(const sim &, const heyoka::detail::dfloat<double> &);
+    std::uint64_t write_cheby(const sim &, const heyoka::detail::dfloat<double> &);
+
+    // NOTE: private delegating constructor, used so that
+    // the generic constructor does not need the complete
+    // definition of impl (see the analogous machinery in sim).
+    struct ptag_t {
+    };
+    explicit ephemeris_writer(ptag_t);
+
+public:
+    template <typename... KwArgs>
+    explicit ephemeris_writer(std::string path, KwArgs &&...kw_args) : ephemeris_writer(ptag_t{})
+    {
+        igor::parser p{kw_args...};
+
+        // LCOV_EXCL_START
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of an ephemeris_writer "
+                          "contain unnamed arguments.");
+            throw;
+        }
+        // LCOV_EXCL_STOP
+
+        // Chebyshev re-fitting tolerance (defaults to zero,
+        // i.e., the Taylor coefficients are stored).
+        double cheby_tol = 0;
+        if constexpr (p.has(kw::cheby_tol)) {
+            if constexpr (std::is_arithmetic_v<std::remove_cvref_t<decltype(p(kw::cheby_tol))>>) {
+                cheby_tol = static_cast<double>(p(kw::cheby_tol));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'cheby_tol' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        finalise_ctor(std::move(path), cheby_tol);
+    }
+    ephemeris_writer(const ephemeris_writer &) = delete;
+    ephemeris_writer(ephemeris_writer &&) = delete;
+    ephemeris_writer &operator=(const ephemeris_writer &) = delete;
+    ephemeris_writer &operator=(ephemeris_writer &&) = delete;
+    ~ephemeris_writer();
+
+    [[nodiscard]] const std::string &get_path() const;
+    [[nodiscard]] double get_cheby_tol() const;
+    [[nodiscard]] std::uint64_t get_n_blocks() const;
+    [[nodiscard]] std::uint64_t get_n_bytes() const;
+
+    // NOTE: this is used by the sim class to
+    // write the block of the superstep which
+    // began at the input time coordinate.
+    void superstep_done(const sim &, const heyoka::detail::dfloat<double> &);
+};
+
+// Reader of ephemeris archives.
+//
+// The archive file is memory-mapped, and the blocks which are complete
+// at the time of construction are indexed by time. The state of a particle
+// at the time t is computed from the last block whose superstep begins at
+// or before t, via the evaluation of the polynomials of the segment
+// containing t. An exception is raised if t is past the end of the
+// validity range of the block.
+//
+// The particles can be identified either via their indices at the
+// time of the query or via their ids (see sim::get_ids()).
+//
+// The states are returned as the 6 values x, y, z, vx, vy, vz.
+class CASCADE_DLL_PUBLIC ephemeris_reader
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+public:
+    explicit ephemeris_reader(const std::string &);
+    ephemeris_reader(const ephemeris_reader &) = delete;
+    ephemeris_reader(ephemeris_reader &&) = delete;
+    ephemeris_reader &operator=(const ephemeris_reader &) = delete;
+    ephemeris_reader &operator=(ephemeris_reader &&) = delete;
+    ~ephemeris_reader();
+
+    [[nodiscard]] std::uint64_t get_n_blocks() const;
+    [[nodiscard]] std::pair<double, double> get_time_range() const;
+    [[nodiscard]] sim::size_type get_nparts(double) const;
+    [[nodiscard]] std::vector<std::uint64_t> get_ids(double) const;
+    [[nodiscard]] sim::size_type id_to_index(std::uint64_t, double) const;
+
+    [[nodiscard]] std::array<double, 6> get_state(sim::size_type, double) const;
+    [[nodiscard]] std::array<double, 6> get_state_by_id(std::uint64_t, double) const;
+    [[nodiscard]] std::vector<double> get_states(double) const;
+    void get_states(std::span<const sim::size_type>, std::span<const double>, std::span<double>) const;
+};
+
+} // namespace cascade
+
+#endif
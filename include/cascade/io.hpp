@@ -0,0 +1,40 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_IO_HPP
+#define CASCADE_IO_HPP
+
+#include <string>
+#include <vector>
+
+#include <cascade/detail/visibility.hpp>
+
+namespace cascade::io
+{
+
+// Loaders for initial conditions and parameters.
+//
+// The returned vectors are flat (i.e., row-major for
+// multidimensional data) and they can be moved directly
+// into the constructor of a sim, e.g.:
+//
+// sim s(io::load_text("state.txt"), ct, kw::pars = io::load_text("pars.txt"));
+
+// Load the whitespace-separated floating-point values contained
+// in the text file at the input path (e.g., one value per line).
+// The file is memory-mapped and parsed in parallel.
+CASCADE_DLL_PUBLIC std::vector<double> load_text(const std::string &);
+
+// Load the floating-point dataset with the input name from
+// the HDF5 file at the input path.
+// NOTE: this requires cascade to be compiled with HDF5 support.
+CASCADE_DLL_PUBLIC std::vector<double> load_hdf5(const std::string &, const std::string &);
+
+} // namespace cascade::io
+
+#endif
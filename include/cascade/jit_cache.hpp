@@ -0,0 +1,70 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_JIT_CACHE_HPP
+#define CASCADE_JIT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <cascade/detail/visibility.hpp>
+
+namespace cascade::jit_cache
+{
+
+// Settings of the on-disk cache of JIT-compiled code.
+//
+// When a cache directory is set, the construction of a sim
+// stores into the directory the integrators and the JIT-compiled
+// functions, keyed by the dynamics, the event equations, the integrator
+// settings, the heyoka and LLVM versions and the model and features of
+// the host CPU. A later
+// construction with the same key (possibly in another process) loads the
+// compiled code from the cache instead of compiling it again.
+//
+// The cache directory is initially read from the CASCADE_JIT_CACHE_DIR
+// environment variable. An empty path disables the cache (this is the default
+// if the environment variable is not set).
+CASCADE_DLL_PUBLIC void set_dir(const std::string &);
+CASCADE_DLL_PUBLIC std::string get_dir();
+
+// Maximum size (in bytes) of the cache directory. After an entry is
+// added to the cache, the least-recently used entries are removed
+// until the total size of the entries does not exceed this limit.
+CASCADE_DLL_PUBLIC void set_max_size(std::uintmax_t);
+CASCADE_DLL_PUBLIC std::uintmax_t get_max_size();
+
+// Directory of the precompiled entries. These are the entries for the
+// standard dynamics (see dynamics::kepler()) which are generated when
+// building cascade with the CASCADE_PRECOMPILE_JIT option, and which are
+// installed alongside the library. The precompiled entries are looked up
+// after the cache directory and they are never modified. An empty path
+// disables the lookup (this is the default if cascade was built
+// without the CASCADE_PRECOMPILE_JIT option).
+CASCADE_DLL_PUBLIC void set_precompiled_dir(const std::string &);
+CASCADE_DLL_PUBLIC std::string get_precompiled_dir();
+
+// Total size (in bytes) of the entries in the cache directory.
+CASCADE_DLL_PUBLIC std::uintmax_t get_size();
+
+// Remove all the entries from the cache directory.
+CASCADE_DLL_PUBLIC void clear();
+
+// Independently of the on-disk cache, the compiled code is also kept
+// in a process-wide registry, so that constructing a sim whose setup
+// matches that of a sim which is still alive does not need any
+// compilation or disk access. An entry of the registry is released
+// as soon as all the sims constructed from it are destroyed.
+//
+// Number of live entries in the registry.
+CASCADE_DLL_PUBLIC std::size_t get_registry_size();
+
+} // namespace cascade::jit_cache
+
+#endif
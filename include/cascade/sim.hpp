@@ -10,14 +10,18 @@
 #define CASCADE_SIM_HPP
 
 #include <array>
+#include <chrono>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <ranges>
+#include <span>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_set>
@@ -29,8 +33,10 @@
 
 #include <fmt/core.h>
 
+#include <heyoka/detail/dfloat.hpp>
 #include <heyoka/detail/igor.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/s11n.hpp>
 
 #include <cascade/detail/fmt_compat.hpp>
 #include <cascade/detail/visibility.hpp>
@@ -50,6 +56,8 @@ namespace dynamics
 {
 
 CASCADE_DLL_PUBLIC std::vector<std::pair<heyoka::expression, heyoka::expression>> kepler(double = 1.);
+CASCADE_DLL_PUBLIC std::vector<std::pair<heyoka::expression, heyoka::expression>>
+simple_earth(bool = true, bool = false, bool = true, bool = false, bool = false, bool = false, bool = true);
 
 } // namespace dynamics
 
@@ -67,6 +75,12 @@ IGOR_MAKE_NAMED_ARGUMENT(conj_thresh);
 IGOR_MAKE_NAMED_ARGUMENT(min_coll_radius);
 IGOR_MAKE_NAMED_ARGUMENT(coll_whitelist);
 IGOR_MAKE_NAMED_ARGUMENT(conj_whitelist);
+IGOR_MAKE_NAMED_ARGUMENT(coll_whitelist_ids);
+IGOR_MAKE_NAMED_ARGUMENT(conj_whitelist_ids);
+IGOR_MAKE_NAMED_ARGUMENT(conj_aggr);
+IGOR_MAKE_NAMED_ARGUMENT(conj_aggr_window);
+IGOR_MAKE_NAMED_ARGUMENT(screening_volume);
+IGOR_MAKE_NAMED_ARGUMENT(det_order);
 
 } // namespace kw
 
@@ -80,6 +94,114 @@ CASCADE_CONCEPT_DECL di_range
 
 enum class outcome { success, time_limit, collision, reentry, exit, err_nf_state };
 
+// Conjunction aggregation modes:
+// - none: every distance minimum below the conjunction
+//   threshold is recorded as a separate conjunction,
+// - superstep: for each pair of particles, only the closest approach
+//   within each superstep is recorded,
+// - window: for each pair of particles, only the closest approach
+//   within each aggregation window is recorded. The aggregation windows
+//   are the time intervals [k*w, (k+1)*w), where w is the window length.
+enum class conj_aggr_mode { none, superstep, window };
+
+namespace detail
+{
+
+// Read-only snapshot of the time coordinate, the
+// state and the parameters of a simulation.
+struct sim_state_snapshot {
+    double time = 0;
+    std::shared_ptr<const std::vector<double>> state;
+    std::shared_ptr<const std::vector<double>> pars;
+};
+
+// The asynchronous operation (if any) running on a simulation (see
+// sim::step_async()), together with the snapshot taken at its launch.
+// NOTE: copying, moving, assigning or destroying the operation waits for its
+// completion. This is the first data member of sim, so that the other data
+// members are never copied or moved while an operation is running on them.
+class sim_async_op
+{
+public:
+    std::shared_future<outcome> fut;
+    std::optional<sim_state_snapshot> snapshot;
+
+    sim_async_op() = default;
+    sim_async_op(const sim_async_op &other) : snapshot(other.wait_snapshot()) {}
+    sim_async_op(sim_async_op &&other) noexcept : snapshot(other.wait_snapshot()) {}
+    ~sim_async_op()
+    {
+        wait();
+    }
+
+    sim_async_op &operator=(const sim_async_op &other)
+    {
+        if (this != &other) {
+            wait();
+            snapshot = other.wait_snapshot();
+        }
+
+        return *this;
+    }
+    sim_async_op &operator=(sim_async_op &&other) noexcept
+    {
+        return *this = static_cast<const sim_async_op &>(other);
+    }
+
+    void wait() const noexcept
+    {
+        if (fut.valid()) {
+            fut.wait();
+        }
+    }
+    [[nodiscard]] bool running() const
+    {
+        return fut.valid() && fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+
+private:
+    const std::optional<sim_state_snapshot> &wait_snapshot() const noexcept
+    {
+        wait();
+
+        return snapshot;
+    }
+};
+
+} // namespace detail
+
+class conj_sink;
+class snapshot_writer;
+class checkpointer;
+class ephemeris_writer;
+
+// Screening volume for conjunction detection.
+//
+// A screening volume is the intersection of the regions of space in which
+// a list of predicates is negative. The predicates are expressions of the state
+// of the primary particle (variables x, y, z, vx, vy, vz) and of the state
+// of the secondary particle relative to the primary (variables dx, dy, dz,
+// dvx, dvy, dvz). The bounding radius is the radius of a sphere centred
+// on the primary which fully contains the screening volume.
+class CASCADE_DLL_PUBLIC screening_volume
+{
+    std::vector<heyoka::expression> m_preds;
+    double m_bradius = 0;
+
+public:
+    explicit screening_volume(std::vector<heyoka::expression>, double);
+
+    // Built-in screening volumes defined in the radial/in-track/cross-track
+    // frame of the primary particle.
+    static screening_volume ric_ellipsoid(double, double, double);
+    static screening_volume ric_box(double, double, double);
+
+    [[nodiscard]] const std::vector<heyoka::expression> &get_predicates() const;
+    [[nodiscard]] double get_bounding_radius() const;
+
+    static const std::array<std::string, 12> &get_variables();
+};
+
 class CASCADE_DLL_PUBLIC sim
 {
 public:
@@ -91,6 +213,10 @@ public:
         size_type i = 0;
         size_type j = 0;
 
+        // Ids of the two particles.
+        std::uint64_t id_i = 0;
+        std::uint64_t id_j = 0;
+
         // Absolute time coordinate.
         double time = 0;
 
@@ -100,16 +226,48 @@ public:
         // State of the two particles.
         std::array<double, 6> state_i = {};
         std::array<double, 6> state_j = {};
+
+        // Conjunction tier, that is, the index of the smallest
+        // conjunction threshold greater than the conjunction distance.
+        size_type tier = 0;
+
+        // Number of distance minima below the conjunction threshold
+        // and total time spent below the conjunction threshold. These
+        // are meaningful only when conjunction aggregation is active
+        // (otherwise, they are always 1 and 0 respectively).
+        size_type n_min = 1;
+        double time_under = 0;
+    };
+
+    // An error raised by one of the output components (conjunction sink,
+    // snapshot writer, ephemeris writer, checkpointer) at the end of a step.
+    struct output_error {
+        // The name of the component.
+        std::string component;
+        // The time coordinate at the end of the last
+        // step in which the component failed.
+        double time = 0;
+        // The error message of the last failure.
+        std::string message;
+        // The number of failures.
+        std::uint64_t count = 0;
     };
 
     // The whitelist type.
     // NOTE: consider replacing this with the new Boost
     // flat unordered set in the future.
     using whitelist_t = std::unordered_set<size_type>;
+    // The type of the whitelists expressed
+    // via particle ids (see get_ids()).
+    using id_whitelist_t = std::unordered_set<std::uint64_t>;
 
 private:
     struct sim_data;
 
+    // NOTE: this must be the first data member
+    // (see the explanation in sim_async_op).
+    detail::sim_async_op m_async;
+
     // NOTE: wrap into shared pointers to enable
     // safe resizing on the Python side: when a
     // NumPy array is constructed from the internal
@@ -121,6 +279,19 @@ private:
     // will be invalidated under certain circumstances.
     std::shared_ptr<std::vector<double>> m_state;
     std::shared_ptr<std::vector<double>> m_pars;
+    // The particle ids, that is, the map from the particle
+    // indices to the ids. The ids are assigned in ascending order
+    // when the particles are inserted and they are never reused,
+    // thus m_ids is always sorted in ascending order and the
+    // map from the ids to the indices is a binary search.
+    // NOTE: we do not maintain a hash map from the ids to the
+    // indices because the removal of particles shifts the indices
+    // of all the following particles, which would require rebuilding
+    // the map at every removal. The O(log(n)) cost of the lookups
+    // is negligible with respect to the cost of a step.
+    std::vector<std::uint64_t> m_ids;
+    // The id which will be assigned to the next inserted particle.
+    std::uint64_t m_next_id = 0;
     // The collisional timestep.
     double m_ct = 0;
     // The number of collisional timesteps
@@ -134,29 +305,61 @@ private:
     //   in which the non-finite step was generated, measured relative to the beginning
     //   of the superstep).
     std::optional<std::variant<std::array<size_type, 2>, size_type, std::tuple<size_type, double>>> m_int_info;
+    // The interrupt info expressed in terms of particle ids.
+    // NOTE: this is set up together with m_int_info, so that it
+    // remains valid after the modification of the set of particles.
+    std::optional<std::variant<std::array<std::uint64_t, 2>, std::uint64_t, std::tuple<std::uint64_t, double>>>
+        m_int_ids;
     // Reentry radius(es).
     std::variant<double, std::vector<double>> m_reentry_radius;
     // Exit radius.
     double m_exit_radius = 0;
     // Number of params in the dynamics.
     std::uint32_t m_npars = 0;
-    // Conjunction threshold
+    // Conjunction threshold (i.e., the largest
+    // conjunction tier, or zero if no tiers are defined).
     double m_conj_thresh = 0;
+    // Conjunction tiers, sorted in ascending order.
+    std::vector<double> m_conj_tiers;
+    // Number of conjunctions recorded in m_det_conj
+    // for each conjunction tier.
+    std::vector<size_type> m_conj_tier_counts;
     // List of detected conjunctions.
     // NOTE: wrap into shared_ptr for the same
     // reasons explained above for m_state.
     std::shared_ptr<std::vector<conjunction>> m_det_conj;
     // Minimum collisional radius.
     double m_min_coll_radius = 0;
+    // Conjunction aggregation mode and window.
+    conj_aggr_mode m_conj_aggr = conj_aggr_mode::none;
+    double m_conj_aggr_window = 0;
     // The whitelists.
     whitelist_t m_coll_whitelist, m_conj_whitelist;
+    // The screening volume.
+    std::optional<screening_volume> m_svol;
+    // The degree of the economised polynomials used to screen
+    // the trajectories in the narrow phase (zero if not used).
+    std::uint32_t m_det_order = 0;
+    // The conjunction sink.
+    std::shared_ptr<conj_sink> m_conj_sink;
+    // The snapshot writer.
+    std::shared_ptr<snapshot_writer> m_snap_writer;
+    // The checkpointer.
+    std::shared_ptr<checkpointer> m_ckpt;
+    // The ephemeris writer.
+    std::shared_ptr<ephemeris_writer> m_eph_writer;
+    // The errors raised by the output components since the
+    // last call to clear_output_errors(), one entry per component.
+    // NOTE: like the output components, these are
+    // neither copied nor serialised.
+    std::vector<output_error> m_output_errors;
     // The internal implementation-detail data (buffers, caches, etc.).
     std::unique_ptr<sim_data> m_data;
 
     void finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expression>>, std::vector<double>,
-                       std::variant<double, std::vector<double>>, double, double, bool, std::uint32_t, double, double,
-                       whitelist_t, whitelist_t);
-    CASCADE_DLL_LOCAL void add_jit_functions();
+                       std::variant<double, std::vector<double>>, double, double, bool, std::uint32_t,
+                       std::variant<double, std::vector<double>>, double, whitelist_t, whitelist_t, conj_aggr_mode,
+                       double, std::optional<screening_volume>, std::uint32_t);
     CASCADE_DLL_LOCAL void morton_encode_sort_parallel();
     CASCADE_DLL_LOCAL void construct_bvh_trees_parallel();
     CASCADE_DLL_LOCAL void verify_bvh_trees_parallel() const;
@@ -165,22 +368,60 @@ private:
     CASCADE_DLL_LOCAL void narrow_phase_parallel();
     CASCADE_DLL_LOCAL void verify_global_aabbs() const;
     CASCADE_DLL_LOCAL void dense_propagate(double);
+    CASCADE_DLL_LOCAL outcome step_impl();
     template <typename T>
     CASCADE_DLL_LOCAL outcome propagate_until_impl(const T &);
+    template <typename F>
+    CASCADE_DLL_LOCAL std::shared_future<outcome> launch_async(F);
     [[nodiscard]] CASCADE_DLL_LOCAL bool with_reentry_event() const;
     [[nodiscard]] CASCADE_DLL_LOCAL bool with_exit_event() const;
     [[nodiscard]] CASCADE_DLL_LOCAL std::uint32_t reentry_event_idx() const;
     [[nodiscard]] CASCADE_DLL_LOCAL std::uint32_t exit_event_idx() const;
-    CASCADE_DLL_LOCAL void verify_state_vector(const std::vector<double> &) const;
+    CASCADE_DLL_LOCAL void verify_state_vector(std::span<const double>, size_type = 0,
+                                               std::span<const size_type> = {}) const;
     CASCADE_DLL_LOCAL void copy_from_final_state() noexcept;
-    CASCADE_DLL_LOCAL void validate_pars_vector(std::vector<double> &, size_type) const;
+    CASCADE_DLL_LOCAL void validate_pars_vector(std::span<const double>, size_type) const;
     template <typename T>
     CASCADE_DLL_LOCAL void init_scalar_ta(T &, size_type) const;
     template <typename T>
     CASCADE_DLL_LOCAL void init_batch_ta(T &, size_type, size_type) const;
     template <typename T>
     CASCADE_DLL_LOCAL void compute_particle_aabb(unsigned, const T &, const T &, size_type);
+    [[nodiscard]] CASCADE_DLL_LOCAL bool with_det_order() const;
+    CASCADE_DLL_LOCAL void compute_det_tcs(size_type, std::vector<double> &);
     CASCADE_DLL_LOCAL std::vector<conjunction>::iterator append_conj_data(void *) noexcept;
+    CASCADE_DLL_LOCAL void update_conj_tier_counts(std::vector<conjunction>::const_iterator) noexcept;
+    CASCADE_DLL_LOCAL void update_int_ids() noexcept;
+    CASCADE_DLL_LOCAL void assign_conj_ids(std::vector<conjunction>::iterator) noexcept;
+    [[nodiscard]] CASCADE_DLL_LOCAL std::uint64_t append_new_ids(std::vector<std::uint64_t> &, size_type) const;
+    [[nodiscard]] CASCADE_DLL_LOCAL id_whitelist_t whitelist_to_ids(const whitelist_t &) const;
+    [[nodiscard]] CASCADE_DLL_LOCAL whitelist_t ids_to_whitelist(const id_whitelist_t &) const;
+    CASCADE_DLL_LOCAL void push_conj_sink();
+    CASCADE_DLL_LOCAL void write_snapshots(double);
+    CASCADE_DLL_LOCAL void run_outputs(const heyoka::detail::dfloat<double> &) noexcept;
+    [[nodiscard]] CASCADE_DLL_LOCAL double get_conj_screening_radius() const;
+    [[nodiscard]] CASCADE_DLL_LOCAL std::int64_t conj_aggr_window_idx(double) const;
+    CASCADE_DLL_LOCAL void reserve_conj_data(size_type);
+    CASCADE_DLL_LOCAL void conj_aggr_prepare(double, double, double);
+    CASCADE_DLL_LOCAL void conj_aggr_merge(double, double, double, void *) noexcept;
+    CASCADE_DLL_LOCAL void conj_aggr_flush(std::optional<std::int64_t>) noexcept;
+
+    // Serialisation.
+    // NOTE: the conjunction sink, the snapshot writer, the checkpointer
+    // and the ephemeris writer are not serialised.
+    friend class boost::serialization::access;
+    void save(boost::archive::binary_oarchive &, unsigned) const;
+    void load(boost::archive::binary_iarchive &, unsigned);
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+    // NOTE: these are used by the checkpointer
+    // class for the incremental checkpoints.
+    friend class checkpointer;
+    CASCADE_DLL_LOCAL void save_delta(boost::archive::binary_oarchive &, size_type, bool) const;
+    CASCADE_DLL_LOCAL void load_delta(boost::archive::binary_iarchive &, bool,
+                                      std::optional<std::vector<std::uint64_t>>);
+    // NOTE: the ephemeris writer needs access
+    // to the Taylor coefficients of the superstep.
+    friend class ephemeris_writer;
 
     // Private delegating constructor machinery. This is used
     // in the generic constructor to move the initialisation of
@@ -312,11 +553,22 @@ public:
             }
         }
 
-        // Conjunction threshold (defaults to zero).
-        double conj_thresh = 0;
+        // Conjunction threshold (defaults to zero). A range of values
+        // can also be passed in order to define multiple conjunction tiers.
+        std::variant<double, std::vector<double>> conj_thresh(0.);
         if constexpr (p.has(kw::conj_thresh)) {
             if constexpr (std::convertible_to<decltype(p(kw::conj_thresh)), double>) {
                 conj_thresh = static_cast<double>(std::forward<decltype(p(kw::conj_thresh))>(p(kw::conj_thresh)));
+            } else if constexpr (di_range<decltype(p(kw::conj_thresh))>) {
+                // NOTE: turn it into an lvalue.
+                auto &&tmp_range = p(kw::conj_thresh);
+
+                std::vector<double> vd;
+                for (auto &&val : tmp_range) {
+                    vd.push_back(static_cast<double>(val));
+                }
+
+                conj_thresh = std::move(vd);
             } else {
                 // LCOV_EXCL_START
                 static_assert(detail::always_false_v<KwArgs...>,
@@ -364,8 +616,112 @@ public:
             }
         }
 
+        // The whitelists expressed via particle ids. They are mutually
+        // exclusive with the index-based whitelists.
+        // NOTE: the ids are converted to indices at the end of the
+        // constructor, after the particle ids have been assigned.
+        id_whitelist_t coll_whitelist_ids;
+        if constexpr (p.has(kw::coll_whitelist_ids)) {
+            if constexpr (p.has(kw::coll_whitelist)) {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'coll_whitelist' and 'coll_whitelist_ids' keyword arguments "
+                              "cannot be used together.");
+                // LCOV_EXCL_STOP
+            } else if constexpr (std::is_assignable_v<id_whitelist_t &, decltype(p(kw::coll_whitelist_ids))>) {
+                coll_whitelist_ids = std::forward<decltype(p(kw::coll_whitelist_ids))>(p(kw::coll_whitelist_ids));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'coll_whitelist_ids' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        id_whitelist_t conj_whitelist_ids;
+        if constexpr (p.has(kw::conj_whitelist_ids)) {
+            if constexpr (p.has(kw::conj_whitelist)) {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'conj_whitelist' and 'conj_whitelist_ids' keyword arguments "
+                              "cannot be used together.");
+                // LCOV_EXCL_STOP
+            } else if constexpr (std::is_assignable_v<id_whitelist_t &, decltype(p(kw::conj_whitelist_ids))>) {
+                conj_whitelist_ids = std::forward<decltype(p(kw::conj_whitelist_ids))>(p(kw::conj_whitelist_ids));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'conj_whitelist_ids' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Conjunction aggregation mode (defaults to none).
+        auto conj_aggr = conj_aggr_mode::none;
+        if constexpr (p.has(kw::conj_aggr)) {
+            if constexpr (std::convertible_to<decltype(p(kw::conj_aggr)), conj_aggr_mode>) {
+                conj_aggr = static_cast<conj_aggr_mode>(std::forward<decltype(p(kw::conj_aggr))>(p(kw::conj_aggr)));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'conj_aggr' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Conjunction aggregation window (defaults to zero, which
+        // is valid only if the aggregation mode is not 'window').
+        double conj_aggr_window = 0;
+        if constexpr (p.has(kw::conj_aggr_window)) {
+            if constexpr (std::convertible_to<decltype(p(kw::conj_aggr_window)), double>) {
+                conj_aggr_window
+                    = static_cast<double>(std::forward<decltype(p(kw::conj_aggr_window))>(p(kw::conj_aggr_window)));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'conj_aggr_window' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Screening volume (defaults to none, which means that
+        // conjunctions are detected only via the conjunction threshold).
+        std::optional<screening_volume> svol;
+        if constexpr (p.has(kw::screening_volume)) {
+            if constexpr (std::convertible_to<decltype(p(kw::screening_volume)), screening_volume>) {
+                svol.emplace(std::forward<decltype(p(kw::screening_volume))>(p(kw::screening_volume)));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'screening_volume' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Detection order (defaults to zero, which means that the
+        // narrow phase uses only the Taylor polynomials of the integrator).
+        std::uint32_t det_order = 0;
+        if constexpr (p.has(kw::det_order)) {
+            if constexpr (std::integral<std::remove_cvref_t<decltype(p(kw::det_order))>>) {
+                det_order = boost::numeric_cast<std::uint32_t>(p(kw::det_order));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'det_order' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
         finalise_ctor(std::move(dyn), std::move(pars), std::move(reentry_radius), exit_radius, tol, ha, n_par_ct,
-                      conj_thresh, min_coll_radius, std::move(coll_whitelist), std::move(conj_whitelist));
+                      std::move(conj_thresh), min_coll_radius, std::move(coll_whitelist), std::move(conj_whitelist),
+                      conj_aggr, conj_aggr_window, std::move(svol), det_order);
+
+        if constexpr (p.has(kw::coll_whitelist_ids)) {
+            set_coll_whitelist_ids(coll_whitelist_ids);
+        }
+        if constexpr (p.has(kw::conj_whitelist_ids)) {
+            set_conj_whitelist_ids(conj_whitelist_ids);
+        }
     }
     sim(const sim &);
     sim(sim &&) noexcept;
@@ -379,6 +735,10 @@ public:
     {
         return m_int_info;
     }
+    [[nodiscard]] const auto &get_interrupt_ids() const
+    {
+        return m_int_ids;
+    }
 
     [[nodiscard]] const auto &get_state() const
     {
@@ -411,6 +771,13 @@ public:
         return get_state().size() / 7u;
     }
 
+    // Stable particle ids.
+    [[nodiscard]] const auto &get_ids() const
+    {
+        return m_ids;
+    }
+    [[nodiscard]] size_type id_to_index(std::uint64_t) const;
+
     [[nodiscard]] double get_time() const;
     void set_time(double);
 
@@ -436,12 +803,74 @@ public:
         return m_conj_thresh;
     }
     void set_conj_thresh(double);
+    [[nodiscard]] const auto &get_conj_tiers() const
+    {
+        return m_conj_tiers;
+    }
+    void set_conj_tiers(std::vector<double>);
+    [[nodiscard]] const auto &get_conj_tier_counts() const
+    {
+        return m_conj_tier_counts;
+    }
     [[nodiscard]] const auto &get_conjunctions() const
     {
         return *m_det_conj;
     }
     void reset_conjunctions();
 
+    [[nodiscard]] conj_aggr_mode get_conj_aggr() const
+    {
+        return m_conj_aggr;
+    }
+    void set_conj_aggr(conj_aggr_mode);
+    [[nodiscard]] double get_conj_aggr_window() const
+    {
+        return m_conj_aggr_window;
+    }
+    void set_conj_aggr_window(double);
+    [[nodiscard]] size_type get_n_pending_conjunctions() const;
+    void flush_conjunctions();
+
+    [[nodiscard]] const std::shared_ptr<conj_sink> &get_conj_sink() const
+    {
+        return m_conj_sink;
+    }
+    void set_conj_sink(std::shared_ptr<conj_sink>);
+
+    [[nodiscard]] const std::shared_ptr<snapshot_writer> &get_snapshot_writer() const
+    {
+        return m_snap_writer;
+    }
+    void set_snapshot_writer(std::shared_ptr<snapshot_writer>);
+
+    [[nodiscard]] const std::shared_ptr<checkpointer> &get_checkpointer() const
+    {
+        return m_ckpt;
+    }
+    void set_checkpointer(std::shared_ptr<checkpointer>);
+
+    [[nodiscard]] const std::shared_ptr<ephemeris_writer> &get_ephemeris_writer() const
+    {
+        return m_eph_writer;
+    }
+    void set_ephemeris_writer(std::shared_ptr<ephemeris_writer>);
+
+    [[nodiscard]] const std::vector<output_error> &get_output_errors() const
+    {
+        return m_output_errors;
+    }
+    void clear_output_errors() noexcept;
+
+    [[nodiscard]] const std::optional<screening_volume> &get_screening_volume() const
+    {
+        return m_svol;
+    }
+
+    [[nodiscard]] std::uint32_t get_det_order() const
+    {
+        return m_det_order;
+    }
+
     [[nodiscard]] double get_min_coll_radius() const
     {
         return m_min_coll_radius;
@@ -460,12 +889,57 @@ public:
     }
     void set_conj_whitelist(whitelist_t);
 
+    // The whitelists expressed via particle ids. The
+    // ids are converted to particle indices by the setters.
+    [[nodiscard]] id_whitelist_t get_coll_whitelist_ids() const;
+    void set_coll_whitelist_ids(const id_whitelist_t &);
+    [[nodiscard]] id_whitelist_t get_conj_whitelist_ids() const;
+    void set_conj_whitelist_ids(const id_whitelist_t &);
+
     void set_new_state_pars(std::vector<double>, std::vector<double> = {});
-    void remove_particles(std::vector<size_type>);
 
+    // Incremental modifications of the set of particles. Only the
+    // rows being added or updated are validated, and the state/pars
+    // vectors are modified in-place (unless they are currently shared
+    // with external views, in which case they are replaced).
+    void add_particles(std::span<const double>, std::span<const double> = {});
+    void remove_particles(std::vector<size_type>);
+    void update_particles(std::span<const size_type>, std::span<const double>, std::span<const double> = {});
+
+    // NOTE: the conjunction sink, the snapshot writer, the ephemeris
+    // writer and the checkpointer are invoked at the end of each step,
+    // after the new state of the simulation has been committed. Their
+    // failures do not propagate out of step()/propagate_until(): each
+    // failure is logged and recorded in the list returned by
+    // get_output_errors(), the other components are still invoked and
+    // the outcome of the step is returned normally. The conjunctions
+    // rejected by the sink are kept in the simulation and they are
+    // pushed again at the end of the next step.
     outcome step();
     outcome propagate_until(double);
 
+    // Asynchronous stepping.
+    // NOTE: these functions launch step()/propagate_until() in a
+    // separate thread and return immediately. While the operation is
+    // running, the simulation must not be accessed, except via the
+    // functions below and get_async_snapshot(), which returns the time
+    // coordinate, the state and the parameters at the launch of the operation.
+    // Views on the conjunctions detected before the launch remain valid.
+    // Copying, moving or destroying the simulation waits for the
+    // completion of the operation. The Python bindings enforce the ownership
+    // of the simulation by the operation, raising an error from the mutating
+    // functions and from the getters of the data modified by the operation
+    // (time, state, parameters, conjunctions, etc.) while the operation is running.
+    std::shared_future<outcome> step_async();
+    std::shared_future<outcome> propagate_until_async(double);
+    [[nodiscard]] bool async_running() const;
+    void wait_async() const;
+    [[nodiscard]] const std::optional<detail::sim_state_snapshot> &get_async_snapshot() const;
+
+    // Checkpointing.
+    void save_checkpoint(std::ostream &) const;
+    static sim load_checkpoint(std::istream &);
+
     // NOTE: these helpers are used to fetch
     // copies of shared pointers to internal data.
     // The intended purpose
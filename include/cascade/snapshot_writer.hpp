@@ -0,0 +1,177 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_SNAPSHOT_WRITER_HPP
+#define CASCADE_SNAPSHOT_WRITER_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <heyoka/detail/igor.hpp>
+
+#include <cascade/detail/visibility.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(snap_every);
+IGOR_MAKE_NAMED_ARGUMENT(snap_times);
+IGOR_MAKE_NAMED_ARGUMENT(compression);
+IGOR_MAKE_NAMED_ARGUMENT(queue_size);
+
+} // namespace kw
+
+// Asynchronous writer of state snapshots to an HDF5 file.
+//
+// When a writer is set on a sim (see sim::set_snapshot_writer()), a snapshot
+// of the time coordinate, the state and the parameters of the sim is taken
+// every snap_every steps (if snap_every is not zero) and at the time
+// coordinates in snap_times (computed via dense output). The snapshots are
+// copied into a pool of queue_size buffers and written to the HDF5 file by a
+// background thread, so that the writing overlaps with the next steps of the
+// simulation. The copying blocks only if all the buffers are in use.
+//
+// The HDF5 file contains the chunked, extendable datasets "time" (shape (n,)),
+// "state" (shape (n, nparts, 7)) and, if the sim has parameters, "pars"
+// (shape (n, nparts, npars)), where n is the number of snapshots. If compression
+// is not zero, the datasets are compressed with the deflate filter at the
+// given compression level. The number of particles and of parameters cannot
+// change between snapshots.
+//
+// The writer is available only if cascade was built with HDF5 support.
+class CASCADE_DLL_PUBLIC snapshot_writer
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+    void finalise_ctor(std::string, std::uint64_t, std::vector<double>, unsigned, std::size_t);
+
+    // NOTE: private delegating constructor, used so that
+    // the generic constructor does not need the complete
+    // definition of impl (see the analogous machinery in sim).
+    struct ptag_t {
+    };
+    explicit snapshot_writer(ptag_t);
+
+public:
+    template <typename... KwArgs>
+    explicit snapshot_writer(std::string path, KwArgs &&...kw_args) : snapshot_writer(ptag_t{})
+    {
+        igor::parser p{kw_args...};
+
+        // LCOV_EXCL_START
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of a snapshot writer "
+                          "contain unnamed arguments.");
+            throw;
+        }
+        // LCOV_EXCL_STOP
+
+        // Snapshot every n steps (defaults to 1).
+        std::uint64_t snap_every = 1;
+        if constexpr (p.has(kw::snap_every)) {
+            if constexpr (std::integral<std::remove_cvref_t<decltype(p(kw::snap_every))>>) {
+                snap_every = boost::numeric_cast<std::uint64_t>(p(kw::snap_every));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'snap_every' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Snapshot times (defaults to empty).
+        std::vector<double> snap_times;
+        if constexpr (p.has(kw::snap_times)) {
+            if constexpr (di_range<decltype(p(kw::snap_times))>) {
+                // NOTE: turn it into an lvalue.
+                auto &&tmp_range = p(kw::snap_times);
+
+                for (auto &&val : tmp_range) {
+                    snap_times.push_back(static_cast<double>(val));
+                }
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'snap_times' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Compression level (defaults to zero, i.e., no compression).
+        unsigned compression = 0;
+        if constexpr (p.has(kw::compression)) {
+            if constexpr (std::integral<std::remove_cvref_t<decltype(p(kw::compression))>>) {
+                compression = boost::numeric_cast<unsigned>(p(kw::compression));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'compression' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        // Number of snapshot buffers (defaults to 2, i.e., double buffering).
+        std::size_t queue_size = 2;
+        if constexpr (p.has(kw::queue_size)) {
+            if constexpr (std::integral<std::remove_cvref_t<decltype(p(kw::queue_size))>>) {
+                queue_size = boost::numeric_cast<std::size_t>(p(kw::queue_size));
+            } else {
+                // LCOV_EXCL_START
+                static_assert(detail::always_false_v<KwArgs...>,
+                              "The 'queue_size' keyword argument is of the wrong type.");
+                // LCOV_EXCL_STOP
+            }
+        }
+
+        finalise_ctor(std::move(path), snap_every, std::move(snap_times), compression, queue_size);
+    }
+    snapshot_writer(const snapshot_writer &) = delete;
+    snapshot_writer(snapshot_writer &&) = delete;
+    snapshot_writer &operator=(const snapshot_writer &) = delete;
+    snapshot_writer &operator=(snapshot_writer &&) = delete;
+    ~snapshot_writer();
+
+    [[nodiscard]] const std::string &get_path() const;
+    [[nodiscard]] std::uint64_t get_snap_every() const;
+    [[nodiscard]] const std::vector<double> &get_snap_times() const;
+    [[nodiscard]] unsigned get_compression() const;
+    [[nodiscard]] std::size_t get_queue_size() const;
+    [[nodiscard]] std::uint64_t get_n_snapshots() const;
+
+    void submit(double, std::span<const double>, std::span<const double>);
+    void flush();
+    void close();
+
+    // NOTE: these are used by the sim class to determine
+    // when the snapshots must be taken.
+    [[nodiscard]] std::optional<double> next_snap_time() const;
+    void pop_snap_time();
+    bool step_done();
+    [[nodiscard]] std::optional<double> last_snap_time() const;
+};
+
+} // namespace cascade
+
+#endif
@@ -0,0 +1,594 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/serialization/binary_object.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <fmt/core.h>
+
+#include <cascade/checkpointer.hpp>
+#include <cascade/detail/sim_data.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The header of a checkpoint file.
+struct ckpt_header {
+    char magic[8];
+    std::uint64_t version;
+};
+
+static_assert(std::is_trivially_copyable_v<ckpt_header>);
+
+constexpr char ckpt_magic[8] = {'C', 'S', 'C', 'D', 'C', 'K', 'P', 'T'};
+
+constexpr std::uint64_t ckpt_version = 3;
+
+// The header of a record in a checkpoint file.
+// NOTE: the size of the payload is written after the
+// payload itself, so that a record whose writing was interrupted
+// has a zero payload size.
+struct ckpt_record_header {
+    std::uint64_t kind;
+    std::uint64_t size;
+};
+
+static_assert(std::is_trivially_copyable_v<ckpt_record_header>);
+
+constexpr std::uint64_t ckpt_base_record = 0;
+constexpr std::uint64_t ckpt_delta_record = 1;
+
+using ckpt_buffer_t = std::vector<unsigned char, no_init_alloc<unsigned char>>;
+
+// Encode the bitwise XOR of cur and ref into out. The encoded data consists
+// of a 4-bit header for each XORed 64-bit word, containing the number of
+// significant (i.e., not leading zero) bytes in the word, followed by the
+// significant bytes of all the words, from the least significant one.
+void xor_encode(std::span<const double> cur, std::span<const double> ref, ckpt_buffer_t &out)
+{
+    static_assert(sizeof(double) == sizeof(std::uint64_t));
+
+    assert(cur.size() == ref.size());
+
+    const auto n = cur.size();
+    const auto hdr_size = n / 2u + n % 2u;
+
+    out.resize(hdr_size + n * 8u);
+    auto *const hdr = out.data();
+    auto *body = out.data() + hdr_size;
+
+    std::fill(hdr, body, static_cast<unsigned char>(0));
+
+    for (decltype(cur.size()) i = 0; i < n; ++i) {
+        const auto x = std::bit_cast<std::uint64_t>(cur[i]) ^ std::bit_cast<std::uint64_t>(ref[i]);
+        const auto nsig = static_cast<unsigned>(8 - std::countl_zero(x) / 8);
+
+        hdr[i / 2u] = static_cast<unsigned char>(hdr[i / 2u] | (nsig << (4u * (i % 2u))));
+
+        for (auto b = 0u; b < nsig; ++b) {
+            *body++ = static_cast<unsigned char>(x >> (8u * b));
+        }
+    }
+
+    out.resize(static_cast<decltype(out.size())>(body - out.data()));
+}
+
+// Decode the data produced by xor_encode() given the reference vector ref.
+std::vector<double> xor_decode(std::span<const unsigned char> in, std::span<const double> ref)
+{
+    const auto n = ref.size();
+    const auto hdr_size = n / 2u + n % 2u;
+
+    if (in.size() < hdr_size) {
+        throw std::invalid_argument("Invalid XOR-encoded data detected in a checkpoint file");
+    }
+
+    const auto *const hdr = in.data();
+    const auto *body = in.data() + hdr_size;
+    const auto *const end = in.data() + in.size();
+
+    std::vector<double> retval;
+    retval.reserve(n);
+
+    for (decltype(ref.size()) i = 0; i < n; ++i) {
+        const auto nsig = static_cast<unsigned>((hdr[i / 2u] >> (4u * (i % 2u))) & 0xFu);
+
+        if (nsig > 8u || static_cast<unsigned>(end - body) < nsig) {
+            throw std::invalid_argument("Invalid XOR-encoded data detected in a checkpoint file");
+        }
+
+        std::uint64_t x = 0;
+        for (auto b = 0u; b < nsig; ++b) {
+            x |= static_cast<std::uint64_t>(*body++) << (8u * b);
+        }
+
+        retval.push_back(std::bit_cast<double>(std::bit_cast<std::uint64_t>(ref[i]) ^ x));
+    }
+
+    if (body != end) {
+        throw std::invalid_argument("Invalid XOR-encoded data detected in a checkpoint file");
+    }
+
+    return retval;
+}
+
+// Remove in-place from v, interpreted as a row-major matrix with
+// ncols columns, the rows at the (sorted and unique) indices idxs.
+template <typename T>
+void remove_rows(std::vector<T> &v, std::uint64_t ncols, std::span<const sim::size_type> idxs)
+{
+    if (ncols == 0u) {
+        return;
+    }
+
+    assert(v.size() % ncols == 0u);
+    const auto nrows = v.size() / ncols;
+
+    if (!idxs.empty() && idxs.back() >= nrows) {
+        throw std::invalid_argument(
+            fmt::format("Invalid particle index {} detected in the removal log of a checkpoint file", idxs.back()));
+    }
+
+    auto idxs_it = idxs.begin();
+    decltype(v.size()) out = 0;
+    for (decltype(v.size()) i = 0; i < nrows; ++i) {
+        if (idxs_it != idxs.end() && *idxs_it == i) {
+            ++idxs_it;
+            continue;
+        }
+
+        std::copy(v.begin() + static_cast<std::ptrdiff_t>(i * ncols),
+                  v.begin() + static_cast<std::ptrdiff_t>((i + 1u) * ncols),
+                  v.begin() + static_cast<std::ptrdiff_t>(out * ncols));
+        ++out;
+    }
+
+    v.resize(out * ncols);
+}
+
+} // namespace
+
+} // namespace detail
+
+struct checkpointer::impl {
+    std::string m_path;
+    std::uint64_t m_ckpt_every = 0;
+    bool m_xor_delta = true;
+
+    std::ofstream m_file;
+    std::uint64_t m_n_records = 0;
+    std::uint64_t m_n_steps = 0;
+
+    // Flag to signal that the next
+    // record must be a base record.
+    bool m_need_base = true;
+
+    // The state and pars vectors of the previous record, with the
+    // removals since the previous record already applied, and
+    // the number of detected conjunctions in the previous record.
+    std::vector<double> m_ref_state, m_ref_pars;
+    sim::size_type m_n_conj = 0;
+
+    // The changes since the previous record.
+    bool m_replaced = false;
+    bool m_conj_reset = false;
+    std::vector<std::vector<sim::size_type>> m_removals;
+
+    // Buffer for the XOR-encoded data.
+    detail::ckpt_buffer_t m_buffer;
+};
+
+void checkpointer::finalise_ctor(std::string path, std::uint64_t ckpt_every, bool xor_delta)
+{
+    auto im = std::make_unique<impl>();
+
+    im->m_path = std::move(path);
+    im->m_ckpt_every = ckpt_every;
+    im->m_xor_delta = xor_delta;
+
+    im->m_file.open(im->m_path, std::ios::binary | std::ios::trunc);
+    if (!im->m_file) {
+        throw std::invalid_argument(fmt::format("Unable to open the checkpoint file '{}' for writing", im->m_path));
+    }
+
+    // Write the file header.
+    detail::ckpt_header hdr{};
+    std::memcpy(hdr.magic, detail::ckpt_magic, sizeof(hdr.magic));
+    hdr.version = detail::ckpt_version;
+    im->m_file.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    im->m_file.flush();
+
+    if (!im->m_file) {
+        throw std::invalid_argument(fmt::format("Error writing to the checkpoint file '{}'", im->m_path));
+    }
+
+    m_impl = std::move(im);
+}
+
+checkpointer::checkpointer(ptag_t) {}
+
+checkpointer::~checkpointer() = default;
+
+const std::string &checkpointer::get_path() const
+{
+    return m_impl->m_path;
+}
+
+std::uint64_t checkpointer::get_ckpt_every() const
+{
+    return m_impl->m_ckpt_every;
+}
+
+bool checkpointer::get_xor_delta() const
+{
+    return m_impl->m_xor_delta;
+}
+
+std::uint64_t checkpointer::get_n_records() const
+{
+    return m_impl->m_n_records;
+}
+
+// Fetch the size in bytes of the checkpoint file.
+std::uint64_t checkpointer::get_n_bytes() const
+{
+    return boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(m_impl->m_file.tellp()));
+}
+
+void checkpointer::write(const sim &s)
+{
+    write_record(s, false);
+}
+
+void checkpointer::write_base(const sim &s)
+{
+    write_record(s, true);
+}
+
+void checkpointer::write_record(const sim &s, bool base)
+{
+    auto &im = *m_impl;
+    auto &file = im.m_file;
+
+    if (!file) {
+        throw std::invalid_argument(fmt::format("Cannot write to the checkpoint file '{}' after an error", im.m_path));
+    }
+
+    const auto &state = s.get_state();
+    const auto &pars = s.get_pars();
+    const auto &conj = s.get_conjunctions();
+
+    base = base || im.m_need_base;
+
+    // NOTE: if the reference vectors are not aligned with the state of the
+    // sim (e.g., because the state was modified via an unsupported path),
+    // store the state and pars vectors without encoding.
+    const auto replaced = im.m_replaced || state.size() != im.m_ref_state.size() || pars.size() != im.m_ref_pars.size();
+    const auto conj_reset = im.m_conj_reset || conj.size() < im.m_n_conj;
+
+    const auto rec_begin = file.tellp();
+
+    try {
+        // Write the record header, with a zero payload size.
+        detail::ckpt_record_header rhdr{base ? detail::ckpt_base_record : detail::ckpt_delta_record, 0};
+        file.write(reinterpret_cast<const char *>(&rhdr), sizeof(rhdr));
+
+        // Write the payload.
+        if (base) {
+            s.save_checkpoint(file);
+        } else {
+            boost::archive::binary_oarchive oa(file);
+
+            oa << replaced;
+            oa << im.m_removals;
+            oa << conj_reset;
+
+            // NOTE: the particle ids are saved only if the state
+            // was replaced. Otherwise, they are reconstructed from
+            // the previous record and the removal log.
+            s.save_delta(oa, conj_reset ? 0 : im.m_n_conj, replaced);
+
+            const auto use_xor = im.m_xor_delta && !replaced;
+            oa << use_xor;
+
+            if (use_xor) {
+                const auto write_encoded = [&](const std::vector<double> &cur, const std::vector<double> &ref) {
+                    detail::xor_encode(cur, ref, im.m_buffer);
+
+                    oa << static_cast<std::uint64_t>(im.m_buffer.size());
+                    oa << boost::serialization::make_binary_object(im.m_buffer.data(), im.m_buffer.size());
+                };
+
+                write_encoded(state, im.m_ref_state);
+                write_encoded(pars, im.m_ref_pars);
+            } else {
+                oa << state;
+                oa << pars;
+            }
+        }
+
+        // Write the payload size.
+        const auto rec_end = file.tellp();
+        rhdr.size = boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(rec_end - rec_begin))
+                    - sizeof(rhdr);
+
+        file.seekp(rec_begin + static_cast<std::streamoff>(offsetof(detail::ckpt_record_header, size)));
+        file.write(reinterpret_cast<const char *>(&rhdr.size), sizeof(rhdr.size));
+        file.seekp(rec_end);
+        file.flush();
+
+        if (!file) {
+            throw std::invalid_argument(fmt::format("Error writing to the checkpoint file '{}'", im.m_path));
+        }
+    } catch (...) {
+        // NOTE: discard the partially-written record, so that it is not
+        // read back by restore() and the next record is written in its place.
+        file.clear();
+        file.seekp(rec_begin);
+
+        std::error_code ec;
+        std::filesystem::resize_file(im.m_path, static_cast<std::uintmax_t>(static_cast<std::streamoff>(rec_begin)),
+                                     ec);
+
+        throw;
+    }
+
+    // Update the reference data.
+    im.m_ref_state.assign(state.begin(), state.end());
+    im.m_ref_pars.assign(pars.begin(), pars.end());
+    im.m_n_conj = conj.size();
+
+    im.m_need_base = false;
+    im.m_replaced = false;
+    im.m_conj_reset = false;
+    im.m_removals.clear();
+
+    ++im.m_n_records;
+}
+
+sim checkpointer::restore(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::invalid_argument(fmt::format("Unable to open the checkpoint file '{}' for reading", path));
+    }
+
+    // Fetch the size of the file.
+    file.seekg(0, std::ios::end);
+    const auto fsize = boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(file.tellg()));
+    file.seekg(0);
+
+    // Check the file header.
+    detail::ckpt_header hdr{};
+    if (fsize < sizeof(hdr) || !file.read(reinterpret_cast<char *>(&hdr), sizeof(hdr))
+        || std::memcmp(hdr.magic, detail::ckpt_magic, sizeof(hdr.magic)) != 0) {
+        throw std::invalid_argument(fmt::format("The file '{}' is not a checkpoint file", path));
+    }
+
+    if (hdr.version != detail::ckpt_version) {
+        throw std::invalid_argument(fmt::format("The checkpoint file '{}' has version {}, but version {} is expected",
+                                                path, hdr.version, detail::ckpt_version));
+    }
+
+    // Locate the complete records, and the last base record.
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> records;
+    std::uint64_t pos = sizeof(hdr);
+    std::optional<decltype(records.size())> last_base;
+
+    while (fsize - pos >= sizeof(detail::ckpt_record_header)) {
+        detail::ckpt_record_header rhdr{};
+        file.seekg(boost::numeric_cast<std::streamoff>(pos));
+        file.read(reinterpret_cast<char *>(&rhdr), sizeof(rhdr));
+
+        if (!file || rhdr.size == 0u || rhdr.kind > detail::ckpt_delta_record
+            || rhdr.size > fsize - pos - sizeof(rhdr)) {
+            // Incomplete record.
+            break;
+        }
+
+        if (rhdr.kind == detail::ckpt_base_record) {
+            last_base = records.size();
+        }
+
+        records.emplace_back(rhdr.kind, pos + sizeof(rhdr));
+        pos += sizeof(rhdr) + rhdr.size;
+    }
+
+    if (!last_base) {
+        throw std::invalid_argument(
+            fmt::format("The checkpoint file '{}' does not contain any complete base record", path));
+    }
+
+    file.clear();
+
+    // Load the base record.
+    file.seekg(boost::numeric_cast<std::streamoff>(records[*last_base].second));
+    auto s = sim::load_checkpoint(file);
+
+    // Replay the delta records.
+    for (auto r = *last_base + 1u; r < records.size(); ++r) {
+        file.seekg(boost::numeric_cast<std::streamoff>(records[r].second));
+        boost::archive::binary_iarchive ia(file);
+
+        bool replaced{};
+        ia >> replaced;
+        std::vector<std::vector<sim::size_type>> removals;
+        ia >> removals;
+        bool conj_reset{};
+        ia >> conj_reset;
+
+        for (const auto &rem : removals) {
+            if (!std::is_sorted(rem.begin(), rem.end())
+                || std::adjacent_find(rem.begin(), rem.end()) != rem.end()) {
+                throw std::invalid_argument(
+                    fmt::format("Invalid removal log detected in the checkpoint file '{}'", path));
+            }
+        }
+
+        // Reconstruct the particle ids, unless the state was replaced.
+        std::optional<std::vector<std::uint64_t>> ids;
+        if (!replaced) {
+            ids.emplace(s.get_ids());
+
+            for (const auto &rem : removals) {
+                detail::remove_rows(*ids, 1, rem);
+            }
+        }
+
+        s.load_delta(ia, conj_reset, std::move(ids));
+
+        bool use_xor{};
+        ia >> use_xor;
+
+        const auto npars = s.get_npars();
+
+        std::vector<double> state, pars;
+        if (use_xor) {
+            if (replaced) {
+                throw std::invalid_argument(
+                    fmt::format("Invalid delta record detected in the checkpoint file '{}'", path));
+            }
+
+            // Build the reference vectors.
+            auto ref_state = s.get_state();
+            auto ref_pars = s.get_pars();
+            for (const auto &rem : removals) {
+                detail::remove_rows(ref_state, 7, rem);
+                detail::remove_rows(ref_pars, npars, rem);
+            }
+
+            const auto read_encoded = [&ia](const std::vector<double> &ref) {
+                std::uint64_t size{};
+                ia >> size;
+
+                detail::ckpt_buffer_t buffer;
+                buffer.resize(boost::numeric_cast<decltype(buffer.size())>(size));
+                ia >> boost::serialization::make_binary_object(buffer.data(), buffer.size());
+
+                return detail::xor_decode(buffer, ref);
+            };
+
+            state = read_encoded(ref_state);
+            pars = read_encoded(ref_pars);
+        } else {
+            ia >> state;
+            ia >> pars;
+        }
+
+        if (state.size() % 7u != 0u || pars.size() != (state.size() / 7u) * npars
+            || s.get_ids().size() != state.size() / 7u) {
+            throw std::invalid_argument(
+                fmt::format("Inconsistent state/parameters detected in the checkpoint file '{}'", path));
+        }
+
+        s.m_state = std::make_shared<std::vector<double>>(std::move(state));
+        s.m_pars = std::make_shared<std::vector<double>>(std::move(pars));
+    }
+
+    return s;
+}
+
+bool checkpointer::step_done()
+{
+    auto &im = *m_impl;
+
+    ++im.m_n_steps;
+
+    return im.m_ckpt_every != 0u && im.m_n_steps % im.m_ckpt_every == 0u;
+}
+
+void checkpointer::sim_attached()
+{
+    m_impl->m_need_base = true;
+}
+
+// NOTE: the removals are applied to the reference vectors
+// immediately, so that they remain aligned with the state
+// of the sim.
+// NOTE: this is invoked from the noexcept section of
+// sim::remove_particles(), thus it must not throw. If the
+// removal cannot be logged, the next record will store
+// the full state and pars vectors.
+void checkpointer::particles_removed(sim::size_type nparts, std::span<const sim::size_type> removed) noexcept
+{
+    auto &im = *m_impl;
+
+    assert(std::is_sorted(removed.begin(), removed.end()));
+
+    if (im.m_need_base || im.m_replaced || removed.empty()) {
+        return;
+    }
+
+    if (im.m_ref_state.size() != nparts * 7u || nparts == 0u || im.m_ref_pars.size() % nparts != 0u
+        || removed.back() >= nparts) {
+        // NOTE: the reference vectors are not aligned with the
+        // state of the sim, the next record will store the full
+        // state and pars vectors.
+        particles_replaced();
+
+        return;
+    }
+
+    // NOTE: log the removal first, as this is the only
+    // step that allocates. The removal from the reference
+    // vectors cannot fail after the checks above.
+    try {
+        im.m_removals.emplace_back(removed.begin(), removed.end());
+    } catch (...) {
+        particles_replaced();
+
+        return;
+    }
+
+    detail::remove_rows(im.m_ref_state, 7, removed);
+    detail::remove_rows(im.m_ref_pars, im.m_ref_pars.size() / nparts, removed);
+}
+
+void checkpointer::particles_replaced() noexcept
+{
+    auto &im = *m_impl;
+
+    im.m_replaced = true;
+    im.m_removals.clear();
+}
+
+void checkpointer::conjunctions_reset() noexcept
+{
+    m_impl->m_conj_reset = true;
+}
+
+} // namespace cascade
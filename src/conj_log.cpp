@@ -0,0 +1,440 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
+
+#include <fmt/core.h>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Current version of the log file format.
+constexpr std::uint32_t conj_log_version = 2;
+
+// The header of a log file.
+struct conj_log_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t header_size;
+    std::uint64_t n_records;
+    char schema[256];
+};
+
+static_assert(sizeof(conj_log_header) <= conj_log_header_size);
+static_assert(std::is_trivially_copyable_v<conj_log_header>);
+static_assert(std::is_trivially_copyable_v<sim::conjunction>);
+static_assert(std::is_standard_layout_v<sim::conjunction>);
+
+constexpr char conj_log_magic[8] = {'C', 'S', 'C', 'D', 'C', 'L', 'O', 'G'};
+
+// An entry in the index file.
+struct conj_log_index_entry {
+    double time;
+    std::uint64_t idx;
+};
+
+// Textual description of the layout of the records,
+// in the format name:type@offset.
+std::string conj_log_schema()
+{
+    using conj_t = sim::conjunction;
+
+    constexpr auto st_size = sizeof(sim::size_type);
+
+    return fmt::format("i:u{}@{},j:u{}@{},id_i:u8@{},id_j:u8@{},time:f8@{},dist:f8@{},state_i:6f8@{},"
+                       "state_j:6f8@{},tier:u{}@{},n_min:u{}@{},time_under:f8@{}",
+                       st_size, offsetof(conj_t, i), st_size, offsetof(conj_t, j), offsetof(conj_t, id_i),
+                       offsetof(conj_t, id_j), offsetof(conj_t, time), offsetof(conj_t, dist),
+                       offsetof(conj_t, state_i), offsetof(conj_t, state_j), st_size, offsetof(conj_t, tier),
+                       st_size, offsetof(conj_t, n_min), offsetof(conj_t, time_under));
+}
+
+// Initial capacity (in number of records) of a log file.
+constexpr std::uint64_t conj_log_init_cap = 4096;
+
+} // namespace
+
+} // namespace detail
+
+struct conj_log_sink::impl {
+    std::string m_path;
+    std::uint64_t m_n_records = 0;
+    // Number of records which can be stored
+    // in the file without resizing it.
+    std::uint64_t m_capacity = 0;
+    boost::interprocess::file_mapping m_fmap;
+    boost::interprocess::mapped_region m_region;
+    std::ofstream m_idx_file;
+    bool m_closed = false;
+
+    // Data for the background flusher.
+    // NOTE: m_dirty_begin/m_dirty_end is the byte range of the records
+    // written since the last flush. m_flushing signals that the flusher is
+    // currently flushing data without holding the mutex, in which case
+    // the memory mapping cannot be altered.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    bool m_flushing = false;
+    std::size_t m_dirty_begin = 0;
+    std::size_t m_dirty_end = 0;
+    std::exception_ptr m_flush_error;
+    std::thread m_flusher;
+
+    [[nodiscard]] detail::conj_log_header *header() const
+    {
+        return static_cast<detail::conj_log_header *>(m_region.get_address());
+    }
+
+    [[nodiscard]] static std::size_t file_size(std::uint64_t n)
+    {
+        using safe_size_t = boost::safe_numerics::safe<std::size_t>;
+
+        return safe_size_t(conj_log_header_size) + safe_size_t(n) * sizeof(sim::conjunction);
+    }
+
+    void map()
+    {
+        m_fmap = boost::interprocess::file_mapping(m_path.c_str(), boost::interprocess::read_write);
+        m_region = boost::interprocess::mapped_region(m_fmap, boost::interprocess::read_write);
+    }
+
+    // Resize the log file so that it can contain at least n records.
+    // NOTE: this must be invoked while holding the mutex.
+    void grow(std::unique_lock<std::mutex> &lock, std::uint64_t n)
+    {
+        assert(lock.owns_lock());
+
+        // Wait for the flusher to finish.
+        m_cv.wait(lock, [this]() { return !m_flushing; });
+
+        const std::uint64_t dbl_cap = boost::safe_numerics::safe<std::uint64_t>(m_capacity) * 2u;
+        const auto new_cap = std::max(n, dbl_cap);
+
+        // NOTE: unmap before resizing.
+        m_region = boost::interprocess::mapped_region();
+        std::filesystem::resize_file(m_path, file_size(new_cap));
+        map();
+
+        m_capacity = new_cap;
+    }
+
+    void flusher_loop()
+    {
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            m_cv.wait(lock, [this]() { return m_stop || m_dirty_end > m_dirty_begin; });
+
+            if (m_dirty_end > m_dirty_begin) {
+                // NOTE: the flushed range must begin at a page boundary.
+                const auto page_size = boost::interprocess::mapped_region::get_page_size();
+                const auto begin = m_dirty_begin / page_size * page_size;
+                const auto end = m_dirty_end;
+                m_dirty_begin = 0;
+                m_dirty_end = 0;
+
+                // Flush without holding the mutex, so that
+                // push() can keep on writing new records.
+                m_flushing = true;
+                lock.unlock();
+
+                const auto ok = m_region.flush(0, sizeof(detail::conj_log_header), false)
+                                && m_region.flush(begin, end - begin, false);
+
+                lock.lock();
+                m_flushing = false;
+
+                if (!ok && !m_flush_error) {
+                    // LCOV_EXCL_START
+                    m_flush_error = std::make_exception_ptr(std::invalid_argument(
+                        fmt::format("Error flushing the conjunction log file '{}' to disk", m_path)));
+                    // LCOV_EXCL_STOP
+                }
+
+                m_cv.notify_all();
+            } else {
+                assert(m_stop);
+
+                break;
+            }
+        }
+    }
+
+    void check_flush_error()
+    {
+        if (m_flush_error) {
+            // LCOV_EXCL_START
+            std::rethrow_exception(std::exchange(m_flush_error, nullptr));
+            // LCOV_EXCL_STOP
+        }
+    }
+};
+
+conj_log_sink::conj_log_sink(std::string path, bool append) : m_impl(std::make_unique<impl>())
+{
+    auto &im = *m_impl;
+    im.m_path = std::move(path);
+
+    if (append && std::filesystem::exists(im.m_path)) {
+        // Open an existing log file.
+        // NOTE: check the file size before mapping,
+        // as empty files cannot be mapped.
+        const auto fsize = std::filesystem::file_size(im.m_path);
+        if (fsize < conj_log_header_size) {
+            throw std::invalid_argument(fmt::format("The file '{}' is not a valid conjunction log file", im.m_path));
+        }
+
+        im.map();
+
+        detail::conj_log_header hdr{};
+        std::memcpy(&hdr, im.header(), sizeof(hdr));
+
+        if (std::memcmp(hdr.magic, detail::conj_log_magic, sizeof(hdr.magic)) != 0) {
+            throw std::invalid_argument(fmt::format("The file '{}' is not a valid conjunction log file", im.m_path));
+        }
+
+        if (hdr.version != detail::conj_log_version || hdr.record_size != sizeof(sim::conjunction)
+            || hdr.header_size != conj_log_header_size) {
+            throw std::invalid_argument(
+                fmt::format("The conjunction log file '{}' has version {} and record size {}, but version {} and "
+                            "record size {} are expected",
+                            im.m_path, hdr.version, hdr.record_size, detail::conj_log_version,
+                            sizeof(sim::conjunction)));
+        }
+
+        if (fsize < impl::file_size(hdr.n_records)) {
+            throw std::invalid_argument(fmt::format(
+                "The conjunction log file '{}' is truncated: it should contain {} record(s), but its size is {} bytes",
+                im.m_path, hdr.n_records, fsize));
+        }
+
+        im.m_n_records = hdr.n_records;
+        im.m_capacity = (fsize - conj_log_header_size) / sizeof(sim::conjunction);
+
+        im.m_idx_file.open(im.m_path + ".idx", std::ios::binary | std::ios::app);
+    } else {
+        // Create a new log file.
+        {
+            std::ofstream ofile(im.m_path, std::ios::binary | std::ios::trunc);
+
+            if (!ofile) {
+                throw std::invalid_argument(
+                    fmt::format("Unable to open the file '{}' for writing the conjunction log", im.m_path));
+            }
+        }
+
+        std::filesystem::resize_file(im.m_path, impl::file_size(detail::conj_log_init_cap));
+        im.map();
+        im.m_capacity = detail::conj_log_init_cap;
+
+        // Write the header.
+        detail::conj_log_header hdr{};
+        std::memcpy(hdr.magic, detail::conj_log_magic, sizeof(hdr.magic));
+        hdr.version = detail::conj_log_version;
+        hdr.record_size = static_cast<std::uint32_t>(sizeof(sim::conjunction));
+        hdr.header_size = conj_log_header_size;
+        hdr.n_records = 0;
+
+        const auto schema = detail::conj_log_schema();
+        assert(schema.size() < sizeof(hdr.schema));
+        std::copy(schema.begin(), schema.end(), hdr.schema);
+
+        std::memcpy(im.header(), &hdr, sizeof(hdr));
+
+        im.m_idx_file.open(im.m_path + ".idx", std::ios::binary | std::ios::trunc);
+    }
+
+    if (!im.m_idx_file) {
+        throw std::invalid_argument(fmt::format("Unable to open the index file '{}.idx'", im.m_path));
+    }
+
+    // Start the flusher.
+    im.m_flusher = std::thread([&im]() { im.flusher_loop(); });
+}
+
+conj_log_sink::~conj_log_sink()
+{
+    try {
+        close();
+        // LCOV_EXCL_START
+    } catch (...) {
+        // NOTE: errors during the closing of the log
+        // file cannot be reported from the destructor. Make sure
+        // at least that the flusher thread is stopped.
+        if (m_impl->m_flusher.joinable()) {
+            {
+                std::lock_guard lock(m_impl->m_mutex);
+                m_impl->m_stop = true;
+            }
+            m_impl->m_cv.notify_all();
+            m_impl->m_flusher.join();
+        }
+    }
+    // LCOV_EXCL_STOP
+}
+
+void conj_log_sink::push(std::span<const sim::conjunction> cs)
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        throw std::invalid_argument(fmt::format("Cannot write to the closed conjunction log file '{}'", im.m_path));
+    }
+
+    if (cs.empty()) {
+        return;
+    }
+
+    const auto old_n = im.m_n_records;
+    const std::uint64_t new_n = boost::safe_numerics::safe<std::uint64_t>(old_n) + cs.size();
+
+    {
+        std::unique_lock lock(im.m_mutex);
+
+        im.check_flush_error();
+
+        if (new_n > im.m_capacity) {
+            im.grow(lock, new_n);
+        }
+    }
+
+    // Write the records.
+    // NOTE: the flusher never writes into the mapped memory,
+    // thus there is no need to hold the mutex here.
+    const auto begin = impl::file_size(old_n);
+    std::memcpy(static_cast<char *>(im.m_region.get_address()) + begin, cs.data(), cs.size_bytes());
+
+    // Update the index.
+    const auto idx_pos = im.m_idx_file.tellp();
+    for (auto idx = (old_n + conj_log_index_stride - 1u) / conj_log_index_stride * conj_log_index_stride;
+         idx < new_n; idx += conj_log_index_stride) {
+        const detail::conj_log_index_entry entry{cs[static_cast<std::size_t>(idx - old_n)].time, idx};
+        im.m_idx_file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    }
+
+    if (!im.m_idx_file) {
+        // NOTE: rewind the index file, so that the entries written
+        // partially will be overwritten when the records are pushed again.
+        im.m_idx_file.clear();
+        im.m_idx_file.seekp(idx_pos);
+
+        throw std::invalid_argument(fmt::format("Error writing to the index file '{}.idx'", im.m_path));
+    }
+
+    // Update the number of records in the header.
+    // NOTE: this is done after writing the records, so that readers
+    // never see a number of records larger than the records actually written.
+    im.m_n_records = new_n;
+    std::memcpy(reinterpret_cast<char *>(im.header()) + offsetof(detail::conj_log_header, n_records), &new_n,
+                sizeof(new_n));
+
+    // Schedule the flushing of the new records.
+    {
+        std::lock_guard lock(im.m_mutex);
+
+        im.m_dirty_begin = (im.m_dirty_end > im.m_dirty_begin) ? std::min(im.m_dirty_begin, begin) : begin;
+        im.m_dirty_end = std::max(im.m_dirty_end, impl::file_size(new_n));
+    }
+    im.m_cv.notify_all();
+}
+
+const std::string &conj_log_sink::get_path() const
+{
+    return m_impl->m_path;
+}
+
+std::uint64_t conj_log_sink::get_n_records() const
+{
+    return m_impl->m_n_records;
+}
+
+// Wait until all the records written so far have been flushed to disk.
+void conj_log_sink::flush()
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        return;
+    }
+
+    {
+        std::unique_lock lock(im.m_mutex);
+        im.m_cv.wait(lock, [&im]() { return !im.m_flushing && im.m_dirty_end <= im.m_dirty_begin; });
+
+        im.check_flush_error();
+    }
+
+    im.m_idx_file.flush();
+
+    if (!im.m_idx_file) {
+        throw std::invalid_argument(fmt::format("Error flushing the index file '{}.idx'", im.m_path));
+    }
+}
+
+// Flush the data, stop the flusher, unmap the file and
+// trim the preallocated space at the end of the log file.
+void conj_log_sink::close()
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        return;
+    }
+
+    flush();
+
+    {
+        std::lock_guard lock(im.m_mutex);
+        im.m_stop = true;
+    }
+    im.m_cv.notify_all();
+    im.m_flusher.join();
+
+    im.m_closed = true;
+
+    im.m_region = boost::interprocess::mapped_region();
+    im.m_fmap = boost::interprocess::file_mapping();
+    im.m_idx_file.close();
+
+    std::filesystem::resize_file(im.m_path, impl::file_size(im.m_n_records));
+}
+
+} // namespace cascade
@@ -0,0 +1,257 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
+
+#include <fmt/core.h>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+conj_sink::conj_sink() = default;
+
+conj_sink::~conj_sink() = default;
+
+memory_conj_sink::memory_conj_sink() = default;
+
+memory_conj_sink::~memory_conj_sink() = default;
+
+void memory_conj_sink::push(std::span<const sim::conjunction> cs)
+{
+    using safe_size_t = boost::safe_numerics::safe<decltype(m_conj.size())>;
+
+    // NOTE: reserve first, so that the insertion cannot throw.
+    m_conj.reserve(m_conj.size() + safe_size_t(cs.size()));
+
+    m_conj.insert(m_conj.end(), cs.begin(), cs.end());
+}
+
+const std::vector<sim::conjunction> &memory_conj_sink::get_conjunctions() const
+{
+    return m_conj;
+}
+
+void memory_conj_sink::clear()
+{
+    m_conj.clear();
+}
+
+file_conj_sink::file_conj_sink(std::string path) : m_path(std::move(path))
+{
+    m_file.open(m_path, std::ios::binary | std::ios::trunc);
+
+    if (!m_file) {
+        throw std::invalid_argument(
+            fmt::format("Unable to open the file '{}' for writing the conjunction data", m_path));
+    }
+}
+
+file_conj_sink::~file_conj_sink() = default;
+
+void file_conj_sink::push(std::span<const sim::conjunction> cs)
+{
+    static_assert(std::is_trivially_copyable_v<sim::conjunction>);
+
+    const auto size = boost::numeric_cast<std::streamsize>(cs.size_bytes());
+    const auto pos = m_file.tellp();
+
+    m_file.write(reinterpret_cast<const char *>(cs.data()), size);
+
+    if (!m_file) {
+        // NOTE: rewind the file to the end of the last successful write,
+        // so that the conjunctions written partially will be overwritten
+        // when they are pushed again.
+        m_file.clear();
+        m_file.seekp(pos);
+
+        throw std::invalid_argument(fmt::format("Error writing the conjunction data to the file '{}'", m_path));
+    }
+
+    m_n_conj += cs.size();
+}
+
+const std::string &file_conj_sink::get_path() const
+{
+    return m_path;
+}
+
+std::uint64_t file_conj_sink::get_n_conj() const
+{
+    return m_n_conj;
+}
+
+void file_conj_sink::flush()
+{
+    m_file.flush();
+
+    if (!m_file) {
+        throw std::invalid_argument(fmt::format("Error flushing the conjunction data to the file '{}'", m_path));
+    }
+}
+
+counting_conj_sink::counting_conj_sink() = default;
+
+counting_conj_sink::~counting_conj_sink() = default;
+
+void counting_conj_sink::push(std::span<const sim::conjunction> cs)
+{
+    // NOTE: resize the tier counters before updating them,
+    // so that the counting cannot throw.
+    for (const auto &c : cs) {
+        if (c.tier >= m_tier_counts.size()) {
+            m_tier_counts.resize(boost::numeric_cast<decltype(m_tier_counts.size())>(c.tier + 1u), 0);
+        }
+    }
+
+    for (const auto &c : cs) {
+        ++m_tier_counts[c.tier];
+    }
+
+    m_n_conj += cs.size();
+}
+
+std::uint64_t counting_conj_sink::get_n_conj() const
+{
+    return m_n_conj;
+}
+
+const std::vector<std::uint64_t> &counting_conj_sink::get_tier_counts() const
+{
+    return m_tier_counts;
+}
+
+void counting_conj_sink::reset()
+{
+    m_n_conj = 0;
+    m_tier_counts.clear();
+}
+
+callback_conj_sink::callback_conj_sink(callback_t cb) : m_cb(std::move(cb))
+{
+    if (!m_cb) {
+        throw std::invalid_argument("Cannot construct a callback conjunction sink from an empty callback");
+    }
+}
+
+callback_conj_sink::~callback_conj_sink() = default;
+
+void callback_conj_sink::push(std::span<const sim::conjunction> cs)
+{
+    m_cb(cs);
+}
+
+ring_conj_sink::ring_conj_sink(std::size_t cap)
+{
+    if (cap == 0u) {
+        throw std::invalid_argument("The capacity of a ring conjunction sink cannot be zero");
+    }
+
+    if (cap == std::numeric_limits<std::size_t>::max()) {
+        throw std::overflow_error("Overflow detected in the construction of a ring conjunction sink");
+    }
+
+    m_buffer.resize(cap + 1u);
+}
+
+ring_conj_sink::~ring_conj_sink() = default;
+
+// NOTE: push() is invoked only by the producer. The producer owns m_tail,
+// and it reads m_head with acquire semantics in order to synchronise
+// with the release store in pop().
+void ring_conj_sink::push(std::span<const sim::conjunction> cs)
+{
+    const auto bsize = m_buffer.size();
+
+    const auto head = m_head.load(std::memory_order_acquire);
+    auto tail = m_tail.load(std::memory_order_relaxed);
+
+    // Number of free slots in the ring buffer.
+    const auto n_free = (head + bsize - tail - 1u) % bsize;
+
+    const auto n_push = std::min(n_free, cs.size());
+    for (std::size_t k = 0; k < n_push; ++k) {
+        m_buffer[tail] = cs[k];
+        tail = (tail + 1u) % bsize;
+    }
+
+    // Publish the new elements to the consumer.
+    m_tail.store(tail, std::memory_order_release);
+
+    if (n_push < cs.size()) {
+        m_n_dropped.fetch_add(cs.size() - n_push, std::memory_order_relaxed);
+    }
+}
+
+// NOTE: pop() is invoked only by the consumer (symmetrically to push()).
+std::size_t ring_conj_sink::pop(std::span<sim::conjunction> out)
+{
+    const auto bsize = m_buffer.size();
+
+    const auto tail = m_tail.load(std::memory_order_acquire);
+    auto head = m_head.load(std::memory_order_relaxed);
+
+    // Number of elements available in the ring buffer.
+    const auto n_avail = (tail + bsize - head) % bsize;
+
+    const auto n_pop = std::min(n_avail, out.size());
+    for (std::size_t k = 0; k < n_pop; ++k) {
+        out[k] = m_buffer[head];
+        head = (head + 1u) % bsize;
+    }
+
+    // Release the slots to the producer.
+    m_head.store(head, std::memory_order_release);
+
+    return n_pop;
+}
+
+std::vector<sim::conjunction> ring_conj_sink::pop_all()
+{
+    std::vector<sim::conjunction> retval;
+    retval.resize(get_size());
+
+    retval.resize(pop(retval));
+
+    return retval;
+}
+
+std::size_t ring_conj_sink::get_capacity() const
+{
+    return m_buffer.size() - 1u;
+}
+
+std::size_t ring_conj_sink::get_size() const
+{
+    const auto bsize = m_buffer.size();
+
+    return (m_tail.load(std::memory_order_acquire) + bsize - m_head.load(std::memory_order_acquire)) % bsize;
+}
+
+std::uint64_t ring_conj_sink::get_n_dropped() const
+{
+    return m_n_dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace cascade
@@ -0,0 +1,269 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
+
+#include <fmt/core.h>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+conj_store::conj_store(double bucket_width)
+    : m_bucket_width(bucket_width), m_conj(std::make_shared<std::vector<sim::conjunction>>())
+{
+    if (!std::isfinite(bucket_width) || bucket_width <= 0) {
+        throw std::invalid_argument(fmt::format(
+            "The bucket width of a conjunction store must be finite and positive, but it is {} instead", bucket_width));
+    }
+}
+
+conj_store::~conj_store() = default;
+
+void conj_store::push(std::span<const sim::conjunction> cs)
+{
+    if (cs.empty()) {
+        return;
+    }
+
+    auto &conj = *m_conj;
+
+    // Validate the input conjunctions before modifying the store.
+    auto last_time = conj.empty() ? cs.front().time : conj.back().time;
+    for (const auto &c : cs) {
+        if (!std::isfinite(c.time)) {
+            throw std::invalid_argument(
+                fmt::format("Cannot insert into a conjunction store a conjunction with a non-finite time ({})", c.time));
+        }
+
+        if (c.time < last_time) {
+            throw std::invalid_argument(
+                fmt::format("The conjunctions inserted into a conjunction store must be in chronological order, but a "
+                            "conjunction at time {} was inserted after a conjunction at time {}",
+                            c.time, last_time));
+        }
+
+        last_time = c.time;
+    }
+
+    const auto bucket_origin
+        = conj.empty() ? std::floor(cs.front().time / m_bucket_width) * m_bucket_width : m_bucket_origin;
+    // NOTE: the conjunctions are in chronological order, thus the last one
+    // is in the bucket with the highest index. Compute it here so that
+    // the numeric_cast below cannot throw after the store has been modified.
+    const auto max_bucket = boost::numeric_cast<sim::size_type>(
+        std::max(0., std::floor((cs.back().time - bucket_origin) / m_bucket_width)));
+    m_bucket_offsets.reserve(max_bucket + 1u);
+
+    // Make sure there is enough space for the new conjunctions.
+    const auto new_size = conj.size() + cs.size();
+    if (new_size > conj.capacity()) {
+        // NOTE: as explained in the header, we cannot reallocate the
+        // existing vector because it may be referenced by external views.
+        auto new_conj = std::make_shared<std::vector<sim::conjunction>>();
+        new_conj->reserve(std::max(new_size, conj.capacity() * 2u));
+        new_conj->insert(new_conj->end(), conj.begin(), conj.end());
+
+        m_conj = std::move(new_conj);
+    }
+
+    // NOTE: noexcept from here.
+    m_bucket_origin = bucket_origin;
+
+    for (const auto &c : cs) {
+        const auto cid = m_conj->size();
+
+        m_conj->push_back(c);
+
+        const auto b = std::min(
+            max_bucket, static_cast<sim::size_type>(std::max(0., std::floor((c.time - m_bucket_origin) / m_bucket_width))));
+        while (m_bucket_offsets.size() <= b) {
+            m_bucket_offsets.push_back(cid);
+        }
+    }
+}
+
+double conj_store::get_bucket_width() const
+{
+    return m_bucket_width;
+}
+
+const std::vector<sim::conjunction> &conj_store::get_conjunctions() const
+{
+    return *m_conj;
+}
+
+// Incorporate into the per-particle index the
+// conjunctions inserted since the last update.
+void conj_store::update_adj_index()
+{
+    const auto &conj = *m_conj;
+    const auto n_conj = conj.size();
+
+    // Helper to fetch the list for the input key, making
+    // sure that a new id can be appended to it without
+    // reallocation.
+    const auto fetch_list = [this](sim::size_type key) {
+        if (key >= m_adj.size()) {
+            m_adj.resize(boost::safe_numerics::safe<decltype(m_adj.size())>(key) + 1u);
+        }
+
+        auto &ptr = m_adj[key];
+
+        if (!ptr || ptr->size() == ptr->capacity()) {
+            // NOTE: as in push(), we cannot reallocate the existing
+            // list because it may be referenced by external views.
+            auto new_ptr = std::make_shared<std::vector<sim::size_type>>();
+            new_ptr->reserve(ptr ? ptr->size() * 2u : 4u);
+            if (ptr) {
+                new_ptr->insert(new_ptr->end(), ptr->begin(), ptr->end());
+            }
+
+            ptr = std::move(new_ptr);
+        }
+
+        return ptr.get();
+    };
+
+    // NOTE: each conjunction is indexed only after both lists
+    // have been prepared, so that an exception leaves the
+    // index in a consistent state.
+    for (; m_n_indexed < n_conj; ++m_n_indexed) {
+        const auto key_i = boost::numeric_cast<sim::size_type>(conj[m_n_indexed].id_i);
+        const auto key_j = boost::numeric_cast<sim::size_type>(conj[m_n_indexed].id_j);
+
+        auto *list_i = fetch_list(key_i);
+        auto *list_j = (key_j == key_i) ? nullptr : fetch_list(key_j);
+
+        // NOTE: noexcept from here.
+        list_i->push_back(m_n_indexed);
+        if (list_j != nullptr) {
+            list_j->push_back(m_n_indexed);
+        }
+    }
+}
+
+// Fetch the sorted ids of the conjunctions involving
+// the particle with the given id.
+std::span<const sim::size_type> conj_store::get_particle_conj_ids(std::uint64_t key)
+{
+    update_adj_index();
+
+    if (key >= m_adj.size() || !m_adj[key]) {
+        return {};
+    }
+
+    return *m_adj[key];
+}
+
+// Fetch the pointer to the list of the ids of the conjunctions
+// involving the particle with the given id. A null pointer is
+// returned if there are no such conjunctions.
+std::shared_ptr<std::vector<sim::size_type>> conj_store::_get_adj_ids_ptr(std::uint64_t key)
+{
+    update_adj_index();
+
+    if (key >= m_adj.size()) {
+        return {};
+    }
+
+    return m_adj[key];
+}
+
+// Fetch the sorted ids of the conjunctions between
+// the particles with the given ids.
+std::vector<sim::size_type> conj_store::get_pair_conj_ids(std::uint64_t key_a, std::uint64_t key_b)
+{
+    // NOTE: scan the shortest of the two lists.
+    auto ids = get_particle_conj_ids(key_a);
+    if (const auto ids_b = get_particle_conj_ids(key_b); ids_b.size() < ids.size()) {
+        ids = ids_b;
+        std::swap(key_a, key_b);
+    }
+
+    const auto &conj = *m_conj;
+
+    std::vector<sim::size_type> retval;
+    for (const auto cid : ids) {
+        if ((conj[cid].id_i == key_a && conj[cid].id_j == key_b)
+            || (conj[cid].id_j == key_a && conj[cid].id_i == key_b)) {
+            retval.push_back(cid);
+        }
+    }
+
+    return retval;
+}
+
+// Fetch the range of ids of the conjunctions whose
+// time coordinate is in the [t_begin, t_end) range.
+std::pair<sim::size_type, sim::size_type> conj_store::get_time_range_ids(double t_begin, double t_end) const
+{
+    if (std::isnan(t_begin) || std::isnan(t_end)) {
+        throw std::invalid_argument("A time range query on a conjunction store cannot involve NaN values");
+    }
+
+    const auto &conj = *m_conj;
+    const auto n_conj = conj.size();
+
+    // Helper to locate the id of the first
+    // conjunction whose time is not less than t.
+    const auto lower_bound = [&](double t) -> sim::size_type {
+        if (n_conj == 0u || t <= conj.front().time) {
+            return 0;
+        }
+
+        if (t > conj.back().time) {
+            return n_conj;
+        }
+
+        // NOTE: here t is within the time range of the conjunctions,
+        // thus its bucket is one of the buckets in the index. Clamp
+        // anyway in order to guard against floating-point rounding.
+        assert(!m_bucket_offsets.empty());
+        const auto b = std::min(m_bucket_offsets.size() - 1u,
+                                static_cast<sim::size_type>(std::max(0., std::floor((t - m_bucket_origin) / m_bucket_width))));
+
+        const auto begin = m_bucket_offsets[b];
+        const auto end = (b + 1u < m_bucket_offsets.size()) ? m_bucket_offsets[b + 1u] : n_conj;
+
+        const auto it = std::lower_bound(conj.begin() + static_cast<std::ptrdiff_t>(begin),
+                                         conj.begin() + static_cast<std::ptrdiff_t>(end), t,
+                                         [](const auto &c, double tm) { return c.time < tm; });
+
+        return static_cast<sim::size_type>(it - conj.begin());
+    };
+
+    const auto lb = lower_bound(t_begin);
+    const auto ub = lower_bound(t_end);
+
+    return {lb, std::max(lb, ub)};
+}
+
+// Fetch the conjunctions whose time coordinate
+// is in the [t_begin, t_end) range.
+std::span<const sim::conjunction> conj_store::get_time_range(double t_begin, double t_end) const
+{
+    const auto [lb, ub] = get_time_range_ids(t_begin, t_end);
+
+    return std::span<const sim::conjunction>(m_conj->data() + lb, ub - lb);
+}
+
+} // namespace cascade
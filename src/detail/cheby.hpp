@@ -0,0 +1,296 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_DETAIL_CHEBY_HPP
+#define CASCADE_DETAIL_CHEBY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include "ival.hpp"
+
+namespace cascade::detail
+{
+
+// Utilities for the Chebyshev representation of trajectories.
+//
+// A Chebyshev series with n coefficients c_0, ..., c_{n-1} represents
+// the polynomial sum_k c_k * T_k(x) for x in [-1, 1], where T_k is the
+// Chebyshev polynomial of the first kind of degree k. The interval [-1, 1]
+// is mapped affinely onto the time interval of interest. Because |T_k(x)| <= 1,
+// the coefficients give cheap bounds both on the range of the series and on
+// the error committed by dropping its trailing terms.
+
+// Maximum number of coefficients of the series
+// produced by cheby_fit().
+inline constexpr std::uint32_t cheby_max_n = 64;
+
+// Convert the Taylor polynomial of order order whose coefficients
+// are stored in tc into a Chebyshev series over the interval
+// h in [lb, ub], writing the order + 1 coefficients of the series into out.
+// NOTE: the conversion is exact (up to floating-point rounding). The
+// polynomial is evaluated via Horner's scheme in the variable h = m + r * x,
+// carrying out the products by x in the Chebyshev basis
+// via x * T_0 = T_1 and x * T_k = (T_{k-1} + T_{k+1}) / 2.
+// The cost is quadratic in the order.
+inline void taylor_to_cheby(const double *tc, std::uint32_t order, double lb, double ub, double *out)
+{
+    const auto m = (lb + ub) / 2;
+    const auto r = (ub - lb) / 2;
+
+    out[0] = tc[order];
+
+    for (std::uint32_t len = 1; len <= order; ++len) {
+        // Multiply the current series (which has len coefficients)
+        // by m + r * x. prev is the value of the coefficient
+        // at index j - 1 before the multiplication.
+        double prev = 0;
+        for (std::uint32_t j = 0; j <= len; ++j) {
+            const auto cur = (j < len) ? out[j] : 0.;
+            const auto next = (j + 1u < len) ? out[j + 1u] : 0.;
+
+            const auto xa = (j == 0u) ? next / 2 : ((j == 1u) ? prev + next / 2 : (prev + next) / 2);
+
+            out[j] = m * cur + r * xa;
+            prev = cur;
+        }
+
+        out[0] += tc[order - len];
+    }
+}
+
+// Convert the Chebyshev series with n coefficients stored in c
+// over the interval h in [lb, ub] into a polynomial in h, writing
+// the n coefficients of the polynomial into out. work must
+// point to a buffer of at least 2 * n doubles.
+// NOTE: this is the inverse of taylor_to_cheby(). The Chebyshev
+// polynomials are computed in the variable x = (h - m) / r
+// via the recurrence T_{k+1} = 2 * x * T_k - T_{k-1}.
+// The cost is quadratic in n.
+inline void cheby_to_taylor(const double *c, std::uint32_t n, double lb, double ub, double *out, double *work)
+{
+    assert(n > 0u);
+
+    const auto m = (lb + ub) / 2;
+    const auto r = (ub - lb) / 2;
+
+    // The coefficients of T_{k-1} and T_k.
+    auto *t_prev = work;
+    auto *t_cur = work + n;
+
+    std::fill(out, out + n, 0.);
+    std::fill(t_prev, t_prev + n, 0.);
+    std::fill(t_cur, t_cur + n, 0.);
+
+    // T_0 = 1.
+    t_cur[0] = 1;
+    out[0] = c[0];
+
+    for (std::uint32_t k = 1; k < n; ++k) {
+        // Compute T_k = f * x * T_{k-1} - g * T_{k-2}, with
+        // f = 1, g = 0 for k == 1 and f = 2, g = 1 otherwise,
+        // overwriting T_{k-2} in t_prev.
+        const auto f = (k == 1u) ? 1. : 2.;
+        const auto g = (k == 1u) ? 0. : 1.;
+
+        for (auto j = k; j > 0u; --j) {
+            t_prev[j] = f * (t_cur[j - 1u] - m * t_cur[j]) / r - g * t_prev[j];
+        }
+        t_prev[0] = -f * m * t_cur[0] / r - g * t_prev[0];
+
+        std::swap(t_prev, t_cur);
+
+        for (std::uint32_t j = 0; j <= k; ++j) {
+            out[j] += c[k] * t_cur[j];
+        }
+    }
+}
+
+// Evaluate at x the Chebyshev series with n coefficients stored in c
+// via Clenshaw's algorithm.
+inline double cheby_eval(const double *c, std::uint32_t n, double x)
+{
+    assert(n > 0u);
+
+    double b1 = 0, b2 = 0;
+    for (auto k = n - 1u; k > 0u; --k) {
+        const auto tmp = c[k] + 2 * x * b1 - b2;
+        b2 = b1;
+        b1 = tmp;
+    }
+
+    return c[0] + x * b1 - b2;
+}
+
+// Sum of the absolute values of the coefficients
+// of the Chebyshev series c from the index begin to the index n.
+inline double cheby_tail(const double *c, std::uint32_t begin, std::uint32_t n)
+{
+    double ret = 0;
+    for (auto k = begin; k < n; ++k) {
+        ret += std::abs(c[k]);
+    }
+
+    return ret;
+}
+
+// Economise the Taylor polynomial of order order whose coefficients are
+// stored in tc to a polynomial of degree deg over the interval h in [0, h_max],
+// writing the deg + 1 coefficients of the economised polynomial into out.
+// work must point to a buffer of at least 3 * (order + 1) doubles.
+//
+// The polynomial is converted into a Chebyshev series, which is then
+// truncated to deg + 1 terms and converted back. The return value is an
+// upper bound on the absolute difference between the original and the
+// economised polynomials in [0, h_max]: this is computed as the sum of the
+// absolute values of the differences between the Chebyshev coefficients of
+// the two polynomials, so that it accounts both for the truncated terms and
+// for the rounding errors in the conversion back to the monomial basis.
+// A further slack proportional to the magnitude of the polynomial is added
+// in order to account for the rounding errors in the evaluation of the polynomials.
+// If the bound cannot be computed, +inf is returned.
+inline double taylor_economise(const double *tc, std::uint32_t order, std::uint32_t deg, double h_max, double *out,
+                               double *work)
+{
+    assert(deg <= order);
+
+    auto *cf_orig = work;
+    auto *cf_econ = work + (order + 1u);
+
+    taylor_to_cheby(tc, order, 0, h_max, cf_orig);
+    cheby_to_taylor(cf_orig, deg + 1u, 0, h_max, out, cf_econ);
+    taylor_to_cheby(out, deg, 0, h_max, cf_econ);
+
+    auto ret = cheby_tail(cf_orig, deg + 1u, order + 1u);
+    for (std::uint32_t k = 0; k <= deg; ++k) {
+        ret += std::abs(cf_orig[k] - cf_econ[k]);
+    }
+    ret += 4 * (order + 1u) * std::numeric_limits<double>::epsilon() * cheby_tail(cf_orig, 0, order + 1u);
+
+    // NOTE: this also catches nans.
+    return std::isfinite(ret) ? ret : std::numeric_limits<double>::infinity();
+}
+
+// Enclosure of the range of the Chebyshev series
+// with n coefficients stored in c.
+inline ival cheby_bound(const double *c, std::uint32_t n)
+{
+    assert(n > 0u);
+
+    const auto tail = cheby_tail(c, 1, n);
+
+    return ival(c[0] - tail, c[0] + tail);
+}
+
+// Fit Chebyshev series to the D components of the function f over [-1, 1].
+// f(x, ptr) must write the D components of the function at x into ptr.
+//
+// The series are computed by interpolation at the Chebyshev nodes, doubling
+// the number of nodes (up to cheby_max_n) until the error measured at the nodes
+// of the next doubling is not greater than tols[j] for each component j. The trailing
+// coefficients whose magnitude fits in the leftover tolerance are then dropped.
+// On success, true is returned and out contains the coefficients as a row-major
+// 2D array with dimensions (D, n), with n the number of coefficients of the series.
+// If the tolerance cannot be met, false is returned.
+// NOTE: the samples at the check nodes of an iteration are reused
+// as the interpolation samples of the next iteration.
+template <std::size_t D, typename F>
+inline bool cheby_fit(F &&f, const std::array<double, D> &tols, std::vector<double> &out)
+{
+    using std::numbers::pi;
+
+    // Sample f at the n Chebyshev nodes of the first kind.
+    auto sample = [&f](std::uint32_t n, std::vector<double> &vals) {
+        vals.resize(static_cast<std::vector<double>::size_type>(n) * D);
+
+        for (std::uint32_t i = 0; i < n; ++i) {
+            f(std::cos(pi * (i + 0.5) / n), vals.data() + i * D);
+        }
+    };
+
+    std::vector<double> vals, check_vals, coeffs;
+
+    std::uint32_t n = 8;
+    sample(n, vals);
+
+    for (; n <= cheby_max_n; n *= 2u) {
+        // Compute the coefficients via the discrete cosine transform
+        // of the samples. The coefficients are stored in the (D, n) layout.
+        coeffs.assign(static_cast<std::vector<double>::size_type>(n) * D, 0.);
+        for (std::uint32_t k = 0; k < n; ++k) {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                const auto cf = std::cos(pi * k * (i + 0.5) / n) * (k == 0u ? 1. : 2.) / n;
+
+                for (std::size_t j = 0; j < D; ++j) {
+                    coeffs[j * n + k] += cf * vals[i * D + j];
+                }
+            }
+        }
+
+        // Measure the error at the nodes of the next doubling.
+        sample(2u * n, check_vals);
+
+        std::array<double, D> errs{};
+        for (std::uint32_t i = 0; i < 2u * n; ++i) {
+            const auto x = std::cos(pi * (i + 0.5) / (2u * n));
+
+            for (std::size_t j = 0; j < D; ++j) {
+                const auto err = std::abs(cheby_eval(coeffs.data() + j * n, n, x) - check_vals[i * D + j]);
+
+                // NOTE: turn nans into infinities, so that they are not
+                // ignored by std::max() and they prevent convergence.
+                errs[j] = std::max(errs[j], std::isnan(err) ? std::numeric_limits<double>::infinity() : err);
+            }
+        }
+
+        bool converged = true;
+        for (std::size_t j = 0; j < D; ++j) {
+            converged = converged && errs[j] <= tols[j];
+        }
+
+        if (converged) {
+            // Drop the trailing coefficients.
+            auto new_n = n;
+            while (new_n > 1u) {
+                bool can_drop = true;
+                for (std::size_t j = 0; j < D; ++j) {
+                    can_drop = can_drop && errs[j] + cheby_tail(coeffs.data() + j * n, new_n - 1u, n) <= tols[j];
+                }
+
+                if (!can_drop) {
+                    break;
+                }
+
+                --new_n;
+            }
+
+            out.resize(static_cast<std::vector<double>::size_type>(new_n) * D);
+            for (std::size_t j = 0; j < D; ++j) {
+                std::copy(coeffs.data() + j * n, coeffs.data() + j * n + new_n, out.data() + j * new_n);
+            }
+
+            return true;
+        }
+
+        vals.swap(check_vals);
+    }
+
+    return false;
+}
+
+} // namespace cascade::detail
+
+#endif
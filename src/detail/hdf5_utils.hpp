@@ -0,0 +1,90 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_DETAIL_HDF5_UTILS_HPP
+#define CASCADE_DETAIL_HDF5_UTILS_HPP
+
+#if defined(CASCADE_WITH_HDF5)
+
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/core.h>
+
+#include <hdf5.h>
+
+namespace cascade::detail
+{
+
+// NOTE: the HDF5 library is in general not thread-safe, thus
+// all the HDF5 calls in cascade are serialised via this mutex.
+inline std::mutex hdf5_mutex;
+
+// Minimal RAII wrapper for HDF5 identifiers.
+class h5_id
+{
+    hid_t m_id = H5I_INVALID_HID;
+    herr_t (*m_close)(hid_t) = nullptr;
+
+public:
+    h5_id() = default;
+    h5_id(hid_t id, herr_t (*close)(hid_t), const char *what) : m_id(id), m_close(close)
+    {
+        if (m_id < 0) {
+            throw std::invalid_argument(fmt::format("HDF5 error: {}", what));
+        }
+    }
+    h5_id(const h5_id &) = delete;
+    h5_id(h5_id &&other) noexcept : m_id(std::exchange(other.m_id, H5I_INVALID_HID)), m_close(other.m_close) {}
+    h5_id &operator=(const h5_id &) = delete;
+    h5_id &operator=(h5_id &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            m_id = std::exchange(other.m_id, H5I_INVALID_HID);
+            m_close = other.m_close;
+        }
+
+        return *this;
+    }
+    ~h5_id()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if (m_id >= 0) {
+            m_close(m_id);
+            m_id = H5I_INVALID_HID;
+        }
+    }
+
+    [[nodiscard]] hid_t get() const
+    {
+        return m_id;
+    }
+    explicit operator bool() const
+    {
+        return m_id >= 0;
+    }
+};
+
+inline void h5_check(herr_t status, const char *what)
+{
+    if (status < 0) {
+        throw std::invalid_argument(fmt::format("HDF5 error: {}", what));
+    }
+}
+
+} // namespace cascade::detail
+
+#endif
+
+#endif
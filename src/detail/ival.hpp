@@ -43,6 +43,11 @@ inline ival operator+(double a, ival b)
     return ival(a) + b;
 }
 
+inline ival operator-(ival a, ival b)
+{
+    return ival(a.lower - b.upper, a.upper - b.lower);
+}
+
 inline ival operator*(ival a, ival b)
 {
     const auto tmp1 = a.lower * b.lower;
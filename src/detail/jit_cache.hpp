@@ -0,0 +1,48 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_DETAIL_JIT_CACHE_HPP
+#define CASCADE_DETAIL_JIT_CACHE_HPP
+
+#include <memory>
+#include <string>
+
+#include <cascade/detail/sim_data.hpp>
+
+namespace cascade::detail
+{
+
+// The part of the keys of the cache entries which depends on the
+// environment (heyoka and LLVM versions, host CPU) rather than on
+// the simulation setup.
+const std::string &jit_cache_env_key();
+
+// Look up in the on-disk cache the compiled data corresponding to the input key.
+// A null pointer is returned if the cache is disabled, if the entry
+// does not exist or if it cannot be loaded.
+// NOTE: the pointers to the JIT-compiled functions
+// in the returned object are not set up.
+std::shared_ptr<sim_jit_data> jit_cache_load(const std::string &);
+
+// Store compiled data in the on-disk cache (if enabled). Failures are logged
+// and otherwise ignored.
+void jit_cache_store(const std::string &, const sim_jit_data &);
+
+// Look up the compiled data corresponding to the input key in the
+// process-wide registry. A null pointer is returned if no live
+// entry exists.
+std::shared_ptr<const sim_jit_data> jit_registry_lookup(const std::string &);
+
+// Insert compiled data into the registry. If a live entry with the same
+// key already exists (e.g., because it was inserted concurrently by
+// another thread), the existing entry is returned instead.
+std::shared_ptr<const sim_jit_data> jit_registry_insert(const std::string &, std::shared_ptr<const sim_jit_data>);
+
+} // namespace cascade::detail
+
+#endif
@@ -0,0 +1,42 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CASCADE_DETAIL_REL_VEL_SIEVE_HPP
+#define CASCADE_DETAIL_REL_VEL_SIEVE_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include <cascade/detail/visibility.hpp>
+
+// NOTE: the sieve is exported from the shared library
+// only in builds with the unit tests enabled.
+#if defined(CASCADE_EXPORT_TEST_SYMBOLS)
+
+#define CASCADE_DLL_TEST_PUBLIC CASCADE_DLL_PUBLIC
+
+#else
+
+#define CASCADE_DLL_TEST_PUBLIC
+
+#endif
+
+namespace cascade::detail
+{
+
+// Relative-velocity sieve of the narrow phase (see the implementation
+// in sim_narrow_phase.cpp).
+CASCADE_DLL_TEST_PUBLIC std::optional<std::pair<double, double>>
+rel_vel_sieve(const std::array<const double *, 3> &, const std::array<const double *, 3> &, double, double, double,
+              double, std::uint32_t);
+
+} // namespace cascade::detail
+
+#endif
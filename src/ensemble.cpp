@@ -0,0 +1,178 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#include <cascade/detail/logging_impl.hpp>
+#include <cascade/ensemble.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+ensemble::ensemble() = default;
+
+ensemble::ensemble(const sim &proto, std::vector<std::vector<double>> states, std::vector<std::vector<double>> pars)
+{
+    if (!pars.empty() && pars.size() != states.size()) {
+        throw std::invalid_argument(fmt::format("The number of parameter vectors passed to the constructor of an "
+                                                "ensemble ({}) must be equal to the number of states ({})",
+                                                pars.size(), states.size()));
+    }
+
+    // NOTE: the members are copies of the prototype, thus
+    // they share its compiled code (see the copy constructor of sim).
+    m_members.reserve(states.size());
+    for (decltype(states.size()) i = 0; i < states.size(); ++i) {
+        m_members.push_back(proto);
+    }
+
+    m_summaries.resize(states.size());
+
+    // Set up the initial states in parallel.
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<size_type>(0, m_members.size(), 1), [&](const auto &range) {
+        for (auto i = range.begin(); i != range.end(); ++i) {
+            m_members[i].set_new_state_pars(std::move(states[i]),
+                                            pars.empty() ? std::vector<double>{} : std::move(pars[i]));
+        }
+    });
+}
+
+const sim &ensemble::get_member(size_type i) const
+{
+    if (i >= m_members.size()) {
+        throw std::out_of_range(fmt::format(
+            "Cannot access the member at index {} of an ensemble of size {}", i, m_members.size()));
+    }
+
+    return m_members[i];
+}
+
+sim &ensemble::get_member(size_type i)
+{
+    if (i >= m_members.size()) {
+        throw std::out_of_range(fmt::format(
+            "Cannot access the member at index {} of an ensemble of size {}", i, m_members.size()));
+    }
+
+    return m_members[i];
+}
+
+// Propagate the member at index idx up to the time t,
+// handling the interruptions along the way.
+void ensemble::propagate_member(size_type idx, double t)
+{
+    auto &s = m_members[idx];
+    auto &sm = m_summaries[idx];
+
+    if (sm.oc == outcome::err_nf_state) {
+        // The member was stopped.
+        return;
+    }
+
+    // NOTE: the number of detected conjunctions is computed from the
+    // per-tier counters, which, unlike the list of conjunctions in the sim,
+    // are not cleared when the conjunctions are pushed to a sink. The counters
+    // also account for the conjunctions flushed by the particle removals.
+    const auto conj_total = [&s]() {
+        const auto &counts = s.get_conj_tier_counts();
+        return std::accumulate(counts.begin(), counts.end(), size_type(0));
+    };
+    const auto n_conj = conj_total();
+    const auto update_n_conj = [&]() {
+        // NOTE: the counters may be reset (e.g., by the user)
+        // only between propagations.
+        assert(conj_total() >= n_conj);
+        sm.n_conjunctions += conj_total() - n_conj;
+    };
+
+    while (true) {
+        if (s.get_nparts() == 0u) {
+            // NOTE: a simulation with no particles cannot be
+            // propagated, we just need to update the time coordinate.
+            if (!(t >= s.get_time())) {
+                throw std::invalid_argument(
+                    fmt::format("The final time passed to the propagate_until() function of an ensemble must be not "
+                                "less than the current time of the members, but a value of {} was provided instead",
+                                t));
+            }
+
+            s.set_time(t);
+            sm.oc = outcome::time_limit;
+            update_n_conj();
+
+            return;
+        }
+
+        const auto oc = s.propagate_until(t);
+
+        sm.oc = oc;
+
+        switch (oc) {
+            case outcome::collision: {
+                const auto [i, j] = std::get<0>(*s.get_interrupt_info());
+                ++sm.n_collisions;
+                s.remove_particles({i, j});
+                break;
+            }
+            case outcome::reentry:
+                ++sm.n_reentries;
+                s.remove_particles({std::get<1>(*s.get_interrupt_info())});
+                break;
+            case outcome::exit:
+                ++sm.n_exits;
+                s.remove_particles({std::get<1>(*s.get_interrupt_info())});
+                break;
+            default:
+                // time_limit or err_nf_state.
+                // NOTE: success is never returned by propagate_until().
+                assert(oc != outcome::success);
+                update_n_conj();
+
+                return;
+        }
+    }
+}
+
+void ensemble::propagate_until(double t)
+{
+    if (!std::isfinite(t)) {
+        throw std::invalid_argument(fmt::format(
+            "The final time passed to the propagate_until() function of an ensemble must be finite, but a value "
+            "of {} was provided instead",
+            t));
+    }
+
+    spdlog::stopwatch sw;
+
+    // NOTE: the members are propagated concurrently in the
+    // current TBB arena, where their internal parallel loops are nested.
+    // A grain size of 1 lets the scheduler balance members
+    // with different numbers of particles and interruptions.
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<size_type>(0, m_members.size(), 1),
+                              [&](const auto &range) {
+                                  for (auto i = range.begin(); i != range.end(); ++i) {
+                                      propagate_member(i, t);
+                                  }
+                              });
+
+    detail::get_logger()->trace("Ensemble propagation time: {}s", sw);
+}
+
+} // namespace cascade
@@ -0,0 +1,926 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
+
+#include <fmt/core.h>
+
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#include <heyoka/detail/dfloat.hpp>
+
+#include <cascade/detail/sim_data.hpp>
+#include <cascade/ephemeris.hpp>
+#include <cascade/sim.hpp>
+
+#include "detail/cheby.hpp"
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+using dfloat = heyoka::detail::dfloat<double>;
+
+// The header of an ephemeris file.
+struct eph_header {
+    char magic[8];
+    std::uint64_t version;
+};
+
+static_assert(std::is_trivially_copyable_v<eph_header>);
+
+constexpr char eph_magic[8] = {'C', 'S', 'C', 'D', 'E', 'P', 'H', 'M'};
+
+// NOTE: version 2 introduced the Chebyshev blocks,
+// version 3 introduced the particle ids in the blocks.
+constexpr std::uint64_t eph_version = 3;
+
+// The kinds of blocks.
+constexpr std::uint64_t eph_taylor = 0;
+constexpr std::uint64_t eph_cheby = 1;
+
+// The header of a block in an ephemeris file.
+// NOTE: the size of the block is written after the
+// rest of the block, so that a block whose writing was
+// interrupted has a zero size.
+struct eph_block_header {
+    std::uint64_t size;
+    std::uint64_t nparts;
+    std::uint64_t kind;
+    std::uint64_t order;
+    std::uint64_t n_segments;
+    double t0_hi, t0_lo;
+    double t1_hi, t1_lo;
+};
+
+static_assert(std::is_trivially_copyable_v<eph_block_header>);
+static_assert(sizeof(eph_block_header) == 72u);
+
+// Number of particles whose Taylor coefficients
+// are assembled in the write buffer at a time.
+constexpr std::size_t eph_write_batch = 1024;
+
+using safe_u64_t = boost::safe_numerics::safe<std::uint64_t>;
+
+// Compute the size in bytes of the part of a block
+// preceding the polynomial coefficients.
+safe_u64_t eph_block_index_size(std::uint64_t nparts, std::uint64_t n_segments)
+{
+    return sizeof(eph_block_header) + (safe_u64_t(nparts) + 1) * 8 + safe_u64_t(nparts) * 8
+           + safe_u64_t(n_segments) * 16;
+}
+
+// Write the particle ids of the sim s into file.
+void eph_write_ids(std::ofstream &file, const sim &s)
+{
+    const auto &ids = s.get_ids();
+
+    file.write(reinterpret_cast<const char *>(ids.data()),
+               boost::numeric_cast<std::streamsize>(ids.size() * sizeof(std::uint64_t)));
+}
+
+// Compute the size in bytes of a Taylor block.
+std::uint64_t eph_taylor_block_size(std::uint64_t nparts, std::uint64_t order, std::uint64_t n_segments)
+{
+    return eph_block_index_size(nparts, n_segments) + safe_u64_t(n_segments) * 6 * (safe_u64_t(order) + 1) * 8;
+}
+
+// Compute the size in bytes of a Chebyshev block
+// containing n_coeffs coefficients.
+std::uint64_t eph_cheby_block_size(std::uint64_t nparts, std::uint64_t n_segments, std::uint64_t n_coeffs)
+{
+    return eph_block_index_size(nparts, n_segments) + (safe_u64_t(n_segments) + 1) * 8 + safe_u64_t(n_coeffs) * 8;
+}
+
+// Evaluate at h the 6 Taylor polynomials of order order whose
+// coefficients are stored in c as a row-major 2D array with
+// dimensions (order + 1, 6), writing the result into out.
+// NOTE: the 6 polynomials are evaluated at the same time,
+// so that the inner loop can be vectorised.
+void horner6(const double *c, std::uint64_t order, double h, double *out)
+{
+    std::array<double, 6> acc{};
+    std::copy(c + order * 6u, c + order * 6u + 6u, acc.begin());
+
+    for (auto o = order; o-- > 0u;) {
+        const auto *cur_c = c + o * 6u;
+
+        for (auto j = 0u; j < 6u; ++j) {
+            acc[j] = cur_c[j] + acc[j] * h;
+        }
+    }
+
+    std::copy(acc.begin(), acc.end(), out);
+}
+
+// Chebyshev series of the trajectory of a particle
+// during a superstep.
+struct eph_cheby_traj {
+    // The ends of the segments.
+    std::vector<double> ends;
+    // The number of coefficients of the segments.
+    std::vector<std::uint64_t> sizes;
+    // The coefficients of the segments, each stored
+    // in the (6, n) layout.
+    std::vector<double> coeffs;
+};
+
+} // namespace
+
+} // namespace detail
+
+struct ephemeris_writer::impl {
+    std::string m_path;
+    double m_cheby_tol = 0;
+    std::ofstream m_file;
+    std::uint64_t m_n_blocks = 0;
+    // The beginning of the superstep
+    // of the last block.
+    std::optional<detail::dfloat> m_last_t0;
+    // Buffers used to assemble the blocks.
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<double, detail::no_init_alloc<double>> m_buffer;
+    std::vector<detail::eph_cheby_traj> m_trajs;
+};
+
+ephemeris_writer::ephemeris_writer(ptag_t) : m_impl(std::make_unique<impl>()) {}
+
+void ephemeris_writer::finalise_ctor(std::string path, double cheby_tol)
+{
+    auto &im = *m_impl;
+
+    if (!std::isfinite(cheby_tol) || cheby_tol < 0) {
+        throw std::invalid_argument(
+            fmt::format("The Chebyshev tolerance of an ephemeris writer must be finite and non-negative, but "
+                        "it is {} instead",
+                        cheby_tol));
+    }
+
+    im.m_path = std::move(path);
+    im.m_cheby_tol = cheby_tol;
+
+    im.m_file.open(im.m_path, std::ios::binary | std::ios::trunc);
+    if (!im.m_file) {
+        throw std::invalid_argument(fmt::format("Unable to open the ephemeris file '{}' for writing", im.m_path));
+    }
+
+    // Write the file header.
+    detail::eph_header hdr{};
+    std::memcpy(hdr.magic, detail::eph_magic, sizeof(hdr.magic));
+    hdr.version = detail::eph_version;
+    im.m_file.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    im.m_file.flush();
+
+    if (!im.m_file) {
+        throw std::invalid_argument(fmt::format("Error writing to the ephemeris file '{}'", im.m_path));
+    }
+}
+
+ephemeris_writer::~ephemeris_writer() = default;
+
+const std::string &ephemeris_writer::get_path() const
+{
+    return m_impl->m_path;
+}
+
+double ephemeris_writer::get_cheby_tol() const
+{
+    return m_impl->m_cheby_tol;
+}
+
+std::uint64_t ephemeris_writer::get_n_blocks() const
+{
+    return m_impl->m_n_blocks;
+}
+
+// Fetch the size in bytes of the ephemeris file.
+std::uint64_t ephemeris_writer::get_n_bytes() const
+{
+    return boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(m_impl->m_file.tellp()));
+}
+
+// Write a Taylor block, returning its size.
+std::uint64_t ephemeris_writer::write_taylor(const sim &s, const heyoka::detail::dfloat<double> &t0)
+{
+    auto &im = *m_impl;
+    auto &file = im.m_file;
+
+    const auto &s_data = s.m_data->s_data;
+    const auto order = s.m_data->jit->s_ta.get_order();
+    const auto nparts = s.get_nparts();
+    const auto t1 = s.m_data->time;
+
+    // Build the per-particle index.
+    auto &offsets = im.m_offsets;
+    using safe_size_t = boost::safe_numerics::safe<decltype(offsets.size())>;
+    offsets.resize(static_cast<decltype(offsets.size())>(safe_size_t(nparts) + 1));
+    offsets[0] = 0;
+    for (decltype(s_data.size()) i = 0; i < nparts; ++i) {
+        offsets[i + 1u] = detail::safe_u64_t(offsets[i]) + s_data[i].tcoords.size();
+    }
+    const auto n_substeps = offsets.back();
+
+    // Write the block header, with a zero block size.
+    const detail::eph_block_header bhdr{0, nparts, detail::eph_taylor, order, n_substeps, t0.hi, t0.lo, t1.hi, t1.lo};
+    file.write(reinterpret_cast<const char *>(&bhdr), sizeof(bhdr));
+
+    // Write the per-particle index and the particle ids.
+    file.write(reinterpret_cast<const char *>(offsets.data()),
+               boost::numeric_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t)));
+    detail::eph_write_ids(file, s);
+
+    // Write the time coordinates.
+    for (const auto &sd : s_data) {
+        for (const auto &tc : sd.tcoords) {
+            const std::array tc_arr{tc.hi, tc.lo};
+            file.write(reinterpret_cast<const char *>(tc_arr.data()), sizeof(tc_arr));
+        }
+    }
+
+    // Write the Taylor coefficients. The coefficients are assembled
+    // in batches of particles, transposing them from the
+    // (n_substeps, 7, order + 1) layout of the sim to
+    // the (n_substeps, order + 1, 6) layout of the archive.
+    const auto ss_size = 6u * (order + 1u);
+
+    for (decltype(s_data.size()) b_begin = 0; b_begin < nparts; b_begin += detail::eph_write_batch) {
+        const auto b_end = std::min<decltype(s_data.size())>(nparts, b_begin + detail::eph_write_batch);
+
+        const auto buf_begin = offsets[b_begin];
+        im.m_buffer.resize(boost::numeric_cast<decltype(im.m_buffer.size())>((offsets[b_end] - buf_begin) * ss_size));
+
+        oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(b_begin, b_end), [&](const auto &range) {
+            for (auto pidx = range.begin(); pidx != range.end(); ++pidx) {
+                const auto &sd = s_data[pidx];
+                auto *out = im.m_buffer.data() + (offsets[pidx] - buf_begin) * ss_size;
+
+                for (decltype(sd.tcoords.size()) ss_idx = 0; ss_idx < sd.tcoords.size(); ++ss_idx) {
+                    const auto *tcs = sd.tcs.data() + ss_idx * 7u * (order + 1u);
+
+                    for (auto o = 0u; o <= order; ++o) {
+                        for (auto j = 0u; j < 6u; ++j) {
+                            *out++ = tcs[j * (order + 1u) + o];
+                        }
+                    }
+                }
+            }
+        });
+
+        file.write(reinterpret_cast<const char *>(im.m_buffer.data()),
+                   boost::numeric_cast<std::streamsize>(im.m_buffer.size() * sizeof(double)));
+    }
+
+    return detail::eph_taylor_block_size(nparts, order, n_substeps);
+}
+
+// Write a Chebyshev block, returning its size.
+//
+// The trajectory of each particle is re-fitted over each chunk of the superstep
+// (i.e., over each collisional timestep). If the fit fails to meet the
+// tolerance, the fitting interval is bisected. If the fitting interval
+// falls within a single substep, the Taylor polynomials are instead converted
+// exactly and then truncated.
+std::uint64_t ephemeris_writer::write_cheby(const sim &s, const heyoka::detail::dfloat<double> &t0)
+{
+    using dfloat = detail::dfloat;
+
+    auto &im = *m_impl;
+    auto &file = im.m_file;
+
+    const auto &s_data = s.m_data->s_data;
+    const auto order = s.m_data->jit->s_ta.get_order();
+    const auto nparts = s.get_nparts();
+    const auto nchunks = s.m_data->nchunks;
+    const auto t1 = s.m_data->time;
+    const auto tol = im.m_cheby_tol;
+
+    // Fit the trajectories.
+    auto &trajs = im.m_trajs;
+    trajs.resize(nparts);
+
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<sim::size_type>(0, nparts), [&](const auto &range) {
+        std::vector<double> fit;
+
+        for (auto pidx = range.begin(); pidx != range.end(); ++pidx) {
+            const auto &tcoords = s_data[pidx].tcoords;
+            const auto *tcs = s_data[pidx].tcs.data();
+            auto &traj = trajs[pidx];
+
+            traj.ends.clear();
+            traj.sizes.clear();
+            traj.coeffs.clear();
+
+            if (tcoords.empty()) {
+                continue;
+            }
+
+            // Locate the index of the substep containing the time h
+            // (relative to the beginning of the superstep), and fetch
+            // the initial time coordinate of the substep
+            // (see dense_propagate() in the sim class).
+            auto locate_ss = [&tcoords](double h) {
+                auto it = std::lower_bound(tcoords.begin(), tcoords.end(), dfloat(h));
+                it -= (it == tcoords.end());
+
+                return std::pair{static_cast<decltype(tcoords.size())>(it - tcoords.begin()),
+                                 (it == tcoords.begin()) ? dfloat(0) : *(it - 1)};
+            };
+
+            // Evaluate the state of the particle at the time h.
+            auto eval = [&](double h, double *out) {
+                const auto [ss_idx, ss_start] = locate_ss(h);
+                const auto *ss_tcs = tcs + ss_idx * 7u * (order + 1u);
+                const auto hh = static_cast<double>(dfloat(h) - ss_start);
+
+                for (auto j = 0u; j < 6u; ++j) {
+                    const auto *ptr = ss_tcs + j * (order + 1u);
+
+                    auto acc = ptr[order];
+                    for (auto o = 1u; o <= order; ++o) {
+                        acc = ptr[order - o] + acc * hh;
+                    }
+
+                    out[j] = acc;
+                }
+            };
+
+            auto append = [&traj](double end, std::uint32_t n, const double *c) {
+                traj.ends.push_back(end);
+                traj.sizes.push_back(6u * n);
+                traj.coeffs.insert(traj.coeffs.end(), c, c + 6u * n);
+            };
+
+            // Fit the trajectory over [lb, ub].
+            auto fit_segment = [&](auto &self, double lb, double ub) -> void {
+                const auto half = (ub - lb) / 2;
+                const std::array tols{tol, tol, tol, tol / half, tol / half, tol / half};
+
+                if (detail::cheby_fit<6>([&](double x, double *out) { eval(lb + half * (x + 1), out); }, tols,
+                                         fit)) {
+                    append(ub, static_cast<std::uint32_t>(fit.size() / 6u), fit.data());
+                    return;
+                }
+
+                // Locate the substep containing the beginning of [lb, ub].
+                // NOTE: unlike in locate_ss(), if lb is the end of a
+                // substep we want the next substep.
+                auto ss_it = std::upper_bound(tcoords.begin(), tcoords.end(), dfloat(lb));
+                ss_it -= (ss_it == tcoords.end());
+                const auto ss_idx = static_cast<decltype(tcoords.size())>(ss_it - tcoords.begin());
+                const auto ss_start = (ss_it == tcoords.begin()) ? dfloat(0) : *(ss_it - 1);
+
+                // If [lb, ub] spans multiple substeps, split it at
+                // the substep boundary closest to its midpoint.
+                // NOTE: the boundaries within (lb, ub) are in the
+                // range [ss_it, bnd_end).
+                const auto bnd_end = std::lower_bound(ss_it, tcoords.end(), dfloat(ub));
+                if (ss_it != bnd_end) {
+                    const auto mid = lb + half;
+
+                    auto split_it = std::lower_bound(ss_it, bnd_end, dfloat(mid));
+                    if (split_it == bnd_end
+                        || (split_it != ss_it
+                            && mid - static_cast<double>(*(split_it - 1)) < static_cast<double>(*split_it) - mid)) {
+                        --split_it;
+                    }
+
+                    // NOTE: the check is needed because of the
+                    // conversion of the boundary to double.
+                    if (const auto split = static_cast<double>(*split_it); split > lb && split < ub) {
+                        self(self, lb, split);
+                        self(self, split, ub);
+
+                        return;
+                    }
+                }
+
+                // [lb, ub] is within a single substep: convert exactly
+                // the Taylor polynomials and drop the trailing
+                // coefficients within the tolerance.
+                fit.resize(6u * (order + 1u));
+
+                const auto h_lb = static_cast<double>(dfloat(lb) - ss_start);
+                const auto h_ub = static_cast<double>(dfloat(ub) - ss_start);
+
+                for (auto j = 0u; j < 6u; ++j) {
+                    detail::taylor_to_cheby(tcs + (ss_idx * 7u + j) * (order + 1u), order, h_lb, h_ub,
+                                            fit.data() + j * (order + 1u));
+                }
+
+                auto n = order + 1u;
+                while (n > 1u) {
+                    bool can_drop = true;
+                    for (auto j = 0u; j < 6u; ++j) {
+                        can_drop = can_drop
+                                   && detail::cheby_tail(fit.data() + j * (order + 1u), n - 1u, order + 1u) <= tols[j];
+                    }
+
+                    if (!can_drop) {
+                        break;
+                    }
+
+                    --n;
+                }
+
+                for (auto j = 1u; j < 6u; ++j) {
+                    std::copy(fit.data() + j * (order + 1u), fit.data() + j * (order + 1u) + n, fit.data() + j * n);
+                }
+
+                append(ub, n, fit.data());
+            };
+
+            const auto t_end = static_cast<double>(tcoords.back());
+
+            for (auto chunk_idx = 0u; chunk_idx < nchunks; ++chunk_idx) {
+                const auto [c_begin, c_end] = s.m_data->get_chunk_begin_end(chunk_idx, s.m_ct);
+
+                if (c_begin >= t_end) {
+                    break;
+                }
+
+                // NOTE: the last segment always extends to the end of the
+                // last substep, so that the fit covers the whole trajectory.
+                fit_segment(fit_segment, c_begin, (chunk_idx + 1u == nchunks) ? t_end : std::min(c_end, t_end));
+            }
+        }
+    });
+
+    // Build the per-particle index.
+    auto &offsets = im.m_offsets;
+    using safe_size_t = boost::safe_numerics::safe<decltype(offsets.size())>;
+    offsets.resize(static_cast<decltype(offsets.size())>(safe_size_t(nparts) + 1));
+    offsets[0] = 0;
+    std::uint64_t max_deg = 0;
+    for (decltype(trajs.size()) i = 0; i < nparts; ++i) {
+        offsets[i + 1u] = detail::safe_u64_t(offsets[i]) + trajs[i].ends.size();
+
+        for (auto sz : trajs[i].sizes) {
+            max_deg = std::max(max_deg, sz / 6u - 1u);
+        }
+    }
+    const auto n_segments = offsets.back();
+
+    // Write the block header, with a zero block size.
+    const detail::eph_block_header bhdr{0, nparts, detail::eph_cheby, max_deg, n_segments, t0.hi, t0.lo, t1.hi, t1.lo};
+    file.write(reinterpret_cast<const char *>(&bhdr), sizeof(bhdr));
+
+    // Write the per-particle index and the particle ids.
+    file.write(reinterpret_cast<const char *>(offsets.data()),
+               boost::numeric_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t)));
+    detail::eph_write_ids(file, s);
+
+    // Write the ends of the segments.
+    for (const auto &traj : trajs) {
+        for (auto end : traj.ends) {
+            const std::array tc_arr{end, 0.};
+            file.write(reinterpret_cast<const char *>(tc_arr.data()), sizeof(tc_arr));
+        }
+    }
+
+    // Write the offsets of the coefficients.
+    std::uint64_t n_coeffs = 0;
+    file.write(reinterpret_cast<const char *>(&n_coeffs), sizeof(n_coeffs));
+    for (const auto &traj : trajs) {
+        for (auto sz : traj.sizes) {
+            n_coeffs = detail::safe_u64_t(n_coeffs) + sz;
+            file.write(reinterpret_cast<const char *>(&n_coeffs), sizeof(n_coeffs));
+        }
+    }
+
+    // Write the coefficients.
+    for (const auto &traj : trajs) {
+        file.write(reinterpret_cast<const char *>(traj.coeffs.data()),
+                   boost::numeric_cast<std::streamsize>(traj.coeffs.size() * sizeof(double)));
+    }
+
+    return detail::eph_cheby_block_size(nparts, n_segments, n_coeffs);
+}
+
+void ephemeris_writer::superstep_done(const sim &s, const heyoka::detail::dfloat<double> &t0)
+{
+    auto &im = *m_impl;
+    auto &file = im.m_file;
+
+    if (!file) {
+        throw std::invalid_argument(fmt::format("Cannot write to the ephemeris file '{}' after an error", im.m_path));
+    }
+
+    // NOTE: the reader locates the blocks via binary search.
+    if (im.m_last_t0 && t0 < *im.m_last_t0) {
+        throw std::invalid_argument(
+            fmt::format("Cannot write to the ephemeris file '{}' a superstep beginning at the time {}, which "
+                        "precedes the beginning of the previous superstep ({})",
+                        im.m_path, static_cast<double>(t0), static_cast<double>(*im.m_last_t0)));
+    }
+
+    assert(s.m_data->s_data.size() == s.get_nparts());
+
+    const auto block_begin = file.tellp();
+
+    try {
+        const auto block_size = (im.m_cheby_tol == 0) ? write_taylor(s, t0) : write_cheby(s, t0);
+
+        // Write the block size.
+        const auto block_end = file.tellp();
+        assert(static_cast<std::uint64_t>(static_cast<std::streamoff>(block_end - block_begin)) == block_size);
+
+        file.seekp(block_begin);
+        file.write(reinterpret_cast<const char *>(&block_size), sizeof(block_size));
+        file.seekp(block_end);
+        file.flush();
+
+        if (!file) {
+            throw std::invalid_argument(fmt::format("Error writing to the ephemeris file '{}'", im.m_path));
+        }
+    } catch (...) {
+        // NOTE: discard the partially-written block, so that
+        // the next block is written in its place.
+        file.clear();
+        file.seekp(block_begin);
+
+        std::error_code ec;
+        std::filesystem::resize_file(im.m_path, static_cast<std::uintmax_t>(static_cast<std::streamoff>(block_begin)),
+                                     ec);
+
+        throw;
+    }
+
+    im.m_last_t0 = t0;
+    ++im.m_n_blocks;
+}
+
+struct ephemeris_reader::impl {
+    struct block {
+        detail::dfloat t0, t1;
+        std::uint64_t nparts = 0;
+        std::uint64_t kind = 0;
+        std::uint64_t order = 0;
+        std::uint64_t n_segments = 0;
+        const std::uint64_t *offsets = nullptr;
+        const std::uint64_t *ids = nullptr;
+        const double *tcoords = nullptr;
+        // NOTE: for Chebyshev blocks, this points
+        // to the offsets of the coefficients.
+        const std::uint64_t *c_offsets = nullptr;
+        const double *coeffs = nullptr;
+    };
+
+    std::string m_path;
+    boost::interprocess::file_mapping m_fmap;
+    boost::interprocess::mapped_region m_region;
+    std::vector<block> m_blocks;
+
+    [[nodiscard]] const block &locate(double) const;
+    [[nodiscard]] sim::size_type id_to_index(const block &, std::uint64_t, double) const;
+    void eval(const block &, sim::size_type, double, double *) const;
+};
+
+// Locate the block covering the time t.
+const ephemeris_reader::impl::block &ephemeris_reader::impl::locate(double t) const
+{
+    if (!std::isfinite(t)) {
+        throw std::invalid_argument(
+            fmt::format("Cannot query the ephemeris archive '{}' at the non-finite time {}", m_path, t));
+    }
+
+    const detail::dfloat dt(t);
+
+    // Locate the first block beginning after t.
+    const auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), dt,
+                                     [](const auto &tm, const block &b) { return tm < b.t0; });
+
+    if (it == m_blocks.begin() || dt > (it - 1)->t1) {
+        throw std::invalid_argument(
+            fmt::format("The time {} is not covered by the ephemeris archive '{}'", t, m_path));
+    }
+
+    return *(it - 1);
+}
+
+// Fetch the index of the particle with the input id in the block b.
+// NOTE: t is used only in the error message.
+sim::size_type ephemeris_reader::impl::id_to_index(const block &b, std::uint64_t id, double t) const
+{
+    // NOTE: the ids in a block are sorted in ascending order (see sim::get_ids()).
+    const auto *const it = std::lower_bound(b.ids, b.ids + b.nparts, id);
+
+    if (it == b.ids + b.nparts || *it != id) {
+        throw std::out_of_range(
+            fmt::format("No particle with id {} exists at the time {} in the ephemeris archive '{}'", id, t, m_path));
+    }
+
+    return static_cast<sim::size_type>(it - b.ids);
+}
+
+// Evaluate the state of the particle at index pidx
+// in the block b at the time t, writing it into out.
+void ephemeris_reader::impl::eval(const block &b, sim::size_type pidx, double t, double *out) const
+{
+    if (pidx >= b.nparts) {
+        throw std::invalid_argument(
+            fmt::format("Invalid particle index {} specified in a query at the time {} of the ephemeris archive "
+                        "'{}': the number of particles at this time is {}",
+                        pidx, t, m_path, b.nparts));
+    }
+
+    const auto ss_begin = b.offsets[pidx];
+    const auto ss_end = b.offsets[pidx + 1u];
+
+    if (ss_begin >= ss_end || ss_end > b.n_segments) {
+        throw std::invalid_argument(
+            fmt::format("Invalid per-particle index detected in the ephemeris archive '{}'", m_path));
+    }
+
+    const auto tcoord
+        = [&b](std::uint64_t idx) { return detail::dfloat(b.tcoords[2u * idx], b.tcoords[2u * idx + 1u]); };
+
+    // The time relative to the beginning of the superstep.
+    const auto dt = detail::dfloat(t) - b.t0;
+
+    // Locate the first segment whose end is *greater than or
+    // equal to* t, rolling back by one if necessary
+    // (see dense_propagate() in the sim class).
+    auto lb = ss_begin, ub = ss_end;
+    while (lb < ub) {
+        const auto mid = lb + (ub - lb) / 2u;
+
+        if (tcoord(mid) < dt) {
+            lb = mid + 1u;
+        } else {
+            ub = mid;
+        }
+    }
+    lb -= (lb == ss_end);
+
+    // The initial time coordinate of the segment.
+    const auto ss_start = (lb == ss_begin) ? detail::dfloat(0) : tcoord(lb - 1u);
+
+    if (b.kind == detail::eph_taylor) {
+        detail::horner6(b.coeffs + lb * 6u * (b.order + 1u), b.order, static_cast<double>(dt - ss_start), out);
+    } else {
+        const auto c_begin = b.c_offsets[lb];
+        const auto c_end = b.c_offsets[lb + 1u];
+
+        if (c_begin >= c_end || c_end > b.c_offsets[b.n_segments] || (c_end - c_begin) % 6u != 0u) {
+            throw std::invalid_argument(
+                fmt::format("Invalid Chebyshev coefficients detected in the ephemeris archive '{}'", m_path));
+        }
+
+        const auto n = boost::numeric_cast<std::uint32_t>((c_end - c_begin) / 6u);
+
+        // Map the time into [-1, 1].
+        const auto len = static_cast<double>(tcoord(lb) - ss_start);
+        const auto x = (2 * static_cast<double>(dt - ss_start) - len) / len;
+
+        for (auto j = 0u; j < 6u; ++j) {
+            out[j] = detail::cheby_eval(b.coeffs + c_begin + j * n, n, x);
+        }
+    }
+}
+
+ephemeris_reader::ephemeris_reader(const std::string &path) : m_impl(std::make_unique<impl>())
+{
+    auto &im = *m_impl;
+
+    im.m_path = path;
+
+    if (!std::filesystem::is_regular_file(path)
+        || std::filesystem::file_size(path) < sizeof(detail::eph_header)) {
+        throw std::invalid_argument(fmt::format("Unable to open the ephemeris file '{}' for reading", path));
+    }
+
+    im.m_fmap = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+    im.m_region = boost::interprocess::mapped_region(im.m_fmap, boost::interprocess::read_only);
+
+    const auto *const base = static_cast<const char *>(im.m_region.get_address());
+    const auto fsize = static_cast<std::uint64_t>(im.m_region.get_size());
+
+    // Check the file header.
+    detail::eph_header hdr{};
+    std::memcpy(&hdr, base, sizeof(hdr));
+    if (std::memcmp(hdr.magic, detail::eph_magic, sizeof(hdr.magic)) != 0 || hdr.version != detail::eph_version) {
+        throw std::invalid_argument(fmt::format("The file '{}' is not a valid ephemeris file", path));
+    }
+
+    // Index the blocks.
+    // NOTE: stop at the first incomplete block.
+    std::uint64_t offset = sizeof(hdr);
+    while (fsize - offset >= sizeof(detail::eph_block_header)) {
+        detail::eph_block_header bhdr{};
+        std::memcpy(&bhdr, base + offset, sizeof(bhdr));
+
+        if (bhdr.size == 0u || bhdr.size > fsize - offset) {
+            break;
+        }
+
+        const auto invalid_block = [&]() {
+            throw std::invalid_argument(
+                fmt::format("An invalid block was detected at the offset {} of the ephemeris file '{}'", offset, path));
+        };
+
+        impl::block b;
+        b.t0 = detail::dfloat(bhdr.t0_hi, bhdr.t0_lo);
+        b.t1 = detail::dfloat(bhdr.t1_hi, bhdr.t1_lo);
+        b.nparts = bhdr.nparts;
+        b.kind = bhdr.kind;
+        b.order = bhdr.order;
+        b.n_segments = bhdr.n_segments;
+
+        // NOTE: all the sections of a block have sizes which are multiples of 8 bytes,
+        // and the mapped region is page-aligned, thus the pointers
+        // below are suitably aligned.
+        const auto *ptr = base + offset + sizeof(bhdr);
+        b.offsets = reinterpret_cast<const std::uint64_t *>(ptr);
+        ptr += (bhdr.nparts + 1u) * 8u;
+        b.ids = reinterpret_cast<const std::uint64_t *>(ptr);
+        ptr += bhdr.nparts * 8u;
+        b.tcoords = reinterpret_cast<const double *>(ptr);
+        ptr += bhdr.n_segments * 16u;
+
+        switch (bhdr.kind) {
+            case detail::eph_taylor:
+                if (bhdr.size != detail::eph_taylor_block_size(bhdr.nparts, bhdr.order, bhdr.n_segments)) {
+                    invalid_block();
+                }
+
+                b.coeffs = reinterpret_cast<const double *>(ptr);
+
+                break;
+            case detail::eph_cheby:
+                // NOTE: check that the block contains the offsets of the
+                // coefficients before reading the number of coefficients.
+                if (detail::eph_cheby_block_size(bhdr.nparts, bhdr.n_segments, 0) > bhdr.size) {
+                    invalid_block();
+                }
+
+                b.c_offsets = reinterpret_cast<const std::uint64_t *>(ptr);
+                ptr += (bhdr.n_segments + 1u) * 8u;
+                b.coeffs = reinterpret_cast<const double *>(ptr);
+
+                if (bhdr.size
+                    != detail::eph_cheby_block_size(bhdr.nparts, bhdr.n_segments, b.c_offsets[bhdr.n_segments])) {
+                    invalid_block();
+                }
+
+                break;
+            default:
+                invalid_block();
+        }
+
+        if (!im.m_blocks.empty() && b.t0 < im.m_blocks.back().t0) {
+            throw std::invalid_argument(fmt::format(
+                "The blocks of the ephemeris file '{}' are not in chronological order", path));
+        }
+
+        im.m_blocks.push_back(b);
+
+        offset += bhdr.size;
+    }
+
+    if (im.m_blocks.empty()) {
+        throw std::invalid_argument(fmt::format("The ephemeris file '{}' does not contain any block", path));
+    }
+}
+
+ephemeris_reader::~ephemeris_reader() = default;
+
+std::uint64_t ephemeris_reader::get_n_blocks() const
+{
+    return static_cast<std::uint64_t>(m_impl->m_blocks.size());
+}
+
+std::pair<double, double> ephemeris_reader::get_time_range() const
+{
+    const auto &blocks = m_impl->m_blocks;
+
+    return {static_cast<double>(blocks.front().t0), static_cast<double>(blocks.back().t1)};
+}
+
+// Fetch the number of particles at the time t.
+sim::size_type ephemeris_reader::get_nparts(double t) const
+{
+    return boost::numeric_cast<sim::size_type>(m_impl->locate(t).nparts);
+}
+
+// Fetch the ids of the particles at the time t.
+std::vector<std::uint64_t> ephemeris_reader::get_ids(double t) const
+{
+    const auto &b = m_impl->locate(t);
+
+    return std::vector<std::uint64_t>(b.ids, b.ids + b.nparts);
+}
+
+// Fetch the index of the particle with the input id at the time t.
+sim::size_type ephemeris_reader::id_to_index(std::uint64_t id, double t) const
+{
+    const auto &im = *m_impl;
+
+    return im.id_to_index(im.locate(t), id, t);
+}
+
+std::array<double, 6> ephemeris_reader::get_state(sim::size_type pidx, double t) const
+{
+    const auto &im = *m_impl;
+
+    std::array<double, 6> retval{};
+    im.eval(im.locate(t), pidx, t, retval.data());
+
+    return retval;
+}
+
+// Compute the state of the particle with the input id at the time t.
+std::array<double, 6> ephemeris_reader::get_state_by_id(std::uint64_t id, double t) const
+{
+    const auto &im = *m_impl;
+    const auto &b = im.locate(t);
+
+    std::array<double, 6> retval{};
+    im.eval(b, im.id_to_index(b, id, t), t, retval.data());
+
+    return retval;
+}
+
+// Compute the state of all the particles at the time t. The result
+// is a row-major 2D array with dimensions (nparts, 6).
+std::vector<double> ephemeris_reader::get_states(double t) const
+{
+    const auto &im = *m_impl;
+    const auto &b = im.locate(t);
+
+    using safe_size_t = boost::safe_numerics::safe<std::vector<double>::size_type>;
+    const auto nparts = boost::numeric_cast<sim::size_type>(b.nparts);
+
+    std::vector<double> retval(static_cast<std::vector<double>::size_type>(safe_size_t(nparts) * 6));
+
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<sim::size_type>(0, nparts), [&](const auto &range) {
+        for (auto pidx = range.begin(); pidx != range.end(); ++pidx) {
+            im.eval(b, pidx, t, retval.data() + pidx * 6u);
+        }
+    });
+
+    return retval;
+}
+
+// Compute the states of the particles at the indices pidxs at
+// the corresponding times ts, writing the result into out
+// as a row-major 2D array with dimensions (pidxs.size(), 6).
+void ephemeris_reader::get_states(std::span<const sim::size_type> pidxs, std::span<const double> ts,
+                                  std::span<double> out) const
+{
+    if (pidxs.size() != ts.size()) {
+        throw std::invalid_argument(
+            fmt::format("The number of particle indices ({}) and the number of times ({}) must be equal in a "
+                        "batched ephemeris query",
+                        pidxs.size(), ts.size()));
+    }
+
+    if (out.size() / 6u != pidxs.size() || out.size() % 6u != 0u) {
+        throw std::invalid_argument(fmt::format(
+            "The size of the output buffer in a batched ephemeris query must be {}, but it is {} instead",
+            static_cast<std::size_t>(boost::safe_numerics::safe<std::size_t>(pidxs.size()) * 6), out.size()));
+    }
+
+    const auto &im = *m_impl;
+
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<std::size_t>(0, pidxs.size()), [&](const auto &range) {
+        for (auto i = range.begin(); i != range.end(); ++i) {
+            im.eval(im.locate(ts[i]), pidxs[i], ts[i], out.data() + i * 6u);
+        }
+    });
+}
+
+} // namespace cascade
@@ -0,0 +1,206 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/core.h>
+
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#if defined(CASCADE_WITH_HDF5)
+
+#include <hdf5.h>
+
+#endif
+
+#include <cascade/io.hpp>
+
+#include "detail/hdf5_utils.hpp"
+
+namespace cascade::io
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Target size (in bytes) of the chunks
+// of a text file parsed in parallel.
+constexpr std::size_t text_chunk_size = 1u << 20;
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Invoke f on all the whitespace-separated tokens in [begin, end).
+template <typename F>
+void for_each_token(const char *begin, const char *end, F &&f)
+{
+    while (true) {
+        begin = std::find_if_not(begin, end, is_space);
+        if (begin == end) {
+            return;
+        }
+
+        const auto *tok_end = std::find_if(begin, end, is_space);
+        f(begin, tok_end);
+        begin = tok_end;
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<double> load_text(const std::string &path)
+{
+    if (!std::filesystem::is_regular_file(path)) {
+        throw std::invalid_argument(fmt::format("Unable to open the text file '{}' for reading", path));
+    }
+
+    // NOTE: empty files cannot be memory-mapped.
+    const auto fsize = std::filesystem::file_size(path);
+    if (fsize == 0u) {
+        return {};
+    }
+
+    const boost::interprocess::file_mapping fmap(path.c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(fmap, boost::interprocess::read_only);
+    region.advise(boost::interprocess::mapped_region::advice_sequential);
+
+    const auto *const fbegin = static_cast<const char *>(region.get_address());
+    const auto size = boost::numeric_cast<std::size_t>(fsize);
+    assert(region.get_size() == size);
+
+    // Split the file into chunks. The chunk boundaries
+    // are moved forward to the next whitespace character,
+    // so that no value is split across two chunks.
+    const auto n_chunks = std::max<std::size_t>(1, size / detail::text_chunk_size);
+    std::vector<const char *> bounds{fbegin};
+    for (std::size_t i = 1; i < n_chunks; ++i) {
+        const auto *nominal = std::max(fbegin + i * (size / n_chunks), bounds.back());
+        bounds.push_back(std::find_if(nominal, fbegin + size, detail::is_space));
+    }
+    bounds.push_back(fbegin + size);
+
+    // Count the values in each chunk.
+    std::vector<std::size_t> offsets(n_chunks + 1u);
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<std::size_t>(0, n_chunks), [&](const auto &range) {
+        for (auto i = range.begin(); i != range.end(); ++i) {
+            std::size_t count = 0;
+            detail::for_each_token(bounds[i], bounds[i + 1u], [&count](const char *, const char *) { ++count; });
+            offsets[i + 1u] = count;
+        }
+    });
+    std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+
+    // Parse the chunks directly into the return value.
+    std::vector<double> retval(offsets.back());
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<std::size_t>(0, n_chunks), [&](const auto &range) {
+        for (auto i = range.begin(); i != range.end(); ++i) {
+            auto *out = retval.data() + offsets[i];
+
+            detail::for_each_token(bounds[i], bounds[i + 1u], [&](const char *tbegin, const char *tend) {
+                // NOTE: from_chars() does not accept a leading plus sign.
+                const auto *pbegin = (*tbegin == '+' && tend - tbegin > 1 && tbegin[1] != '-') ? tbegin + 1 : tbegin;
+
+                const auto [ptr, ec] = std::from_chars(pbegin, tend, *out);
+                if (ec != std::errc{} || ptr != tend) {
+                    // NOTE: compute the line number only in case of error.
+                    const auto line = std::count(fbegin, tbegin, '\n') + 1;
+
+                    throw std::invalid_argument(
+                        fmt::format("Invalid floating-point value '{}' detected at line {} of the text file '{}'",
+                                    std::string_view(tbegin, std::min<std::size_t>(tend - tbegin, 64)), line, path));
+                }
+
+                ++out;
+            });
+
+            assert(out == retval.data() + offsets[i + 1u]);
+        }
+    });
+
+    return retval;
+}
+
+std::vector<double> load_hdf5([[maybe_unused]] const std::string &path, [[maybe_unused]] const std::string &dataset)
+{
+#if defined(CASCADE_WITH_HDF5)
+
+    namespace cd = cascade::detail;
+
+    if (!std::filesystem::is_regular_file(path)) {
+        throw std::invalid_argument(fmt::format("Unable to open the HDF5 file '{}' for reading", path));
+    }
+
+    std::lock_guard lock(cd::hdf5_mutex);
+
+    const cd::h5_id file(H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), &H5Fclose, "file opening");
+
+    if (H5Lexists(file.get(), dataset.c_str(), H5P_DEFAULT) <= 0) {
+        throw std::invalid_argument(
+            fmt::format("The dataset '{}' does not exist in the HDF5 file '{}'", dataset, path));
+    }
+
+    const cd::h5_id ds(H5Dopen2(file.get(), dataset.c_str(), H5P_DEFAULT), &H5Dclose, "dataset opening");
+
+    const cd::h5_id dtype(H5Dget_type(ds.get()), &H5Tclose, "datatype retrieval");
+    if (H5Tget_class(dtype.get()) != H5T_FLOAT) {
+        throw std::invalid_argument(fmt::format(
+            "The dataset '{}' in the HDF5 file '{}' does not contain floating-point values", dataset, path));
+    }
+
+    const cd::h5_id space(H5Dget_space(ds.get()), &H5Sclose, "dataspace retrieval");
+    const auto npoints = H5Sget_simple_extent_npoints(space.get());
+    if (npoints < 0) {
+        // LCOV_EXCL_START
+        throw std::invalid_argument("HDF5 error: dataspace size retrieval");
+        // LCOV_EXCL_STOP
+    }
+
+    // NOTE: the dataset is read with a single call directly into the
+    // return value, letting HDF5 take care of the conversion
+    // to double precision (if needed).
+    std::vector<double> retval(boost::numeric_cast<std::vector<double>::size_type>(npoints));
+    if (!retval.empty()) {
+        cd::h5_check(H5Dread(ds.get(), H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, retval.data()),
+                     "dataset read");
+    }
+
+    return retval;
+
+#else
+
+    // LCOV_EXCL_START
+    throw std::runtime_error("HDF5 loading is not available because cascade was built without HDF5 support");
+    // LCOV_EXCL_STOP
+
+#endif
+}
+
+} // namespace cascade::io
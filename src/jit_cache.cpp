@@ -0,0 +1,545 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+
+#include <fmt/core.h>
+
+#include <heyoka/config.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/s11n.hpp>
+#include <heyoka/taylor.hpp>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Config/llvm-config.h>
+
+#if LLVM_VERSION_MAJOR >= 17
+
+#include <llvm/TargetParser/Host.h>
+
+#else
+
+#include <llvm/Support/Host.h>
+
+#endif
+
+#include <cascade/detail/logging_impl.hpp>
+#include <cascade/detail/sim_data.hpp>
+#include <cascade/jit_cache.hpp>
+
+#include "detail/jit_cache.hpp"
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+namespace hy = heyoka;
+
+// NOTE: this must be bumped whenever the
+// layout of the cache entries changes.
+constexpr unsigned jit_cache_version = 2;
+
+// Extension of the files of the cache entries.
+constexpr auto jit_cache_ext = ".cjc";
+
+// Default maximum size of the cache directory (1 GiB).
+constexpr std::uintmax_t jit_cache_default_max_size = 1ull << 30;
+
+// Default directory of the precompiled entries (see the
+// CASCADE_PRECOMPILE_JIT option in the build system).
+#if defined(CASCADE_JIT_PRECOMPILED_DIR)
+
+constexpr auto jit_cache_default_precompiled_dir = CASCADE_JIT_PRECOMPILED_DIR;
+
+#else
+
+constexpr auto jit_cache_default_precompiled_dir = "";
+
+#endif
+
+struct jit_cache_settings {
+    std::mutex mutex;
+    // NOTE: this is read lazily from the
+    // environment on first access.
+    std::optional<std::string> dir;
+    std::uintmax_t max_size = jit_cache_default_max_size;
+    std::string precompiled_dir = jit_cache_default_precompiled_dir;
+};
+
+jit_cache_settings &get_jit_cache_settings()
+{
+    static jit_cache_settings s;
+
+    return s;
+}
+
+std::string get_jit_cache_dir()
+{
+    auto &s = get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    if (!s.dir) {
+        const auto *env = std::getenv("CASCADE_JIT_CACHE_DIR");
+        s.dir.emplace(env == nullptr ? "" : env);
+    }
+
+    return *s.dir;
+}
+
+std::string get_jit_cache_precompiled_dir()
+{
+    auto &s = get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    return s.precompiled_dir;
+}
+
+std::uintmax_t get_jit_cache_max_size()
+{
+    auto &s = get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    return s.max_size;
+}
+
+// The full list of the features of the host CPU,
+// sorted by name, in the "+feat,-feat" format used by LLVM.
+// NOTE: heyoka compiles for the host CPU, thus
+// any feature may end up in the generated code.
+std::string host_cpu_features()
+{
+#if LLVM_VERSION_MAJOR >= 19
+    const auto fmap = llvm::sys::getHostCPUFeatures();
+#else
+    llvm::StringMap<bool> fmap;
+    llvm::sys::getHostCPUFeatures(fmap);
+#endif
+
+    std::vector<std::string> feats;
+    feats.reserve(fmap.size());
+    for (const auto &f : fmap) {
+        feats.push_back((f.getValue() ? "+" : "-") + f.getKey().str());
+    }
+
+    // NOTE: the iteration order of a StringMap is unspecified.
+    std::ranges::sort(feats, [](const auto &a, const auto &b) { return a.substr(1) < b.substr(1); });
+
+    std::string ret;
+    for (decltype(feats.size()) i = 0; i < feats.size(); ++i) {
+        if (i != 0u) {
+            ret += ',';
+        }
+        ret += feats[i];
+    }
+
+    return ret;
+}
+
+} // namespace
+
+// The part of the keys of the cache entries which depends
+// on the environment (heyoka and LLVM versions, host CPU) rather than
+// on the simulation setup.
+// NOTE: the IR of an empty llvm state contains the target
+// triple and the data layout of the host machine.
+const std::string &jit_cache_env_key()
+{
+    static const std::string ret = []() {
+        const auto &tf = hy::detail::get_target_features();
+
+        return fmt::format("cascade JIT cache v{}\nheyoka {}\nLLVM {}\ncpu={}\nfeatures={}\n"
+                           "avx={} avx2={} avx512f={} aarch64={} vsx={} vsx3={}\n{}\n",
+                           jit_cache_version, HEYOKA_VERSION_STRING, LLVM_VERSION_STRING,
+                           llvm::sys::getHostCPUName().str(), host_cpu_features(), tf.avx, tf.avx2, tf.avx512f,
+                           tf.aarch64, tf.vsx, tf.vsx3, hy::llvm_state{}.get_ir());
+    }();
+
+    return ret;
+}
+
+namespace
+{
+
+// 64-bit FNV-1a hash, used to name the files of the cache entries.
+// NOTE: we need a hash which is stable across platforms and
+// library versions, which is not guaranteed by std::hash.
+std::uint64_t fnv1a(const std::string &s)
+{
+    std::uint64_t ret = 14695981039346656037ull;
+
+    for (const auto c : s) {
+        ret ^= static_cast<unsigned char>(c);
+        ret *= 1099511628211ull;
+    }
+
+    return ret;
+}
+
+fs::path entry_path(const fs::path &dir, const std::string &full_key)
+{
+    return dir / fmt::format("{:016x}{}", fnv1a(full_key), jit_cache_ext);
+}
+
+// List the entries in the cache directory as (last write time, size, path) tuples.
+// NOTE: the entries may be concurrently added and removed by other
+// processes, thus all errors are ignored here.
+std::vector<std::tuple<fs::file_time_type, std::uintmax_t, fs::path>> list_entries(const fs::path &dir)
+{
+    std::vector<std::tuple<fs::file_time_type, std::uintmax_t, fs::path>> retval;
+
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const auto &p = it->path();
+
+        if (p.extension() != jit_cache_ext) {
+            continue;
+        }
+
+        std::error_code ec_sz, ec_time;
+        const auto sz = fs::file_size(p, ec_sz);
+        const auto t = fs::last_write_time(p, ec_time);
+
+        if (!ec_sz && !ec_time) {
+            retval.emplace_back(t, sz, p);
+        }
+    }
+
+    return retval;
+}
+
+// Remove the least-recently used entries from the cache
+// directory until its size does not exceed max_size.
+void evict(const fs::path &dir, std::uintmax_t max_size)
+{
+    auto entries = list_entries(dir);
+
+    std::uintmax_t tot_size = 0;
+    for (const auto &e : entries) {
+        tot_size += std::get<1>(e);
+    }
+
+    if (tot_size <= max_size) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const auto &e1, const auto &e2) { return std::get<0>(e1) < std::get<0>(e2); });
+
+    auto *logger = get_logger();
+
+    for (const auto &[t, sz, p] : entries) {
+        if (tot_size <= max_size) {
+            break;
+        }
+
+        std::error_code ec;
+        if (fs::remove(p, ec)) {
+            logger->trace("JIT cache entry {} evicted", p.string());
+            tot_size -= sz;
+        }
+    }
+}
+
+// The process-wide registry of compiled data.
+// NOTE: the registry holds weak references to the entries, which
+// are owned by the simulations constructed from them.
+struct jit_registry {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<const sim_jit_data>> map;
+};
+
+jit_registry &get_jit_registry()
+{
+    static jit_registry r;
+
+    return r;
+}
+
+// Load the entry corresponding to full_key from the cache directory dir.
+std::shared_ptr<sim_jit_data> jit_cache_load_entry(const fs::path &dir, const std::string &full_key, bool touch)
+{
+    auto *logger = get_logger();
+
+    const auto path = entry_path(dir, full_key);
+
+    std::ifstream ifile(path, std::ios::binary);
+    if (!ifile.is_open()) {
+        logger->trace("JIT cache miss ({})", path.string());
+
+        return {};
+    }
+
+    try {
+        boost::archive::binary_iarchive ia(ifile);
+
+        // NOTE: check the full key in order
+        // to guard against hash collisions.
+        std::string stored_key;
+        ia >> stored_key;
+        if (stored_key != full_key) {
+            logger->trace("JIT cache miss ({}, key mismatch)", path.string());
+
+            return {};
+        }
+
+        auto retval = std::make_shared<sim_jit_data>();
+        ia >> retval->s_ta;
+        ia >> retval->b_ta;
+        ia >> retval->state;
+        ia >> retval->det_state;
+
+        if (touch) {
+            // Mark the entry as recently used.
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        }
+
+        logger->trace("JIT cache hit ({})", path.string());
+
+        return retval;
+    } catch (const std::exception &e) {
+        // NOTE: the entry will be overwritten
+        // after compilation.
+        logger->warn("The JIT cache entry {} could not be loaded and it will be ignored. The error message is: {}",
+                     path.string(), e.what());
+
+        return {};
+    }
+}
+
+} // namespace
+
+std::shared_ptr<const sim_jit_data> jit_registry_lookup(const std::string &key)
+{
+    auto &r = get_jit_registry();
+
+    std::lock_guard lock(r.mutex);
+
+    const auto it = r.map.find(key);
+    if (it == r.map.end()) {
+        return {};
+    }
+
+    auto retval = it->second.lock();
+    if (!retval) {
+        r.map.erase(it);
+    }
+
+    return retval;
+}
+
+std::shared_ptr<const sim_jit_data> jit_registry_insert(const std::string &key,
+                                                        std::shared_ptr<const sim_jit_data> jd)
+{
+    assert(jd);
+
+    auto &r = get_jit_registry();
+
+    std::lock_guard lock(r.mutex);
+
+    // Remove the expired entries.
+    std::erase_if(r.map, [](const auto &p) { return p.second.expired(); });
+
+    auto &wp = r.map[key];
+    if (auto existing = wp.lock()) {
+        return existing;
+    }
+
+    wp = jd;
+
+    return jd;
+}
+
+std::shared_ptr<sim_jit_data> jit_cache_load(const std::string &key)
+{
+    const auto full_key = jit_cache_env_key() + key;
+
+    if (const auto dir = get_jit_cache_dir(); !dir.empty()) {
+        if (auto retval = jit_cache_load_entry(dir, full_key, true)) {
+            return retval;
+        }
+    }
+
+    // NOTE: the precompiled entries are read-only, thus
+    // their last write time is not updated.
+    if (const auto dir = get_jit_cache_precompiled_dir(); !dir.empty()) {
+        return jit_cache_load_entry(dir, full_key, false);
+    }
+
+    return {};
+}
+
+void jit_cache_store(const std::string &key, const sim_jit_data &jd)
+{
+    const auto dir = get_jit_cache_dir();
+    if (dir.empty()) {
+        return;
+    }
+
+    auto *logger = get_logger();
+
+    const auto full_key = jit_cache_env_key() + key;
+    const auto path = entry_path(dir, full_key);
+
+    // NOTE: the entry is written into a temporary file which is then
+    // renamed, so that other processes never see incomplete entries.
+    const auto tmp_path = fs::path(path).concat(fmt::format(".{:08x}.tmp", std::random_device{}()));
+
+    try {
+        fs::create_directories(dir);
+
+        {
+            std::ofstream ofile(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!ofile.is_open()) {
+                throw std::runtime_error(fmt::format("Could not open the file {}", tmp_path.string()));
+            }
+
+            boost::archive::binary_oarchive oa(ofile);
+
+            oa << full_key;
+            oa << jd.s_ta;
+            oa << jd.b_ta;
+            oa << jd.state;
+            oa << jd.det_state;
+        }
+
+        fs::rename(tmp_path, path);
+
+        logger->trace("JIT cache entry {} stored", path.string());
+    } catch (const std::exception &e) {
+        logger->warn("The JIT cache entry {} could not be stored. The error message is: {}", path.string(), e.what());
+
+        std::error_code ec;
+        fs::remove(tmp_path, ec);
+
+        return;
+    }
+
+    evict(dir, get_jit_cache_max_size());
+}
+
+} // namespace detail
+
+namespace jit_cache
+{
+
+void set_dir(const std::string &dir)
+{
+    auto &s = detail::get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    s.dir.emplace(dir);
+}
+
+std::string get_dir()
+{
+    return detail::get_jit_cache_dir();
+}
+
+void set_max_size(std::uintmax_t max_size)
+{
+    auto &s = detail::get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    s.max_size = max_size;
+}
+
+std::uintmax_t get_max_size()
+{
+    return detail::get_jit_cache_max_size();
+}
+
+void set_precompiled_dir(const std::string &dir)
+{
+    auto &s = detail::get_jit_cache_settings();
+
+    std::lock_guard lock(s.mutex);
+
+    s.precompiled_dir = dir;
+}
+
+std::string get_precompiled_dir()
+{
+    return detail::get_jit_cache_precompiled_dir();
+}
+
+std::uintmax_t get_size()
+{
+    const auto dir = get_dir();
+    if (dir.empty()) {
+        return 0;
+    }
+
+    std::uintmax_t retval = 0;
+    for (const auto &e : detail::list_entries(dir)) {
+        retval += std::get<1>(e);
+    }
+
+    return retval;
+}
+
+std::size_t get_registry_size()
+{
+    auto &r = detail::get_jit_registry();
+
+    std::lock_guard lock(r.mutex);
+
+    return static_cast<std::size_t>(
+        std::count_if(r.map.begin(), r.map.end(), [](const auto &p) { return !p.second.expired(); }));
+}
+
+void clear()
+{
+    const auto dir = get_dir();
+    if (dir.empty()) {
+        return;
+    }
+
+    for (const auto &e : detail::list_entries(dir)) {
+        std::error_code ec;
+        std::filesystem::remove(std::get<2>(e), ec);
+    }
+}
+
+} // namespace jit_cache
+
+} // namespace cascade
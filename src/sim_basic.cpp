@@ -6,20 +6,28 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <ostream>
 #include <ranges>
 #include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -42,10 +50,14 @@
 #include <heyoka/taylor.hpp>
 #include <heyoka/variable.hpp>
 
+#include <cascade/checkpointer.hpp>
+#include <cascade/conj_sink.hpp>
 #include <cascade/detail/logging_impl.hpp>
 #include <cascade/detail/sim_data.hpp>
 #include <cascade/sim.hpp>
 
+#include "detail/jit_cache.hpp"
+
 #if defined(__clang__) || defined(__GNUC__)
 
 #pragma GCC diagnostic push
@@ -77,6 +89,38 @@ const std::array<std::string, 6> allowed_vars = {"x", "y", "z", "vx", "vy", "vz"
 // NOLINTNEXTLINE(cert-err58-cpp)
 const std::set<std::string> allowed_vars_alph(allowed_vars.begin(), allowed_vars.end());
 
+// Helper to turn a scalar conjunction threshold into a vector of conjunction
+// tiers (which will be empty if the threshold is zero).
+std::vector<double> conj_thresh_to_tiers(double conj_thresh)
+{
+    if (!std::isfinite(conj_thresh) || conj_thresh < 0) {
+        throw std::invalid_argument(fmt::format(
+            "The conjunction threshold value {} is invalid: it must be finite and non-negative", conj_thresh));
+    }
+
+    if (conj_thresh == 0) {
+        return {};
+    } else {
+        return {conj_thresh};
+    }
+}
+
+// Helper to validate a vector of conjunction tiers.
+void validate_conj_tiers(const std::vector<double> &tiers)
+{
+    for (const auto t : tiers) {
+        if (!std::isfinite(t) || t <= 0) {
+            throw std::invalid_argument(
+                fmt::format("The conjunction tier value {} is invalid: it must be finite and positive", t));
+        }
+    }
+
+    if (std::adjacent_find(tiers.begin(), tiers.end(), std::greater_equal<>{}) != tiers.end()) {
+        throw std::invalid_argument(fmt::format(
+            "The conjunction tiers must be sorted in strictly ascending order, but the tiers {} were provided", tiers));
+    }
+}
+
 } // namespace
 
 } // namespace detail
@@ -111,20 +155,29 @@ sim::sim(ptag_t, std::vector<double> state, double ct)
 }
 
 sim::sim(const sim &other)
-    : m_state(std::make_shared<std::vector<double>>(*other.m_state)),
-      m_pars(std::make_shared<std::vector<double>>(*other.m_pars)), m_ct(other.m_ct), m_n_par_ct(other.m_n_par_ct),
-      m_int_info(other.m_int_info), m_reentry_radius(other.m_reentry_radius), m_exit_radius(other.m_exit_radius),
-      m_npars(other.m_npars), m_conj_thresh(other.m_conj_thresh),
+    // NOTE: copying m_async first waits for the completion
+    // of the asynchronous operation (if any) running on other.
+    : m_async(other.m_async), m_state(std::make_shared<std::vector<double>>(*other.m_state)),
+      m_pars(std::make_shared<std::vector<double>>(*other.m_pars)), m_ids(other.m_ids), m_next_id(other.m_next_id),
+      m_ct(other.m_ct), m_n_par_ct(other.m_n_par_ct),
+      m_int_info(other.m_int_info), m_int_ids(other.m_int_ids), m_reentry_radius(other.m_reentry_radius), m_exit_radius(other.m_exit_radius),
+      m_npars(other.m_npars), m_conj_thresh(other.m_conj_thresh), m_conj_tiers(other.m_conj_tiers),
+      m_conj_tier_counts(other.m_conj_tier_counts),
       m_det_conj(std::make_shared<std::vector<conjunction>>(*other.m_det_conj)),
-      m_min_coll_radius(other.m_min_coll_radius), m_coll_whitelist(other.m_coll_whitelist),
-      m_conj_whitelist(other.m_conj_whitelist)
+      m_min_coll_radius(other.m_min_coll_radius), m_conj_aggr(other.m_conj_aggr),
+      m_conj_aggr_window(other.m_conj_aggr_window), m_coll_whitelist(other.m_coll_whitelist),
+      m_conj_whitelist(other.m_conj_whitelist), m_svol(other.m_svol), m_det_order(other.m_det_order)
 {
+    // NOTE: the conjunction sink, the snapshot writer, the checkpointer and
+    // the ephemeris writer are deliberately not copied: sharing them among several
+    // simulations would interleave their conjunctions, snapshots, checkpoints and ephemerides.
+
     // For m_data, we will be copying only:
-    // - the integrator templates,
-    // - the llvm state,
-    // - the time coordinate.
-    // Below, we will also be assigning the function pointers
-    // for the jitted functions. The rest of sim_data's members are set up
+    // - the pointer to the compiled data, which
+    //   is immutable and thus shared with other,
+    // - the time coordinate,
+    // - the pending aggregated conjunctions.
+    // The rest of sim_data's members are set up
     // explicitly at the beginning of each timestep.
 
 #if defined(__clang__)
@@ -133,26 +186,16 @@ sim::sim(const sim &other)
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
 
     auto new_data = std::make_unique<sim_data>(
-        sim_data{other.m_data->s_ta, other.m_data->b_ta, other.m_data->state, other.m_data->time});
+        sim_data{other.m_data->jit, other.m_data->time, other.m_data->conj_aggr_windows});
 
 #pragma GCC diagnostic pop
 
 #else
 
-    auto new_data
-        = std::make_unique<sim_data>(other.m_data->s_ta, other.m_data->b_ta, other.m_data->state, other.m_data->time);
+    auto new_data = std::make_unique<sim_data>(other.m_data->jit, other.m_data->time, other.m_data->conj_aggr_windows);
 
 #endif
 
-    // Need to assign the JIT function pointers.
-    new_data->pta_cfunc = reinterpret_cast<decltype(new_data->pta_cfunc)>(new_data->state.jit_lookup("pta_cfunc"));
-    new_data->pssdiff3_cfunc
-        = reinterpret_cast<decltype(new_data->pssdiff3_cfunc)>(new_data->state.jit_lookup("ssdiff3_cfunc"));
-    new_data->fex_check = reinterpret_cast<decltype(new_data->fex_check)>(new_data->state.jit_lookup("fex_check"));
-    new_data->rtscc = reinterpret_cast<decltype(new_data->rtscc)>(new_data->state.jit_lookup("poly_rtscc"));
-    // NOTE: this is implicitly added by llvm_add_poly_rtscc().
-    new_data->pt1 = reinterpret_cast<decltype(new_data->pt1)>(new_data->state.jit_lookup("poly_translate_1"));
-
     // Assign the new pointer.
     m_data = std::move(new_data);
 }
@@ -170,7 +213,12 @@ sim &sim::operator=(const sim &other)
 
 sim &sim::operator=(sim &&) noexcept = default;
 
-sim::~sim() = default;
+sim::~sim()
+{
+    // NOTE: wait for the completion of the asynchronous operation
+    // (if any) before destroying the data members it operates on.
+    m_async.wait();
+}
 
 double sim::get_ct() const
 {
@@ -203,12 +251,24 @@ void sim::set_n_par_ct(std::uint32_t n_par_ct)
 
 void sim::set_conj_thresh(double conj_thresh)
 {
-    if (!std::isfinite(conj_thresh) || conj_thresh < 0) {
-        throw std::invalid_argument(fmt::format(
-            "The conjunction threshold value {} is invalid: it must be finite and non-negative", conj_thresh));
-    }
+    set_conj_tiers(detail::conj_thresh_to_tiers(conj_thresh));
+}
+
+// NOTE: changing the conjunction tiers resets the per-tier counters.
+void sim::set_conj_tiers(std::vector<double> tiers)
+{
+    detail::validate_conj_tiers(tiers);
+
+    std::vector<size_type> new_counts(tiers.size());
 
-    m_conj_thresh = conj_thresh;
+    // Flush the pending aggregated conjunctions, as
+    // their tier indices refer to the current tiers.
+    flush_conjunctions();
+
+    // NOTE: noexcept from here.
+    m_conj_thresh = tiers.empty() ? 0. : tiers.back();
+    m_conj_tiers = std::move(tiers);
+    m_conj_tier_counts = std::move(new_counts);
 }
 
 std::uint32_t sim::get_npars() const
@@ -218,9 +278,9 @@ std::uint32_t sim::get_npars() const
 
 double sim::get_tol() const
 {
-    assert(m_data->s_ta.get_tol() == m_data->b_ta.get_tol());
+    assert(m_data->jit->s_ta.get_tol() == m_data->jit->b_ta.get_tol());
 
-    return m_data->s_ta.get_tol();
+    return m_data->jit->s_ta.get_tol();
 }
 
 std::variant<double, std::vector<double>> sim::get_reentry_radius() const
@@ -230,43 +290,38 @@ std::variant<double, std::vector<double>> sim::get_reentry_radius() const
 
 bool sim::get_high_accuracy() const
 {
-    assert(m_data->s_ta.get_high_accuracy() == m_data->b_ta.get_high_accuracy());
+    assert(m_data->jit->s_ta.get_high_accuracy() == m_data->jit->b_ta.get_high_accuracy());
 
-    return m_data->s_ta.get_high_accuracy();
+    return m_data->jit->s_ta.get_high_accuracy();
 }
 
-// A helper that validates (and possibly modifies in-place) the input
-// array of parameters pars. The validation checks that pars is consistent
-// both with m_npars (the number of parameters in the dynamics) and with
-// the number of particles in the simulation nparts. Note that nparts
-// is passed explicitly to this function (rather than being established via
-// get_nparts()) because this function is also used in set_new_state_pars(),
-// where nparts is given by the new state vector.
-void sim::validate_pars_vector(std::vector<double> &pars, size_type nparts) const
+// A helper that validates the input array of parameters pars. The validation
+// checks that pars is consistent both with m_npars (the number of parameters in
+// the dynamics) and with the number of rows nparts. Note that nparts is passed explicitly
+// to this function (rather than being established via get_nparts()) because this
+// function is also used in set_new_state_pars() and in the functions adding/updating
+// particles, where nparts is given by the input state vector. An empty
+// pars is always accepted (it signals zero-initialisation or no modification,
+// depending on the caller).
+void sim::validate_pars_vector(std::span<const double> pars, size_type nparts) const
 {
-    using safe_size_t = boost::safe_numerics::safe<std::vector<double>::size_type>;
+    if (pars.empty()) {
+        return;
+    }
 
     if (m_npars == 0u) {
         // If there are no params in the dynamics, then the array of
         // param values must be empty.
-        if (!pars.empty()) {
-            throw std::invalid_argument(
-                "The input array of parameter values must be empty when the number of parameters "
-                "in the dynamics is zero");
-        }
-    } else {
-        if (pars.empty()) {
-            // There are parameters in the dynamics but the user did not
-            // provide an array of param values (or an empty one as provided).
-            // In such a case, zero-init the array of param values with the correct size.
-            pars.resize(safe_size_t(nparts) * m_npars);
-        } else if (pars.size() % m_npars != 0u || pars.size() / m_npars != nparts) {
-            // There are parameters in the dynamics and the user provided
-            // an array of param values, but the shape is wrong.
-            throw std::invalid_argument(fmt::format("The input array of parameter values must have shape ({}, {}), "
-                                                    "but instead its flattened size is {}",
-                                                    nparts, m_npars, pars.size()));
-        }
+        throw std::invalid_argument("The input array of parameter values must be empty when the number of parameters "
+                                    "in the dynamics is zero");
+    }
+
+    if (pars.size() % m_npars != 0u || pars.size() / m_npars != nparts) {
+        // There are parameters in the dynamics and the user provided
+        // an array of param values, but the shape is wrong.
+        throw std::invalid_argument(fmt::format("The input array of parameter values must have shape ({}, {}), "
+                                                "but instead its flattened size is {}",
+                                                nparts, m_npars, pars.size()));
     }
 }
 
@@ -278,75 +333,587 @@ void sim::remove_particles(std::vector<size_type> idxs)
     // Remove consecutive (adjacent) duplicates.
     idxs.erase(std::unique(idxs.begin(), idxs.end()), idxs.end());
 
-    // Create the new state/pars filtering out
-    // the particles in idxs.
-    std::vector<double> new_state, new_pars;
-    auto idxs_it = idxs.cbegin();
-    const auto idxs_end = idxs.cend();
-
     const auto nparts = get_nparts();
     const auto npars = get_npars();
 
-    for (size_type i = 0; i < nparts; ++i) {
-        if (idxs_it != idxs_end && *idxs_it == i) {
-            ++idxs_it;
-            continue;
+    if (!idxs.empty() && idxs.back() >= nparts) {
+        throw std::invalid_argument(
+            fmt::format("An invalid vector of indices was passed to the function for particle removal: {}", idxs));
+    }
+
+    if (idxs.empty()) {
+        return;
+    }
+
+    const auto new_nparts = nparts - idxs.size();
+
+    // Helpers to check if a particle is being removed and
+    // to compute the index of a surviving particle after the removal.
+    const auto is_removed = [&idxs](size_type idx) { return std::binary_search(idxs.begin(), idxs.end(), idx); };
+    const auto new_idx = [&idxs](size_type idx) {
+        return idx - static_cast<size_type>(std::lower_bound(idxs.begin(), idxs.end(), idx) - idxs.begin());
+    };
+
+    // The pending aggregated conjunctions are keyed by the particle indices. If any of
+    // them involves a removed particle, we flush all of them, so that they are recorded
+    // with the indices they were detected with. Otherwise, they are re-keyed below.
+    auto pending_removed = false;
+    for (const auto &[_, wmap] : m_data->conj_aggr_windows) {
+        for (const auto &[__, c] : wmap) {
+            pending_removed = pending_removed || (c.n_min > 0u && (is_removed(c.i) || is_removed(c.j)));
         }
+    }
+    if (pending_removed) {
+        flush_conjunctions();
+    }
+
+    // Re-key the pending aggregated conjunctions.
+    // NOTE: the renumbering is monotonic, thus the
+    // ordering of the indices in the keys is preserved.
+    decltype(m_data->conj_aggr_windows) new_windows;
+    for (const auto &[w, wmap] : m_data->conj_aggr_windows) {
+        auto &new_wmap = new_windows[w];
+
+        for (const auto &[key, c] : wmap) {
+            const auto [ki, kj, tier] = key;
+
+            // NOTE: entries involving removed particles
+            // can be left here only if they contain no minimum.
+            if (is_removed(ki) || is_removed(kj)) {
+                assert(c.n_min == 0u);
+                continue;
+            }
+
+            auto new_c = c;
+            if (c.n_min > 0u) {
+                new_c.i = new_idx(c.i);
+                new_c.j = new_idx(c.j);
+            }
+
+            new_wmap.insert({{new_idx(ki), new_idx(kj), tier}, new_c});
+        }
+    }
+
+    // Renumber the whitelists.
+    const auto remap_wl = [&](const whitelist_t &wl) {
+        whitelist_t ret;
 
-        for (auto j = 0u; j < 7u; ++j) {
-            new_state.push_back((*m_state)[i * 7u + j]);
+        for (const auto idx : wl) {
+            if (!is_removed(idx)) {
+                ret.insert(new_idx(idx));
+            }
         }
 
-        for (std::uint32_t j = 0; j < npars; ++j) {
-            new_pars.push_back((*m_pars)[i * npars + j]);
+        return ret;
+    };
+    auto new_coll_wl = remap_wl(m_coll_whitelist);
+    auto new_conj_wl = remap_wl(m_conj_whitelist);
+
+    // The rows to be kept are organised in runs: the i-th run begins right after the
+    // (i-1)-th removed particle (or at the beginning) and it ends at the i-th removed
+    // particle (or at the end). After the removal, the i-th run is shifted back by i rows.
+    const auto nruns = idxs.size() + 1u;
+    const auto run_begin = [&idxs](size_type i) { return i == 0u ? size_type(0) : idxs[i - 1u] + 1u; };
+    const auto run_end = [&idxs, nparts](size_type i) { return i == idxs.size() ? nparts : idxs[i]; };
+
+    // NOTE: if the state/pars vectors are shared with external views, the views
+    // must keep on referring to the original data. In such a case, the runs are gathered
+    // in parallel into new vectors. Otherwise, the vectors are compacted in-place.
+    const auto gather = [&](const std::vector<double> &v, std::uint32_t ncols) {
+        auto ret = std::make_shared<std::vector<double>>(new_nparts * ncols);
+
+        oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<size_type>(0, nruns), [&](const auto &range) {
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                std::copy(v.data() + run_begin(i) * ncols, v.data() + run_end(i) * ncols,
+                          ret->data() + (run_begin(i) - i) * ncols);
+            }
+        });
+
+        return ret;
+    };
+    const auto compact = [&](auto &v, std::uint32_t ncols) noexcept {
+        // NOTE: the destination of a run overlaps the source of the previous
+        // runs, hence the runs must be moved sequentially.
+        for (size_type i = 1; i < nruns; ++i) {
+            std::copy(v.data() + run_begin(i) * ncols, v.data() + run_end(i) * ncols,
+                      v.data() + (run_begin(i) - i) * ncols);
         }
+
+        v.resize(new_nparts * ncols);
+    };
+
+    auto new_st_ptr = m_state.use_count() == 1 ? nullptr : gather(*m_state, 7);
+    auto new_pars_ptr = m_pars.use_count() == 1 ? nullptr : gather(*m_pars, npars);
+
+    // NOTE: noexcept from here.
+    // NOTE: the ids of the surviving particles are preserved.
+    compact(m_ids, 1);
+    if (new_st_ptr) {
+        m_state = std::move(new_st_ptr);
+    } else {
+        compact(*m_state, 7);
+    }
+    if (new_pars_ptr) {
+        m_pars = std::move(new_pars_ptr);
+    } else {
+        compact(*m_pars, npars);
     }
 
-    if (idxs_it != idxs_end) {
-        throw std::invalid_argument(
-            fmt::format("An invalid vector of indices was passed to the function for particle removal: {}", idxs));
+    m_data->conj_aggr_windows = std::move(new_windows);
+    m_coll_whitelist = std::move(new_coll_wl);
+    m_conj_whitelist = std::move(new_conj_wl);
+
+    assert(get_nparts() == new_nparts);
+    assert(m_pars->size() == new_nparts * npars);
+    assert(m_ids.size() == new_nparts);
+
+    // Notify the checkpointer, if any.
+    if (m_ckpt) {
+        m_ckpt->particles_removed(nparts, idxs);
     }
+}
 
-    // NOTE: the new state/pars do not need additional validation.
-#if !defined(NDEBUG)
+// Append to the simulation the particles with state vectors
+// state and parameter values pars. If pars is empty, the
+// parameter values of the new particles are zero-initialised.
+// The new particles are assigned consecutive ids.
+void sim::add_particles(std::span<const double> state, std::span<const double> pars)
+{
+    using safe_size_t = boost::safe_numerics::safe<std::vector<double>::size_type>;
 
-    assert(new_state.size() % 7u == 0u);
-    const auto new_nparts = new_state.size() / 7u;
+    const auto nparts = get_nparts();
+    const auto npars = get_npars();
 
-    if (npars == 0u) {
-        assert(new_pars.empty());
-    } else {
-        assert(new_pars.size() % npars == 0u);
-        assert(new_pars.size() / npars == new_nparts);
+    // Verify only the new rows.
+    // NOTE: in the error messages, the new particles are
+    // identified by the indices they would be assigned.
+    verify_state_vector(state, nparts);
+    const auto n_new = state.size() / 7u;
+    validate_pars_vector(pars, n_new);
+
+    if (n_new == 0u) {
+        return;
     }
 
-#endif
+    const auto new_nparts = safe_size_t(nparts) + n_new;
+
+    // NOTE: as in remove_particles(), the vectors are
+    // copied if they are shared with external views.
+    const auto prepare = [new_nparts](const std::shared_ptr<std::vector<double>> &vptr, std::uint32_t ncols) {
+        const auto new_size = static_cast<std::vector<double>::size_type>(new_nparts * ncols);
+
+        if (vptr.use_count() == 1) {
+            vptr->reserve(new_size);
+
+            return vptr;
+        }
+
+        auto ret = std::make_shared<std::vector<double>>();
+        ret->reserve(new_size);
+        ret->insert(ret->end(), vptr->begin(), vptr->end());
+
+        return ret;
+    };
+
+    auto new_st_ptr = prepare(m_state, 7);
+    auto new_pars_ptr = prepare(m_pars, npars);
+
+    // Assign the ids of the new particles.
+    // NOTE: m_ids is restored if an exception is thrown.
+    std::uint64_t new_next_id{};
+    try {
+        new_next_id = append_new_ids(m_ids, n_new);
+    } catch (...) {
+        m_ids.resize(nparts);
+        throw;
+    }
+
+    // NOTE: noexcept from here, as the vectors have
+    // enough capacity to receive the new rows.
+    m_next_id = new_next_id;
+    new_st_ptr->insert(new_st_ptr->end(), state.begin(), state.end());
+    if (pars.empty()) {
+        new_pars_ptr->resize(new_pars_ptr->size() + n_new * npars);
+    } else {
+        new_pars_ptr->insert(new_pars_ptr->end(), pars.begin(), pars.end());
+    }
 
-    // Create and assign the new vectors.
-    auto new_st_ptr = std::make_shared<std::vector<double>>(std::move(new_state));
-    auto new_pars_ptr = std::make_shared<std::vector<double>>(std::move(new_pars));
-    // NOTE: noexcept from here.
     m_state = std::move(new_st_ptr);
     m_pars = std::move(new_pars_ptr);
+
+    // NOTE: the conjunction sink does not need to be notified, as the new
+    // particles are appended at the end. The checkpointer instead will
+    // store the full state and pars vectors in the next record.
+    if (m_ckpt) {
+        m_ckpt->particles_replaced();
+    }
+}
+
+// Overwrite the state vectors (and, if pars is not empty, the parameter
+// values) of the particles at the indices idxs. If an index appears
+// multiple times, the last occurrence prevails.
+// NOTE: the update is performed in-place, thus it is visible
+// from the external views of the state and pars vectors (as the
+// updates performed by the propagation functions).
+void sim::update_particles(std::span<const size_type> idxs, std::span<const double> state,
+                           std::span<const double> pars)
+{
+    const auto nparts = get_nparts();
+    const auto npars = get_npars();
+
+    if (state.size() / 7u != idxs.size() || state.size() % 7u != 0u) {
+        throw std::invalid_argument(fmt::format("The input state vector must have shape ({}, 7), but instead its "
+                                                "flattened size is {}",
+                                                idxs.size(), state.size()));
+    }
+
+    for (const auto idx : idxs) {
+        if (idx >= nparts) {
+            throw std::invalid_argument(fmt::format(
+                "Cannot update the particle at index {} in a simulation with {} particle(s)", idx, nparts));
+        }
+    }
+
+    // Verify only the updated rows.
+    verify_state_vector(state, 0, idxs);
+    validate_pars_vector(pars, idxs.size());
+
+    // NOTE: noexcept from here.
+    for (decltype(idxs.size()) k = 0; k < idxs.size(); ++k) {
+        std::copy(state.data() + k * 7u, state.data() + (k + 1u) * 7u, m_state->data() + idxs[k] * 7u);
+
+        if (!pars.empty()) {
+            std::copy(pars.data() + k * npars, pars.data() + (k + 1u) * npars, m_pars->data() + idxs[k] * npars);
+        }
+    }
+}
+
+// Append to ids n new consecutive ids, starting from m_next_id.
+// The return value is the id following the last appended one.
+std::uint64_t sim::append_new_ids(std::vector<std::uint64_t> &ids, size_type n) const
+{
+    if (n > std::numeric_limits<std::uint64_t>::max() - m_next_id) {
+        throw std::overflow_error("Overflow detected in the assignment of the particle ids");
+    }
+
+    const auto orig_size = ids.size();
+    ids.resize(orig_size + n);
+    std::iota(ids.begin() + static_cast<std::ptrdiff_t>(orig_size), ids.end(), m_next_id);
+
+    return m_next_id + n;
+}
+
+// Fetch the index of the particle with the input id.
+sim::size_type sim::id_to_index(std::uint64_t id) const
+{
+    const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+
+    if (it == m_ids.end() || *it != id) {
+        throw std::out_of_range(fmt::format("No particle with id {} exists in the simulation", id));
+    }
+
+    return static_cast<size_type>(it - m_ids.begin());
+}
+
+// Set up m_int_ids from m_int_info.
+// NOTE: this must be invoked whenever m_int_info is set up, while
+// the particle indices in m_int_info refer to the current set of particles.
+void sim::update_int_ids() noexcept
+{
+    if (!m_int_info) {
+        m_int_ids.reset();
+
+        return;
+    }
+
+    const auto get_id = [this](size_type idx) {
+        assert(idx < m_ids.size());
+
+        return m_ids[idx];
+    };
+
+    std::visit(
+        [&](const auto &v) {
+            using type = std::remove_cvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, std::array<size_type, 2>>) {
+                m_int_ids.emplace(std::array{get_id(v[0]), get_id(v[1])});
+            } else if constexpr (std::is_same_v<type, size_type>) {
+                m_int_ids.emplace(get_id(v));
+            } else {
+                m_int_ids.emplace(std::tuple{get_id(std::get<0>(v)), std::get<1>(v)});
+            }
+        },
+        *m_int_info);
 }
 
 void sim::set_new_state_pars(std::vector<double> new_state, std::vector<double> new_pars)
 {
+    using safe_size_t = boost::safe_numerics::safe<std::vector<double>::size_type>;
+
     // Verify the new state.
     verify_state_vector(new_state);
 
     // Fetch the new number of particles.
     const auto new_nparts = new_state.size() / 7u;
 
-    // Validate/prepare the new parameters vector.
+    // Validate the new parameters vector.
     validate_pars_vector(new_pars, new_nparts);
 
+    // If there are parameters in the dynamics but the user did not
+    // provide an array of param values, zero-init the array of param
+    // values with the correct size.
+    if (m_npars > 0u && new_pars.empty()) {
+        new_pars.resize(safe_size_t(new_nparts) * m_npars);
+    }
+
+    // Assign new ids to all the particles.
+    std::vector<std::uint64_t> new_ids;
+    const auto new_next_id = append_new_ids(new_ids, new_nparts);
+
     // Create and assign the new vectors.
     auto new_st_ptr = std::make_shared<std::vector<double>>(std::move(new_state));
     auto new_pars_ptr = std::make_shared<std::vector<double>>(std::move(new_pars));
     // NOTE: noexcept from here.
     m_state = std::move(new_st_ptr);
     m_pars = std::move(new_pars_ptr);
+    m_ids = std::move(new_ids);
+    m_next_id = new_next_id;
+
+    if (m_ckpt) {
+        m_ckpt->particles_replaced();
+    }
+}
+
+// Setup the compiled data of a simulation, looking it up first in the in-memory
+// registry and then in the JIT cache. dyn is the full dynamics (including
+// the equation for r), verify is run concurrently with the cache lookup.
+std::shared_ptr<const detail::sim_jit_data>
+detail::make_sim_jit_data(std::vector<std::pair<heyoka::expression, heyoka::expression>> dyn,
+                          const std::variant<double, std::vector<double>> &reentry_radius, double exit_radius,
+                          double tol, bool ha, const std::optional<screening_volume> &svol, std::uint32_t det_order,
+                          const std::function<void()> &verify)
+{
+    namespace hy = heyoka;
+    using safe_size_t = boost::safe_numerics::safe<std::vector<double>::size_type>;
+
+    auto *logger = get_logger();
+
+    const auto sym_vars = hy::make_vars("x", "y", "z");
+    const auto &x = sym_vars[0];
+    const auto &y = sym_vars[1];
+    const auto &z = sym_vars[2];
+
+    // NOTE: the radii were already validated.
+    const auto with_exit_event = exit_radius > 0;
+    const auto *reentry_dbl_ptr = std::get_if<double>(&reentry_radius);
+    const auto with_reentry_event = reentry_dbl_ptr == nullptr || *reentry_dbl_ptr > 0;
+
+    // Helpers to create the exit/reentry event equations.
+    auto make_exit_eq = [&]() {
+        assert(exit_radius > 0);
+
+        return hy::sum_sq({x, y, z}) - exit_radius * exit_radius;
+    };
+
+    auto make_reentry_eq = [&]() {
+        if (auto *dbl_ptr = std::get_if<double>(&reentry_radius)) {
+            assert(*dbl_ptr > 0);
+
+            return hy::sum_sq({x, y, z}) - *dbl_ptr * *dbl_ptr;
+        } else {
+            const auto &ax_vec = std::get<std::vector<double>>(reentry_radius);
+
+            assert(ax_vec.size() == 3u);
+
+            const auto ax_a = ax_vec[0];
+            const auto ax_b = ax_vec[1];
+            const auto ax_c = ax_vec[2];
+
+            return hy::sum_sq({ax_b * ax_c * x, ax_a * ax_c * y, ax_a * ax_b * z})
+                   - ax_a * ax_a * ax_b * ax_b * ax_c * ax_c;
+        }
+    };
+
+    const std::uint32_t batch_size = hy::recommended_simd_size<double>();
+
+    // Build the key of the integrators and of the JIT-compiled functions
+    // in the JIT cache. The key must account for all the data
+    // the compiled code depends on.
+    // NOTE: the environment-dependent part of the key (heyoka version,
+    // CPU features, etc.) is added by the cache itself.
+    auto cache_key = fmt::format("tol: {:a}\nha: {}\nbatch size: {}\ndet order: {}\n", tol, ha, batch_size, det_order);
+    for (const auto &[lhs, rhs] : dyn) {
+        cache_key += fmt::format("{}' = {}\n", lhs, rhs);
+    }
+    if (with_exit_event) {
+        cache_key += fmt::format("exit event: {}\n", make_exit_eq());
+    }
+    if (with_reentry_event) {
+        cache_key += fmt::format("reentry event: {}\n", make_reentry_eq());
+    }
+    if (svol) {
+        for (const auto &pred : svol->get_predicates()) {
+            cache_key += fmt::format("screening volume: {}\n", pred);
+        }
+    }
+
+    // Machinery to construct the integrators.
+    std::optional<hy::taylor_adaptive<double>> s_ta;
+    std::optional<hy::taylor_adaptive_batch<double>> b_ta;
+
+    auto s_ta_setup = [&]() {
+        using ev_t = hy::taylor_adaptive<double>::t_event_t;
+        std::vector<ev_t> t_events;
+
+        if (with_exit_event) {
+            t_events.emplace_back(make_exit_eq(),
+                                  // NOTE: direction is positive in order to detect only domain exit (not entrance).
+                                  hy::kw::direction = hy::event_direction::positive);
+        }
+
+        if (with_reentry_event) {
+            t_events.emplace_back(make_reentry_eq(),
+                                  // NOTE: direction is negative in order to detect only crashing into.
+                                  hy::kw::direction = hy::event_direction::negative);
+        }
+
+        s_ta.emplace(dyn, std::vector<double>(7u), hy::kw::t_events = std::move(t_events), hy::kw::tol = tol,
+                     hy::kw::high_accuracy = ha);
+    };
+
+    auto b_ta_setup = [&]() {
+        using ev_t = hy::taylor_adaptive_batch<double>::t_event_t;
+        std::vector<ev_t> t_events;
+
+        if (with_exit_event) {
+            t_events.emplace_back(make_exit_eq(),
+                                  // NOTE: direction is positive in order to detect only domain exit (not entrance).
+                                  hy::kw::direction = hy::event_direction::positive);
+        }
+
+        if (with_reentry_event) {
+            t_events.emplace_back(make_reentry_eq(),
+                                  // NOTE: direction is negative in order to detect only crashing into.
+                                  hy::kw::direction = hy::event_direction::negative);
+        }
+
+        const std::vector<double>::size_type state_size = safe_size_t(7) * batch_size;
+        b_ta.emplace(dyn, std::vector<double>(state_size), batch_size, hy::kw::t_events = std::move(t_events),
+                     hy::kw::tol = tol, hy::kw::high_accuracy = ha);
+    };
+
+    // The llvm states holding the narrow-phase kernels.
+    std::optional<hy::llvm_state> kstate, det_kstate;
+
+    // NOTE: the narrow-phase kernels depend only on the order of the integrators,
+    // which is predicted from the tolerance so that the kernels can be compiled
+    // concurrently with the integrators. A prediction of zero means that the order
+    // could not be predicted, in which case the kernels are compiled after the
+    // construction of the integrators.
+    const auto pred_order = taylor_order_from_tol(tol);
+
+    auto kernels_setup = [&](std::uint32_t order) {
+        kstate.emplace();
+        det_kstate.emplace();
+        add_jit_functions(*kstate, *det_kstate, order, svol, det_order);
+    };
+
+    // Breakdown of the construction time.
+    using dur_t = std::chrono::duration<double>;
+    dur_t t_lookup{}, t_verify{}, t_s_ta{}, t_b_ta{}, t_kernels{}, t_store{};
+
+    // Helper to run f, accumulating its runtime into t.
+    auto timed = [](dur_t &t, const auto &f) {
+        spdlog::stopwatch sw_f;
+        f();
+        t += sw_f.elapsed();
+    };
+
+    auto verify_state = [&]() { timed(t_verify, verify); };
+
+    spdlog::stopwatch sw;
+
+    // Look up the compiled data in the in-memory
+    // registry first, and then in the JIT cache.
+    std::shared_ptr<const sim_jit_data> jit;
+    timed(t_lookup, [&]() { jit = jit_registry_lookup(cache_key); });
+
+    if (jit) {
+        verify_state();
+    } else {
+        std::shared_ptr<sim_jit_data> new_jit;
+
+        // Concurrently:
+        // - load the compiled data from the JIT cache,
+        // - check the state vector.
+        oneapi::tbb::parallel_invoke(
+            [&]() { timed(t_lookup, [&]() { new_jit = jit_cache_load(cache_key); }); }, verify_state);
+
+        if (!new_jit) {
+            // Concurrently:
+            // - setup the heyoka integrators,
+            // - compile the narrow-phase kernels.
+            oneapi::tbb::parallel_invoke([&]() { timed(t_s_ta, s_ta_setup); }, [&]() { timed(t_b_ta, b_ta_setup); },
+                                         [&]() {
+                                             if (pred_order != 0u) {
+                                                 timed(t_kernels, [&]() { kernels_setup(pred_order); });
+                                             }
+                                         });
+
+            assert(s_ta);
+            assert(b_ta);
+
+            if (pred_order != s_ta->get_order()) {
+                // NOTE: the prediction of the order was not available
+                // or it was wrong, compile the kernels again.
+                logger->debug("The predicted integrator order {} does not match the actual order {}", pred_order,
+                              s_ta->get_order());
+
+                timed(t_kernels, [&]() { kernels_setup(s_ta->get_order()); });
+            }
+
+            assert(kstate);
+            assert(det_kstate);
+
+#if defined(__clang__)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+            new_jit = std::make_shared<sim_jit_data>(
+                sim_jit_data{std::move(*s_ta), std::move(*b_ta), std::move(*kstate), std::move(*det_kstate)});
+
+#pragma GCC diagnostic pop
+
+#else
+
+            new_jit = std::make_shared<sim_jit_data>(std::move(*s_ta), std::move(*b_ta), std::move(*kstate),
+                                                             std::move(*det_kstate));
+
+#endif
+
+            timed(t_store, [&]() { jit_cache_store(cache_key, *new_jit); });
+        }
+
+        // NOTE: the llvm state was either compiled above or restored
+        // from its object code, we just need to look up the compiled functions.
+        new_jit->lookup_jit_functions(svol.has_value(), use_det_order(det_order, new_jit->s_ta.get_order()));
+
+        // NOTE: the dynamics is not stored in the JIT cache, set it here.
+        new_jit->dyn = std::move(dyn);
+
+        jit = jit_registry_insert(cache_key, std::move(new_jit));
+    }
+
+    // NOTE: the components run concurrently, thus their
+    // times do not add up to the total setup time.
+    logger->trace("JIT setup time: {}s (cache lookup: {}s, state verification: {}s, scalar integrator: {}s, "
+                  "batch integrator: {}s, narrow-phase kernels: {}s, cache store: {}s)",
+                  sw, t_lookup.count(), t_verify.count(), t_s_ta.count(), t_b_ta.count(), t_kernels.count(),
+                  t_store.count());
+
+    return jit;
 }
 
 void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expression>> dyn, std::vector<double> pars,
@@ -354,8 +921,10 @@ void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expres
                         std::variant<double, std::vector<double>> reentry_radius, double exit_radius, double tol,
                         bool ha,
                         // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-                        std::uint32_t n_par_ct, double conj_thresh, double min_coll_radius, whitelist_t coll_whitelist,
-                        whitelist_t conj_whitelist)
+                        std::uint32_t n_par_ct, std::variant<double, std::vector<double>> conj_thresh,
+                        double min_coll_radius, whitelist_t coll_whitelist,
+                        whitelist_t conj_whitelist, conj_aggr_mode conj_aggr, double conj_aggr_window,
+                        std::optional<screening_volume> svol, std::uint32_t det_order)
 {
     namespace hy = heyoka;
 
@@ -385,8 +954,17 @@ void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expres
     // Set the number of parallel collisional timesteps.
     set_n_par_ct(n_par_ct);
 
-    // Set the conjunction threshold.
-    set_conj_thresh(conj_thresh);
+    // Set the conjunction tiers.
+    // NOTE: m_data has not been set up yet, but there cannot
+    // be any pending conjunction at this stage, thus we
+    // just check and assign the values.
+    auto conj_tiers = std::holds_alternative<double>(conj_thresh)
+                          ? detail::conj_thresh_to_tiers(std::get<double>(conj_thresh))
+                          : std::move(std::get<std::vector<double>>(conj_thresh));
+    detail::validate_conj_tiers(conj_tiers);
+    m_conj_tier_counts.resize(conj_tiers.size());
+    m_conj_thresh = conj_tiers.empty() ? 0. : conj_tiers.back();
+    m_conj_tiers = std::move(conj_tiers);
 
     // Set the minimum collisional radius.
     set_min_coll_radius(min_coll_radius);
@@ -395,6 +973,43 @@ void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expres
     set_coll_whitelist(std::move(coll_whitelist));
     set_conj_whitelist(std::move(conj_whitelist));
 
+    // Set the conjunction aggregation window and mode.
+    // NOTE: the window must be set first, as the validity
+    // of the window mode depends on it.
+    // NOTE: m_data has not been set up yet, but there cannot
+    // be any pending conjunction at this stage, thus we
+    // just check and assign the values.
+    if (!std::isfinite(conj_aggr_window) || conj_aggr_window < 0) {
+        throw std::invalid_argument(
+            fmt::format("The conjunction aggregation window must be finite and non-negative, but it is {} instead",
+                        conj_aggr_window));
+    }
+    m_conj_aggr_window = conj_aggr_window;
+
+    if (conj_aggr < conj_aggr_mode::none || conj_aggr > conj_aggr_mode::window) {
+        throw std::invalid_argument("An invalid conjunction aggregation mode was specified");
+    }
+    if (conj_aggr == conj_aggr_mode::window && m_conj_aggr_window == 0) {
+        throw std::invalid_argument(
+            "A positive conjunction aggregation window is required when using the window aggregation mode");
+    }
+    m_conj_aggr = conj_aggr;
+
+    // Set the screening volume.
+    // NOTE: the screening volume was already validated
+    // on construction, and it cannot be changed after construction
+    // because its predicates are JIT-compiled below.
+    m_svol = std::move(svol);
+
+    // Set the detection order.
+    // NOTE: the economised polynomials are used only if the detection
+    // order is less than the order of the integrator, which
+    // is checked after the setup of the integrators.
+    if (det_order == 1u) {
+        throw std::invalid_argument("The detection order must be either zero or at least 2, but it is 1 instead");
+    }
+    m_det_order = det_order;
+
     if (dyn.empty()) {
         // Default is Keplerian dynamics with unitary mu.
         dyn = dynamics::kepler();
@@ -450,6 +1065,15 @@ void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expres
     // Validate m_pars.
     validate_pars_vector(*m_pars, nparts);
 
+    // Zero-init m_pars if there are parameters in the dynamics
+    // but no param values were provided.
+    if (m_npars > 0u && m_pars->empty()) {
+        m_pars->resize(safe_size_t(nparts) * m_npars);
+    }
+
+    // Assign the particle ids.
+    m_next_id = append_new_ids(m_ids, nparts);
+
     // Add the differential equation for r.
     const auto sym_vars = hy::make_vars("x", "y", "z", "vx", "vy", "vz", "r");
     const auto &x = sym_vars[0];
@@ -493,117 +1117,34 @@ void sim::finalise_ctor(std::vector<std::pair<heyoka::expression, heyoka::expres
     }
     m_exit_radius = exit_radius;
 
-    // Machinery to construct the integrators.
-    std::optional<hy::taylor_adaptive<double>> s_ta;
-    std::optional<hy::taylor_adaptive_batch<double>> b_ta;
-
-    auto integrators_setup = [&]() {
-        // Helpers to create the exit/reentry event equations.
-        auto make_exit_eq = [&]() {
-            assert(m_exit_radius > 0);
-
-            return hy::sum_sq({x, y, z}) - m_exit_radius * m_exit_radius;
-        };
-
-        auto make_reentry_eq = [&]() {
-            if (auto *dbl_ptr = std::get_if<double>(&m_reentry_radius)) {
-                assert(*dbl_ptr > 0);
-
-                return hy::sum_sq({x, y, z}) - *dbl_ptr * *dbl_ptr;
-            } else {
-                const auto &ax_vec = std::get<std::vector<double>>(m_reentry_radius);
-
-                assert(ax_vec.size() == 3u);
-
-                const auto ax_a = ax_vec[0];
-                const auto ax_b = ax_vec[1];
-                const auto ax_c = ax_vec[2];
-
-                return hy::sum_sq({ax_b * ax_c * x, ax_a * ax_c * y, ax_a * ax_b * z})
-                       - ax_a * ax_a * ax_b * ax_b * ax_c * ax_c;
-            }
-        };
-
-        oneapi::tbb::parallel_invoke(
-            [&]() {
-                using ev_t = hy::taylor_adaptive<double>::t_event_t;
-                std::vector<ev_t> t_events;
-
-                if (with_exit_event()) {
-                    t_events.emplace_back(
-                        make_exit_eq(),
-                        // NOTE: direction is positive in order to detect only domain exit (not entrance).
-                        hy::kw::direction = hy::event_direction::positive);
-                }
-
-                if (with_reentry_event()) {
-                    t_events.emplace_back(make_reentry_eq(),
-                                          // NOTE: direction is negative in order to detect only crashing into.
-                                          hy::kw::direction = hy::event_direction::negative);
-                }
-
-                s_ta.emplace(dyn, std::vector<double>(7u), hy::kw::t_events = std::move(t_events), hy::kw::tol = tol,
-                             hy::kw::high_accuracy = ha);
-            },
-            [&]() {
-                const std::uint32_t batch_size = hy::recommended_simd_size<double>();
-
-                using ev_t = hy::taylor_adaptive_batch<double>::t_event_t;
-                std::vector<ev_t> t_events;
-
-                if (with_exit_event()) {
-                    t_events.emplace_back(
-                        make_exit_eq(),
-                        // NOTE: direction is positive in order to detect only domain exit (not entrance).
-                        hy::kw::direction = hy::event_direction::positive);
-                }
-
-                if (with_reentry_event()) {
-                    t_events.emplace_back(make_reentry_eq(),
-                                          // NOTE: direction is negative in order to detect only crashing into.
-                                          hy::kw::direction = hy::event_direction::negative);
-                }
-
-                const std::vector<double>::size_type state_size = safe_size_t(7) * batch_size;
-                b_ta.emplace(dyn, std::vector<double>(state_size), batch_size, hy::kw::t_events = std::move(t_events),
-                             hy::kw::tol = tol, hy::kw::high_accuracy = ha);
-            });
-    };
-
-    spdlog::stopwatch sw;
-
-    // Concurrently:
-    // - setup the heyoka integrators,
-    // - check the state vector.
-    oneapi::tbb::parallel_invoke(integrators_setup, [this]() { verify_state_vector(*m_state); });
-
-    logger->trace("Integrators setup time: {}s", sw);
-
-    assert(s_ta);
-    assert(b_ta);
+    auto jit = detail::make_sim_jit_data(std::move(dyn), m_reentry_radius, m_exit_radius, tol, ha, m_svol, m_det_order,
+                                         [this]() { verify_state_vector(*m_state); });
 
 #if defined(__clang__)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
 
-    auto data_ptr = std::make_unique<sim_data>(sim_data{std::move(*s_ta), std::move(*b_ta)});
+    m_data = std::make_unique<sim_data>(sim_data{std::move(jit)});
 
 #pragma GCC diagnostic pop
 
 #else
 
-    auto data_ptr = std::make_unique<sim_data>(std::move(*s_ta), std::move(*b_ta));
+    m_data = std::make_unique<sim_data>(std::move(jit));
 
 #endif
 
-    m_data = std::move(data_ptr);
-
-    sw.reset();
-
-    add_jit_functions();
+    if (with_det_order()) {
+        logger->trace("Detection order: {} (integrator order: {})", m_det_order, m_data->jit->s_ta.get_order());
+    }
+}
 
-    logger->trace("JIT functions setup time: {}s", sw);
+// Check if the narrow phase screens the trajectories via the
+// economised polynomials of degree m_det_order (see compute_det_tcs()).
+bool sim::with_det_order() const
+{
+    return detail::use_det_order(m_det_order, m_data->jit->s_ta.get_order());
 }
 
 double sim::get_time() const
@@ -675,7 +1216,12 @@ std::uint32_t sim::exit_event_idx() const
 //   simulation, no position falls within the central body
 //   or outside the domain,
 // - no particle size is negative.
-void sim::verify_state_vector(const std::vector<double> &st) const
+// In the error messages, the particle at row k of st is identified by the
+// index idx_offset + k or, if idxs is not empty, by the index idxs[k].
+// NOTE: this is used also to validate only a subset of the
+// rows of the state vector (see add_particles() and update_particles()).
+void sim::verify_state_vector(std::span<const double> st, size_type idx_offset,
+                              std::span<const size_type> idxs) const
 {
     namespace stdex = std::experimental;
 
@@ -690,6 +1236,8 @@ void sim::verify_state_vector(const std::vector<double> &st) const
     // Infer the number of particles.
     const auto nparts = st.size() / 7u;
 
+    assert(idxs.empty() || idxs.size() == nparts);
+
     // Init the span for accessing st as a 2D array.
     stdex::mdspan sv(st.data(), stdex::extents<size_type, stdex::dynamic_extent, 7u>(nparts));
 
@@ -698,8 +1246,12 @@ void sim::verify_state_vector(const std::vector<double> &st) const
     const auto with_exit = with_exit_event();
 
     oneapi::tbb::parallel_for(
-        oneapi::tbb::blocked_range<size_type>(0, nparts), [sv, with_reentry, with_exit, this](const auto &range) {
+        oneapi::tbb::blocked_range<size_type>(0, nparts),
+        [sv, with_reentry, with_exit, idx_offset, idxs, this](const auto &range) {
             for (auto pidx = range.begin(); pidx != range.end(); ++pidx) {
+                // The index of the particle in the error messages.
+                const auto eidx = idxs.empty() ? idx_offset + pidx : idxs[pidx];
+
                 // Positions.
                 const auto x = sv(pidx, 0);
                 const auto y = sv(pidx, 1);
@@ -707,14 +1259,14 @@ void sim::verify_state_vector(const std::vector<double> &st) const
 
                 if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) {
                     throw std::invalid_argument(fmt::format(
-                        "An non-finite position was detected in the state vector of the particle at index {}", pidx));
+                        "An non-finite position was detected in the state vector of the particle at index {}", eidx));
                 }
 
                 if (with_reentry) {
                     if (const auto *dbl_ptr = std::get_if<double>(&m_reentry_radius)) {
                         if (x * x + y * y + z * z < *dbl_ptr * *dbl_ptr) {
                             throw std::invalid_argument(
-                                fmt::format("The particle at index {} is inside the spherical central body", pidx));
+                                fmt::format("The particle at index {} is inside the spherical central body", eidx));
                         }
                     } else {
                         const auto &ax_vec = std::get<std::vector<double>>(m_reentry_radius);
@@ -724,7 +1276,7 @@ void sim::verify_state_vector(const std::vector<double> &st) const
 
                         if (x * x / (ax_a * ax_a) + y * y / (ax_b * ax_b) + z * z / (ax_c * ax_c) < 1) {
                             throw std::invalid_argument(
-                                fmt::format("The particle at index {} is inside the ellipsoidal central body", pidx));
+                                fmt::format("The particle at index {} is inside the ellipsoidal central body", eidx));
                         }
                     }
                 }
@@ -732,20 +1284,20 @@ void sim::verify_state_vector(const std::vector<double> &st) const
                 if (with_exit) {
                     if (x * x + y * y + z * z >= m_exit_radius * m_exit_radius) {
                         throw std::invalid_argument(
-                            fmt::format("The particle at index {} is outside the exit radius {}", pidx, m_exit_radius));
+                            fmt::format("The particle at index {} is outside the exit radius {}", eidx, m_exit_radius));
                     }
                 }
 
                 // Velocities
                 if (!std::isfinite(sv(pidx, 3)) || !std::isfinite(sv(pidx, 4)) || !std::isfinite(sv(pidx, 5))) {
                     throw std::invalid_argument(fmt::format(
-                        "An non-finite velocity was detected in the state vector of the particle at index {}", pidx));
+                        "An non-finite velocity was detected in the state vector of the particle at index {}", eidx));
                 }
 
                 // Size.
                 if (!std::isfinite(sv(pidx, 6)) || sv(pidx, 6) < 0) {
                     throw std::invalid_argument(fmt::format(
-                        "An invalid particle size of {} was detected for the particle at index {}", sv(pidx, 6), pidx));
+                        "An invalid particle size of {} was detected for the particle at index {}", sv(pidx, 6), eidx));
                 }
             }
         });
@@ -754,6 +1306,16 @@ void sim::verify_state_vector(const std::vector<double> &st) const
 void sim::reset_conjunctions()
 {
     m_det_conj = std::make_shared<std::vector<conjunction>>();
+
+    // Discard also the pending aggregated conjunctions.
+    m_data->conj_aggr_windows.clear();
+
+    // Reset the per-tier counters.
+    std::fill(m_conj_tier_counts.begin(), m_conj_tier_counts.end(), size_type(0));
+
+    if (m_ckpt) {
+        m_ckpt->conjunctions_reset();
+    }
 }
 
 std::ostream &operator<<(std::ostream &os, const sim &s)
@@ -791,4 +1353,85 @@ void sim::set_conj_whitelist(whitelist_t wl)
     m_conj_whitelist = std::move(wl);
 }
 
+// Convert a whitelist of particle indices into a whitelist of particle ids.
+// NOTE: the indices which do not refer to any particle are ignored.
+sim::id_whitelist_t sim::whitelist_to_ids(const whitelist_t &wl) const
+{
+    id_whitelist_t retval;
+
+    for (const auto idx : wl) {
+        if (idx < m_ids.size()) {
+            retval.insert(m_ids[idx]);
+        }
+    }
+
+    return retval;
+}
+
+// Convert a whitelist of particle ids into a whitelist of particle indices.
+// NOTE: this will throw if any id does not refer to a particle in the simulation.
+sim::whitelist_t sim::ids_to_whitelist(const id_whitelist_t &ids) const
+{
+    whitelist_t retval;
+
+    for (const auto id : ids) {
+        retval.insert(id_to_index(id));
+    }
+
+    return retval;
+}
+
+sim::id_whitelist_t sim::get_coll_whitelist_ids() const
+{
+    return whitelist_to_ids(m_coll_whitelist);
+}
+
+void sim::set_coll_whitelist_ids(const id_whitelist_t &ids)
+{
+    set_coll_whitelist(ids_to_whitelist(ids));
+}
+
+sim::id_whitelist_t sim::get_conj_whitelist_ids() const
+{
+    return whitelist_to_ids(m_conj_whitelist);
+}
+
+void sim::set_conj_whitelist_ids(const id_whitelist_t &ids)
+{
+    set_conj_whitelist(ids_to_whitelist(ids));
+}
+
+// NOTE: the conjunctions already recorded in m_det_conj
+// will be pushed to the new sink at the end of the next step.
+void sim::set_conj_sink(std::shared_ptr<conj_sink> cs)
+{
+    m_conj_sink = std::move(cs);
+}
+
+void sim::set_snapshot_writer(std::shared_ptr<snapshot_writer> sw)
+{
+    m_snap_writer = std::move(sw);
+}
+
+// NOTE: the first record written by the checkpointer
+// after being set will be a base record.
+void sim::set_checkpointer(std::shared_ptr<checkpointer> ckpt)
+{
+    if (ckpt) {
+        ckpt->sim_attached();
+    }
+
+    m_ckpt = std::move(ckpt);
+}
+
+void sim::set_ephemeris_writer(std::shared_ptr<ephemeris_writer> ew)
+{
+    m_eph_writer = std::move(ew);
+}
+
+void sim::clear_output_errors() noexcept
+{
+    m_output_errors.clear();
+}
+
 } // namespace cascade
@@ -0,0 +1,446 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/safe_numerics/safe_integer.hpp>
+
+#include <fmt/core.h>
+
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#include <cascade/detail/logging_impl.hpp>
+#include <cascade/detail/sim_data.hpp>
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+std::size_t sim::sim_data::conj_aggr_hc::hash(const conj_aggr_key_t &k)
+{
+    std::size_t seed = 0;
+
+    boost::hash_combine(seed, std::get<0>(k));
+    boost::hash_combine(seed, std::get<1>(k));
+    boost::hash_combine(seed, std::get<2>(k));
+
+    return seed;
+}
+
+bool sim::sim_data::conj_aggr_hc::equal(const conj_aggr_key_t &k1, const conj_aggr_key_t &k2)
+{
+    return k1 == k2;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to build the key for the pair of particles
+// (i, j) and the conjunction tier t in the pending
+// aggregation windows.
+auto conj_aggr_key(sim::size_type i, sim::size_type j, sim::size_type t)
+{
+    const auto [a, b] = std::minmax(i, j);
+
+    return std::tuple{a, b, t};
+}
+
+// Helper to invoke f(widx, dt) for each aggregation window
+// widx overlapping the time interval [tb, te), where dt
+// is the length of the overlap. The window indices are clamped
+// to the [w_begin, w_end] range.
+template <typename F>
+void conj_aggr_for_each_window(const sim &s, std::int64_t w_begin, std::int64_t w_end, double tb, double te,
+                               const F &f)
+{
+    // Helper to compute the clamped window index for the time coordinate t.
+    // NOTE: the clamping is needed because floating-point rounding in the
+    // computation of the absolute time coordinates could push the values
+    // slightly outside the time range of the superstep.
+    auto widx = [&](double t) {
+        if (s.get_conj_aggr() == conj_aggr_mode::superstep) {
+            return static_cast<std::int64_t>(0);
+        }
+
+        return std::clamp(static_cast<std::int64_t>(std::floor(t / s.get_conj_aggr_window())), w_begin, w_end);
+    };
+
+    if (!(te > tb)) {
+        return;
+    }
+
+    const auto wb = widx(tb);
+    const auto we = widx(te);
+
+    if (wb == we) {
+        f(wb, te - tb);
+        return;
+    }
+
+    const auto w = s.get_conj_aggr_window();
+
+    for (auto cur_w = wb; cur_w <= we; ++cur_w) {
+        const auto lo = std::max(tb, static_cast<double>(cur_w) * w);
+        const auto hi = std::min(te, static_cast<double>(cur_w + 1) * w);
+
+        if (hi > lo) {
+            f(cur_w, hi - lo);
+        }
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+void sim::set_conj_aggr(conj_aggr_mode mode)
+{
+    if (mode < conj_aggr_mode::none || mode > conj_aggr_mode::window) {
+        throw std::invalid_argument("An invalid conjunction aggregation mode was specified");
+    }
+
+    if (mode == conj_aggr_mode::window && m_conj_aggr_window == 0) {
+        throw std::invalid_argument(
+            "A positive conjunction aggregation window is required when using the window aggregation mode");
+    }
+
+    // Flush the pending conjunctions before switching
+    // to the new mode.
+    flush_conjunctions();
+
+    m_conj_aggr = mode;
+}
+
+void sim::set_conj_aggr_window(double w)
+{
+    if (!std::isfinite(w) || w < 0) {
+        throw std::invalid_argument(fmt::format(
+            "The conjunction aggregation window must be finite and non-negative, but it is {} instead", w));
+    }
+
+    if (m_conj_aggr == conj_aggr_mode::window && w == 0) {
+        throw std::invalid_argument(
+            "A positive conjunction aggregation window is required when using the window aggregation mode");
+    }
+
+    // Flush the pending conjunctions, as the
+    // window boundaries are changing.
+    flush_conjunctions();
+
+    m_conj_aggr_window = w;
+}
+
+// Number of pending aggregated conjunctions, that is, conjunctions
+// which will be appended to m_det_conj once their aggregation window
+// is closed.
+sim::size_type sim::get_n_pending_conjunctions() const
+{
+    using safe_size_t = boost::safe_numerics::safe<size_type>;
+
+    safe_size_t retval = 0;
+
+    for (const auto &[_, wmap] : m_data->conj_aggr_windows) {
+        for (const auto &[__, c] : wmap) {
+            retval += static_cast<size_type>(c.n_min > 0u);
+        }
+    }
+
+    return retval;
+}
+
+// Flush all the pending aggregated conjunctions into m_det_conj,
+// regardless of whether or not their aggregation windows are closed.
+void sim::flush_conjunctions()
+{
+    using safe_size_t = boost::safe_numerics::safe<size_type>;
+
+    safe_size_t n_pending = 0;
+    for (const auto &[_, wmap] : m_data->conj_aggr_windows) {
+        n_pending += wmap.size();
+    }
+
+    reserve_conj_data(n_pending);
+
+    // NOTE: noexcept from now on.
+    conj_aggr_flush({});
+
+    // Push the flushed conjunctions to the sink, if needed.
+    push_conj_sink();
+}
+
+// Compute the index of the aggregation window
+// containing the absolute time coordinate t.
+std::int64_t sim::conj_aggr_window_idx(double t) const
+{
+    assert(m_conj_aggr != conj_aggr_mode::none);
+
+    if (m_conj_aggr == conj_aggr_mode::superstep) {
+        return 0;
+    }
+
+    assert(std::isfinite(m_conj_aggr_window) && m_conj_aggr_window > 0);
+
+    const auto widx = std::floor(t / m_conj_aggr_window);
+
+    if (!std::isfinite(widx)) {
+        // LCOV_EXCL_START
+        throw std::invalid_argument(fmt::format(
+            "Cannot compute the index of the conjunction aggregation window for the time coordinate {}", t));
+        // LCOV_EXCL_STOP
+    }
+
+    return boost::numeric_cast<std::int64_t>(widx);
+}
+
+// Prepare the aggregation of the conjunction data detected during the
+// last superstep. t0 and t1 are the absolute time coordinates of the
+// beginning and of the end of the superstep, and only the minima and
+// the time intervals before the cutoff time are taken into account.
+//
+// This function creates the entries in the pending windows for all the
+// pairs of particles which will be updated by conj_aggr_merge(), and it
+// ensures that m_det_conj can receive the content of the windows closed
+// at the end of the superstep without reallocating. In this way,
+// conj_aggr_merge() can then be run in the noexcept section of step().
+// NOTE: the newly-created entries are neutral (no minima, zero time
+// below the threshold, infinite distance), so that if an exception
+// is thrown at any point the pending windows are left in a consistent state.
+void sim::conj_aggr_prepare(double t0, double t1, double cutoff)
+{
+    assert(m_conj_aggr != conj_aggr_mode::none);
+    assert(m_conj_thresh != 0);
+
+    spdlog::stopwatch sw;
+
+    auto *logger = detail::get_logger();
+
+    // Create the windows which may receive data during this superstep.
+    const auto w_begin = conj_aggr_window_idx(t0);
+    const auto w_end = conj_aggr_window_idx(std::min(t1, cutoff));
+    assert(w_end >= w_begin);
+
+    auto &windows = m_data->conj_aggr_windows;
+    for (auto w = w_begin;; ++w) {
+        windows.try_emplace(w);
+
+        if (w == w_end) {
+            break;
+        }
+    }
+
+    // The neutral entry.
+    const auto neutral = [&]() {
+        conjunction c;
+        c.dist = std::numeric_limits<double>::infinity();
+        c.n_min = 0;
+        c.time_under = 0;
+
+        return c;
+    }();
+
+    // Helper to fetch the map of the window containing the time coordinate t.
+    // NOTE: find() on the std::map is safe to invoke concurrently,
+    // as long as no modification takes place.
+    auto wmap = [&](std::int64_t w) -> sim_data::conj_aggr_map_t & {
+        const auto it = windows.find(w);
+        assert(it != windows.end());
+
+        return it->second;
+    };
+
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(0u, m_data->nchunks), [&](const auto &range) {
+        for (auto chunk_idx = range.begin(); chunk_idx != range.end(); ++chunk_idx) {
+            const auto &cv = m_data->conj_vecs[chunk_idx];
+            const auto &tv = m_data->conj_tu_vecs[chunk_idx];
+
+            oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(cv.begin(), cv.end()), [&](const auto &rn) {
+                for (const auto &c : rn) {
+                    if (c.time < cutoff) {
+                        const auto w = std::clamp(conj_aggr_window_idx(c.time), w_begin, w_end);
+                        wmap(w).insert({detail::conj_aggr_key(c.i, c.j, c.tier), neutral});
+                    }
+                }
+            });
+
+            oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(tv.begin(), tv.end()), [&](const auto &rn) {
+                for (const auto &[pi, pj, tier, tb, te] : rn) {
+                    detail::conj_aggr_for_each_window(
+                        *this, w_begin, w_end, t0 + tb, std::min(t0 + te, cutoff),
+                        [&, pi = pi, pj = pj, tier = tier](std::int64_t w, double) {
+                            wmap(w).insert({detail::conj_aggr_key(pi, pj, tier), neutral});
+                        });
+                }
+            });
+        }
+    });
+
+    // Make sure that m_det_conj can receive the content
+    // of the windows closed at the end of the superstep.
+    using safe_size_t = boost::safe_numerics::safe<size_type>;
+    safe_size_t n_flush = 0;
+    const auto close_idx = (m_conj_aggr == conj_aggr_mode::superstep) ? std::optional<std::int64_t>{}
+                                                                        : conj_aggr_window_idx(t1);
+    for (const auto &[w, wm] : windows) {
+        if (close_idx && w >= *close_idx) {
+            break;
+        }
+
+        n_flush += wm.size();
+    }
+
+    reserve_conj_data(n_flush);
+
+    logger->trace("Conjunction aggregation preparation time: {}s", sw);
+}
+
+// Merge the conjunction data detected during the last superstep
+// into the pending windows, and flush the windows closed at the
+// end of the superstep into m_det_conj. The arguments are the same
+// passed to conj_aggr_prepare(), which must have been invoked
+// beforehand.
+// NOTE: this is noexcept because all the memory allocations
+// were performed in conj_aggr_prepare(). The window index computations
+// were also already performed (and checked) in conj_aggr_prepare().
+void sim::conj_aggr_merge(double t0, double t1, double cutoff, void *logger_) noexcept
+{
+    assert(m_conj_aggr != conj_aggr_mode::none);
+
+    spdlog::stopwatch sw;
+
+    auto *logger = static_cast<decltype(detail::get_logger())>(logger_);
+
+    const auto w_begin = conj_aggr_window_idx(t0);
+    const auto w_end = conj_aggr_window_idx(std::min(t1, cutoff));
+
+    auto &windows = m_data->conj_aggr_windows;
+
+    // Helper to fetch the entry for the pair (i, j) and the tier t in the window w.
+    // NOTE: the entry must have been created by conj_aggr_prepare().
+    auto fetch = [&](sim_data::conj_aggr_map_t::accessor &acc, std::int64_t w, size_type i, size_type j,
+                     size_type t) {
+        const auto it = windows.find(w);
+        assert(it != windows.end());
+
+        [[maybe_unused]] const auto found = it->second.find(acc, detail::conj_aggr_key(i, j, t));
+        assert(found);
+    };
+
+    oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(0u, m_data->nchunks), [&](const auto &range) {
+        for (auto chunk_idx = range.begin(); chunk_idx != range.end(); ++chunk_idx) {
+            const auto &cv = m_data->conj_vecs[chunk_idx];
+            const auto &tv = m_data->conj_tu_vecs[chunk_idx];
+
+            oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(cv.begin(), cv.end()), [&](const auto &rn) {
+                sim_data::conj_aggr_map_t::accessor acc;
+
+                for (const auto &c : rn) {
+                    if (!(c.time < cutoff)) {
+                        continue;
+                    }
+
+                    fetch(acc, std::clamp(conj_aggr_window_idx(c.time), w_begin, w_end), c.i, c.j, c.tier);
+
+                    auto &cur = acc->second;
+
+                    // Keep the closest approach, preserving
+                    // the counters.
+                    if (c.dist < cur.dist) {
+                        const auto n_min = cur.n_min;
+                        const auto time_under = cur.time_under;
+
+                        cur = c;
+
+                        cur.n_min = n_min;
+                        cur.time_under = time_under;
+                    }
+
+                    ++cur.n_min;
+
+                    acc.release();
+                }
+            });
+
+            oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(tv.begin(), tv.end()), [&](const auto &rn) {
+                sim_data::conj_aggr_map_t::accessor acc;
+
+                for (const auto &[pi, pj, tier, tb, te] : rn) {
+                    detail::conj_aggr_for_each_window(*this, w_begin, w_end, t0 + tb, std::min(t0 + te, cutoff),
+                                                      [&, pi = pi, pj = pj, tier = tier](std::int64_t w, double dt) {
+                                                          fetch(acc, w, pi, pj, tier);
+                                                          acc->second.time_under += dt;
+                                                          acc.release();
+                                                      });
+                }
+            });
+        }
+    });
+
+    // Flush the closed windows.
+    conj_aggr_flush(m_conj_aggr == conj_aggr_mode::superstep ? std::optional<std::int64_t>{}
+                                                              : conj_aggr_window_idx(t1));
+
+    logger->trace("Conjunction aggregation merge time: {}s", sw);
+}
+
+// Flush into m_det_conj the content of all the pending aggregation windows
+// whose index is less than close_idx (or all windows, if close_idx is empty).
+// The flushed conjunctions are sorted in chronological order, and the entries
+// containing no distance minimum are discarded.
+// NOTE: we can mark this as noexcept because the capacity of m_det_conj
+// must have been set up beforehand via reserve_conj_data().
+void sim::conj_aggr_flush(std::optional<std::int64_t> close_idx) noexcept
+{
+    auto &windows = m_data->conj_aggr_windows;
+
+    const auto orig_size = m_det_conj->size();
+
+#if !defined(NDEBUG)
+    const auto orig_cap = m_det_conj->capacity();
+#endif
+
+    auto it = windows.begin();
+    for (; it != windows.end() && (!close_idx || it->first < *close_idx); ++it) {
+        for (const auto &[_, c] : it->second) {
+            if (c.n_min > 0u) {
+                assert(m_det_conj->size() < orig_cap);
+
+                m_det_conj->push_back(c);
+            }
+        }
+    }
+
+    windows.erase(windows.begin(), it);
+
+    // NOTE: the windows are disjoint in time and the newly-closed windows
+    // all follow the windows closed earlier, thus sorting the
+    // appended range is enough to keep m_det_conj in chronological order.
+    const auto new_begin = m_det_conj->begin() + static_cast<std::vector<conjunction>::difference_type>(orig_size);
+    std::sort(new_begin, m_det_conj->end(),
+              [](const conjunction &c1, const conjunction &c2) { return c1.time < c2.time; });
+
+    // Assign the particle ids and update the per-tier counters.
+    assign_conj_ids(new_begin);
+    update_conj_tier_counts(new_begin);
+}
+
+} // namespace cascade
@@ -6,17 +6,27 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <array>
 #include <cmath>
 #include <initializer_list>
+#include <optional>
 #include <stdexcept>
 #include <utility>
 #include <vector>
 
+#include <boost/math/constants/constants.hpp>
+
 #include <fmt/format.h>
 
 #include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
 #include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
 #include <heyoka/math/sum_sq.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/param.hpp>
 
 #include <cascade/sim.hpp>
 
@@ -42,4 +52,229 @@ std::vector<std::pair<heyoka::expression, heyoka::expression>> kepler(double mu)
             hy::prime(vz) = -mu * z * hy::pow(hy::sum_sq({x, y, z}), -1.5)};
 }
 
+// NOTE: this is the implementation of cascade.dynamics.simple_earth() in Python,
+// which is also used to generate the precompiled entries of the JIT cache. The
+// expressions are built with the same constants and the same operations
+// in the same order as the original Python implementation.
+std::vector<std::pair<heyoka::expression, heyoka::expression>>
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+simple_earth(bool J2, bool J3, bool C22S22, bool sun, bool moon, bool SRP, bool drag)
+{
+    namespace hy = heyoka;
+
+    constexpr auto deg = boost::math::constants::pi<double>() / 180;
+
+    // Constants (the final underscore reminds us they are not in SI units).
+    const auto GMe_ = 3.986004407799724e5; // [km^3/sec^2]
+    const auto GMo_ = 1.32712440018e11;    // [km^3/sec^2]
+    const auto GMm_ = 4.9028e3;            // [km^3/sec^2]
+    const auto Re_ = 6378.1363;            // [km]
+    const auto C20 = -4.84165371736e-4;
+    const auto C22 = 2.43914352398e-6;
+    const auto S22 = -1.40016683654e-6;
+    const auto J3_dim_value = -2.61913e29; // [m^6/s^2]
+    // The rotation of the Earth fixed system at t0 [rad].
+    const auto theta_g = deg * 280.4606;
+    // The Earth spin angular velocity [rad/sec].
+    const auto nu_e = deg * 4.178074622024230e-3;
+    const auto nu_o = deg * 1.1407410259335311e-5;  // [rad/sec]
+    const auto nu_ma = deg * 1.512151961904581e-4;  // [rad/sec]
+    const auto nu_mp = deg * 1.2893925235125941e-6; // [rad/sec]
+    const auto nu_ms = deg * 6.128913003523574e-7;  // [rad/sec]
+    const auto alpha_o_ = 1.49619e8;                // [km]
+    const auto epsilon = deg * 23.4392911;          // [rad]
+    const auto phi_o = deg * 357.5256;              // [rad]
+    const auto Omega_plus_w = deg * 282.94;         // [rad]
+    const auto PSRP_ = 4.56e-3;                     // [kg/(km*sec^2)]
+
+    const auto [x, y, z, vx, vy, vz] = hy::make_vars("x", "y", "z", "vx", "vy", "vz");
+
+    // Keplerian dynamics in SI units.
+    const auto GMe_SI = GMe_ * 1e9;
+    auto dyn = kepler(GMe_SI);
+
+    // Helper to add a perturbation to the accelerations.
+    const auto add_acc = [&dyn](const hy::expression &fx, const hy::expression &fy, const hy::expression &fz) {
+        dyn[3].second = dyn[3].second + fx;
+        dyn[4].second = dyn[4].second + fy;
+        dyn[5].second = dyn[5].second + fz;
+    };
+
+    const auto magr2 = hy::sum_sq({x, y, z});
+
+    const auto Re_SI = Re_ * 1000;
+
+    if (J2) {
+        const auto J2term1 = GMe_SI * std::pow(Re_SI, 2.) * std::sqrt(5.) * C20 / (2. * hy::pow(magr2, 1. / 2));
+        const auto J2term2 = 3. / hy::pow(magr2, 2.);
+        const auto J2term3 = 15. * hy::pow(z, 2.) / hy::pow(magr2, 3.);
+        const auto fJ2x = J2term1 * x * (J2term2 - J2term3);
+        const auto fJ2y = J2term1 * y * (J2term2 - J2term3);
+        const auto fJ2z = J2term1 * z * (3. * J2term2 - J2term3);
+
+        add_acc(fJ2x, fJ2y, fJ2z);
+    }
+
+    if (J3) {
+        // r**9.
+        const auto magr9 = hy::pow(magr2, 1. / 2) * hy::pow(magr2, 4.);
+        const auto fJ3x = J3_dim_value * x * y / magr9
+                          * (10. * hy::pow(z, 2.) - 15. / 2 * (hy::pow(x, 2.) + hy::pow(y, 2.)));
+        const auto fJ3y = J3_dim_value * z * y / magr9
+                          * (10. * hy::pow(z, 2.) - 15. / 2 * (hy::pow(x, 2.) + hy::pow(y, 2.)));
+        const auto fJ3z = J3_dim_value * 1. / magr9
+                          * (4. * hy::pow(z, 2.) * (hy::pow(z, 2.) - 3. * (hy::pow(x, 2.) + hy::pow(y, 2.)))
+                             + 3. / 2 * hy::pow(hy::pow(x, 2.) + hy::pow(y, 2.), 2.));
+
+        add_acc(fJ3x, fJ3y, fJ3z);
+    }
+
+    if (C22S22) {
+        const auto X = x * hy::cos(theta_g + nu_e * hy::time) + y * hy::sin(theta_g + nu_e * hy::time);
+        const auto Y = -x * hy::sin(theta_g + nu_e * hy::time) + y * hy::cos(theta_g + nu_e * hy::time);
+        const auto Z = z;
+
+        const auto C22term1
+            = 5. * GMe_SI * std::pow(Re_SI, 2.) * std::sqrt(15.) * C22 / (2. * hy::pow(magr2, 7. / 2));
+        const auto C22term2 = GMe_SI * std::pow(Re_SI, 2.) * std::sqrt(15.) * C22 / hy::pow(magr2, 5. / 2);
+        const auto fC22X = C22term1 * X * (hy::pow(Y, 2.) - hy::pow(X, 2.)) + C22term2 * X;
+        const auto fC22Y = C22term1 * Y * (hy::pow(Y, 2.) - hy::pow(X, 2.)) - C22term2 * Y;
+        const auto fC22Z = C22term1 * Z * (hy::pow(Y, 2.) - hy::pow(X, 2.));
+
+        const auto S22term1 = 5. * GMe_SI * std::pow(Re_SI, 2.) * std::sqrt(15.) * S22 / hy::pow(magr2, 7. / 2);
+        const auto S22term2 = GMe_SI * std::pow(Re_SI, 2.) * std::sqrt(15.) * S22 / hy::pow(magr2, 5. / 2);
+        const auto fS22X = -S22term1 * hy::pow(X, 2.) * Y + S22term2 * Y;
+        const auto fS22Y = -S22term1 * X * hy::pow(Y, 2.) + S22term2 * X;
+        const auto fS22Z = -S22term1 * X * Y * Z;
+
+        const auto fC22x = fC22X * hy::cos(theta_g + nu_e * hy::time) - fC22Y * hy::sin(theta_g + nu_e * hy::time);
+        const auto fC22y = fC22X * hy::sin(theta_g + nu_e * hy::time) + fC22Y * hy::cos(theta_g + nu_e * hy::time);
+        const auto fC22z = fC22Z;
+
+        const auto fS22x = fS22X * hy::cos(theta_g + nu_e * hy::time) - fS22Y * hy::sin(theta_g + nu_e * hy::time);
+        const auto fS22y = fS22X * hy::sin(theta_g + nu_e * hy::time) + fS22Y * hy::cos(theta_g + nu_e * hy::time);
+        const auto fS22z = fS22Z;
+
+        add_acc(fC22x, fC22y, fC22z);
+        add_acc(fS22x, fS22y, fS22z);
+    }
+
+    // The position of the Sun and its distance from the particle
+    // (squared), needed by the Sun gravity and by the SRP.
+    std::optional<hy::expression> Xo, Yo, Zo, magRo2, magRRo2;
+
+    if (sun || SRP) {
+        const auto lo = phi_o + nu_o * hy::time;
+        const auto lambda_o
+            = Omega_plus_w + lo + deg * ((6892. / 3600) * hy::sin(lo) + (72. / 3600) * hy::sin(2. * lo));
+        // [m]
+        const auto ro = (149.619 - 2.499 * hy::cos(lo) - 0.021 * hy::cos(2. * lo)) * 1e9;
+        Xo = ro * hy::cos(lambda_o);
+        Yo = ro * hy::sin(lambda_o) * std::cos(epsilon);
+        Zo = ro * hy::sin(lambda_o) * std::sin(epsilon);
+        magRo2 = hy::pow(*Xo, 2.) + hy::pow(*Yo, 2.) + hy::pow(*Zo, 2.);
+        magRRo2 = hy::pow(x - *Xo, 2.) + hy::pow(y - *Yo, 2.) + hy::pow(z - *Zo, 2.);
+    }
+
+    if (sun) {
+        const auto GMo_SI = GMo_ * 1e9;
+        const auto fSunX = -GMo_SI * ((x - *Xo) / hy::pow(*magRRo2, 3. / 2) + *Xo / hy::pow(*magRo2, 3. / 2));
+        const auto fSunY = -GMo_SI * ((y - *Yo) / hy::pow(*magRRo2, 3. / 2) + *Yo / hy::pow(*magRo2, 3. / 2));
+        const auto fSunZ = -GMo_SI * ((z - *Zo) / hy::pow(*magRRo2, 3. / 2) + *Zo / hy::pow(*magRo2, 3. / 2));
+
+        add_acc(fSunX, fSunY, fSunZ);
+    }
+
+    if (moon) {
+        // The position of the Moon.
+        const auto phi_m = nu_o * hy::time;
+        const auto phi_ma = nu_ma * hy::time;
+        const auto phi_mp = nu_mp * hy::time;
+        const auto phi_ms = nu_ms * hy::time;
+        const auto L0 = phi_mp + phi_ma + deg * 218.31617;
+        const auto lm = phi_ma + deg * 134.96292;
+        const auto llm = phi_m + deg * 357.5256;
+        const auto Fm = phi_mp + phi_ma + phi_ms + deg * 93.27283;
+        const auto Dm = phi_mp + phi_ma - phi_m + deg * 297.85027;
+
+        const auto rm = 385000. - 20905. * hy::cos(lm) - 3699. * hy::cos(2. * Dm - lm) - 2956. * hy::cos(2. * Dm)
+                        - 570. * hy::cos(2. * lm) + 246. * hy::cos(2. * lm - 2. * Dm)
+                        - 205. * hy::cos(llm - 2. * Dm) - 171. * hy::cos(lm + 2. * Dm)
+                        - 152. * hy::cos(lm + llm - 2. * Dm);
+
+        const auto lambda_m
+            = L0
+              + deg
+                    * ((22640. / 3600) * hy::sin(lm) + (769. / 3600) * hy::sin(2. * lm)
+                       - (4856. / 3600) * hy::sin(lm - 2. * Dm) + (2370. / 3600) * hy::sin(2. * Dm)
+                       - (668. / 3600) * hy::sin(llm) - (412. / 3600) * hy::sin(2. * Fm)
+                       - (212. / 3600) * hy::sin(2. * lm - 2. * Dm) - (206. / 3600) * hy::sin(lm + llm - 2. * Dm)
+                       + (192. / 3600) * hy::sin(lm + 2. * Dm) - (165. / 3600) * hy::sin(llm - 2. * Dm)
+                       + (148. / 3600) * hy::sin(lm - llm) - (125. / 3600) * hy::sin(Dm)
+                       - (110. / 3600) * hy::sin(lm + llm) - (55. / 3600) * hy::sin(2. * Fm - 2. * Dm));
+
+        const auto Bm
+            = deg
+              * ((18520. / 3600)
+                     * hy::sin(Fm + lambda_m - L0
+                               + deg * ((412. / 3600) * hy::sin(2. * Fm) + (541. / 3600) * hy::sin(llm)))
+                 - (526. / 3600) * hy::sin(Fm - 2. * Dm) + (44. / 3600) * hy::sin(lm + Fm - 2. * Dm)
+                 - (31. / 3600) * hy::sin(-lm + Fm - 2. * Dm) - (25. / 3600) * hy::sin(-2. * lm + Fm)
+                 - (23. / 3600) * hy::sin(llm + Fm - 2. * Dm) + (21. / 3600) * hy::sin(-lm + Fm)
+                 + (11. / 3600) * hy::sin(-llm + Fm - 2. * Dm));
+
+        const auto Xm = hy::cos(Bm) * hy::cos(lambda_m) * rm;
+        const auto Ym
+            = -std::sin(epsilon) * hy::sin(Bm) * rm + std::cos(epsilon) * hy::cos(Bm) * hy::sin(lambda_m) * rm;
+        const auto Zm = std::cos(epsilon) * hy::sin(Bm) * rm + hy::cos(Bm) * std::sin(epsilon) * hy::sin(lambda_m) * rm;
+
+        const auto GMm_SI = GMm_ * 1e9;
+        const auto magRm2 = hy::pow(Xm, 2.) + hy::pow(Ym, 2.) + hy::pow(Zm, 2.);
+        const auto magRRm2 = hy::pow(x - Xm, 2.) + hy::pow(y - Ym, 2.) + hy::pow(z - Zm, 2.);
+        const auto fMoonX = -GMm_SI * ((x - Xm) / hy::pow(magRRm2, 3. / 2) + Xm / hy::pow(magRm2, 3. / 2));
+        const auto fMoonY = -GMm_SI * ((y - Ym) / hy::pow(magRRm2, 3. / 2) + Ym / hy::pow(magRm2, 3. / 2));
+        const auto fMoonZ = -GMm_SI * ((z - Zm) / hy::pow(magRRm2, 3. / 2) + Zm / hy::pow(magRm2, 3. / 2));
+
+        add_acc(fMoonX, fMoonY, fMoonZ);
+    }
+
+    if (drag) {
+        const auto magv2 = hy::sum_sq({vx, vy, vz});
+        const auto magv = hy::sqrt(magv2);
+        // NOTE: here we consider a spherical Earth.
+        const auto altitude = hy::sqrt(magr2) - Re_SI;
+
+        // The atmospheric density [kg/m^3], via an exponential
+        // fit of the isotropic NRLMSISE00 model.
+        constexpr std::array best_x = {1.01709935e-06, 7.86443375e-01, 7.50341883e-09, 8.63934252e-14,
+                                       4.63822910e-02, 1.86080048e-01, 2.48667176e-02, 4.81080852e-03,
+                                       5.01594516e00,  2.28429809e01,  4.27957829e00,  1.56291673e-01};
+        hy::expression density{0.};
+        for (auto i = 0u; i < 4u; ++i) {
+            const auto alpha = best_x[i];
+            const auto beta = best_x[i + 4u] / 1000;
+            const auto gamma = best_x[i + 8u] * 1000;
+
+            density = density + alpha * hy::exp(-(altitude - gamma) * beta);
+        }
+
+        const auto ref_density = 0.1570 / Re_SI;
+        // NOTE: the BSTAR coefficient is the first parameter.
+        const auto fdrag = density / ref_density * hy::par[0] * magv;
+
+        add_acc(-fdrag * vx, -fdrag * vy, -fdrag * vz);
+    }
+
+    if (SRP) {
+        const auto PSRP_SI = PSRP_ / 1000.;      // [kg/(m*sec^2)]
+        const auto alpha_o_SI = alpha_o_ * 1000.; // [m]
+        // NOTE: the area is the parameter following BSTAR, if present.
+        const auto SRPterm = hy::par[drag ? 1u : 0u] * PSRP_SI * std::pow(alpha_o_SI, 2.) / hy::pow(*magRRo2, 3. / 2);
+
+        add_acc(SRPterm * (x - *Xo), SRPterm * (y - *Yo), SRPterm * (z - *Zo));
+    }
+
+    return dyn;
+}
+
 } // namespace cascade::dynamics
@@ -7,8 +7,12 @@
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <initializer_list>
+#include <limits>
+#include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -61,7 +65,7 @@ namespace hy = heyoka;
 // c'_i = sum_{k=i}^n (c_k * choose(k, k-i) * a**(k-i))
 //
 // (where n == order of the polynomial).
-void add_poly_translator_a(hy::llvm_state &s, std::uint32_t order)
+void add_poly_translator_a(hy::llvm_state &s, std::uint32_t order, const std::string &name)
 {
     using namespace hy::literals;
 
@@ -109,13 +113,16 @@ void add_poly_translator_a(hy::llvm_state &s, std::uint32_t order)
     }
 
     // Add the compiled function.
-    hy::add_cfunc<double>(s, "pta_cfunc", out, hy::kw::vars = std::move(cfs));
+    hy::add_cfunc<double>(s, name, out, hy::kw::vars = std::move(cfs));
 }
 
 // Add a compiled function to compute the sum of the squares
-// of the differences between three polynomials. The computation
-// is performed in the truncated power series algebra.
-void add_poly_ssdiff3_cfunc(hy::llvm_state &s, std::uint32_t order)
+// of the differences between three polynomials. If truncate is true,
+// the computation is performed in the truncated power series algebra
+// (i.e., the result is a polynomial of the same order as the inputs),
+// otherwise the squares are computed exactly (i.e., the result is a
+// polynomial of order 2 * order).
+void add_poly_ssdiff3_cfunc(hy::llvm_state &s, std::uint32_t order, bool truncate, const std::string &name)
 {
     namespace stdex = std::experimental;
     using namespace hy::literals;
@@ -171,26 +178,35 @@ void add_poly_ssdiff3_cfunc(hy::llvm_state &s, std::uint32_t order)
     auto diff_y = pdiff(yi_poly, yj_poly);
     auto diff_z = pdiff(zi_poly, zj_poly);
 
+    // The order of the output polynomial.
+    const auto out_order = truncate ? order : 2u * order;
+
     // Helper to compute the square of a polynomial.
-    auto psquare = [order](const auto &p) {
+    auto psquare = [order, out_order](const auto &p) {
         std::vector<hy::expression> ret, tmp;
-        ret.reserve(order + 1u);
+        ret.reserve(out_order + 1u);
 
-        for (std::uint32_t i = 0; i <= order; ++i) {
+        for (std::uint32_t i = 0; i <= out_order; ++i) {
             tmp.clear();
 
+            // NOTE: the products p[i - j] * p[j] are non-zero only
+            // for i - j <= order, that is, j >= i - order. If i is even, the
+            // loop below is empty when j_begin == i / 2 (i.e., for i == 0 and
+            // i == 2 * order).
+            const auto j_begin = (i > order) ? i - order : 0u;
+
             if (i % 2u == 0u) {
-                if (i == 0u) {
-                    ret.push_back(p[0] * p[0]);
+                if (j_begin == i / 2u) {
+                    ret.push_back(p[i / 2u] * p[i / 2u]);
                 } else {
-                    for (std::uint32_t j = 0; j <= i / 2u - 1u; ++j) {
+                    for (auto j = j_begin; j <= i / 2u - 1u; ++j) {
                         tmp.push_back(p[i - j] * p[j]);
                     }
 
                     ret.push_back(2_dbl * hy::sum(std::move(tmp)) + p[i / 2u] * p[i / 2u]);
                 }
             } else {
-                for (std::uint32_t j = 0; j <= (i - 1u) / 2u; ++j) {
+                for (auto j = j_begin; j <= (i - 1u) / 2u; ++j) {
                     tmp.push_back(p[i - j] * p[j]);
                 }
 
@@ -208,42 +224,113 @@ void add_poly_ssdiff3_cfunc(hy::llvm_state &s, std::uint32_t order)
 
     // Build the outputs vector as the sum of the squares
     std::vector<hy::expression> out;
-    out.reserve(order + 1u);
-    for (std::uint32_t i = 0; i <= order; ++i) {
+    out.reserve(out_order + 1u);
+    for (std::uint32_t i = 0; i <= out_order; ++i) {
         out.push_back(hy::sum({diff2_x[i], diff2_y[i], diff2_z[i]}));
     }
 
     // Add the compiled function.
-    hy::add_cfunc<double>(s, "ssdiff3_cfunc", out, hy::kw::vars = std::move(vars));
+    hy::add_cfunc<double>(s, name, out, hy::kw::vars = std::move(vars));
+}
+
+// Add a compiled function for the evaluation of the
+// predicates of a screening volume.
+void add_svol_cfunc(hy::llvm_state &s, const std::vector<hy::expression> &preds)
+{
+    std::vector<hy::expression> vars;
+    for (const auto &name : screening_volume::get_variables()) {
+        vars.emplace_back(name);
+    }
+
+    hy::add_cfunc<double>(s, "svol_cfunc", preds, hy::kw::vars = std::move(vars));
 }
 
 } // namespace
 
 } // namespace detail
 
-void sim::add_jit_functions()
+std::uint32_t detail::taylor_order_from_tol(double tol)
 {
-    namespace hy = heyoka;
+    // NOTE: a zero tolerance means that the default
+    // tolerance (i.e., the epsilon of double) is used.
+    if (tol == 0) {
+        tol = std::numeric_limits<double>::epsilon();
+    }
 
-    auto &state = m_data->state;
+    if (!std::isfinite(tol) || tol <= 0) {
+        return 0;
+    }
+
+    // NOTE: this is the formula used in heyoka for the computation
+    // of the order of the Taylor method from the tolerance.
+    const auto order_f = std::ceil(-std::log(tol) / 2 + 1);
+
+    if (!std::isfinite(order_f) || order_f < 2 || order_f > std::numeric_limits<std::uint32_t>::max()) {
+        return 0;
+    }
+
+    return static_cast<std::uint32_t>(order_f);
+}
+
+void detail::add_jit_functions(heyoka::llvm_state &state, heyoka::llvm_state &det_state, std::uint32_t order,
+                               const std::optional<screening_volume> &svol, std::uint32_t det_order)
+{
+    namespace hy = heyoka;
 
     auto *fp_t = hy::detail::to_llvm_type<double>(state.context());
 
-    detail::add_poly_translator_a(state, m_data->s_ta.get_order());
-    detail::add_poly_ssdiff3_cfunc(state, m_data->s_ta.get_order());
-    hy::detail::llvm_add_fex_check(state, fp_t, m_data->s_ta.get_order(), 1);
-    hy::detail::llvm_add_poly_rtscc(state, fp_t, m_data->s_ta.get_order(), 1);
+    add_poly_translator_a(state, order, "pta_cfunc");
+    add_poly_ssdiff3_cfunc(state, order, true, "ssdiff3_cfunc");
+    hy::detail::llvm_add_fex_check(state, fp_t, order, 1);
+    hy::detail::llvm_add_poly_rtscc(state, fp_t, order, 1);
+
+    if (svol) {
+        add_svol_cfunc(state, svol->get_predicates());
+    }
 
     state.optimise();
 
     state.compile();
 
-    m_data->pta_cfunc = reinterpret_cast<decltype(m_data->pta_cfunc)>(state.jit_lookup("pta_cfunc"));
-    m_data->pssdiff3_cfunc = reinterpret_cast<decltype(m_data->pssdiff3_cfunc)>(state.jit_lookup("ssdiff3_cfunc"));
-    m_data->fex_check = reinterpret_cast<decltype(m_data->fex_check)>(state.jit_lookup("fex_check"));
-    m_data->rtscc = reinterpret_cast<decltype(m_data->rtscc)>(state.jit_lookup("poly_rtscc"));
+    if (use_det_order(det_order, order)) {
+        // NOTE: the distance square of the economised polynomials is computed
+        // without truncation, thus root finding operates on polynomials
+        // of degree 2 * det_order.
+        auto *det_fp_t = hy::detail::to_llvm_type<double>(det_state.context());
+
+        add_poly_translator_a(det_state, det_order, "pta_cfunc");
+        add_poly_ssdiff3_cfunc(det_state, det_order, false, "ssdiff3_cfunc");
+        hy::detail::llvm_add_fex_check(det_state, det_fp_t, 2u * det_order, 1);
+        hy::detail::llvm_add_poly_rtscc(det_state, det_fp_t, 2u * det_order, 1);
+
+        det_state.optimise();
+    }
+
+    // NOTE: det_state is compiled even if empty, so that
+    // it can be handled uniformly (e.g., in the serialisation).
+    det_state.compile();
+}
+
+void detail::sim_jit_data::lookup_jit_functions(bool with_svol, bool with_det)
+{
+    pta_cfunc = reinterpret_cast<decltype(pta_cfunc)>(state.jit_lookup("pta_cfunc"));
+    pssdiff3_cfunc = reinterpret_cast<decltype(pssdiff3_cfunc)>(state.jit_lookup("ssdiff3_cfunc"));
+    fex_check = reinterpret_cast<decltype(fex_check)>(state.jit_lookup("fex_check"));
+    rtscc = reinterpret_cast<decltype(rtscc)>(state.jit_lookup("poly_rtscc"));
     // NOTE: this is implicitly added by llvm_add_poly_rtscc().
-    m_data->pt1 = reinterpret_cast<decltype(m_data->pt1)>(state.jit_lookup("poly_translate_1"));
+    pt1 = reinterpret_cast<decltype(pt1)>(state.jit_lookup("poly_translate_1"));
+
+    if (with_svol) {
+        svol_cfunc = reinterpret_cast<decltype(svol_cfunc)>(state.jit_lookup("svol_cfunc"));
+    }
+
+    if (with_det) {
+        det_pta_cfunc = reinterpret_cast<decltype(det_pta_cfunc)>(det_state.jit_lookup("pta_cfunc"));
+        det_pssdiff3_cfunc = reinterpret_cast<decltype(det_pssdiff3_cfunc)>(det_state.jit_lookup("ssdiff3_cfunc"));
+        det_fex_check = reinterpret_cast<decltype(det_fex_check)>(det_state.jit_lookup("fex_check"));
+        det_rtscc = reinterpret_cast<decltype(det_rtscc)>(det_state.jit_lookup("poly_rtscc"));
+        det_pt1 = reinterpret_cast<decltype(det_pt1)>(det_state.jit_lookup("poly_translate_1"));
+    }
 }
 
 } // namespace cascade
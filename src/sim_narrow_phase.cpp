@@ -13,6 +13,7 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <optional>
@@ -22,6 +23,7 @@
 #include <vector>
 
 #include <boost/cstdint.hpp>
+#include <boost/math/constants/constants.hpp>
 #include <boost/math/policies/policy.hpp>
 #include <boost/math/tools/toms748_solve.hpp>
 #include <boost/numeric/conversion/cast.hpp>
@@ -39,6 +41,7 @@
 #include <cascade/sim.hpp>
 
 #include "detail/ival.hpp"
+#include "detail/rel_vel_sieve.hpp"
 
 #if defined(__clang__) || defined(__GNUC__)
 
@@ -107,6 +110,67 @@ auto poly_eval_1(InputIt a, T x, std::uint32_t n)
     return ret1;
 }
 
+// Evaluate the first derivative of a polynomial
+// over an interval. Requires random-access iterator.
+template <typename InputIt>
+ival poly_ieval_1(InputIt a, ival x, std::uint32_t n)
+{
+    assert(n >= 2u); // LCOV_EXCL_LINE
+
+    // Init the return value.
+    auto ret1 = ival(a[n] * n);
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        ret1 = a[n - i] * (n - i) + ret1 * x;
+    }
+
+    return ret1;
+}
+
+// Screening via the economised polynomials.
+//
+// Given the polynomial poly of the given order representing the square
+// of the mutual distance of two particles in the time interval [lb, ub],
+// this function will return false if the polynomial is guaranteed to be not
+// less than thresh2 in [lb, ub], true otherwise. The check is performed via
+// interval arithmetic, bisecting the time interval up to depth times in
+// order to reduce the overestimation of the range of the polynomial.
+// NOTE: nans in the evaluation result in a return value of true.
+bool det_screen(const double *poly, std::uint32_t order, double lb, double ub, double thresh2, unsigned depth)
+{
+    if (poly_eval(poly, ival(lb, ub), order).lower >= thresh2) {
+        return false;
+    }
+
+    if (depth == 0u) {
+        return true;
+    }
+
+    const auto mid = lb + (ub - lb) / 2;
+
+    return det_screen(poly, order, lb, mid, thresh2, depth - 1u)
+           || det_screen(poly, order, mid, ub, thresh2, depth - 1u);
+}
+
+// Upper bound on the rounding error of the translation, via pta_cfunc, of the
+// polynomial p of the given order by the amount delta, for the translated
+// polynomial evaluated in the [0, rf_int] range.
+// NOTE: the translated coefficient of degree k is a sum of the terms
+// binomial(j, k) * p_j * delta**(j - k) for j >= k, thus the error of the
+// translated polynomial in [0, rf_int] is bounded by a small multiple of
+// eps * sum_j |p_j| * (delta + rf_int)**j.
+double translation_err(const double *p, std::uint32_t order, double delta, double rf_int)
+{
+    const auto x = delta + rf_int;
+
+    double ret = 0;
+    for (auto j = order + 1u; j-- > 0u;) {
+        ret = ret * x + std::abs(p[j]);
+    }
+
+    return 4 * (order + 1u) * std::numeric_limits<double>::epsilon() * ret;
+}
+
 // Given an input polynomial a(x), substitute
 // x with x_1 * scal and write to ret the resulting
 // polynomial in the new variable x_1. Requires
@@ -139,6 +203,163 @@ void poly_rescale_p2(OutputIt ret, InputIt a, std::uint32_t n)
     }
 }
 
+// Setup the data for the interpolation of the screening volume predicates.
+// The predicates are interpolated at the order + 1 Chebyshev nodes of
+// the [0, 1] interval, which are written into nodes. The interpolation
+// matrix imat, which maps the values of a predicate at the nodes to the
+// coefficients of the interpolating polynomial in the monomial basis, is
+// also computed. imat is stored in row-major format, with one row per node.
+// ewts is the 2-column row-major matrix mapping the values of a predicate at
+// the nodes to the two highest-order coefficients of the interpolating
+// polynomial in the Chebyshev basis, which are used to estimate
+// the interpolation error.
+void svol_interp_setup(std::uint32_t order, std::vector<double> &nodes, std::vector<double> &imat,
+                       std::vector<double> &ewts)
+{
+    const auto n = static_cast<std::size_t>(order) + 1u;
+
+    // Compute the monomial coefficients of the shifted Chebyshev polynomials
+    // T_m(2s - 1) for m = 0, ..., order via the recurrence
+    // T_{m+1} = (4s - 2) * T_m - T_{m-1}.
+    // NOTE: the coefficients are integers whose magnitude is bounded by 4**order,
+    // thus they are computed exactly in double precision for all the orders
+    // of practical interest.
+    std::vector<double> cheb(n * n, 0.);
+    cheb[0] = 1;
+    if (n > 1u) {
+        cheb[n] = -1;
+        cheb[n + 1u] = 2;
+    }
+    for (std::size_t m = 2; m < n; ++m) {
+        for (std::size_t k = 0; k <= m; ++k) {
+            auto val = -cheb[(m - 2u) * n + k] - 2 * cheb[(m - 1u) * n + k];
+            if (k > 0u) {
+                val += 4 * cheb[(m - 1u) * n + k - 1u];
+            }
+            cheb[m * n + k] = val;
+        }
+    }
+
+    // Compute the nodes and the interpolation matrix.
+    const auto pi = boost::math::constants::pi<double>();
+
+    nodes.resize(n);
+    imat.assign(n * n, 0.);
+    ewts.assign(n * 2u, 0.);
+    for (std::size_t j = 0; j < n; ++j) {
+        const auto theta = pi * (static_cast<double>(j) + 0.5) / static_cast<double>(n);
+
+        nodes[j] = (std::cos(theta) + 1) / 2;
+
+        for (std::size_t m = n - std::min<std::size_t>(n, 2); m < n; ++m) {
+            ewts[j * 2u + (n - 1u - m)]
+                = (m == 0u ? 1. : 2.) / static_cast<double>(n) * std::cos(static_cast<double>(m) * theta);
+        }
+
+        for (std::size_t m = 0; m < n; ++m) {
+            // The contribution of the value at node j to
+            // the m-th Chebyshev coefficient.
+            const auto cm = (m == 0u ? 1. : 2.) / static_cast<double>(n) * std::cos(static_cast<double>(m) * theta);
+
+            for (std::size_t k = 0; k <= m; ++k) {
+                imat[j * n + k] += cm * cheb[m * n + k];
+            }
+        }
+    }
+}
+
+// Compute the polynomials of the screening volume predicates
+// in the [0, rf_int] time interval, via interpolation. prim
+// and sec are the (translated) polynomials of the state of the primary and
+// secondary particles. The coefficients of the predicate polynomials are written
+// into out, and an estimate of the interpolation error of each predicate
+// is written into errs. Returns false if non-finite values are generated.
+template <typename SvolCfunc>
+bool svol_compute_polys(double *out, double *errs, const std::array<const double *, 6> &prim,
+                        const std::array<const double *, 6> &sec, double rf_int, std::uint32_t order,
+                        SvolCfunc *svol_cfunc, std::size_t n_preds, const std::vector<double> &nodes,
+                        const std::vector<double> &imat, const std::vector<double> &ewts, std::vector<double> &input,
+                        std::vector<double> &output, std::vector<double> &vals)
+{
+    const auto n = static_cast<std::size_t>(order) + 1u;
+
+    input.resize(12);
+    output.resize(n_preds);
+    vals.resize(n_preds * n);
+
+    // Evaluate the predicates at the nodes.
+    for (std::size_t j = 0; j < n; ++j) {
+        const auto t = nodes[j] * rf_int;
+
+        for (std::size_t k = 0; k < 6u; ++k) {
+            const auto p_val = poly_eval(prim[k], t, order);
+
+            input[k] = p_val;
+            input[6u + k] = poly_eval(sec[k], t, order) - p_val;
+        }
+
+        svol_cfunc(output.data(), input.data(), nullptr);
+
+        for (std::size_t p = 0; p < n_preds; ++p) {
+            if (!std::isfinite(output[p])) {
+                return false;
+            }
+
+            vals[p * n + j] = output[p];
+        }
+    }
+
+    // Build the interpolating polynomials, and rescale them
+    // so that their variable is the time elapsed from the beginning
+    // of the interval.
+    // NOTE: if rf_int is zero, the interpolating polynomials
+    // are constant and the rescaling zeroes out the higher-order terms.
+    const auto scal = (rf_int == 0) ? 0. : 1 / rf_int;
+    for (std::size_t p = 0; p < n_preds; ++p) {
+        auto *pout = out + p * n;
+
+        // Estimate the interpolation error. For smooth functions, the Chebyshev
+        // coefficients decay quickly and the error of the interpolant is dominated
+        // by the first neglected coefficients. We estimate it (conservatively) as twice
+        // the sum of the magnitudes of the two highest-order coefficients, and we add
+        // an estimate of the rounding error in the evaluation of the interpolant.
+        // NOTE: this is not a rigorous bound, which would require a bound
+        // on the derivatives of the predicates.
+        double c_hi = 0, c_hi1 = 0, max_val = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            const auto val = vals[p * n + j];
+
+            c_hi += val * ewts[j * 2u];
+            c_hi1 += val * ewts[j * 2u + 1u];
+            max_val = std::max(max_val, std::abs(val));
+        }
+        errs[p] = 2 * (std::abs(c_hi) + std::abs(c_hi1))
+                  + static_cast<double>(n) * std::numeric_limits<double>::epsilon() * max_val;
+
+        for (std::size_t k = 0; k < n; ++k) {
+            pout[k] = 0;
+        }
+
+        for (std::size_t j = 0; j < n; ++j) {
+            const auto val = vals[p * n + j];
+
+            for (std::size_t k = 0; k < n; ++k) {
+                pout[k] += val * imat[j * n + k];
+            }
+        }
+
+        poly_rescale(pout, pout, scal, order);
+
+        for (std::size_t k = 0; k < n; ++k) {
+            if (!std::isfinite(pout[k])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 // Find the only existing root for the polynomial poly of the given order
 // existing in [lb, ub).
 template <typename T>
@@ -201,11 +422,13 @@ std::tuple<T, int> bracketed_root_find(const T *poly, std::uint32_t order, T lb,
 }
 
 // Polynomial root finding routine, extracted for re-use.
+// Returns false if some root may have been missed due to
+// failures in the root isolation or in the root finding.
 // NOTE: in the future we can get rid of the DT template parameter
 // if/when we move away from a double-length representation of tcoords.
 template <typename T, typename Isol, typename Wlist, typename FexCheck, typename Rtscc, typename Pt1, typename Pidx,
           typename Logger, typename CollVec, typename DT, typename PWrap, typename RIsoCache>
-void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &isol, Wlist &wlist, FexCheck *fex_check,
+bool run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &isol, Wlist &wlist, FexCheck *fex_check,
                            Rtscc *rtscc, Pt1 *pt1, Pidx pi, Pidx pj, Logger *logger, int direction, CollVec &coll_vec,
                            const DT &lb_rf, PWrap &tmp, PWrap &tmp1, PWrap &tmp2, RIsoCache &r_iso_cache)
 {
@@ -216,11 +439,14 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
     fex_check(poly, &rf_int, &back_flag, &fex_check_res);
 
     if (fex_check_res != 0u) {
-        return;
+        return true;
     }
 
     // Fast exclusion check failed, we need to run the real root isolation algorithm.
 
+    // Flag to signal that some root may have been missed.
+    bool rf_ok = true;
+
     // Clear out the list of isolating intervals.
     isol.clear();
 
@@ -238,6 +464,7 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
             logger->warn("Polynomial root finding produced a non-finite root of {} - "
                          "skipping the collision/conjunction between particles {} and {}",
                          root, pi, pj);
+            rf_ok = false;
             return;
             // LCOV_EXCL_STOP
         }
@@ -255,6 +482,7 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
                              "nonfinite derivative {} - "
                              "skipping the collision/conjunction between particles {} and {}",
                              root, der, pi, pj);
+                rf_ok = false;
                 return;
                 // LCOV_EXCL_STOP
             }
@@ -279,6 +507,7 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
                 logger->warn("Polynomial root finding produced a non-finite collision/conjunction time of {} - "
                              "skipping the collision/conjunction between particles {} and {}",
                              tcoll, pi, pj);
+                rf_ok = false;
                 return;
                 // LCOV_EXCL_STOP
             }
@@ -407,6 +636,8 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
                 // LCOV_EXCL_START
                 // Root finding encountered some issue. Ignore the
                 // root and log the issue.
+                rf_ok = false;
+
                 if (cflag == -1) {
                     logger->warn("Polynomial root finding during collision/conjunction detection failed "
                                  "due to too many iterations");
@@ -419,10 +650,102 @@ void run_poly_root_finding(const T *poly, std::uint32_t order, T rf_int, Isol &i
             }
         }
     }
+
+    return rf_ok && !loop_failed;
 }
 
 } // namespace
 
+// Relative-velocity sieve.
+//
+// Given the (untranslated) position polynomials of two particles i and j,
+// the translation amounts delta_i/delta_j mapping the beginning of the root
+// finding interval into the time coordinates of the polynomials and the size
+// rf_int of the root finding interval, this function will determine
+// a sub-interval [t_lo, t_hi] of [0, rf_int] outside which the mutual distance
+// of the particles is guaranteed to be greater than r. If no such sub-interval
+// exists, an empty optional is returned.
+//
+// The sub-interval is determined from the mutual distances d_begin/d_end at the
+// endpoints of the root finding interval and from an upper bound v_max for the
+// magnitude of the relative velocity (computed via interval arithmetic
+// on the time derivatives of the position polynomials): the mutual distance
+// cannot drop to r before (d_begin - r) / v_max, and it must have stayed above r
+// after rf_int - (d_end - r) / v_max.
+//
+// NOTE: the sieve must be conservative, thus the rounding errors are accounted for
+// by using lower bounds for d_begin/d_end (via translation_err()) and by widening
+// v_max, r and the sub-interval by a small relative amount.
+std::optional<std::pair<double, double>>
+rel_vel_sieve(const std::array<const double *, 3> &pos_i, const std::array<const double *, 3> &pos_j, double delta_i,
+              double delta_j, double rf_int, double r, std::uint32_t order)
+{
+    const auto int_i = ival(delta_i, delta_i + rf_int);
+    const auto int_j = ival(delta_j, delta_j + rf_int);
+
+    // Relative widening accounting for the rounding errors
+    // not covered by translation_err().
+    const auto rel_eps = 8 * (order + 1u) * std::numeric_limits<double>::epsilon();
+
+    double d2_begin = 0, d2_end = 0, v2_max = 0, err2 = 0;
+
+    for (std::size_t k = 0; k < 3u; ++k) {
+        const auto diff_begin = poly_eval(pos_i[k], delta_i, order) - poly_eval(pos_j[k], delta_j, order);
+        const auto diff_end
+            = poly_eval(pos_i[k], delta_i + rf_int, order) - poly_eval(pos_j[k], delta_j + rf_int, order);
+        const auto vrel = poly_ieval_1(pos_i[k], int_i, order) - poly_ieval_1(pos_j[k], int_j, order);
+        const auto vrel_max = std::max(std::abs(vrel.lower), std::abs(vrel.upper));
+
+        // Bound on the error of the components of diff_begin/diff_end.
+        const auto err = translation_err(pos_i[k], order, delta_i, rf_int)
+                         + translation_err(pos_j[k], order, delta_j, rf_int);
+
+        d2_begin += diff_begin * diff_begin;
+        d2_end += diff_end * diff_end;
+        v2_max += vrel_max * vrel_max;
+        err2 += err * err;
+    }
+
+    // NOTE: lower bounds for the distances, upper
+    // bound for the relative velocity.
+    const auto d_err = std::sqrt(err2);
+    const auto d_begin = std::sqrt(d2_begin) * (1 - rel_eps) - d_err;
+    const auto d_end = std::sqrt(d2_end) * (1 - rel_eps) - d_err;
+    const auto v_max = std::sqrt(v2_max) * (1 + rel_eps);
+    r *= 1 + rel_eps;
+
+    if (!std::isfinite(d_begin) || !std::isfinite(d_end) || !std::isfinite(v_max)) {
+        // LCOV_EXCL_START
+        // Cannot sieve, return the full interval and let
+        // the checks in the narrow phase deal with non-finite values.
+        return std::pair{0., rf_int};
+        // LCOV_EXCL_STOP
+    }
+
+    if (v_max == 0) {
+        // No relative motion, the mutual distance is constant.
+        if (d_begin <= r) {
+            return std::pair{0., rf_int};
+        } else {
+            return {};
+        }
+    }
+
+    // NOTE: if the particles are already closer than r at either
+    // endpoint, the corresponding bound is the endpoint itself.
+    // NOTE: the quotients are shrunk and t_hi is rounded up,
+    // so that rounding cannot narrow the sub-interval.
+    const auto t_lo = std::max(0., (d_begin - r) / v_max * (1 - rel_eps));
+    const auto t_hi = std::min(rf_int, std::nextafter(rf_int - (d_end - r) / v_max * (1 - rel_eps),
+                                                      std::numeric_limits<double>::infinity()));
+
+    if (!(t_lo <= t_hi)) {
+        return {};
+    }
+
+    return std::pair{t_lo, t_hi};
+}
+
 } // namespace detail
 
 void sim::sim_data::np_data::pwrap::back_to_cache()
@@ -504,14 +827,22 @@ void sim::narrow_phase_parallel()
 
     // Cache a few bits.
     const auto nchunks = m_data->nchunks;
-    const auto order = m_data->s_ta.get_order();
+    const auto order = m_data->jit->s_ta.get_order();
     const auto &s_data = m_data->s_data;
-    const auto pta_cfunc = m_data->pta_cfunc;
-    const auto pssdiff3_cfunc = m_data->pssdiff3_cfunc;
-    const auto fex_check = m_data->fex_check;
-    const auto rtscc = m_data->rtscc;
-    const auto pt1 = m_data->pt1;
+    const auto pta_cfunc = m_data->jit->pta_cfunc;
+    const auto pssdiff3_cfunc = m_data->jit->pssdiff3_cfunc;
+    const auto fex_check = m_data->jit->fex_check;
+    const auto rtscc = m_data->jit->rtscc;
+    const auto pt1 = m_data->jit->pt1;
+    const auto with_det = with_det_order();
+    const auto det_order = m_det_order;
+    const auto det_pta_cfunc = m_data->jit->det_pta_cfunc;
+    const auto det_pssdiff3_cfunc = m_data->jit->det_pssdiff3_cfunc;
+    const auto det_fex_check = m_data->jit->det_fex_check;
+    const auto det_rtscc = m_data->jit->det_rtscc;
+    const auto det_pt1 = m_data->jit->det_pt1;
     const auto conj_thresh2 = m_conj_thresh * m_conj_thresh;
+    const auto &conj_tiers = m_conj_tiers;
 
     if (!std::isfinite(conj_thresh2)) {
         // LCOV_EXCL_START
@@ -523,6 +854,23 @@ void sim::narrow_phase_parallel()
     // Is conjunction detection activated globally?
     const auto with_conj = (m_conj_thresh != 0);
 
+    // The screening radius for conjunctions (see get_conj_screening_radius()).
+    const auto conj_r = get_conj_screening_radius();
+    const auto conj_r2 = conj_r * conj_r;
+
+    // Setup the screening volume data, if needed.
+    const auto svol_cfunc = m_data->jit->svol_cfunc;
+    const std::size_t n_svol_preds = m_svol ? m_svol->get_predicates().size() : 0u;
+    std::vector<double> svol_nodes, svol_imat, svol_ewts;
+    if (with_conj && m_svol) {
+        assert(svol_cfunc != nullptr);
+
+        detail::svol_interp_setup(order, svol_nodes, svol_imat, svol_ewts);
+    }
+
+    // Is conjunction aggregation active?
+    const auto with_conj_aggr = with_conj && (m_conj_aggr != conj_aggr_mode::none);
+
     // The time coordinate at the beginning of
     // the superstep.
     const auto init_time = m_data->time;
@@ -535,6 +883,17 @@ void sim::narrow_phase_parallel()
     stdex::mdspan sv(std::as_const(m_state)->data(),
                      stdex::extents<size_type, stdex::dynamic_extent, 7u>(get_nparts()));
 
+    // Counters for the relative-velocity sieve: total number
+    // of root finding intervals, number of intervals skipped
+    // and number of intervals shrunk by the sieve.
+    // NOTE: these are used only for logging purposes.
+    std::atomic<size_type> sieve_tot(0), sieve_skip(0), sieve_shrink(0);
+
+    // Counter for the root finding intervals skipped via
+    // the screening with the economised polynomials.
+    // NOTE: this is used only for logging purposes.
+    std::atomic<size_type> det_skip(0);
+
     oneapi::tbb::parallel_for(oneapi::tbb::blocked_range(0u, nchunks), [&](const auto &range) {
         for (auto chunk_idx = range.begin(); chunk_idx != range.end(); ++chunk_idx) {
             // Fetch a reference to the chunk-specific broad
@@ -555,6 +914,11 @@ void sim::narrow_phase_parallel()
             auto &cl_conj_vec = m_data->conj_vecs[chunk_idx];
             cl_conj_vec.clear();
 
+            // Same for the vector of time intervals below the
+            // conjunction threshold.
+            auto &cl_tu_vec = m_data->conj_tu_vecs[chunk_idx];
+            cl_tu_vec.clear();
+
             // The time coordinate, relative to init_time, of
             // the chunk's begin/end.
             const auto [c_begin, c_end] = m_data->get_chunk_begin_end(chunk_idx, m_ct);
@@ -576,6 +940,11 @@ void sim::narrow_phase_parallel()
 
                     using safe_size_t = boost::safe_numerics::safe<decltype(pcaches->diff_input.size())>;
                     assert(pcaches->diff_input.size() == (order + 1u) * safe_size_t(6));
+
+                    if (with_det) {
+                        assert(pcaches->det_diff_input.size() == (det_order + 1u) * safe_size_t(6));
+                        assert(pcaches->det_ss_diff.size() == 2u * det_order + 1u);
+                    }
 #endif
                 } else {
                     SPDLOG_LOGGER_DEBUG(logger, "Creating new local polynomials for narrow phase collision detection");
@@ -589,6 +958,12 @@ void sim::narrow_phase_parallel()
 
                     using safe_size_t = boost::safe_numerics::safe<decltype(pcaches->diff_input.size())>;
                     pcaches->diff_input.resize((order + 1u) * safe_size_t(6));
+
+                    if (with_det) {
+                        pcaches->det_diff_input.resize((det_order + 1u) * safe_size_t(6));
+                        pcaches->det_ss_diff.resize(boost::numeric_cast<decltype(pcaches->det_ss_diff.size())>(
+                            2u * safe_size_t(det_order) + 1u));
+                    }
                 }
 
                 // Cache a few quantities.
@@ -601,9 +976,40 @@ void sim::narrow_phase_parallel()
                 auto &r_iso_cache = pcaches->r_iso_cache;
                 auto &tmp_conj_vec = pcaches->tmp_conj_vec;
                 auto &local_conj_vec = pcaches->local_conj_vec;
+                auto &tu_crossings = pcaches->tu_crossings;
+                auto &local_tu_vec = pcaches->local_tu_vec;
+                auto &svol_input = pcaches->svol_input;
+                auto &svol_output = pcaches->svol_output;
+                auto &svol_vals = pcaches->svol_vals;
+                auto &svol_polys = pcaches->svol_polys;
+                auto &svol_errs = pcaches->svol_errs;
+                auto &svol_crossings = pcaches->svol_crossings;
+                auto &det_diff_input = pcaches->det_diff_input;
+                auto &det_ss_diff = pcaches->det_ss_diff;
+                auto &det_r_iso_cache = pcaches->det_r_iso_cache;
+                auto &det_wlist = pcaches->det_wlist;
+                auto &det_isol = pcaches->det_isol;
+                auto &det_roots = pcaches->det_roots;
+
+                // Helper to check if the secondary is within the screening volume
+                // at the time t, using the predicate polynomials.
+                auto svol_inside = [&](double t) {
+                    for (std::size_t p = 0; p < n_svol_preds; ++p) {
+                        if (!(detail::poly_eval(svol_polys.data() + p * (order + 1u), t, order) < 0)) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                };
 
-                // Prepare the local conjunction vector.
+                // Prepare the local conjunction vectors.
                 local_conj_vec.clear();
+                local_tu_vec.clear();
+
+                // Local counters for the relative-velocity sieve
+                // and for the screening via the economised polynomials.
+                size_type n_sieve_tot = 0, n_sieve_skip = 0, n_sieve_shrink = 0, n_det_skip = 0;
 
                 // NOTE: bracket further so that the pwrap objects
                 // are destroyed *before* pcaches is moved into np_cache.
@@ -616,6 +1022,13 @@ void sim::narrow_phase_parallel()
                     using pwrap = sim_data::np_data::pwrap;
                     pwrap tmp1(r_iso_cache, order), tmp2(r_iso_cache, order), tmp(r_iso_cache, order);
 
+                    // Same for the root finding on the economised polynomials.
+                    // NOTE: if the detection order is not in use, these
+                    // are never used.
+                    const auto det_rf_order = with_det ? 2u * det_order : 0u;
+                    pwrap det_tmp1(det_r_iso_cache, det_rf_order), det_tmp2(det_r_iso_cache, det_rf_order),
+                        det_tmp(det_r_iso_cache, det_rf_order);
+
                     for (const auto &pc : rn) {
                         const auto pi = pc.first;
                         const auto pj = pc.second;
@@ -648,6 +1061,14 @@ void sim::narrow_phase_parallel()
                                             stdex::extents<tc_size_t, stdex::dynamic_extent, 7u, stdex::dynamic_extent>(
                                                 sd_j.tcoords.size(), order + 1u));
 
+                        // Same for the economised polynomials.
+                        // NOTE: these are empty views if the detection order is not in use.
+                        using det_ext_t = stdex::extents<tc_size_t, stdex::dynamic_extent, 3u, stdex::dynamic_extent>;
+                        stdex::mdspan det_tcs_i(sd_i.det_tcs.data(),
+                                                det_ext_t(with_det ? sd_i.tcoords.size() : 0u, det_order + 1u));
+                        stdex::mdspan det_tcs_j(sd_j.det_tcs.data(),
+                                                det_ext_t(with_det ? sd_j.tcoords.size() : 0u, det_order + 1u));
+
                         // Load the particle radiuses.
                         const auto p_rad_i = sv(pi, 6);
                         const auto p_rad_j = sv(pj, 6);
@@ -670,6 +1091,26 @@ void sim::narrow_phase_parallel()
                         auto ss_it_end_j = std::lower_bound(ss_it_begin_j, tcoords_end_j, chunk_end);
                         ss_it_end_j += (ss_it_end_j != tcoords_end_j);
 
+                        // Helper to update the substep iterators.
+                        const auto advance_ss_its = [](auto &it_i, auto &it_j) {
+                            if (*it_i < *it_j) {
+                                // The substep for particle i ends
+                                // before the substep for particle j.
+                                ++it_i;
+                            } else if (*it_j < *it_i) {
+                                // The substep for particle j ends
+                                // before the substep for particle i.
+                                ++it_j;
+                            } else {
+                                // Both substeps end at the same time.
+                                // This happens at the last substeps of a chunk
+                                // or in the very unlikely case in which both
+                                // steps end exactly at the same time.
+                                ++it_i;
+                                ++it_j;
+                            }
+                        };
+
                         // Iterate until we get to the end of at least one range.
                         // NOTE: if either range is empty, this loop is never entered.
                         // This should never happen, but see the comments in
@@ -699,7 +1140,7 @@ void sim::narrow_phase_parallel()
                             // NOTE: at this stage lb_rf/ub_rf are still time coordinates wrt
                             // init_time.
                             // NOTE: min/max fine here, all quantities are safe.
-                            const auto lb_rf = std::max(lb_i, lb_j);
+                            auto lb_rf = std::max(lb_i, lb_j);
                             const auto ub_rf = std::min(ub_i, ub_j);
 
                             // The Taylor polynomials for the two particles are time polynomials
@@ -709,11 +1150,11 @@ void sim::narrow_phase_parallel()
                             // common time coordinate, the time elapsed from lb_rf.
 
                             // Compute the translation amount for the two particles.
-                            const auto delta_i = static_cast<double>(lb_rf - ss_start_i);
-                            const auto delta_j = static_cast<double>(lb_rf - ss_start_j);
+                            auto delta_i = static_cast<double>(lb_rf - ss_start_i);
+                            auto delta_j = static_cast<double>(lb_rf - ss_start_j);
 
                             // Compute the time interval within which we will be performing root finding.
-                            const auto rf_int = static_cast<double>(ub_rf - lb_rf);
+                            auto rf_int = static_cast<double>(ub_rf - lb_rf);
 
                             // Do some checking before moving on.
                             if (!std::isfinite(delta_i) || !std::isfinite(delta_j) || !std::isfinite(rf_int)
@@ -755,6 +1196,155 @@ void sim::narrow_phase_parallel()
                             const auto *poly_vyj = pij_conj_active ? &tcs_j(ss_idx_j, 4, 0) : nullptr;
                             const auto *poly_vzj = pij_conj_active ? &tcs_j(ss_idx_j, 5, 0) : nullptr;
 
+                            // Run the relative-velocity sieve in order to restrict
+                            // root finding to the portion of the time interval
+                            // in which the particles can be closer than the largest
+                            // distance of interest (i.e., the sum of the radiuses
+                            // for collisions, the conjunction threshold for conjunctions).
+                            ++n_sieve_tot;
+                            const auto sieve_r = std::max((pi_coll_active || pj_coll_active) ? p_rad_i + p_rad_j : 0.,
+                                                          pij_conj_active ? conj_r : 0.);
+                            const auto sieve_res = detail::rel_vel_sieve({poly_xi, poly_yi, poly_zi},
+                                                                         {poly_xj, poly_yj, poly_zj}, delta_i, delta_j,
+                                                                         rf_int, sieve_r, order);
+
+                            if (!sieve_res) {
+                                // The particles cannot get close enough
+                                // in the current time interval, move on.
+                                ++n_sieve_skip;
+                                advance_ss_its(it_i, it_j);
+
+                                continue;
+                            }
+
+                            if (const auto [t_lo, t_hi] = *sieve_res; t_lo != 0 || t_hi != rf_int) {
+                                // Shrink the root finding interval.
+                                ++n_sieve_shrink;
+
+                                delta_i += t_lo;
+                                delta_j += t_lo;
+                                lb_rf = lb_rf + dfloat(t_lo);
+                                rf_int = t_hi - t_lo;
+                            }
+
+                            // Determine whether or not collisions and conjunctions
+                            // need to be checked in the current time interval.
+                            auto coll_check = pi_coll_active || pj_coll_active;
+                            auto conj_check = pij_conj_active;
+
+                            if (with_det) {
+                                // Run the narrow phase on the economised polynomials. The polynomial
+                                // of the distance square is computed exactly (i.e., without truncation)
+                                // from the economised polynomials, and the distance computed via the
+                                // economised polynomials differs from the distance computed via the
+                                // Taylor polynomials by at most det_err. Thus, in the time ranges in which
+                                // the distance computed via the economised polynomials is not less than
+                                // r + det_err, the particles cannot get closer than r.
+                                // NOTE: det_err includes the economisation error of both particles
+                                // and the rounding errors of the translation of the economised polynomials.
+                                auto det_err = sd_i.det_err[ss_idx_i] + sd_j.det_err[ss_idx_j];
+
+                                // Translate the economised polynomials
+                                // directly into det_diff_input.
+                                using ddi_size_t = decltype(det_diff_input.size());
+                                std::array<double, 2> tr_err{};
+                                for (auto k = 0u; k < 3u; ++k) {
+                                    det_pta_cfunc(det_diff_input.data() + static_cast<ddi_size_t>(k) * (det_order + 1u),
+                                                  &det_tcs_i(ss_idx_i, k, 0), &delta_i);
+                                    det_pta_cfunc(det_diff_input.data()
+                                                      + static_cast<ddi_size_t>(3u + k) * (det_order + 1u),
+                                                  &det_tcs_j(ss_idx_j, k, 0), &delta_j);
+
+                                    tr_err[0] += detail::translation_err(&det_tcs_i(ss_idx_i, k, 0), det_order,
+                                                                         delta_i, rf_int);
+                                    tr_err[1] += detail::translation_err(&det_tcs_j(ss_idx_j, k, 0), det_order,
+                                                                         delta_j, rf_int);
+                                }
+                                det_err += tr_err[0] + tr_err[1];
+
+                                det_pssdiff3_cfunc(det_ss_diff.data(), det_diff_input.data(), nullptr);
+
+                                // Quick check via interval arithmetic.
+                                auto det_check = [&](double r) {
+                                    const auto thresh = r + det_err;
+
+                                    return detail::det_screen(det_ss_diff.data(), det_rf_order, 0., rf_int,
+                                                              thresh * thresh, 3);
+                                };
+
+                                coll_check = coll_check && det_check(p_rad_i + p_rad_j);
+                                conj_check = conj_check && det_check(conj_r);
+
+                                if (!coll_check && !conj_check) {
+                                    // The particles cannot get close enough
+                                    // in the current time interval, move on.
+                                    ++n_det_skip;
+                                    advance_ss_its(it_i, it_j);
+
+                                    continue;
+                                }
+
+                                // Locate, via root finding on the economised polynomials, the
+                                // time range in which the particles can get closer than the largest
+                                // distance of interest, and restrict the root finding on the Taylor
+                                // polynomials to that range.
+                                const auto det_r = std::max(coll_check ? p_rad_i + p_rad_j : 0.,
+                                                            conj_check ? conj_r : 0.)
+                                                   + det_err;
+                                det_ss_diff[0] -= det_r * det_r;
+
+                                det_roots.clear();
+                                const auto det_rf_ok = detail::run_poly_root_finding(
+                                    det_ss_diff.data(), det_rf_order, rf_int, det_isol, det_wlist, det_fex_check,
+                                    det_rtscc, det_pt1, pi, pj, logger, 0, det_roots, dfloat(0.), det_tmp, det_tmp1,
+                                    det_tmp2, det_r_iso_cache);
+
+                                // NOTE: if the root finding failed, we cannot restrict
+                                // the time range and we move on with the full interval.
+                                if (det_rf_ok) {
+                                    // Sort the roots and determine the first and last
+                                    // sub-intervals in which the polynomial is negative.
+                                    std::sort(det_roots.begin(), det_roots.end(),
+                                              [](const auto &r1, const auto &r2) {
+                                                  return std::get<2>(r1) < std::get<2>(r2);
+                                              });
+
+                                    std::optional<double> t_lo;
+                                    double t_hi = 0;
+                                    for (decltype(det_roots.size()) k = 0; k <= det_roots.size(); ++k) {
+                                        const auto t_a = (k == 0u) ? 0. : std::get<2>(det_roots[k - 1u]);
+                                        const auto t_b = (k == det_roots.size()) ? rf_int : std::get<2>(det_roots[k]);
+
+                                        // NOTE: evaluate also on empty sub-intervals, which
+                                        // may result from roots at the boundaries.
+                                        if (!(detail::poly_eval(det_ss_diff.data(), (t_a + t_b) / 2, det_rf_order)
+                                              >= 0)) {
+                                            if (!t_lo) {
+                                                t_lo = t_a;
+                                            }
+                                            t_hi = t_b;
+                                        }
+                                    }
+
+                                    if (!t_lo) {
+                                        // The particles cannot get close enough
+                                        // in the current time interval, move on.
+                                        ++n_det_skip;
+                                        advance_ss_its(it_i, it_j);
+
+                                        continue;
+                                    }
+
+                                    if (*t_lo != 0 || t_hi != rf_int) {
+                                        // Shrink the root finding interval.
+                                        delta_i += *t_lo;
+                                        delta_j += *t_lo;
+                                        lb_rf = lb_rf + dfloat(*t_lo);
+                                        rf_int = t_hi - *t_lo;
+                                    }
+                                }
+                            }
+
                             // Perform the translations, if needed.
                             // NOTE: perhaps we can write a dedicated function
                             // that does the translation for all 3 coordinates/velocities
@@ -770,7 +1360,7 @@ void sim::narrow_phase_parallel()
                                 pta_cfunc(zi_temp.data(), poly_zi, &delta_i);
                                 poly_zi = zi_temp.data();
 
-                                if (pij_conj_active) {
+                                if (conj_check) {
                                     pta_cfunc(vxi_temp.data(), poly_vxi, &delta_i);
                                     poly_vxi = vxi_temp.data();
                                     pta_cfunc(vyi_temp.data(), poly_vyi, &delta_i);
@@ -788,7 +1378,7 @@ void sim::narrow_phase_parallel()
                                 pta_cfunc(zj_temp.data(), poly_zj, &delta_j);
                                 poly_zj = zj_temp.data();
 
-                                if (pij_conj_active) {
+                                if (conj_check) {
                                     pta_cfunc(vxj_temp.data(), poly_vxj, &delta_j);
                                     poly_vxj = vxj_temp.data();
                                     pta_cfunc(vyj_temp.data(), poly_vyj, &delta_j);
@@ -820,7 +1410,7 @@ void sim::narrow_phase_parallel()
                             const auto orig_const_cf = ss_diff_ptr[0];
 
                             // Step 1: detect physical collision, if needed.
-                            if (pi_coll_active || pj_coll_active) {
+                            if (coll_check) {
                                 // Modify the constant term of the polynomial to account for
                                 // particle sizes.
                                 ss_diff_ptr[0] -= (p_rad_i + p_rad_j) * (p_rad_i + p_rad_j);
@@ -832,7 +1422,7 @@ void sim::narrow_phase_parallel()
                             }
 
                             // Step 2: do conjunction tracking, if needed.
-                            if (pij_conj_active) {
+                            if (conj_check) {
                                 // Restore the original constant term of the polynomial,
                                 // which might have been modified by phyisical collision
                                 // detection.
@@ -851,10 +1441,139 @@ void sim::narrow_phase_parallel()
                                     // LCOV_EXCL_STOP
                                 }
 
-                                if (dist2_ieval.lower < conj_thresh2) {
-                                    // The mutual distance between the particles might end up being
-                                    // less than the conjunction threshold during the current time interval.
-                                    // This means that a conjunction *may* happen.
+                                // The mutual distance between the particles might end up being
+                                // less than the screening radius during the current time interval.
+                                // This means that a conjunction *may* happen.
+                                auto conj_possible = dist2_ieval.lower < conj_r2;
+
+                                // If a screening volume is defined, determine the primary
+                                // particle of the pair (i.e., the particle on which the
+                                // screening volume is centred): if only one particle
+                                // is in the conjunction whitelist, that is the primary,
+                                // otherwise the primary is the particle with the lower index.
+                                const auto svol_prim_i = pi_conj_active && (!pj_conj_active || pi < pj);
+
+                                if (conj_possible && m_svol) {
+                                    // Compute the polynomials of the screening volume predicates.
+                                    svol_polys.resize(n_svol_preds * (order + 1u));
+                                    svol_errs.resize(n_svol_preds);
+
+                                    const std::array<const double *, 6> st_i
+                                        = {poly_xi, poly_yi, poly_zi, poly_vxi, poly_vyi, poly_vzi};
+                                    const std::array<const double *, 6> st_j
+                                        = {poly_xj, poly_yj, poly_zj, poly_vxj, poly_vyj, poly_vzj};
+
+                                    if (!detail::svol_compute_polys(
+                                            svol_polys.data(), svol_errs.data(), svol_prim_i ? st_i : st_j,
+                                            svol_prim_i ? st_j : st_i, rf_int, order, svol_cfunc, n_svol_preds,
+                                            svol_nodes, svol_imat, svol_ewts, svol_input, svol_output, svol_vals)) {
+                                        // LCOV_EXCL_START
+                                        logger->warn("Non-finite value(s) detected during the evaluation of the "
+                                                     "screening volume for particles {} and {} - the conjunction "
+                                                     "will not be tracked",
+                                                     pi, pj);
+
+                                        break;
+                                        // LCOV_EXCL_STOP
+                                    }
+
+                                    // The secondary can be within the screening volume
+                                    // only if all predicates can be negative. The interval
+                                    // bound of the interpolating polynomials is enlarged
+                                    // by the estimate of the interpolation error.
+                                    for (std::size_t p = 0; conj_possible && p < n_svol_preds; ++p) {
+                                        conj_possible
+                                            = detail::poly_eval(svol_polys.data() + p * (order + 1u),
+                                                                detail::ival(0, rf_int), order)
+                                                  .lower
+                                              < svol_errs[p];
+                                    }
+
+                                    if (conj_possible) {
+                                        // Locate the crossings of the boundaries of the screening
+                                        // volume. They are needed to detect the conjunctions
+                                        // happening on the boundary of the volume and, in aggregation
+                                        // mode, to compute the time spent within the volume.
+                                        svol_crossings.clear();
+
+                                        for (std::size_t p = 0; p < n_svol_preds; ++p) {
+                                            tmp_conj_vec.clear();
+                                            detail::run_poly_root_finding(
+                                                svol_polys.data() + p * (order + 1u), order, rf_int, isol, wlist,
+                                                fex_check, rtscc, pt1, pi, pj, logger, 0, tmp_conj_vec, dfloat(0.),
+                                                tmp, tmp1, tmp2, r_iso_cache);
+
+                                            for (const auto &[_1, _2, cr_tm] : tmp_conj_vec) {
+                                                svol_crossings.push_back(cr_tm);
+                                            }
+                                        }
+
+                                        std::sort(svol_crossings.begin(), svol_crossings.end());
+                                    }
+                                }
+
+                                if (conj_possible) {
+
+                                    if (with_conj_aggr) {
+                                        // In aggregation mode, we also need to determine the time
+                                        // spent by the particles below the threshold of each
+                                        // conjunction tier.
+                                        for (decltype(conj_tiers.size()) tier = 0; tier < conj_tiers.size();
+                                             ++tier) {
+                                            const auto tier_thresh2 = conj_tiers[tier] * conj_tiers[tier];
+
+                                            if (!(dist2_ieval.lower < tier_thresh2)) {
+                                                // The particles cannot get below the
+                                                // threshold of the current tier.
+                                                continue;
+                                            }
+
+                                            // Locate the threshold crossings via root finding.
+                                            ss_diff_ptr[0] = orig_const_cf - tier_thresh2;
+
+                                            tmp_conj_vec.clear();
+                                            detail::run_poly_root_finding(ss_diff_ptr, order, rf_int, isol, wlist,
+                                                                          fex_check, rtscc, pt1, pi, pj, logger, 0,
+                                                                          tmp_conj_vec, dfloat(0.), tmp, tmp1, tmp2,
+                                                                          r_iso_cache);
+
+                                            // Build the sorted list of crossings, including
+                                            // the boundaries of the root finding interval.
+                                            tu_crossings.clear();
+                                            tu_crossings.push_back(0.);
+                                            for (const auto &[_1, _2, cr_tm] : tmp_conj_vec) {
+                                                tu_crossings.push_back(cr_tm);
+                                            }
+                                            tu_crossings.insert(tu_crossings.end(), svol_crossings.begin(),
+                                                                svol_crossings.end());
+                                            tu_crossings.push_back(rf_int);
+                                            std::sort(tu_crossings.begin(), tu_crossings.end());
+
+                                            // Record the time intervals between consecutive crossings
+                                            // in which the particles are below the threshold (and
+                                            // within the screening volume, if needed).
+                                            // NOTE: we determine this by evaluating the polynomial
+                                            // in the middle of each interval, rather than by relying
+                                            // on the direction of the crossings, for robustness
+                                            // against tangencies and roots at the boundaries.
+                                            for (decltype(tu_crossings.size()) k = 1; k < tu_crossings.size(); ++k) {
+                                                const auto t_a = tu_crossings[k - 1u];
+                                                const auto t_b = tu_crossings[k];
+
+                                                const auto t_mid = (t_a + t_b) / 2;
+
+                                                if (t_b > t_a && detail::poly_eval(ss_diff_ptr, t_mid, order) < 0
+                                                    && (!m_svol || svol_inside(t_mid))) {
+                                                    local_tu_vec.emplace_back(pi, pj, tier,
+                                                                              static_cast<double>(lb_rf + t_a),
+                                                                              static_cast<double>(lb_rf + t_b));
+                                                }
+                                            }
+                                        }
+
+                                        // Restore the original constant term.
+                                        ss_diff_ptr[0] = orig_const_cf;
+                                    }
 
                                     // Compute the time derivative of the dist2 poly.
                                     auto *ss_diff_der_ptr = ss_diff_der.data();
@@ -878,12 +1597,51 @@ void sim::narrow_phase_parallel()
                                         // rather than wrt the beginning of the superstep.
                                         dfloat(0.), tmp, tmp1, tmp2, r_iso_cache);
 
+                                    // NOTE: with a screening volume, a conjunction is the closest
+                                    // approach while the secondary is within the volume. Thus, in addition
+                                    // to the distance minima found above, a conjunction happens when the
+                                    // secondary enters the volume while the distance is increasing, or
+                                    // when it exits the volume while the distance is decreasing. These
+                                    // conjunctions are appended to tmp_conj_vec after the distance minima.
+                                    const auto n_dist_min = tmp_conj_vec.size();
+
+                                    for (decltype(svol_crossings.size()) k = 0; k < svol_crossings.size();
+                                         ++k) {
+                                        const auto cr_tm = svol_crossings[k];
+                                        const auto t_prev = (k == 0u) ? 0. : svol_crossings[k - 1u];
+                                        const auto t_next
+                                            = (k + 1u == svol_crossings.size()) ? rf_int : svol_crossings[k + 1u];
+
+                                        if (k > 0u && cr_tm == t_prev) {
+                                            // Skip simultaneous crossings of multiple predicates.
+                                            continue;
+                                        }
+
+                                        // Determine if the secondary is within the volume
+                                        // before and after the crossing.
+                                        const auto in_before = cr_tm > 0 && svol_inside((t_prev + cr_tm) / 2);
+                                        const auto in_after = cr_tm < rf_int && svol_inside((cr_tm + t_next) / 2);
+
+                                        if (in_before == in_after) {
+                                            // Not a crossing of the boundary of the volume.
+                                            continue;
+                                        }
+
+                                        const auto der = detail::poly_eval(ss_diff_der_ptr, cr_tm, order);
+
+                                        if (in_after ? der > 0 : der < 0) {
+                                            tmp_conj_vec.emplace_back(pi, pj, cr_tm);
+                                        }
+                                    }
+
                                     // For each detected conjunction, we need to:
                                     // - verify that indeed the conjunction happens below
                                     //   the threshold,
                                     // - compute the conjunction distance and absolute
                                     //   time coordinate.
-                                    for (const auto &[_1, _2, conj_tm] : tmp_conj_vec) {
+                                    for (decltype(tmp_conj_vec.size()) cidx = 0; cidx < tmp_conj_vec.size(); ++cidx) {
+                                        const auto &[_1, _2, conj_tm] = tmp_conj_vec[cidx];
+
                                         assert(_1 == pi);
                                         assert(_2 == pj);
 
@@ -918,11 +1676,57 @@ void sim::narrow_phase_parallel()
                                                    detail::poly_eval(poly_vyj, conj_tm, order),
                                                    detail::poly_eval(poly_vzj, conj_tm, order)};
 
+                                            // If a screening volume is defined, check that
+                                            // the secondary is within the volume at the time of closest
+                                            // approach. The predicates are evaluated with the exact state
+                                            // vectors, rather than with their interpolating polynomials.
+                                            // NOTE: the conjunctions on the boundary of the volume
+                                            // are not checked, as they are within the volume by construction.
+                                            if (m_svol && cidx < n_dist_min) {
+                                                const auto &prim_state = svol_prim_i ? pi_state : pj_state;
+                                                const auto &sec_state = svol_prim_i ? pj_state : pi_state;
+
+                                                svol_input.resize(12);
+                                                svol_output.resize(n_svol_preds);
+                                                for (std::size_t k = 0; k < 6u; ++k) {
+                                                    svol_input[k] = prim_state[k];
+                                                    svol_input[6u + k] = sec_state[k] - prim_state[k];
+                                                }
+
+                                                svol_cfunc(svol_output.data(), svol_input.data(), nullptr);
+
+                                                if (!std::all_of(svol_output.begin(), svol_output.end(),
+                                                                 [](double v) { return v < 0; })) {
+                                                    SPDLOG_LOGGER_DEBUG(logger,
+                                                                        "Conjunction ignored because the secondary is "
+                                                                        "outside the screening volume");
+                                                    continue;
+                                                }
+                                            }
+
+                                            // NOTE: conj_dist2 is finite but it could still
+                                            // be negative due to floating-point rounding
+                                            // (e.g., zero-distance conjunctions). Ensure
+                                            // we do not produce NaN here.
+                                            const auto conj_dist = std::sqrt(std::max(conj_dist2, 0.));
+
+                                            // Determine the conjunction tier.
+                                            // NOTE: clamp to the last tier in order to guard
+                                            // against rounding in the computation of conj_dist.
+                                            const auto tier = std::min(
+                                                static_cast<size_type>(
+                                                    std::upper_bound(conj_tiers.begin(), conj_tiers.end(), conj_dist)
+                                                    - conj_tiers.begin()),
+                                                static_cast<size_type>(conj_tiers.size() - 1u));
+
                                             local_conj_vec.emplace_back(
 #if defined(__clang__)
                                                 conjunction {
 #endif
                                                     pi, pj,
+                                                        // NOTE: the particle ids are assigned
+                                                        // later in append_conj_data().
+                                                        std::uint64_t(0), std::uint64_t(0),
                                                         // NOTE: we want to store here the absolute
                                                         // time coordinate of the conjunction. conj_tm
                                                         // is a time coordinate relative to the root
@@ -930,11 +1734,7 @@ void sim::narrow_phase_parallel()
                                                         // to the beginning of the superstep, and then,
                                                         // finally to the absolute time coordinate.
                                                         static_cast<double>(init_time + (lb_rf + conj_tm)),
-                                                        // NOTE: conj_dist2 is finite but it could still
-                                                        // be negative due to floating-point rounding
-                                                        // (e.g., zero-distance conjunctions). Ensure
-                                                        // we do not produce NaN here.
-                                                        std::sqrt(std::max(conj_dist2, 0.)), pi_state, pj_state
+                                                        conj_dist, pi_state, pj_state, tier
 #if defined(__clang__)
                                                 }
 #endif
@@ -948,22 +1748,7 @@ void sim::narrow_phase_parallel()
                             }
 
                             // Update the substep iterators.
-                            if (*it_i < *it_j) {
-                                // The substep for particle i ends
-                                // before the substep for particle j.
-                                ++it_i;
-                            } else if (*it_j < *it_i) {
-                                // The substep for particle j ends
-                                // before the substep for particle i.
-                                ++it_j;
-                            } else {
-                                // Both substeps end at the same time.
-                                // This happens at the last substeps of a chunk
-                                // or in the very unlikely case in which both
-                                // steps end exactly at the same time.
-                                ++it_i;
-                                ++it_j;
-                            }
+                            advance_ss_its(it_i, it_j);
                         }
                     }
                 }
@@ -973,6 +1758,17 @@ void sim::narrow_phase_parallel()
                     cl_conj_vec.grow_by(local_conj_vec.begin(), local_conj_vec.end());
                 }
 
+                // Same for the time intervals below the conjunction threshold.
+                if (with_conj_aggr) {
+                    cl_tu_vec.grow_by(local_tu_vec.begin(), local_tu_vec.end());
+                }
+
+                // Update the global sieve counters.
+                sieve_tot.fetch_add(n_sieve_tot, std::memory_order::relaxed);
+                sieve_skip.fetch_add(n_sieve_skip, std::memory_order::relaxed);
+                sieve_shrink.fetch_add(n_sieve_shrink, std::memory_order::relaxed);
+                det_skip.fetch_add(n_det_skip, std::memory_order::relaxed);
+
                 // Put the polynomials back into the caches.
                 np_cache.push(std::move(pcaches));
             });
@@ -996,18 +1792,16 @@ void sim::narrow_phase_parallel()
         const auto n_new_conj = std::accumulate(m_data->conj_vecs.begin(), m_data->conj_vecs.end(), safe_size_t(0),
                                                 [](const auto &acc, const auto &cur) { return acc + cur.size(); });
 
-        // Do we have enough storage in m_det_conj to store the new conjunctions?
-        if (m_det_conj->size() + n_new_conj > m_det_conj->capacity()) {
-            // m_det_conj cannot store the new conjunctions without reallocating.
-            // We thus prepare a new vector with twice the needed capacity.
-            std::vector<conjunction> new_det_conj;
-            new_det_conj.reserve(2u * (m_det_conj->size() + n_new_conj));
+        // NOTE: in aggregation mode, the new conjunctions are not appended
+        // directly to m_det_conj, and the preparation of m_det_conj
+        // is performed in conj_aggr_prepare() instead.
+        if (!with_conj_aggr) {
+            reserve_conj_data(n_new_conj);
 
-            // Copy over the existing conjunctions.
-            new_det_conj.insert(new_det_conj.end(), m_det_conj->begin(), m_det_conj->end());
-
-            // Assign the new conjunction vector.
-            m_det_conj = std::make_shared<std::vector<conjunction>>(std::move(new_det_conj));
+            // Prepare also the buffer of chunk offsets used in append_conj_data().
+            // NOTE: the offsets are prefix sums of the chunk sizes, which cannot
+            // overflow thanks to the computation of n_new_conj and to reserve_conj_data().
+            m_data->conj_offsets.resize(m_data->conj_vecs.size() + 1u);
         }
 
         // Set the logging variable.
@@ -1016,6 +1810,12 @@ void sim::narrow_phase_parallel()
 
     logger->trace("Narrow phase collision detection time: {}s", sw);
     logger->trace("Total number of collisions detected: {}", m_data->coll_vec.size());
+    logger->trace("Relative-velocity sieve: {} root finding intervals, {} skipped, {} shrunk", sieve_tot.load(),
+                  sieve_skip.load(), sieve_shrink.load());
+
+    if (with_det) {
+        logger->trace("Detection order screening: {} root finding intervals skipped", det_skip.load());
+    }
 
     if (n_det_conjs) {
         logger->trace("Total number of conjunctions detected: {}", *n_det_conjs);
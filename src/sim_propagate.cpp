@@ -11,14 +11,20 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <exception>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/safe_numerics/safe_integer.hpp>
@@ -35,11 +41,16 @@
 #include <heyoka/detail/dfloat.hpp>
 #include <heyoka/taylor.hpp>
 
+#include <cascade/checkpointer.hpp>
+#include <cascade/conj_sink.hpp>
 #include <cascade/detail/atomic_utils.hpp>
 #include <cascade/detail/logging_impl.hpp>
 #include <cascade/detail/sim_data.hpp>
+#include <cascade/ephemeris.hpp>
 #include <cascade/sim.hpp>
+#include <cascade/snapshot_writer.hpp>
 
+#include "detail/cheby.hpp"
 #include "detail/ival.hpp"
 
 #if defined(__clang__) || defined(__GNUC__)
@@ -253,10 +264,10 @@ void sim::compute_particle_aabb(unsigned chunk_idx, const T &chunk_begin, const
     }
 
     // Compute the conjunction radius.
-    const auto conj_radius = m_conj_thresh / 2;
+    const auto conj_radius = get_conj_screening_radius() / 2;
 
     // Cache a few quantities.
-    const auto order = m_data->s_ta.get_order();
+    const auto order = m_data->jit->s_ta.get_order();
     const auto &s_data = m_data->s_data;
     const auto &cur_sd = s_data[pidx];
     const auto &tcoords = cur_sd.tcoords;
@@ -350,6 +361,33 @@ void sim::compute_particle_aabb(unsigned chunk_idx, const T &chunk_begin, const
 
         std::array xyzr_int{horner_eval(tc_ptr_x), horner_eval(tc_ptr_y), horner_eval(tc_ptr_z), horner_eval(tc_ptr_r)};
 
+        // Tighten the enclosures via the Chebyshev bounds. The Taylor polynomials
+        // are converted exactly into Chebyshev series over the evaluation interval,
+        // whose ranges are enclosed by c_0 +- sum_{k>0} |c_k|. Both enclosures
+        // are valid, thus we can take their intersection.
+        // NOTE: interval Horner evaluation overestimates the range of the
+        // polynomials when the evaluation interval does not begin at zero
+        // (i.e., when the substep begins before the chunk), which is where the
+        // Chebyshev bounds help the most.
+        // NOTE: the conversion is skipped for (unrealistically) high orders,
+        // in order to avoid allocating memory.
+        if (order < detail::cheby_max_n) {
+            std::array<double, detail::cheby_max_n> cheby_buf{};
+            const std::array tc_ptrs{tc_ptr_x, tc_ptr_y, tc_ptr_z, tc_ptr_r};
+
+            for (auto i = 0u; i < 4u; ++i) {
+                detail::taylor_to_cheby(tc_ptrs[i], order, h_int_lb, h_int_ub, cheby_buf.data());
+                const auto cb = detail::cheby_bound(cheby_buf.data(), order + 1u);
+
+                // NOTE: guard against empty intersections
+                // due to floating-point rounding.
+                if (cb.lower <= xyzr_int[i].upper && cb.upper >= xyzr_int[i].lower) {
+                    xyzr_int[i].lower = std::max(xyzr_int[i].lower, cb.lower);
+                    xyzr_int[i].upper = std::min(xyzr_int[i].upper, cb.upper);
+                }
+            }
+        }
+
         // Adjust the intervals accounting for the particle radius and/or conjunction tracking.
         for (auto &val : xyzr_int) {
             // NOTE: std::max() here is safe, as both p_radius and conj_radius have
@@ -394,6 +432,60 @@ void sim::compute_particle_aabb(unsigned chunk_idx, const T &chunk_begin, const
     }
 }
 
+// Compute the economised polynomials of the positions of the particle at index pidx
+// for all the substeps of the superstep. The economised polynomials have
+// degree m_det_order, and they are used in the narrow phase to screen the pairs
+// of particles which may be involved in collisions/conjunctions before running
+// root finding on the Taylor polynomials (see narrow_phase_parallel()).
+// work is a scratch buffer, which is resized as needed.
+void sim::compute_det_tcs(size_type pidx, std::vector<double> &work)
+{
+    using dfloat = heyoka::detail::dfloat<double>;
+    namespace stdex = std::experimental;
+
+    assert(with_det_order());
+
+    const auto order = m_data->jit->s_ta.get_order();
+    const auto det_order = m_det_order;
+
+    auto &cur_sd = m_data->s_data[pidx];
+    const auto &tcoords = cur_sd.tcoords;
+    const auto nsteps = tcoords.size();
+
+    // Prepare the output buffers.
+    // NOTE: the size of tcs is 7 * (order + 1) * nsteps,
+    // thus the size of det_tcs can be computed safely.
+    using tc_size_t = decltype(cur_sd.det_tcs.size());
+    cur_sd.det_tcs.resize(static_cast<tc_size_t>(nsteps * 3u * (det_order + 1u)));
+    cur_sd.det_err.resize(boost::numeric_cast<decltype(cur_sd.det_err.size())>(nsteps));
+
+    // Views for reading from tcs and writing into det_tcs.
+    stdex::mdspan tcs(std::as_const(cur_sd.tcs).data(),
+                      stdex::extents<tc_size_t, stdex::dynamic_extent, 7u, stdex::dynamic_extent>(nsteps, order + 1u));
+    stdex::mdspan det_tcs(cur_sd.det_tcs.data(), stdex::extents<tc_size_t, stdex::dynamic_extent, 3u,
+                                                                stdex::dynamic_extent>(nsteps, det_order + 1u));
+
+    // Prepare the work buffer for taylor_economise().
+    work.resize(static_cast<std::vector<double>::size_type>(3) * (order + 1u));
+
+    for (decltype(tcoords.size()) ss_idx = 0; ss_idx < nsteps; ++ss_idx) {
+        // The size of the substep.
+        const auto h = static_cast<double>(tcoords[ss_idx] - (ss_idx == 0u ? dfloat(0) : tcoords[ss_idx - 1u]));
+
+        // Economise x, y and z and combine the error bounds.
+        double err2 = 0;
+        for (auto cidx = 0u; cidx < 3u; ++cidx) {
+            const auto err = detail::taylor_economise(&tcs(ss_idx, cidx, 0), order, det_order, h,
+                                                      &det_tcs(ss_idx, cidx, 0), work.data());
+            err2 += err * err;
+        }
+
+        // NOTE: if err2 overflows, det_err will be +inf, which
+        // disables the screening for the current substep.
+        cur_sd.det_err[ss_idx] = std::sqrt(err2);
+    }
+}
+
 // Perform the Morton encoding of the centres of the AABBs of the particles
 // and sort the AABB data according to the codes.
 void sim::morton_encode_sort_parallel()
@@ -510,10 +602,29 @@ void sim::morton_encode_sort_parallel()
     logger->trace("Morton encoding and sorting time: {}s", sw);
 }
 
+// Take a step, invoking the output components at the end.
+// NOTE: the output components are not invoked if a non-finite
+// state is detected, as the sim is left unchanged in that case.
+outcome sim::step()
+{
+    const auto init_time = m_data->time;
+
+    const auto oc = step_impl();
+
+    if (oc != outcome::err_nf_state) {
+        run_outputs(init_time);
+    }
+
+    return oc;
+}
+
+// Take a step without invoking the output components.
 // NOTE: exception-wise: no user-visible data is altered
 // until the end of the function, at which point the new
-// sim data is set up in a noexcept manner.
-outcome sim::step()
+// sim data is set up in a noexcept manner. The output
+// components must then be invoked via run_outputs(), which
+// records their failures instead of throwing.
+outcome sim::step_impl()
 {
     namespace hy = heyoka;
     using dfloat = hy::detail::dfloat<double>;
@@ -543,9 +654,10 @@ outcome sim::step()
     // Cache a few quantities.
     const auto delta_t = m_data->delta_t;
     const auto nchunks = m_data->nchunks;
-    const auto batch_size = m_data->b_ta.get_batch_size();
+    const auto batch_size = m_data->jit->b_ta.get_batch_size();
     const auto nparts = get_nparts();
-    const auto order = m_data->s_ta.get_order();
+    const auto order = m_data->jit->s_ta.get_order();
+    const auto with_det = with_det_order();
     // Number of regular batches.
     const auto n_batches = nparts / batch_size;
     // The time coordinate at the beginning of
@@ -608,7 +720,7 @@ outcome sim::step()
     resize_if_needed(nparts, m_data->coll_active, m_data->conj_active);
 
     // Narrow phase data.
-    resize_if_needed(nchunks, m_data->np_caches, m_data->conj_vecs);
+    resize_if_needed(nchunks, m_data->np_caches, m_data->conj_vecs, m_data->conj_tu_vecs);
 
     // Stopping terminal events and err_nf_state vectors.
     m_data->ste_vec.clear();
@@ -632,6 +744,8 @@ outcome sim::step()
 
     // Is conjunction detection enabled globally?
     const auto with_conj = (m_conj_thresh != 0);
+    // Is conjunction aggregation active?
+    const auto with_conj_aggr = with_conj && (m_conj_aggr != conj_aggr_mode::none);
     // Is the conjunction whitelist empty?
     const auto conj_wl_empty = m_conj_whitelist.empty();
 
@@ -658,9 +772,9 @@ outcome sim::step()
             SPDLOG_LOGGER_DEBUG(logger, "Creating new batch data");
 
 #if defined(__clang__)
-            bdata_ptr = std::make_unique<sim_data::batch_data>(sim_data::batch_data{m_data->b_ta, {}});
+            bdata_ptr = std::make_unique<sim_data::batch_data>(sim_data::batch_data{m_data->jit->b_ta, {}, {}});
 #else
-            bdata_ptr = std::make_unique<sim_data::batch_data>(m_data->b_ta);
+            bdata_ptr = std::make_unique<sim_data::batch_data>(m_data->jit->b_ta);
 #endif
             bdata_ptr->pfor_ts.resize(boost::numeric_cast<decltype(bdata_ptr->pfor_ts.size())>(batch_size));
         }
@@ -874,6 +988,13 @@ outcome sim::step()
                     fsv(pidx_begin + i, j) = st(j, i);
                 }
             }
+
+            // Compute the economised polynomials, if needed.
+            if (with_det) {
+                for (std::uint32_t i = 0; i < batch_size; ++i) {
+                    compute_det_tcs(pidx_begin + i, bdata_ptr->det_work);
+                }
+            }
         }
 
         // We can now proceed, for each chunk, to:
@@ -933,7 +1054,7 @@ outcome sim::step()
         } else {
             SPDLOG_LOGGER_DEBUG(logger, "Creating new integrator");
 
-            ta_ptr = std::make_unique<hy::taylor_adaptive<double>>(m_data->s_ta);
+            ta_ptr = std::make_unique<hy::taylor_adaptive<double>>(m_data->jit->s_ta);
         }
 
         // Cache a few variables.
@@ -941,6 +1062,10 @@ outcome sim::step()
         const auto *st_data = ta.get_state_data();
         auto &s_data = m_data->s_data;
 
+        // Scratch buffer for the economisation of the trajectories,
+        // shared by all the particles in the range.
+        std::vector<double> det_work;
+
         // View on the Taylor coefficients of the integrator.
         stdex::mdspan tct(ta.get_tc().data(), stdex::extents<std::uint32_t, 7u, stdex::dynamic_extent>(order + 1u));
         assert(ta.get_tc().size() == static_cast<decltype(ta.get_tc().size())>(7) * (order + 1u));
@@ -1053,6 +1178,11 @@ outcome sim::step()
             for (auto j = 0u; j < 6u; ++j) {
                 fsv(pidx, j) = st_data[j];
             }
+
+            // Compute the economised polynomials, if needed.
+            if (with_det) {
+                compute_det_tcs(pidx, det_work);
+            }
         }
 
         // We can now proceed, for each chunk, to:
@@ -1132,6 +1262,7 @@ outcome sim::step()
 
         // Setup the interrupt info.
         m_int_info.emplace(*nf_it);
+        update_int_ids();
 
         logger->debug("The step function was interrupted due to particle {} generating a non-finite state during the "
                       "dynamical propagation",
@@ -1250,8 +1381,19 @@ outcome sim::step()
 
         assert(!interrupt_time);
 
-        // NOTE: it is *important* that everything in this
-        // block is noexcept.
+        // The absolute time coordinates of the beginning
+        // and end of the superstep.
+        const auto t0 = static_cast<double>(init_time);
+        const auto t1 = static_cast<double>(init_time + delta_t);
+
+        // Prepare the aggregation of the conjunction data, if needed.
+        // NOTE: this must be done before entering the noexcept block.
+        if (with_conj_aggr) {
+            conj_aggr_prepare(t0, t1, std::numeric_limits<double>::infinity());
+        }
+
+        // NOTE: it is *important* that everything from here
+        // until the end of the block is noexcept.
 
         // Update the time coordinate.
         // NOTE: the original delta_t is fine,
@@ -1264,9 +1406,12 @@ outcome sim::step()
 
         // Reset the interrupt data.
         m_int_info.reset();
+        m_int_ids.reset();
 
-        // Append the conjunction data, if needed.
-        if (with_conj) {
+        // Append/aggregate the conjunction data, if needed.
+        if (with_conj_aggr) {
+            conj_aggr_merge(t0, t1, std::numeric_limits<double>::infinity(), logger);
+        } else if (with_conj) {
             append_conj_data(logger);
         }
     } else {
@@ -1292,6 +1437,21 @@ outcome sim::step()
         // as expected by dense_propagate().
         dense_propagate(*interrupt_time);
 
+        // The absolute time coordinates of the beginning
+        // and end of the superstep.
+        // NOTE: use only the first component of the end time, for consistency
+        // with the filtering of the conjunctions below.
+        const auto t0 = static_cast<double>(init_time);
+        const auto t1 = (init_time + *interrupt_time).hi;
+
+        // Prepare the aggregation of the conjunction data, if needed.
+        // NOTE: this must be done before entering the noexcept section,
+        // and the conjunction data happening at or after the interrupt
+        // time will be discarded.
+        if (with_conj_aggr) {
+            conj_aggr_prepare(t0, t1, t1);
+        }
+
         // NOTE: noexcept until the end of the block.
 
         // Update the time coordinate.
@@ -1315,9 +1475,12 @@ outcome sim::step()
                 assert(ste_it != m_data->ste_vec.end());
                 m_int_info.emplace(std::get<0>(*ste_it));
         }
+        update_int_ids();
 
-        // Append the conjunction data, if needed.
-        if (with_conj) {
+        // Append/aggregate the conjunction data, if needed.
+        if (with_conj_aggr) {
+            conj_aggr_merge(t0, t1, t1, logger);
+        } else if (with_conj) {
             const auto new_it = append_conj_data(logger);
 
             // Identify the first conjunction added during this superstep
@@ -1332,7 +1495,14 @@ outcome sim::step()
                                    // what the users see.
                                    m_data->time.hi, [](const auto &c, const auto &tgt_tm) { return c.time < tgt_tm; });
 
-            // Erase the conjunctions happening at or after the current time.
+            // Erase the conjunctions happening at or after the current time,
+            // removing them also from the per-tier counters.
+            for (auto it = conj_it; it != m_det_conj->end(); ++it) {
+                assert(it->tier < m_conj_tier_counts.size());
+                assert(m_conj_tier_counts[it->tier] > 0u);
+
+                --m_conj_tier_counts[it->tier];
+            }
             m_det_conj->erase(conj_it, m_det_conj->end());
         }
     }
@@ -1344,6 +1514,73 @@ outcome sim::step()
     return oc;
 }
 
+// Invoke the output components (conjunction sink, snapshot writer,
+// ephemeris writer and checkpointer) after a step beginning at the time t0
+// has been committed.
+// NOTE: the failure of one component must not prevent the others from
+// running, and it must not alter the outcome of the step. Thus, each
+// component is run separately, and its failures are logged and recorded
+// in m_output_errors.
+void sim::run_outputs(const heyoka::detail::dfloat<double> &t0) noexcept
+{
+    auto *logger = detail::get_logger();
+
+    // Helper to record the failure of the component with the given name.
+    // NOTE: failures in recording the error (e.g., memory
+    // allocation failures) are ignored.
+    const auto record_error = [this, logger](const char *name, const char *msg) noexcept {
+        try {
+            logger->warn("The {} failed at the end of a step: {}", name, msg);
+
+            auto it = std::ranges::find_if(m_output_errors,
+                                           [name](const output_error &oe) { return oe.component == name; });
+            if (it == m_output_errors.end()) {
+                output_error oe;
+                oe.component = name;
+                m_output_errors.push_back(std::move(oe));
+                it = m_output_errors.end() - 1;
+            }
+
+            it->time = m_data->time.hi;
+            it->message = msg;
+            ++it->count;
+            // LCOV_EXCL_START
+        } catch (...) {
+        }
+        // LCOV_EXCL_STOP
+    };
+
+    const auto run_output = [&record_error](const char *name, const auto &f) noexcept {
+        try {
+            f();
+        } catch (const std::exception &e) {
+            record_error(name, e.what());
+            // LCOV_EXCL_START
+        } catch (...) {
+            record_error(name, "unknown exception");
+        }
+        // LCOV_EXCL_STOP
+    };
+
+    // Push the conjunctions to the sink, if needed.
+    // NOTE: if the sink throws, the conjunctions are kept in m_det_conj
+    // and they will be pushed again at the end of the next step.
+    run_output("conjunction sink", [this]() { push_conj_sink(); });
+
+    // Write the state snapshots, if needed.
+    run_output("snapshot writer", [this, &t0]() { write_snapshots(static_cast<double>(t0)); });
+
+    // Write the ephemeris block, if needed.
+    if (m_eph_writer) {
+        run_output("ephemeris writer", [this, &t0]() { m_eph_writer->superstep_done(*this, t0); });
+    }
+
+    // Write the checkpoint, if needed.
+    if (m_ckpt && m_ckpt->step_done()) {
+        run_output("checkpointer", [this]() { m_ckpt->write(*this); });
+    }
+}
+
 // Helper to verify the global AABB computed for each chunk.
 void sim::verify_global_aabbs() const
 {
@@ -1391,7 +1628,7 @@ void sim::dense_propagate(double t)
 
     auto *logger = detail::get_logger();
 
-    const auto order = m_data->s_ta.get_order();
+    const auto order = m_data->jit->s_ta.get_order();
     const auto nparts = get_nparts();
 
     // Fetch a view for writing into final_state.
@@ -1507,12 +1744,17 @@ outcome sim::propagate_until_impl(const T &final_t)
 {
     assert(isfinite(final_t) && final_t > m_data->time);
 
+    // NOTE: the steps are taken via step_impl(), and the output components
+    // are invoked only after the eventual rollback to final_t, so that the
+    // outputs (snapshots, ephemeris blocks, checkpoints, etc.) match the
+    // state of the simulation returned to the user.
+
     while (true) {
         // Store the original time coord.
         const auto orig_t = m_data->time;
 
         // Take a step.
-        const auto cur_oc = step();
+        const auto cur_oc = step_impl();
 
         if (cur_oc == outcome::success) {
             // Successful step with no interruption.
@@ -1534,10 +1776,14 @@ outcome sim::propagate_until_impl(const T &final_t)
                 copy_from_final_state();
 
                 // NOTE: m_int_info has already been reset by the
-                // step() function.
+                // step_impl() function.
+
+                run_outputs(orig_t);
 
                 return outcome::time_limit;
             }
+
+            run_outputs(orig_t);
         } else if (cur_oc != outcome::err_nf_state) {
             // Successful step with interruption.
             assert(cur_oc > outcome::success);
@@ -1563,8 +1809,11 @@ outcome sim::propagate_until_impl(const T &final_t)
                 copy_from_final_state();
 
                 // Reset the interrupt data, which
-                // was set up at the end of the step() function.
+                // was set up at the end of the step_impl() function.
                 m_int_info.reset();
+                m_int_ids.reset();
+
+                run_outputs(orig_t);
 
                 return outcome::time_limit;
             } else {
@@ -1572,6 +1821,8 @@ outcome sim::propagate_until_impl(const T &final_t)
                 // NOTE: this also includes the case
                 // m_data->time == final_t: that is, collision
                 // has priority wrt final time.
+                run_outputs(orig_t);
+
                 return cur_oc;
             }
         } else {
@@ -1602,6 +1853,53 @@ outcome sim::propagate_until(double t)
     return propagate_until_impl(dfloat(t));
 }
 
+// Helper to launch f asynchronously, taking a snapshot
+// of the time coordinate, the state and the parameters.
+template <typename F>
+std::shared_future<outcome> sim::launch_async(F f)
+{
+    if (m_async.running()) {
+        throw std::invalid_argument(
+            "Cannot launch an asynchronous operation on a simulation while another one is running");
+    }
+
+    m_async.snapshot.emplace(detail::sim_state_snapshot{get_time(),
+                                                        std::make_shared<const std::vector<double>>(*m_state),
+                                                        std::make_shared<const std::vector<double>>(*m_pars)});
+
+    // NOTE: std::launch::async guarantees that the operation runs in a separate
+    // thread. The parallel algorithms invoked by the operation run in
+    // TBB's default arena, as in the synchronous case.
+    m_async.fut = std::async(std::launch::async, std::move(f)).share();
+
+    return m_async.fut;
+}
+
+std::shared_future<outcome> sim::step_async()
+{
+    return launch_async([this]() { return step(); });
+}
+
+std::shared_future<outcome> sim::propagate_until_async(double t)
+{
+    return launch_async([this, t]() { return propagate_until(t); });
+}
+
+bool sim::async_running() const
+{
+    return m_async.running();
+}
+
+void sim::wait_async() const
+{
+    m_async.wait();
+}
+
+const std::optional<detail::sim_state_snapshot> &sim::get_async_snapshot() const
+{
+    return m_async.snapshot;
+}
+
 // Helper to copy the global state vector from
 // m_data->final_state to m_state.
 // NOTE: mark as noexcept as we use this functions
@@ -1629,6 +1927,132 @@ void sim::copy_from_final_state() noexcept
     });
 }
 
+// Push the content of m_det_conj to the conjunction sink (if any),
+// and then clear m_det_conj.
+void sim::push_conj_sink()
+{
+    if (!m_conj_sink || m_det_conj->empty()) {
+        return;
+    }
+
+    // NOTE: if m_det_conj is being referenced from outside
+    // (e.g., by a NumPy array), it will be replaced with a new
+    // vector, for the same reasons explained in reset_conjunctions().
+    // Create the new vector before pushing, so that nothing
+    // can throw after the sink has accepted the conjunctions
+    // (which would lead to pushing them again in the next step).
+    std::shared_ptr<std::vector<conjunction>> new_det_conj;
+    if (m_det_conj.use_count() != 1) {
+        new_det_conj = std::make_shared<std::vector<conjunction>>();
+    }
+
+    m_conj_sink->push(std::span<const conjunction>(m_det_conj->data(), m_det_conj->size()));
+
+    // NOTE: noexcept from here.
+    if (new_det_conj) {
+        m_det_conj = std::move(new_det_conj);
+    } else {
+        // NOTE: if nobody else is referencing m_det_conj,
+        // we can clear it in place so that its storage is
+        // re-used in the next steps.
+        m_det_conj->clear();
+    }
+
+    if (m_ckpt) {
+        m_ckpt->conjunctions_reset();
+    }
+}
+
+// Submit to the snapshot writer (if any) the snapshots due in
+// the step that began at the time coordinate t0 and that ended
+// at the current time coordinate.
+void sim::write_snapshots(double t0)
+{
+    namespace stdex = std::experimental;
+
+    if (!m_snap_writer) {
+        return;
+    }
+
+    auto &sw = *m_snap_writer;
+
+    // NOTE: use only the first component of the time, which
+    // is what the users see.
+    const auto t1 = m_data->time.hi;
+
+    const auto nparts = get_nparts();
+
+    // Snapshots at the user-specified times.
+    while (const auto tm = sw.next_snap_time()) {
+        if (*tm > t1) {
+            break;
+        }
+
+        if (*tm == t1) {
+            // The snapshot time coincides with the
+            // current time, use the current state.
+            sw.submit(t1, *m_state, *m_pars);
+        } else if (*tm >= t0) {
+            // Compute the state at the snapshot time via dense output.
+            // NOTE: it is fine to use final_state as a scratch buffer here,
+            // as its content has already been copied into m_state.
+            dense_propagate(*tm - t0);
+
+            // Assemble the snapshot state, taking
+            // the particle sizes from m_state.
+            m_data->snap_state.resize(nparts * 7u);
+
+            stdex::mdspan fsv(m_data->final_state.data(),
+                              stdex::extents<size_type, stdex::dynamic_extent, 6u>(nparts));
+            stdex::mdspan sv(m_state->data(), stdex::extents<size_type, stdex::dynamic_extent, 7u>(nparts));
+            stdex::mdspan ssv(m_data->snap_state.data(), stdex::extents<size_type, stdex::dynamic_extent, 7u>(nparts));
+
+            for (size_type pidx = 0; pidx < nparts; ++pidx) {
+                for (auto j = 0u; j < 6u; ++j) {
+                    ssv(pidx, j) = fsv(pidx, j);
+                }
+                ssv(pidx, 6) = sv(pidx, 6);
+            }
+
+            sw.submit(*tm, m_data->snap_state, *m_pars);
+        }
+
+        // NOTE: the snapshot times preceding the beginning
+        // of the step are discarded.
+        sw.pop_snap_time();
+    }
+
+    // Snapshot at the end of the step, unless
+    // it was already taken above.
+    if (sw.step_done() && sw.last_snap_time() != t1) {
+        sw.submit(t1, *m_state, *m_pars);
+    }
+}
+
+// Helper to ensure that m_det_conj can receive n_new
+// additional conjunctions without reallocating.
+// NOTE: if a reallocation is needed, a new vector
+// is created, so that NumPy arrays viewing the
+// existing conjunctions on the Python side remain valid.
+void sim::reserve_conj_data(size_type n_new)
+{
+    using safe_size_t = boost::safe_numerics::safe<size_type>;
+
+    // Do we have enough storage in m_det_conj to store the new conjunctions?
+    if (m_det_conj->size() + safe_size_t(n_new) > m_det_conj->capacity()) {
+        // m_det_conj cannot store the new conjunctions without reallocating.
+        // We thus prepare a new vector with twice the needed capacity.
+        std::vector<conjunction> new_det_conj;
+        new_det_conj.reserve(2u * (m_det_conj->size() + safe_size_t(n_new)));
+
+        // Copy over the existing conjunctions.
+        new_det_conj.insert(new_det_conj.end(), m_det_conj->begin(), m_det_conj->end());
+
+        // Assign the new conjunction vector.
+        m_det_conj = std::make_shared<std::vector<conjunction>>(std::move(new_det_conj));
+    }
+}
+
 // Small helper to append the detected conjunctions data
 // from the chunk-local vectors to the global
 // one. The appended data will be sorted in chronological
@@ -1651,53 +2075,122 @@ std::vector<sim::conjunction>::iterator sim::append_conj_data(void *logger_) noe
     // when conjunction detection is active.
     assert(m_conj_thresh != 0);
 
-    // Is the global vector originally empty?
-    const auto orig_empty = m_det_conj->empty();
-
-    // Store an iterator to the original last element of
-    // m_det_conj, or end() if orig_empty == true.
-    const auto orig_last_it = orig_empty ? m_det_conj->end() : m_det_conj->end() - 1;
+    const auto &conj_vecs = m_data->conj_vecs;
+    const auto nchunks = conj_vecs.size();
+
+    // Compute the offsets in m_det_conj at which the data
+    // of each chunk will be placed via prefix sum.
+    // NOTE: reuse the chunk-local offsets vector, which was set up
+    // with the correct size in narrow_phase_parallel().
+    auto &offsets = m_data->conj_offsets;
+    assert(offsets.size() == nchunks + 1u);
+    offsets[0] = m_det_conj->size();
+    for (decltype(conj_vecs.size()) chunk_idx = 0; chunk_idx < nchunks; ++chunk_idx) {
+        offsets[chunk_idx + 1u] = offsets[chunk_idx] + conj_vecs[chunk_idx].size();
+    }
 
 #if !defined(NDEBUG)
 
     // Store the original m_det_conj data pointer
     // in order to check that no reallocation took place.
-    // NOTE: this is well-defined even if orig_empty == true.
     const auto *orig_ptr = m_det_conj->data();
 
 #endif
 
-    // Append the data.
-    for (const auto &vec : m_data->conj_vecs) {
-        m_det_conj->insert(m_det_conj->end(), vec.begin(), vec.end());
-    }
+    // Resize m_det_conj.
+    // NOTE: this will not throw because the capacity of m_det_conj
+    // was set up in narrow_phase_parallel().
+    assert(offsets[nchunks] <= m_det_conj->capacity());
+    const auto orig_size = offsets[0];
+    m_det_conj->resize(offsets[nchunks]);
+
+    assert(orig_size == 0u || orig_ptr == m_det_conj->data());
+
+    // Copy the data of each chunk into its final position, and sort it
+    // in chronological order. The chunks are processed in parallel.
+    // NOTE: the chunks are time-ordered and their time intervals
+    // are disjoint, thus the concatenation of the sorted chunk-local
+    // vectors is sorted as well.
+    using diff_t = std::vector<conjunction>::difference_type;
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<decltype(conj_vecs.size())>(0, nchunks), [&](const auto &range) {
+            for (auto chunk_idx = range.begin(); chunk_idx != range.end(); ++chunk_idx) {
+                const auto &vec = conj_vecs[chunk_idx];
+
+                const auto out_begin = m_det_conj->begin() + static_cast<diff_t>(offsets[chunk_idx]);
+                std::copy(vec.begin(), vec.end(), out_begin);
+
+                std::sort(out_begin, m_det_conj->begin() + static_cast<diff_t>(offsets[chunk_idx + 1u]),
+                          [](const conjunction &c1, const conjunction &c2) { return c1.time < c2.time; });
+            }
+        });
+
+    // The return value is an iterator to the first appended element.
+    auto retval = m_det_conj->begin() + static_cast<diff_t>(orig_size);
+
+    // NOTE: due to floating-point rounding, the time coordinates
+    // of conjunctions detected right at the boundary between two chunks
+    // might end up slightly out of order. Check the chunk boundaries
+    // and, in the unlikely case of out-of-order data, fall back
+    // to sorting the whole appended range.
+    auto sorted = true;
+    std::optional<double> prev_last_time;
+    for (decltype(conj_vecs.size()) chunk_idx = 0; chunk_idx < nchunks; ++chunk_idx) {
+        if (offsets[chunk_idx] == offsets[chunk_idx + 1u]) {
+            // Empty chunk.
+            continue;
+        }
 
-    if (!orig_empty) {
-        // NOTE: run this check only if m_det_conj
-        // originally contained something (and thus
-        // orig_ptr actually points to a conjunction object),
-        // otherwise I am not sure what sort of guarantees
-        // we have on orig_ptr.
-        assert(orig_ptr == m_det_conj->data());
+        if (prev_last_time && (*m_det_conj)[offsets[chunk_idx]].time < *prev_last_time) {
+            // LCOV_EXCL_START
+            sorted = false;
+            break;
+            // LCOV_EXCL_STOP
+        }
+
+        prev_last_time = (*m_det_conj)[offsets[chunk_idx + 1u] - 1u].time;
     }
 
-    // Build the return value: if m_det_conj was originally empty, then the first
-    // element that was appended is begin() (which will coincide with end()
-    // in case no conjunctions were detected). Otherwise, take the iterator
-    // to the last original element (which is still valid thanks to the fact
-    // that no reallocation took place), and increase it by one: this will either
-    // return an iterator to the first added element, or end() if no conjunctions
-    // were detected.
-    auto retval = orig_empty ? m_det_conj->begin() : orig_last_it + 1;
+    if (!sorted) {
+        // LCOV_EXCL_START
+        std::sort(retval, m_det_conj->end(),
+                  [](const conjunction &c1, const conjunction &c2) { return c1.time < c2.time; });
+        // LCOV_EXCL_STOP
+    }
 
-    // Sort the added elements in chronological order.
-    // NOTE: this can be parallelised: worth it?
-    std::sort(retval, m_det_conj->end(),
-              [](const conjunction &c1, const conjunction &c2) { return c1.time < c2.time; });
+    // Assign the particle ids and update the per-tier counters.
+    assign_conj_ids(retval);
+    update_conj_tier_counts(retval);
 
     logger->trace("Runtime for append_conj_data(): {}s", sw);
 
     return retval;
 }
 
+// Update the per-tier conjunction counters with the
+// conjunctions in m_det_conj from first onwards.
+void sim::update_conj_tier_counts(std::vector<conjunction>::const_iterator first) noexcept
+{
+    for (; first != m_det_conj->cend(); ++first) {
+        assert(first->tier < m_conj_tier_counts.size());
+
+        ++m_conj_tier_counts[first->tier];
+    }
+}
+
+// Fill in the particle ids in the conjunctions
+// in m_det_conj from first onwards.
+// NOTE: this must be invoked when the particle indices
+// in the conjunctions refer to the current set of particles.
+void sim::assign_conj_ids(std::vector<conjunction>::iterator first) noexcept
+{
+    for (; first != m_det_conj->end(); ++first) {
+        assert(first->i < m_ids.size());
+        assert(first->j < m_ids.size());
+
+        first->id_i = m_ids[first->i];
+        first->id_j = m_ids[first->j];
+    }
+}
+
 } // namespace cascade
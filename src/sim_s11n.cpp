@@ -0,0 +1,811 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/unordered_set.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <fmt/core.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/s11n.hpp>
+#include <heyoka/taylor.hpp>
+
+#include <cascade/checkpointer.hpp>
+#include <cascade/detail/logging_impl.hpp>
+#include <cascade/detail/sim_data.hpp>
+#include <cascade/sim.hpp>
+
+#include "detail/jit_cache.hpp"
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+void save_conj(boost::archive::binary_oarchive &oa, const sim::conjunction &c)
+{
+    oa << c.i;
+    oa << c.j;
+    oa << c.id_i;
+    oa << c.id_j;
+    oa << c.time;
+    oa << c.dist;
+    for (auto x : c.state_i) {
+        oa << x;
+    }
+    for (auto x : c.state_j) {
+        oa << x;
+    }
+    oa << c.tier;
+    oa << c.n_min;
+    oa << c.time_under;
+}
+
+void load_conj(boost::archive::binary_iarchive &ia, sim::conjunction &c)
+{
+    ia >> c.i;
+    ia >> c.j;
+    ia >> c.id_i;
+    ia >> c.id_j;
+    ia >> c.time;
+    ia >> c.dist;
+    for (auto &x : c.state_i) {
+        ia >> x;
+    }
+    for (auto &x : c.state_j) {
+        ia >> x;
+    }
+    ia >> c.tier;
+    ia >> c.n_min;
+    ia >> c.time_under;
+}
+
+// Check that the particle ids are sorted in strictly
+// ascending order and that they are less than next_id.
+bool valid_ids(const std::vector<std::uint64_t> &ids, std::uint64_t next_id)
+{
+    return std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<>{}) == ids.end()
+           && (ids.empty() || ids.back() < next_id);
+}
+
+// Save the particle ids ids as runs of consecutive ids, each
+// run being represented by its first id and its length.
+// NOTE: the ids are usually made of a small number of runs,
+// as they are assigned in ascending order and never reused.
+void save_ids_runs(boost::archive::binary_oarchive &oa, const std::vector<std::uint64_t> &ids)
+{
+    std::vector<std::uint64_t> runs;
+    for (const auto id : ids) {
+        if (!runs.empty() && runs[runs.size() - 2u] + runs.back() == id) {
+            ++runs.back();
+        } else {
+            runs.push_back(id);
+            runs.push_back(1);
+        }
+    }
+
+    oa << runs;
+}
+
+// Load the particle ids saved by save_ids_runs().
+std::vector<std::uint64_t> load_ids_runs(boost::archive::binary_iarchive &ia)
+{
+    std::vector<std::uint64_t> runs;
+    ia >> runs;
+
+    if (runs.size() % 2u != 0u) {
+        throw std::invalid_argument("Inconsistent particle ids detected while deserialising a simulation");
+    }
+
+    std::vector<std::uint64_t> ids;
+    for (decltype(runs.size()) i = 0; i < runs.size(); i += 2u) {
+        const auto first = runs[i], len = runs[i + 1u];
+
+        if (len > std::numeric_limits<std::uint64_t>::max() - first
+            || (!ids.empty() && first <= ids.back())) {
+            throw std::invalid_argument("Inconsistent particle ids detected while deserialising a simulation");
+        }
+
+        for (std::uint64_t k = 0; k < len; ++k) {
+            ids.push_back(first + k);
+        }
+    }
+
+    return ids;
+}
+
+// Interrupt info.
+template <typename T>
+void save_int_info(boost::archive::binary_oarchive &oa, const T &int_info)
+{
+    oa << int_info.has_value();
+    if (int_info) {
+        const auto idx = static_cast<std::uint32_t>(int_info->index());
+        oa << idx;
+
+        switch (idx) {
+            case 0u: {
+                const auto &[i, j] = std::get<0>(*int_info);
+                oa << i;
+                oa << j;
+                break;
+            }
+            case 1u:
+                oa << std::get<1>(*int_info);
+                break;
+            default: {
+                const auto &[i, t] = std::get<2>(*int_info);
+                oa << i;
+                oa << t;
+            }
+        }
+    }
+}
+
+template <typename T>
+T load_int_info(boost::archive::binary_iarchive &ia)
+{
+    T int_info;
+
+    // NOTE: the interrupt info is expressed either
+    // in terms of particle indices or of particle ids.
+    using idx_t = std::variant_alternative_t<1, typename T::value_type>;
+
+    bool has_int_info{};
+    ia >> has_int_info;
+    if (has_int_info) {
+        std::uint32_t idx{};
+        ia >> idx;
+
+        switch (idx) {
+            case 0u: {
+                std::array<idx_t, 2> pidx{};
+                ia >> pidx[0];
+                ia >> pidx[1];
+                int_info.emplace(pidx);
+                break;
+            }
+            case 1u: {
+                idx_t pidx{};
+                ia >> pidx;
+                int_info.emplace(pidx);
+                break;
+            }
+            case 2u: {
+                idx_t pidx{};
+                double t{};
+                ia >> pidx;
+                ia >> t;
+                int_info.emplace(std::tuple{pidx, t});
+                break;
+            }
+            default:
+                throw std::invalid_argument(
+                    fmt::format("Invalid interrupt info index {} detected while deserialising a simulation", idx));
+        }
+    }
+
+    return int_info;
+}
+
+// Pending aggregated conjunctions.
+template <typename Map>
+void save_aggr_windows(boost::archive::binary_oarchive &oa, const Map &windows)
+{
+    oa << static_cast<std::uint64_t>(windows.size());
+    for (const auto &[widx, wmap] : windows) {
+        oa << widx;
+        oa << static_cast<std::uint64_t>(wmap.size());
+
+        for (const auto &[key, c] : wmap) {
+            oa << std::get<0>(key);
+            oa << std::get<1>(key);
+            oa << std::get<2>(key);
+            save_conj(oa, c);
+        }
+    }
+}
+
+template <typename Map>
+Map load_aggr_windows(boost::archive::binary_iarchive &ia)
+{
+    Map windows;
+
+    std::uint64_t n_windows{};
+    ia >> n_windows;
+    for (std::uint64_t w = 0; w < n_windows; ++w) {
+        std::int64_t widx{};
+        ia >> widx;
+        auto &wmap = windows[widx];
+
+        std::uint64_t wsize{};
+        ia >> wsize;
+        for (std::uint64_t k = 0; k < wsize; ++k) {
+            sim::size_type i{}, j{}, tier{};
+            ia >> i;
+            ia >> j;
+            ia >> tier;
+
+            sim::conjunction c;
+            load_conj(ia, c);
+
+            wmap.insert(std::pair{std::tuple{i, j, tier}, c});
+        }
+    }
+
+    return windows;
+}
+
+// Save a whitelist, omitting the indices which do not refer to any
+// of the nparts particles (see validate_settings()).
+void save_whitelist(boost::archive::binary_oarchive &oa, const sim::whitelist_t &wl, sim::size_type nparts)
+{
+    sim::whitelist_t tmp;
+    for (const auto idx : wl) {
+        if (idx < nparts) {
+            tmp.insert(idx);
+        }
+    }
+
+    oa << tmp;
+}
+
+// Validate the settings and the pending aggregated conjunctions
+// of a deserialised simulation with nparts particles.
+// NOTE: the detected conjunctions are not checked against the tiers,
+// as they may refer to tiers which were later replaced
+// (see sim::set_conj_tiers()).
+template <typename Map>
+void validate_settings(double ct, std::uint32_t n_par_ct, double conj_thresh, const std::vector<double> &conj_tiers,
+                       const std::vector<sim::size_type> &conj_tier_counts, int conj_aggr, double conj_aggr_window,
+                       const sim::whitelist_t &coll_whitelist, const sim::whitelist_t &conj_whitelist,
+                       const Map &conj_aggr_windows, sim::size_type nparts)
+{
+    if (!std::isfinite(ct) || ct <= 0) {
+        throw std::invalid_argument(
+            fmt::format("Invalid collisional timestep {} detected while deserialising a simulation", ct));
+    }
+
+    if (n_par_ct == 0u) {
+        throw std::invalid_argument("Invalid number of collisional timesteps to be processed in parallel (zero) "
+                                    "detected while deserialising a simulation");
+    }
+
+    if (conj_tier_counts.size() != conj_tiers.size()
+        || std::any_of(conj_tiers.begin(), conj_tiers.end(), [](double t) { return !std::isfinite(t) || t <= 0; })
+        || std::adjacent_find(conj_tiers.begin(), conj_tiers.end(), std::greater_equal<>{}) != conj_tiers.end()
+        || conj_thresh != (conj_tiers.empty() ? 0. : conj_tiers.back())) {
+        throw std::invalid_argument("Inconsistent conjunction tiers detected while deserialising a simulation");
+    }
+
+    if (conj_aggr < 0 || conj_aggr > static_cast<int>(conj_aggr_mode::window)) {
+        throw std::invalid_argument(fmt::format(
+            "Invalid conjunction aggregation mode {} detected while deserialising a simulation", conj_aggr));
+    }
+
+    if (!std::isfinite(conj_aggr_window) || conj_aggr_window < 0
+        || (conj_aggr == static_cast<int>(conj_aggr_mode::window) && conj_aggr_window == 0)) {
+        throw std::invalid_argument(fmt::format(
+            "Invalid conjunction aggregation window {} detected while deserialising a simulation", conj_aggr_window));
+    }
+
+    const auto invalid_idx = [nparts](sim::size_type idx) { return idx >= nparts; };
+    if (std::any_of(coll_whitelist.begin(), coll_whitelist.end(), invalid_idx)
+        || std::any_of(conj_whitelist.begin(), conj_whitelist.end(), invalid_idx)) {
+        throw std::invalid_argument("Invalid whitelist detected while deserialising a simulation");
+    }
+
+    for (const auto &[_, wmap] : conj_aggr_windows) {
+        for (const auto &[key, c] : wmap) {
+            const auto [i, j, tier] = key;
+
+            if (i >= nparts || j >= nparts || tier >= conj_tiers.size() || c.tier != tier
+                || (c.n_min > 0u && (c.i >= nparts || c.j >= nparts))) {
+                throw std::invalid_argument(
+                    "Inconsistent pending aggregated conjunctions detected while deserialising a simulation");
+            }
+        }
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+// NOTE: the serialised representation of a simulation contains, in addition
+// to the state, the parameters and the settings, the integrators and the llvm
+// state holding the JIT-compiled functions. heyoka serialises the object code
+// of the llvm states, so that the compiled functions are restored on loading
+// without invoking the JIT compiler again.
+void sim::save(boost::archive::binary_oarchive &oa, unsigned) const
+{
+    oa << *m_state;
+    oa << *m_pars;
+    oa << m_ids;
+    oa << m_next_id;
+    oa << m_ct;
+    oa << m_n_par_ct;
+
+    // Interrupt info.
+    detail::save_int_info(oa, m_int_info);
+    detail::save_int_info(oa, m_int_ids);
+
+    // Reentry radius.
+    oa << static_cast<std::uint32_t>(m_reentry_radius.index());
+    if (const auto *rr = std::get_if<double>(&m_reentry_radius)) {
+        oa << *rr;
+    } else {
+        oa << std::get<1>(m_reentry_radius);
+    }
+
+    oa << m_exit_radius;
+    oa << m_npars;
+    oa << m_conj_thresh;
+    oa << m_conj_tiers;
+    oa << m_conj_tier_counts;
+
+    // Detected conjunctions.
+    oa << static_cast<std::uint64_t>(m_det_conj->size());
+    for (const auto &c : *m_det_conj) {
+        detail::save_conj(oa, c);
+    }
+
+    oa << m_min_coll_radius;
+    oa << static_cast<int>(m_conj_aggr);
+    oa << m_conj_aggr_window;
+    detail::save_whitelist(oa, m_coll_whitelist, get_nparts());
+    detail::save_whitelist(oa, m_conj_whitelist, get_nparts());
+
+    // Screening volume.
+    oa << m_svol.has_value();
+    if (m_svol) {
+        oa << m_svol->get_predicates();
+        oa << m_svol->get_bounding_radius();
+    }
+
+    oa << m_det_order;
+
+    // The environment the compiled code was generated for,
+    // and the dynamics needed to compile it again on a different
+    // host (see load()).
+    oa << detail::jit_cache_env_key();
+    oa << m_data->jit->dyn;
+
+    // The implementation-detail data.
+    oa << m_data->jit->s_ta;
+    oa << m_data->jit->b_ta;
+    oa << m_data->jit->state;
+    oa << m_data->jit->det_state;
+    oa << m_data->time.hi;
+    oa << m_data->time.lo;
+
+    // Pending aggregated conjunctions.
+    detail::save_aggr_windows(oa, m_data->conj_aggr_windows);
+}
+
+// NOTE: the data is loaded into temporaries first, and this is
+// modified only at the end, so that this is left unchanged
+// if an exception is thrown during loading.
+void sim::load(boost::archive::binary_iarchive &ia, unsigned)
+{
+    std::vector<double> state, pars;
+    ia >> state;
+    ia >> pars;
+    std::vector<std::uint64_t> ids;
+    ia >> ids;
+    std::uint64_t next_id{};
+    ia >> next_id;
+
+    double ct{};
+    ia >> ct;
+    std::uint32_t n_par_ct{};
+    ia >> n_par_ct;
+
+    // Interrupt info.
+    auto int_info = detail::load_int_info<decltype(m_int_info)>(ia);
+    auto int_ids = detail::load_int_info<decltype(m_int_ids)>(ia);
+    if (int_info.has_value() != int_ids.has_value()
+        || (int_info && int_info->index() != int_ids->index())) {
+        throw std::invalid_argument("Inconsistent interrupt info detected while deserialising a simulation");
+    }
+
+    // Reentry radius.
+    std::variant<double, std::vector<double>> reentry_radius;
+    std::uint32_t rr_idx{};
+    ia >> rr_idx;
+    if (rr_idx == 0u) {
+        double rr{};
+        ia >> rr;
+        reentry_radius = rr;
+    } else {
+        std::vector<double> rr;
+        ia >> rr;
+        reentry_radius = std::move(rr);
+    }
+
+    double exit_radius{};
+    ia >> exit_radius;
+    std::uint32_t npars{};
+    ia >> npars;
+    double conj_thresh{};
+    ia >> conj_thresh;
+    std::vector<double> conj_tiers;
+    ia >> conj_tiers;
+    std::vector<size_type> conj_tier_counts;
+    ia >> conj_tier_counts;
+
+    // Detected conjunctions.
+    std::uint64_t n_det_conj{};
+    ia >> n_det_conj;
+    auto det_conj = std::make_shared<std::vector<conjunction>>();
+    for (std::uint64_t k = 0; k < n_det_conj; ++k) {
+        detail::load_conj(ia, det_conj->emplace_back());
+    }
+
+    double min_coll_radius{};
+    ia >> min_coll_radius;
+    int conj_aggr{};
+    ia >> conj_aggr;
+    double conj_aggr_window{};
+    ia >> conj_aggr_window;
+    whitelist_t coll_whitelist, conj_whitelist;
+    ia >> coll_whitelist;
+    ia >> conj_whitelist;
+
+    // Screening volume.
+    std::optional<screening_volume> svol;
+    bool has_svol{};
+    ia >> has_svol;
+    if (has_svol) {
+        std::vector<heyoka::expression> preds;
+        ia >> preds;
+        double bradius{};
+        ia >> bradius;
+        svol.emplace(std::move(preds), bradius);
+    }
+
+    std::uint32_t det_order{};
+    ia >> det_order;
+
+    std::string env_key;
+    ia >> env_key;
+    std::vector<std::pair<heyoka::expression, heyoka::expression>> dyn;
+    ia >> dyn;
+
+    // The implementation-detail data.
+    heyoka::taylor_adaptive<double> s_ta;
+    ia >> s_ta;
+    heyoka::taylor_adaptive_batch<double> b_ta;
+    ia >> b_ta;
+    heyoka::llvm_state llvm_s;
+    ia >> llvm_s;
+    heyoka::llvm_state det_llvm_s;
+    ia >> det_llvm_s;
+    heyoka::detail::dfloat<double> time;
+    ia >> time.hi;
+    ia >> time.lo;
+
+    // Pending aggregated conjunctions.
+    auto conj_aggr_windows = detail::load_aggr_windows<decltype(sim_data::conj_aggr_windows)>(ia);
+
+    // Basic consistency checks.
+    if (state.size() % 7u != 0u || pars.size() != (state.size() / 7u) * npars) {
+        throw std::invalid_argument("Inconsistent state/parameters detected while deserialising a simulation");
+    }
+
+    if (ids.size() != state.size() / 7u || !detail::valid_ids(ids, next_id)) {
+        throw std::invalid_argument("Inconsistent particle ids detected while deserialising a simulation");
+    }
+
+    detail::validate_settings(ct, n_par_ct, conj_thresh, conj_tiers, conj_tier_counts, conj_aggr, conj_aggr_window,
+                              coll_whitelist, conj_whitelist, conj_aggr_windows, ids.size());
+
+    if (det_order == 1u) {
+        throw std::invalid_argument("Invalid detection order 1 detected while deserialising a simulation");
+    }
+
+    if (!std::isfinite(exit_radius) || exit_radius < 0
+        || std::visit(
+            [](const auto &rr) {
+                if constexpr (std::is_same_v<decltype(rr), const double &>) {
+                    return !std::isfinite(rr) || rr < 0;
+                } else {
+                    return rr.size() != 3u
+                           || std::any_of(rr.begin(), rr.end(), [](double x) { return !std::isfinite(x) || x <= 0; });
+                }
+            },
+            reentry_radius)) {
+        throw std::invalid_argument("Invalid reentry/exit radius detected while deserialising a simulation");
+    }
+
+    if (dyn.size() != 7u) {
+        throw std::invalid_argument("Invalid dynamics detected while deserialising a simulation");
+    }
+
+    std::shared_ptr<const detail::sim_jit_data> new_jit;
+
+    if (env_key == detail::jit_cache_env_key()) {
+#if defined(__clang__)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+        auto jit = std::make_shared<detail::sim_jit_data>(
+            detail::sim_jit_data{std::move(s_ta), std::move(b_ta), std::move(llvm_s), std::move(det_llvm_s)});
+
+#pragma GCC diagnostic pop
+
+#else
+
+        auto jit = std::make_shared<detail::sim_jit_data>(std::move(s_ta), std::move(b_ta), std::move(llvm_s),
+                                                          std::move(det_llvm_s));
+
+#endif
+
+        // NOTE: the llvm state was restored from its object code,
+        // thus we just need to look up the compiled functions.
+        jit->lookup_jit_functions(svol.has_value(), detail::use_det_order(det_order, jit->s_ta.get_order()));
+        jit->dyn = std::move(dyn);
+
+        new_jit = std::move(jit);
+    } else {
+        // NOTE: the object code in the archive was generated for a different
+        // environment (CPU, heyoka or LLVM version), and it cannot be used here.
+        // Set up the compiled data again from the dynamics, going through
+        // the in-memory registry and the JIT cache as in the constructor.
+        detail::get_logger()->debug("The simulation was serialised in a different environment, "
+                                    "the compiled data will be set up again");
+
+        new_jit = detail::make_sim_jit_data(std::move(dyn), reentry_radius, exit_radius, s_ta.get_tol(),
+                                            s_ta.get_high_accuracy(), svol, det_order, []() {});
+    }
+
+#if defined(__clang__)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+    auto new_data = std::make_unique<sim_data>(sim_data{std::move(new_jit), time, std::move(conj_aggr_windows)});
+
+#pragma GCC diagnostic pop
+
+#else
+
+    auto new_data = std::make_unique<sim_data>(std::move(new_jit), time, std::move(conj_aggr_windows));
+
+#endif
+
+    auto new_state = std::make_shared<std::vector<double>>(std::move(state));
+    auto new_pars = std::make_shared<std::vector<double>>(std::move(pars));
+
+    // NOTE: noexcept from here.
+    // NOTE: the state, pars and conjunctions vectors are replaced
+    // rather than modified in place, for the same reasons explained
+    // in set_new_state_pars().
+    m_state = std::move(new_state);
+    m_pars = std::move(new_pars);
+    m_ids = std::move(ids);
+    m_next_id = next_id;
+    m_ct = ct;
+    m_n_par_ct = n_par_ct;
+    m_int_info = std::move(int_info);
+    m_int_ids = std::move(int_ids);
+    m_reentry_radius = std::move(reentry_radius);
+    m_exit_radius = exit_radius;
+    m_npars = npars;
+    m_conj_thresh = conj_thresh;
+    m_conj_tiers = std::move(conj_tiers);
+    m_conj_tier_counts = std::move(conj_tier_counts);
+    m_det_conj = std::move(det_conj);
+    m_min_coll_radius = min_coll_radius;
+    m_conj_aggr = static_cast<conj_aggr_mode>(conj_aggr);
+    m_conj_aggr_window = conj_aggr_window;
+    m_coll_whitelist = std::move(coll_whitelist);
+    m_conj_whitelist = std::move(conj_whitelist);
+    m_svol = std::move(svol);
+    m_det_order = det_order;
+    m_data = std::move(new_data);
+
+    // NOTE: the checkpointer must start a new chain
+    // of records after the sim has been replaced.
+    if (m_ckpt) {
+        m_ckpt->sim_attached();
+    }
+}
+
+// Save the data which may change between the records of a chain
+// of incremental checkpoints (see the checkpointer class), apart from
+// the state and parameters vectors. Only the detected conjunctions
+// starting from the index first_conj are saved. The particle ids
+// are saved only if save_ids is true.
+void sim::save_delta(boost::archive::binary_oarchive &oa, size_type first_conj, bool save_ids) const
+{
+    assert(first_conj <= m_det_conj->size());
+
+    oa << m_data->time.hi;
+    oa << m_data->time.lo;
+    oa << m_ct;
+    oa << m_n_par_ct;
+    oa << m_next_id;
+    if (save_ids) {
+        detail::save_ids_runs(oa, m_ids);
+    }
+
+    // Interrupt info.
+    detail::save_int_info(oa, m_int_info);
+    detail::save_int_info(oa, m_int_ids);
+
+    oa << m_conj_thresh;
+    oa << m_conj_tiers;
+    oa << m_conj_tier_counts;
+    oa << m_min_coll_radius;
+    oa << static_cast<int>(m_conj_aggr);
+    oa << m_conj_aggr_window;
+    detail::save_whitelist(oa, m_coll_whitelist, get_nparts());
+    detail::save_whitelist(oa, m_conj_whitelist, get_nparts());
+
+    // Pending aggregated conjunctions.
+    detail::save_aggr_windows(oa, m_data->conj_aggr_windows);
+
+    // The new detected conjunctions.
+    oa << static_cast<std::uint64_t>(m_det_conj->size() - first_conj);
+    for (auto it = m_det_conj->begin() + static_cast<std::ptrdiff_t>(first_conj); it != m_det_conj->end(); ++it) {
+        detail::save_conj(oa, *it);
+    }
+}
+
+// Load the data saved by save_delta(). If conj_reset is true, the new detected
+// conjunctions replace the existing ones, otherwise they are appended. If ids_ is
+// empty, the particle ids are loaded from the archive, otherwise they are set to ids_.
+void sim::load_delta(boost::archive::binary_iarchive &ia, bool conj_reset,
+                     std::optional<std::vector<std::uint64_t>> ids_)
+{
+    heyoka::detail::dfloat<double> time;
+    ia >> time.hi;
+    ia >> time.lo;
+
+    double ct{};
+    ia >> ct;
+    std::uint32_t n_par_ct{};
+    ia >> n_par_ct;
+    std::uint64_t next_id{};
+    ia >> next_id;
+    auto ids = ids_ ? std::move(*ids_) : detail::load_ids_runs(ia);
+
+    // Interrupt info.
+    auto int_info = detail::load_int_info<decltype(m_int_info)>(ia);
+    auto int_ids = detail::load_int_info<decltype(m_int_ids)>(ia);
+    if (int_info.has_value() != int_ids.has_value()
+        || (int_info && int_info->index() != int_ids->index())) {
+        throw std::invalid_argument("Inconsistent interrupt info detected while deserialising a simulation");
+    }
+
+    double conj_thresh{};
+    ia >> conj_thresh;
+    std::vector<double> conj_tiers;
+    ia >> conj_tiers;
+    std::vector<size_type> conj_tier_counts;
+    ia >> conj_tier_counts;
+    double min_coll_radius{};
+    ia >> min_coll_radius;
+    int conj_aggr{};
+    ia >> conj_aggr;
+    double conj_aggr_window{};
+    ia >> conj_aggr_window;
+    whitelist_t coll_whitelist, conj_whitelist;
+    ia >> coll_whitelist;
+    ia >> conj_whitelist;
+
+    // Pending aggregated conjunctions.
+    auto conj_aggr_windows = detail::load_aggr_windows<decltype(sim_data::conj_aggr_windows)>(ia);
+
+    // The new detected conjunctions.
+    std::uint64_t n_new_conj{};
+    ia >> n_new_conj;
+    std::vector<conjunction> new_conj;
+    for (std::uint64_t k = 0; k < n_new_conj; ++k) {
+        detail::load_conj(ia, new_conj.emplace_back());
+    }
+
+    // NOTE: the number of particles after the delta is given by the ids,
+    // whose consistency with the state vector is checked below.
+    detail::validate_settings(ct, n_par_ct, conj_thresh, conj_tiers, conj_tier_counts, conj_aggr, conj_aggr_window,
+                              coll_whitelist, conj_whitelist, conj_aggr_windows, ids.size());
+
+    // NOTE: the consistency of the ids with the state
+    // vector is checked by the checkpointer, after the
+    // state vector has been restored.
+    if (!detail::valid_ids(ids, next_id)) {
+        throw std::invalid_argument("Inconsistent particle ids detected while deserialising a simulation");
+    }
+
+    // NOTE: if the conjunctions are not reset, make sure the
+    // new ones can be appended below without reallocating.
+    std::shared_ptr<std::vector<conjunction>> det_conj;
+    if (conj_reset) {
+        det_conj = std::make_shared<std::vector<conjunction>>(std::move(new_conj));
+    } else {
+        m_det_conj->reserve(m_det_conj->size() + new_conj.size());
+    }
+
+    // NOTE: noexcept from here.
+    m_data->time = time;
+    m_ct = ct;
+    m_n_par_ct = n_par_ct;
+    m_ids = std::move(ids);
+    m_next_id = next_id;
+    m_int_info = std::move(int_info);
+    m_int_ids = std::move(int_ids);
+    m_conj_thresh = conj_thresh;
+    m_conj_tiers = std::move(conj_tiers);
+    m_conj_tier_counts = std::move(conj_tier_counts);
+    m_min_coll_radius = min_coll_radius;
+    m_conj_aggr = static_cast<conj_aggr_mode>(conj_aggr);
+    m_conj_aggr_window = conj_aggr_window;
+    m_coll_whitelist = std::move(coll_whitelist);
+    m_conj_whitelist = std::move(conj_whitelist);
+    m_data->conj_aggr_windows = std::move(conj_aggr_windows);
+    if (det_conj) {
+        m_det_conj = std::move(det_conj);
+    } else {
+        m_det_conj->insert(m_det_conj->end(), new_conj.begin(), new_conj.end());
+    }
+}
+
+// Write a checkpoint of the simulation into a binary stream.
+void sim::save_checkpoint(std::ostream &os) const
+{
+    boost::archive::binary_oarchive oa(os);
+    oa << *this;
+}
+
+// Restore a simulation from a checkpoint produced by save_checkpoint().
+// NOTE: the simulation is restored in an object constructed via the
+// private constructor, which (unlike the default constructor) does not
+// involve any JIT compilation.
+sim sim::load_checkpoint(std::istream &is)
+{
+    sim retval(ptag_t{}, {}, 0.);
+
+    boost::archive::binary_iarchive ia(is);
+    ia >> retval;
+
+    return retval;
+}
+
+} // namespace cascade
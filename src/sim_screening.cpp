@@ -0,0 +1,183 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/math/sum_sq.hpp>
+
+#include <cascade/sim.hpp>
+
+namespace cascade
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to check the semi-axes/half-sizes
+// of the built-in screening volumes.
+void check_ric_sizes(double r, double i, double c)
+{
+    for (const auto val : {r, i, c}) {
+        if (!std::isfinite(val) || val <= 0) {
+            throw std::invalid_argument(fmt::format(
+                "The sizes of a RIC screening volume must be finite and positive, but the sizes [{}, {}, {}] "
+                "were provided instead",
+                r, i, c));
+        }
+    }
+}
+
+// Helper to compute the squares of the components of the relative position of
+// the secondary in the radial/in-track/cross-track frame of the primary.
+// NOTE: the frame is defined by the position r and velocity v of the primary:
+// the radial direction is r/|r|, the cross-track direction is h/|h| (where h = r x v is
+// the angular momentum) and the in-track direction completes the right-handed triad.
+std::array<heyoka::expression, 3> ric_sq_components()
+{
+    namespace hy = heyoka;
+
+    const auto [x, y, z, vx, vy, vz, dx, dy, dz]
+        = hy::make_vars("x", "y", "z", "vx", "vy", "vz", "dx", "dy", "dz");
+
+    // Angular momentum.
+    const auto h_x = y * vz - z * vy;
+    const auto h_y = z * vx - x * vz;
+    const auto h_z = x * vy - y * vx;
+
+    // h x r (the in-track direction, scaled by |h||r|).
+    const auto it_x = h_y * z - h_z * y;
+    const auto it_y = h_z * x - h_x * z;
+    const auto it_z = h_x * y - h_y * x;
+
+    const auto r2 = hy::sum_sq({x, y, z});
+    const auto h2 = hy::sum_sq({h_x, h_y, h_z});
+
+    // Projections of the relative position onto the (unnormalised) axes.
+    const auto d_r = hy::sum({dx * x, dy * y, dz * z});
+    const auto d_i = hy::sum({dx * it_x, dy * it_y, dz * it_z});
+    const auto d_c = hy::sum({dx * h_x, dy * h_y, dz * h_z});
+
+    return {d_r * d_r / r2, d_i * d_i / (h2 * r2), d_c * d_c / h2};
+}
+
+} // namespace
+
+} // namespace detail
+
+// The variables which can appear in the predicates
+// of a screening volume, in the order in which they are
+// passed to the compiled function.
+const std::array<std::string, 12> &screening_volume::get_variables()
+{
+    static const std::array<std::string, 12> vars
+        = {"x", "y", "z", "vx", "vy", "vz", "dx", "dy", "dz", "dvx", "dvy", "dvz"};
+
+    return vars;
+}
+
+screening_volume::screening_volume(std::vector<heyoka::expression> preds, double bradius)
+    : m_preds(std::move(preds)), m_bradius(bradius)
+{
+    namespace hy = heyoka;
+
+    if (m_preds.empty()) {
+        throw std::invalid_argument("A screening volume must be defined by at least one predicate");
+    }
+
+    if (!std::isfinite(m_bradius) || m_bradius <= 0) {
+        throw std::invalid_argument(fmt::format(
+            "The bounding radius of a screening volume must be finite and positive, but it is {} instead", m_bradius));
+    }
+
+    const auto &allowed_vars = get_variables();
+
+    for (const auto &pred : m_preds) {
+        if (hy::get_param_size(pred) != 0u) {
+            throw std::invalid_argument(
+                fmt::format("The predicate '{}' of a screening volume cannot contain runtime parameters", pred));
+        }
+
+        for (const auto &var : hy::get_variables(pred)) {
+            if (std::find(allowed_vars.begin(), allowed_vars.end(), var) == allowed_vars.end()) {
+                throw std::invalid_argument(
+                    fmt::format("The predicate '{}' of a screening volume contains the invalid variable '{}' (the "
+                                "allowed variables are {})",
+                                pred, var, allowed_vars));
+            }
+        }
+    }
+}
+
+// Ellipsoid with semi-axes r, i and c along the
+// radial, in-track and cross-track directions.
+screening_volume screening_volume::ric_ellipsoid(double r, double i, double c)
+{
+    namespace hy = heyoka;
+
+    detail::check_ric_sizes(r, i, c);
+
+    const auto [d_r2, d_i2, d_c2] = detail::ric_sq_components();
+
+    return screening_volume({hy::sum({d_r2 / (r * r), d_i2 / (i * i), d_c2 / (c * c)}) - 1.}, std::max({r, i, c}));
+}
+
+// Box with half-sizes r, i and c along the
+// radial, in-track and cross-track directions.
+// NOTE: the box is the intersection of three slabs,
+// each represented by a separate predicate.
+screening_volume screening_volume::ric_box(double r, double i, double c)
+{
+    detail::check_ric_sizes(r, i, c);
+
+    const auto [d_r2, d_i2, d_c2] = detail::ric_sq_components();
+
+    return screening_volume({d_r2 / (r * r) - 1., d_i2 / (i * i) - 1., d_c2 / (c * c) - 1.},
+                            std::sqrt(r * r + i * i + c * c));
+}
+
+const std::vector<heyoka::expression> &screening_volume::get_predicates() const
+{
+    return m_preds;
+}
+
+double screening_volume::get_bounding_radius() const
+{
+    return m_bradius;
+}
+
+// The radius used for conjunction screening in the broad and
+// narrow phases. If a screening volume is defined, a conjunction
+// requires the secondary to be both within the conjunction threshold
+// and within the screening volume, hence the screening radius is the
+// smaller between the conjunction threshold and the bounding radius
+// of the volume.
+double sim::get_conj_screening_radius() const
+{
+    if (m_svol) {
+        return std::min(m_conj_thresh, m_svol->get_bounding_radius());
+    } else {
+        return m_conj_thresh;
+    }
+}
+
+} // namespace cascade
@@ -0,0 +1,556 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#if defined(CASCADE_WITH_HDF5)
+
+#include <hdf5.h>
+
+#endif
+
+#include <cascade/sim.hpp>
+#include <cascade/snapshot_writer.hpp>
+
+#include "detail/hdf5_utils.hpp"
+
+namespace cascade
+{
+
+#if defined(CASCADE_WITH_HDF5)
+
+namespace detail
+{
+
+namespace
+{
+
+// Create an extendable chunked dataset of doubles with the given
+// shape for each snapshot.
+h5_id h5_create_dataset(hid_t file, const char *name, const std::vector<hsize_t> &snap_shape, hsize_t chunk_n,
+                        unsigned compression)
+{
+    std::vector<hsize_t> dims{0}, max_dims{H5S_UNLIMITED}, chunk_dims{chunk_n};
+    for (const auto d : snap_shape) {
+        dims.push_back(d);
+        max_dims.push_back(d);
+        chunk_dims.push_back(d);
+    }
+
+    const auto rank = static_cast<int>(dims.size());
+
+    h5_id space(H5Screate_simple(rank, dims.data(), max_dims.data()), &H5Sclose, "dataspace creation");
+    h5_id plist(H5Pcreate(H5P_DATASET_CREATE), &H5Pclose, "property list creation");
+    h5_check(H5Pset_chunk(plist.get(), rank, chunk_dims.data()), "chunk setup");
+
+    if (compression != 0u) {
+        h5_check(H5Pset_shuffle(plist.get()), "shuffle filter setup");
+        h5_check(H5Pset_deflate(plist.get(), compression), "deflate filter setup");
+    }
+
+    return h5_id(H5Dcreate2(file, name, H5T_NATIVE_DOUBLE, space.get(), H5P_DEFAULT, plist.get(), H5P_DEFAULT),
+                 &H5Dclose, "dataset creation");
+}
+
+// Append a snapshot to a dataset created via h5_create_dataset().
+void h5_append(hid_t ds, hsize_t n, const std::vector<hsize_t> &snap_shape, const double *data)
+{
+    std::vector<hsize_t> new_dims{n + 1u}, start{n}, count{1};
+    for (const auto d : snap_shape) {
+        new_dims.push_back(d);
+        start.push_back(0);
+        count.push_back(d);
+    }
+
+    const auto rank = static_cast<int>(new_dims.size());
+
+    h5_check(H5Dset_extent(ds, new_dims.data()), "dataset extension");
+
+    h5_id fspace(H5Dget_space(ds), &H5Sclose, "dataspace retrieval");
+    h5_check(H5Sselect_hyperslab(fspace.get(), H5S_SELECT_SET, start.data(), nullptr, count.data(), nullptr),
+             "hyperslab selection");
+    h5_id mspace(H5Screate_simple(rank, count.data(), nullptr), &H5Sclose, "dataspace creation");
+
+    h5_check(H5Dwrite(ds, H5T_NATIVE_DOUBLE, mspace.get(), fspace.get(), H5P_DEFAULT, data), "dataset write");
+}
+
+} // namespace
+
+} // namespace detail
+
+#endif
+
+struct snapshot_writer::impl {
+    struct buffer {
+        double time = 0;
+        std::vector<double> state;
+        std::vector<double> pars;
+    };
+
+    std::string m_path;
+    std::uint64_t m_snap_every = 0;
+    std::vector<double> m_snap_times;
+    unsigned m_compression = 0;
+    bool m_closed = false;
+
+    // Data used to determine when
+    // the snapshots must be taken.
+    std::uint64_t m_n_steps = 0;
+    std::vector<double>::size_type m_snap_time_idx = 0;
+    std::optional<double> m_last_time;
+
+    // The shape of the snapshots, established
+    // by the first snapshot.
+    std::optional<std::array<std::size_t, 2>> m_shape;
+
+    // The snapshot buffers and the queue of
+    // the buffers waiting to be written.
+    std::vector<buffer> m_buffers;
+    std::vector<buffer *> m_free;
+    std::deque<buffer *> m_queue;
+
+    // Data for the background writer.
+    // NOTE: m_n_busy is the number of buffers either in the queue or
+    // being written by the writer thread.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::size_t m_n_busy = 0;
+    std::uint64_t m_n_written = 0;
+    std::exception_ptr m_write_error;
+    std::thread m_writer;
+
+#if defined(CASCADE_WITH_HDF5)
+
+    detail::h5_id m_file, m_ds_time, m_ds_state, m_ds_pars;
+
+    // Write a snapshot to the file.
+    // NOTE: this is invoked only by the writer thread.
+    void write(const buffer &buf, std::uint64_t n)
+    {
+        std::lock_guard lock(detail::hdf5_mutex);
+
+        assert(buf.state.size() % 7u == 0u);
+        const auto nparts = static_cast<hsize_t>(buf.state.size() / 7u);
+        const auto npars = static_cast<hsize_t>(buf.pars.size() / nparts);
+
+        if (!m_ds_time) {
+            // Create the datasets at the first snapshot, when
+            // the shapes are known. The time coordinates are chunked
+            // in groups, the states and the parameters one snapshot at a time.
+            m_ds_time = detail::h5_create_dataset(m_file.get(), "time", {}, 1024, m_compression);
+            m_ds_state = detail::h5_create_dataset(m_file.get(), "state", {nparts, 7}, 1, m_compression);
+            if (npars != 0u) {
+                m_ds_pars = detail::h5_create_dataset(m_file.get(), "pars", {nparts, npars}, 1, m_compression);
+            }
+        }
+
+        detail::h5_append(m_ds_time.get(), n, {}, &buf.time);
+        detail::h5_append(m_ds_state.get(), n, {nparts, 7}, buf.state.data());
+        if (m_ds_pars) {
+            detail::h5_append(m_ds_pars.get(), n, {nparts, npars}, buf.pars.data());
+        }
+    }
+
+    void h5_flush()
+    {
+        std::lock_guard lock(detail::hdf5_mutex);
+
+        detail::h5_check(H5Fflush(m_file.get(), H5F_SCOPE_LOCAL), "file flush");
+    }
+
+    void h5_close()
+    {
+        std::lock_guard lock(detail::hdf5_mutex);
+
+        m_ds_pars.reset();
+        m_ds_state.reset();
+        m_ds_time.reset();
+        m_file.reset();
+    }
+
+#endif
+
+    void writer_loop()
+    {
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+
+            if (!m_queue.empty()) {
+                auto *buf = m_queue.front();
+                m_queue.pop_front();
+
+                // NOTE: the number of snapshots already written
+                // is the index of the new snapshot in the file.
+                [[maybe_unused]] const auto n = m_n_written;
+                // NOTE: after a write error, the remaining
+                // snapshots are discarded.
+                [[maybe_unused]] const auto discard = static_cast<bool>(m_write_error);
+
+                // Write without holding the mutex, so that
+                // submit() can keep on filling other buffers.
+                lock.unlock();
+
+                std::exception_ptr err;
+                try {
+#if defined(CASCADE_WITH_HDF5)
+                    if (!discard) {
+                        write(*buf, n);
+                    }
+#endif
+                    // LCOV_EXCL_START
+                } catch (...) {
+                    err = std::current_exception();
+                }
+                // LCOV_EXCL_STOP
+
+                lock.lock();
+
+                if (err) {
+                    // LCOV_EXCL_START
+                    if (!m_write_error) {
+                        m_write_error = err;
+                    }
+                    // LCOV_EXCL_STOP
+                } else if (!m_write_error) {
+                    ++m_n_written;
+                }
+
+                m_free.push_back(buf);
+                --m_n_busy;
+
+                m_cv.notify_all();
+            } else {
+                assert(m_stop);
+
+                break;
+            }
+        }
+    }
+
+    void check_write_error()
+    {
+        if (m_write_error) {
+            // LCOV_EXCL_START
+            std::rethrow_exception(std::exchange(m_write_error, nullptr));
+            // LCOV_EXCL_STOP
+        }
+    }
+};
+
+void snapshot_writer::finalise_ctor(std::string path, std::uint64_t snap_every, std::vector<double> snap_times,
+                                    unsigned compression, std::size_t queue_size)
+{
+#if defined(CASCADE_WITH_HDF5)
+
+    if (compression > 9u) {
+        throw std::invalid_argument(fmt::format(
+            "The compression level of a snapshot writer must be in the [0, 9] range, but it is {} instead",
+            compression));
+    }
+
+    if (queue_size == 0u) {
+        throw std::invalid_argument("The queue size of a snapshot writer cannot be zero");
+    }
+
+    for (const auto t : snap_times) {
+        if (!std::isfinite(t)) {
+            throw std::invalid_argument(
+                fmt::format("The snapshot times of a snapshot writer must be finite, but the time {} was provided", t));
+        }
+    }
+
+    // Sort the snapshot times and remove the duplicates.
+    std::sort(snap_times.begin(), snap_times.end());
+    snap_times.erase(std::unique(snap_times.begin(), snap_times.end()), snap_times.end());
+
+    auto im = std::make_unique<impl>();
+    im->m_path = std::move(path);
+    im->m_snap_every = snap_every;
+    im->m_snap_times = std::move(snap_times);
+    im->m_compression = compression;
+
+    im->m_buffers.resize(queue_size);
+    for (auto &buf : im->m_buffers) {
+        im->m_free.push_back(&buf);
+    }
+
+    // Create the file.
+    {
+        std::lock_guard lock(detail::hdf5_mutex);
+
+        try {
+            im->m_file = detail::h5_id(H5Fcreate(im->m_path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT),
+                                       &H5Fclose, "file creation");
+        } catch (const std::invalid_argument &) {
+            throw std::invalid_argument(
+                fmt::format("Unable to create the HDF5 file '{}' for writing the snapshots", im->m_path));
+        }
+    }
+
+    // Start the writer.
+    im->m_writer = std::thread([p = im.get()]() { p->writer_loop(); });
+
+    m_impl = std::move(im);
+
+#else
+
+    // LCOV_EXCL_START
+    throw std::runtime_error("Snapshot writers are not available because cascade was built without HDF5 support");
+    // LCOV_EXCL_STOP
+
+#endif
+}
+
+snapshot_writer::snapshot_writer(ptag_t) {}
+
+snapshot_writer::~snapshot_writer()
+{
+    // NOTE: m_impl is null if the construction failed.
+    if (!m_impl) {
+        return;
+    }
+
+    try {
+        close();
+        // LCOV_EXCL_START
+    } catch (...) {
+        // NOTE: errors during the closing of the file cannot be
+        // reported from the destructor. Make sure at
+        // least that the writer thread is stopped.
+        if (m_impl->m_writer.joinable()) {
+            {
+                std::lock_guard lock(m_impl->m_mutex);
+                m_impl->m_stop = true;
+            }
+            m_impl->m_cv.notify_all();
+            m_impl->m_writer.join();
+        }
+    }
+    // LCOV_EXCL_STOP
+}
+
+const std::string &snapshot_writer::get_path() const
+{
+    return m_impl->m_path;
+}
+
+std::uint64_t snapshot_writer::get_snap_every() const
+{
+    return m_impl->m_snap_every;
+}
+
+const std::vector<double> &snapshot_writer::get_snap_times() const
+{
+    return m_impl->m_snap_times;
+}
+
+unsigned snapshot_writer::get_compression() const
+{
+    return m_impl->m_compression;
+}
+
+std::size_t snapshot_writer::get_queue_size() const
+{
+    return m_impl->m_buffers.size();
+}
+
+// Number of snapshots written to the file so far.
+std::uint64_t snapshot_writer::get_n_snapshots() const
+{
+    std::lock_guard lock(m_impl->m_mutex);
+
+    return m_impl->m_n_written;
+}
+
+// Queue a snapshot for writing. This will block
+// only if all the snapshot buffers are in use.
+void snapshot_writer::submit(double time, std::span<const double> state, std::span<const double> pars)
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        throw std::invalid_argument(fmt::format("Cannot write to the closed snapshot file '{}'", im.m_path));
+    }
+
+    if (state.size() % 7u != 0u) {
+        throw std::invalid_argument(fmt::format(
+            "The size of the state vector of a snapshot must be a multiple of 7, but it is {} instead", state.size()));
+    }
+
+    if (state.empty()) {
+        throw std::invalid_argument("Cannot write a snapshot with no particles");
+    }
+
+    const auto nparts = state.size() / 7u;
+    const auto npars = pars.size() / nparts;
+
+    if (pars.size() != nparts * npars) {
+        throw std::invalid_argument(
+            fmt::format("The size of the parameters vector of a snapshot ({}) is inconsistent with the number "
+                        "of particles ({})",
+                        pars.size(), nparts));
+    }
+
+    const std::array<std::size_t, 2> shape{nparts, npars};
+    if (im.m_shape && *im.m_shape != shape) {
+        throw std::invalid_argument(fmt::format(
+            "The number of particles and parameters in a snapshot ({} and {}) differ from the number of particles "
+            "and parameters in the first snapshot ({} and {})",
+            nparts, npars, (*im.m_shape)[0], (*im.m_shape)[1]));
+    }
+
+    // Fetch a free buffer.
+    impl::buffer *buf = nullptr;
+    {
+        std::unique_lock lock(im.m_mutex);
+
+        im.m_cv.wait(lock, [&im]() { return !im.m_free.empty(); });
+
+        im.check_write_error();
+
+        buf = im.m_free.back();
+        im.m_free.pop_back();
+    }
+
+    // Fill in the buffer.
+    // NOTE: the writer thread never accesses
+    // the free buffers, thus there is no need to hold the mutex.
+    try {
+        buf->time = time;
+        buf->state.assign(state.begin(), state.end());
+        buf->pars.assign(pars.begin(), pars.end());
+        // LCOV_EXCL_START
+    } catch (...) {
+        std::lock_guard lock(im.m_mutex);
+        im.m_free.push_back(buf);
+
+        throw;
+    }
+    // LCOV_EXCL_STOP
+
+    // NOTE: m_shape is accessed only from the thread submitting
+    // the snapshots, the writer thread infers the shape from the buffer.
+    im.m_shape = shape;
+    im.m_last_time = time;
+
+    // Queue the buffer.
+    {
+        std::lock_guard lock(im.m_mutex);
+
+        im.m_queue.push_back(buf);
+        ++im.m_n_busy;
+    }
+    im.m_cv.notify_all();
+}
+
+// Wait until all the snapshots queued so far have been written to disk.
+void snapshot_writer::flush()
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        return;
+    }
+
+    {
+        std::unique_lock lock(im.m_mutex);
+        im.m_cv.wait(lock, [&im]() { return im.m_n_busy == 0u; });
+
+        im.check_write_error();
+    }
+
+#if defined(CASCADE_WITH_HDF5)
+    im.h5_flush();
+#endif
+}
+
+// Flush the data, stop the writer and close the file.
+void snapshot_writer::close()
+{
+    auto &im = *m_impl;
+
+    if (im.m_closed) {
+        return;
+    }
+
+    flush();
+
+    {
+        std::lock_guard lock(im.m_mutex);
+        im.m_stop = true;
+    }
+    im.m_cv.notify_all();
+    im.m_writer.join();
+
+#if defined(CASCADE_WITH_HDF5)
+    im.h5_close();
+#endif
+
+    im.m_closed = true;
+}
+
+// Fetch the next snapshot time, if any.
+std::optional<double> snapshot_writer::next_snap_time() const
+{
+    const auto &im = *m_impl;
+
+    if (im.m_snap_time_idx < im.m_snap_times.size()) {
+        return im.m_snap_times[im.m_snap_time_idx];
+    } else {
+        return {};
+    }
+}
+
+void snapshot_writer::pop_snap_time()
+{
+    auto &im = *m_impl;
+
+    assert(im.m_snap_time_idx < im.m_snap_times.size());
+    ++im.m_snap_time_idx;
+}
+
+// Account for a step taken by the sim, returning true
+// if a snapshot must be taken at the end of the step.
+bool snapshot_writer::step_done()
+{
+    auto &im = *m_impl;
+
+    ++im.m_n_steps;
+
+    return im.m_snap_every != 0u && im.m_n_steps % im.m_snap_every == 0u;
+}
+
+// Fetch the time coordinate of the last submitted snapshot, if any.
+std::optional<double> snapshot_writer::last_snap_time() const
+{
+    return m_impl->m_last_time;
+}
+
+} // namespace cascade
@@ -0,0 +1,189 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <cascade/checkpointer.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *ckpt_path = "cascade_checkpointer_test.ckpt";
+
+// Check that the restored sim matches s.
+void check_restore(const sim &s)
+{
+    const auto s2 = checkpointer::restore(ckpt_path);
+
+    REQUIRE(s2.get_state() == s.get_state());
+    REQUIRE(s2.get_pars() == s.get_pars());
+    REQUIRE(s2.get_ids() == s.get_ids());
+    REQUIRE(s2.get_time() == s.get_time());
+    REQUIRE(s2.get_ct() == s.get_ct());
+    REQUIRE(s2.get_conj_whitelist() == s.get_conj_whitelist());
+    REQUIRE(s2.get_conj_tier_counts() == s.get_conj_tier_counts());
+    REQUIRE(s2.get_interrupt_info() == s.get_interrupt_info());
+
+    REQUIRE(s2.get_conjunctions().size() == s.get_conjunctions().size());
+    for (decltype(s.get_conjunctions().size()) k = 0; k < s.get_conjunctions().size(); ++k) {
+        REQUIRE(s2.get_conjunctions()[k].i == s.get_conjunctions()[k].i);
+        REQUIRE(s2.get_conjunctions()[k].j == s.get_conjunctions()[k].j);
+        REQUIRE(s2.get_conjunctions()[k].id_i == s.get_conjunctions()[k].id_i);
+        REQUIRE(s2.get_conjunctions()[k].id_j == s.get_conjunctions()[k].id_j);
+        REQUIRE(s2.get_conjunctions()[k].time == s.get_conjunctions()[k].time);
+    }
+}
+
+} // namespace
+
+TEST_CASE("checkpointer api")
+{
+    REQUIRE_THROWS_AS(checkpointer("/this/path/does/not/exist.ckpt"), std::invalid_argument);
+    REQUIRE_THROWS_AS(checkpointer::restore("/this/path/does/not/exist.ckpt"), std::invalid_argument);
+
+    {
+        checkpointer ckpt(ckpt_path);
+        REQUIRE(ckpt.get_path() == ckpt_path);
+        REQUIRE(ckpt.get_ckpt_every() == 1u);
+        REQUIRE(ckpt.get_xor_delta());
+        REQUIRE(ckpt.get_n_records() == 0u);
+    }
+
+    // No base record.
+    REQUIRE_THROWS_AS(checkpointer::restore(ckpt_path), std::invalid_argument);
+
+    checkpointer ckpt(ckpt_path, kw::ckpt_every = 0, kw::xor_delta = false);
+    REQUIRE(ckpt.get_ckpt_every() == 0u);
+    REQUIRE(!ckpt.get_xor_delta());
+
+    std::remove(ckpt_path);
+}
+
+TEST_CASE("checkpointer sim")
+{
+    // Add a particle on a far away circular
+    // orbit in front of the polar particles.
+    auto state = polar_state;
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    state.insert(state.begin(), far.begin(), far.end());
+
+    for (auto xor_delta : {true, false}) {
+        sim s(state, 0.23, kw::conj_thresh = psize * 100000000);
+
+        auto ckpt = std::make_shared<checkpointer>(ckpt_path, kw::xor_delta = xor_delta);
+        s.set_checkpointer(ckpt);
+        REQUIRE(s.get_checkpointer() == ckpt);
+
+        // The checkpointer is not copied.
+        REQUIRE(!sim(s).get_checkpointer());
+
+        // The first record is a base record.
+        s.step();
+        REQUIRE(ckpt->get_n_records() == 1u);
+        const auto base_size = ckpt->get_n_bytes();
+        check_restore(s);
+
+        // The delta records are much smaller than the base record.
+        s.step();
+        REQUIRE(ckpt->get_n_records() == 2u);
+        REQUIRE(ckpt->get_n_bytes() - base_size < base_size / 10u);
+        check_restore(s);
+
+        // The last record written by propagate_until() holds the
+        // state at the final time, after the rollback.
+        s.propagate_until(10.);
+        REQUIRE(s.get_time() == 10.);
+        check_restore(s);
+
+        // Remove the far away particle and change some settings.
+        s.remove_particles({0});
+        s.set_ct(0.2);
+        s.set_conj_whitelist({0, 1});
+        s.step();
+        check_restore(s);
+
+        s.propagate_until(15.);
+        check_restore(s);
+
+        // Add back the far away particle: the ids are
+        // no longer a single run of consecutive values.
+        s.add_particles(far);
+        REQUIRE(s.get_ids() == std::vector<std::uint64_t>{1, 2, 3});
+        s.remove_particles({1});
+        REQUIRE(s.get_ids() == std::vector<std::uint64_t>{1, 3});
+        s.step();
+        check_restore(s);
+        s.remove_particles({1});
+        s.step();
+        check_restore(s);
+
+        // Conjunction reset.
+        s.reset_conjunctions();
+        s.propagate_until(20.);
+        check_restore(s);
+
+        // Replace the state.
+        s.set_new_state_pars(polar_state);
+        ckpt->write(s);
+        check_restore(s);
+
+        // A new base record.
+        s.step();
+        ckpt->write_base(s);
+        s.step();
+        check_restore(s);
+
+        // An incomplete record at the end of the file is ignored.
+        const auto ref_s = s;
+        const auto size = ckpt->get_n_bytes();
+        s.step();
+        std::filesystem::resize_file(ckpt_path, (size + ckpt->get_n_bytes()) / 2u);
+        check_restore(ref_s);
+
+        // Records are written only at the requested frequency.
+        ckpt = std::make_shared<checkpointer>(ckpt_path, kw::ckpt_every = 3);
+        s.set_checkpointer(ckpt);
+        s.step();
+        s.step();
+        REQUIRE(ckpt->get_n_records() == 0u);
+        s.step();
+        REQUIRE(ckpt->get_n_records() == 1u);
+        check_restore(s);
+    }
+
+    std::remove(ckpt_path);
+}
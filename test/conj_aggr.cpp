@@ -0,0 +1,218 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+TEST_CASE("conj aggr api")
+{
+    sim s(polar_state, 0.23, kw::conj_thresh = psize * 100000000);
+
+    REQUIRE(s.get_conj_aggr() == conj_aggr_mode::none);
+    REQUIRE(s.get_conj_aggr_window() == 0);
+    REQUIRE(s.get_n_pending_conjunctions() == 0u);
+
+    REQUIRE_THROWS_AS(s.set_conj_aggr(conj_aggr_mode::window), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_aggr_window(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_aggr_window(std::numeric_limits<double>::infinity()), std::invalid_argument);
+
+    s.set_conj_aggr_window(5.);
+    s.set_conj_aggr(conj_aggr_mode::window);
+    REQUIRE(s.get_conj_aggr() == conj_aggr_mode::window);
+    REQUIRE(s.get_conj_aggr_window() == 5.);
+    REQUIRE_THROWS_AS(s.set_conj_aggr_window(0.), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(sim(polar_state, 0.23, kw::conj_aggr = conj_aggr_mode::window), std::invalid_argument);
+    REQUIRE_THROWS_AS(sim(polar_state, 0.23, kw::conj_aggr_window = -1.), std::invalid_argument);
+
+    // Pending conjunctions are preserved by copies and
+    // discarded by reset_conjunctions().
+    s.propagate_until(3.);
+    REQUIRE(s.get_conjunctions().empty());
+    const auto n_pending = s.get_n_pending_conjunctions();
+
+    auto s2 = s;
+    REQUIRE(s2.get_n_pending_conjunctions() == n_pending);
+
+    s.reset_conjunctions();
+    REQUIRE(s.get_n_pending_conjunctions() == 0u);
+
+    // Switching mode flushes.
+    s2.set_conj_aggr(conj_aggr_mode::none);
+    REQUIRE(s2.get_n_pending_conjunctions() == 0u);
+    REQUIRE(s2.get_conjunctions().size() == n_pending);
+}
+
+TEST_CASE("conj aggr")
+{
+    for (auto n_par_ct : {1u, 3u}) {
+        // Reference simulation without aggregation.
+        sim s_ref(polar_state, 0.23, kw::conj_thresh = psize * 100000000, kw::n_par_ct = n_par_ct);
+        s_ref.propagate_until(20.);
+
+        const auto &ref_conj = s_ref.get_conjunctions();
+        REQUIRE(ref_conj.size() == 6u);
+
+        // Superstep aggregation: there is at most one minimum per superstep,
+        // thus the results must match the reference.
+        sim s_ss(polar_state, 0.23, kw::conj_thresh = psize * 100000000, kw::n_par_ct = n_par_ct,
+                 kw::conj_aggr = conj_aggr_mode::superstep);
+        s_ss.propagate_until(20.);
+
+        REQUIRE(s_ss.get_n_pending_conjunctions() == 0u);
+        REQUIRE(s_ss.get_conjunctions().size() == ref_conj.size());
+
+        for (decltype(ref_conj.size()) k = 0; k < ref_conj.size(); ++k) {
+            const auto &c = s_ss.get_conjunctions()[k];
+
+            REQUIRE(c.time == ref_conj[k].time);
+            REQUIRE(c.dist == ref_conj[k].dist);
+            REQUIRE(c.n_min == 1u);
+            REQUIRE(c.time_under > 0);
+            REQUIRE(c.time_under <= 0.23 * n_par_ct * (1 + 1e-12));
+        }
+
+        // Window aggregation.
+        const auto w = 5.;
+        sim s_w(polar_state, 0.23, kw::conj_thresh = psize * 100000000, kw::n_par_ct = n_par_ct,
+                kw::conj_aggr = conj_aggr_mode::window, kw::conj_aggr_window = w);
+        s_w.propagate_until(20.);
+        s_w.flush_conjunctions();
+
+        REQUIRE(s_w.get_n_pending_conjunctions() == 0u);
+
+        const auto &w_conj = s_w.get_conjunctions();
+        REQUIRE(w_conj.size() < ref_conj.size());
+        REQUIRE(std::is_sorted(w_conj.begin(), w_conj.end(),
+                               [](const auto &c1, const auto &c2) { return c1.time < c2.time; }));
+
+        decltype(ref_conj[0].n_min) tot_n_min = 0;
+        for (const auto &c : w_conj) {
+            tot_n_min += c.n_min;
+
+            REQUIRE(c.time_under > 0);
+            REQUIRE(c.time_under <= w * (1 + 1e-12));
+
+            // Compute the closest approach in the window from the reference data.
+            const auto widx = std::floor(c.time / w);
+            auto min_dist = std::numeric_limits<double>::infinity();
+            decltype(c.n_min) n_min = 0;
+            for (const auto &rc : ref_conj) {
+                if (std::floor(rc.time / w) == widx) {
+                    min_dist = std::min(min_dist, rc.dist);
+                    ++n_min;
+                }
+            }
+
+            REQUIRE(c.dist == min_dist);
+            REQUIRE(c.n_min == n_min);
+        }
+
+        REQUIRE(tot_n_min == ref_conj.size());
+    }
+}
+
+// The pending aggregated conjunctions must follow
+// the renumbering of the particles on removal.
+TEST_CASE("conj aggr remove particles")
+{
+    const auto w = 5.;
+
+    // Reference simulation.
+    sim s_ref(polar_state, 0.23, kw::conj_thresh = psize * 100000000, kw::conj_aggr = conj_aggr_mode::window,
+              kw::conj_aggr_window = w);
+    s_ref.propagate_until(20.);
+    s_ref.flush_conjunctions();
+
+    const auto &ref_conj = s_ref.get_conjunctions();
+    REQUIRE(!ref_conj.empty());
+
+    // Same setup, with an additional particle on a distant
+    // circular orbit inserted at the beginning.
+    auto state = polar_state;
+    state.insert(state.begin(), {10., 0., 0., 0., std::sqrt(1. / 10), 0., psize});
+
+    sim s(state, 0.23, kw::conj_thresh = psize * 100000000, kw::conj_aggr = conj_aggr_mode::window,
+          kw::conj_aggr_window = w);
+
+    // Propagate so that there are pending conjunctions
+    // involving the particles at indices 1 and 2.
+    s.propagate_until(7.);
+    REQUIRE(s.get_n_pending_conjunctions() > 0u);
+
+    // Removing a particle involved in the pending
+    // conjunctions flushes them with the original indices.
+    {
+        auto s2 = s;
+        const auto n_pending = s2.get_n_pending_conjunctions();
+        const auto n_conj = s2.get_conjunctions().size();
+
+        s2.remove_particles({2});
+
+        REQUIRE(s2.get_n_pending_conjunctions() == 0u);
+        REQUIRE(s2.get_conjunctions().size() == n_conj + n_pending);
+        REQUIRE(s2.get_conjunctions().back().i == 1u);
+        REQUIRE(s2.get_conjunctions().back().j == 2u);
+    }
+
+    // Removing the distant particle re-keys the pending conjunctions,
+    // which must then aggregate the subsequent minima as in the reference.
+    const auto n_pending = s.get_n_pending_conjunctions();
+    s.remove_particles({0});
+    REQUIRE(s.get_n_pending_conjunctions() == n_pending);
+
+    s.propagate_until(20.);
+    s.flush_conjunctions();
+
+    const auto &conj = s.get_conjunctions();
+    REQUIRE(conj.size() == ref_conj.size());
+
+    for (decltype(conj.size()) k = 0; k < conj.size(); ++k) {
+        REQUIRE(conj[k].time == ref_conj[k].time);
+        REQUIRE(conj[k].dist == ref_conj[k].dist);
+        REQUIRE(conj[k].n_min == ref_conj[k].n_min);
+
+        // NOTE: the conjunctions in the windows flushed before
+        // the removal refer to the original indices.
+        if (std::floor(conj[k].time / w) < std::floor(7. / w)) {
+            REQUIRE(conj[k].i == 1u);
+            REQUIRE(conj[k].j == 2u);
+        } else {
+            REQUIRE(conj[k].i == 0u);
+            REQUIRE(conj[k].j == 1u);
+        }
+    }
+}
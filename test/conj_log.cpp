@@ -0,0 +1,158 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *log_path = "cascade_conj_log_test.bin";
+
+// Read the number of records from the header
+// and the records from a log file.
+std::vector<sim::conjunction> read_log(std::uint64_t &n)
+{
+    std::ifstream ifile(log_path, std::ios::binary);
+
+    char hdr[32] = {};
+    ifile.read(hdr, sizeof(hdr));
+    REQUIRE(ifile);
+    REQUIRE(std::memcmp(hdr, "CSCDCLOG", 8) == 0);
+    std::memcpy(&n, hdr + 24, sizeof(n));
+
+    std::vector<sim::conjunction> retval(n);
+    ifile.seekg(static_cast<std::streamoff>(conj_log_header_size));
+    ifile.read(reinterpret_cast<char *>(retval.data()),
+               static_cast<std::streamsize>(retval.size() * sizeof(sim::conjunction)));
+    REQUIRE(ifile);
+
+    return retval;
+}
+
+} // namespace
+
+TEST_CASE("conj log")
+{
+    sim s_ref(polar_state, 0.23, kw::conj_thresh = psize * 100000000);
+    s_ref.propagate_until(20.);
+    const auto &ref_conj = s_ref.get_conjunctions();
+    REQUIRE(ref_conj.size() == 6u);
+
+    {
+        sim s(polar_state, 0.23, kw::conj_thresh = psize * 100000000);
+        auto ls = std::make_shared<conj_log_sink>(log_path);
+        REQUIRE(ls->get_path() == log_path);
+        s.set_conj_sink(ls);
+        s.propagate_until(20.);
+
+        REQUIRE(ls->get_n_records() == 6u);
+
+        // The data is readable while the log is open.
+        ls->flush();
+        std::uint64_t n = 0;
+        const auto recs = read_log(n);
+        REQUIRE(n == 6u);
+        for (decltype(recs.size()) k = 0; k < recs.size(); ++k) {
+            REQUIRE(recs[k].time == ref_conj[k].time);
+            REQUIRE(recs[k].dist == ref_conj[k].dist);
+        }
+
+        ls->close();
+        REQUIRE_THROWS_AS(ls->push(std::span<const sim::conjunction>(ref_conj.data(), ref_conj.size())),
+                          std::invalid_argument);
+
+        // The preallocated space is trimmed on close.
+        REQUIRE(std::filesystem::file_size(log_path) == conj_log_header_size + 6u * sizeof(sim::conjunction));
+    }
+
+    // Append mode, with enough records to generate index entries.
+    {
+        std::vector<sim::conjunction> cv(3000);
+        for (decltype(cv.size()) k = 0; k < cv.size(); ++k) {
+            cv[k].i = k;
+            cv[k].time = 100. + static_cast<double>(k);
+        }
+
+        conj_log_sink ls(log_path, true);
+        REQUIRE(ls.get_n_records() == 6u);
+
+        ls.push(std::span<const sim::conjunction>(cv.data(), 1000));
+        ls.push(std::span<const sim::conjunction>(cv.data() + 1000, 2000));
+        REQUIRE(ls.get_n_records() == 3006u);
+    }
+
+    std::uint64_t n = 0;
+    const auto recs = read_log(n);
+    REQUIRE(n == 3006u);
+    REQUIRE(recs[5].time == ref_conj[5].time);
+    REQUIRE(recs[6].time == 100.);
+    REQUIRE(recs[3005].time == 100. + 2999);
+
+    // Check the index.
+    {
+        std::ifstream ifile(std::string(log_path) + ".idx", std::ios::binary);
+        std::vector<char> buf((std::istreambuf_iterator<char>(ifile)), std::istreambuf_iterator<char>());
+        REQUIRE(buf.size() == 3u * 16u);
+
+        for (std::uint64_t k = 0; k < 3u; ++k) {
+            double tm = 0;
+            std::uint64_t idx = 0;
+            std::memcpy(&tm, buf.data() + k * 16u, sizeof(tm));
+            std::memcpy(&idx, buf.data() + k * 16u + 8u, sizeof(idx));
+
+            REQUIRE(idx == k * conj_log_index_stride);
+            REQUIRE(tm == recs[idx].time);
+        }
+    }
+
+    // Invalid files.
+    {
+        std::ofstream ofile(log_path, std::ios::binary | std::ios::trunc);
+        ofile << "hello world";
+    }
+    REQUIRE_THROWS_AS(conj_log_sink(log_path, true), std::invalid_argument);
+
+    std::remove(log_path);
+    std::remove((std::string(log_path) + ".idx").c_str());
+}
@@ -0,0 +1,271 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+const auto max_thresh = psize * 100000000;
+
+const std::vector<double> tiers = {max_thresh / 2, max_thresh};
+
+namespace
+{
+
+bool conj_equal(const sim::conjunction &c1, const sim::conjunction &c2)
+{
+    return c1.i == c2.i && c1.j == c2.j && c1.time == c2.time && c1.dist == c2.dist && c1.state_i == c2.state_i
+           && c1.state_j == c2.state_j && c1.tier == c2.tier;
+}
+
+} // namespace
+
+TEST_CASE("conj sink api")
+{
+    REQUIRE_THROWS_AS(ring_conj_sink(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(callback_conj_sink({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(file_conj_sink(""), std::invalid_argument);
+
+    sim s(polar_state, 0.23, kw::conj_thresh = max_thresh);
+    REQUIRE(!s.get_conj_sink());
+
+    auto ms = std::make_shared<memory_conj_sink>();
+    s.set_conj_sink(ms);
+    REQUIRE(s.get_conj_sink() == ms);
+
+    // The sink is not copied.
+    auto s2 = s;
+    REQUIRE(!s2.get_conj_sink());
+
+    s.set_conj_sink({});
+    REQUIRE(!s.get_conj_sink());
+}
+
+TEST_CASE("conj sink")
+{
+    for (auto n_par_ct : {1u, 3u}) {
+        // Reference simulation without sink.
+        sim s_ref(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        s_ref.propagate_until(20.);
+
+        const auto &ref_conj = s_ref.get_conjunctions();
+        REQUIRE(ref_conj.size() == 6u);
+
+        // Memory sink.
+        sim s(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        auto ms = std::make_shared<memory_conj_sink>();
+        s.set_conj_sink(ms);
+
+        while (s.get_time() < 20.) {
+            s.step();
+            REQUIRE(s.get_conjunctions().empty());
+        }
+
+        // NOTE: the simulation with the sink may have stepped
+        // slightly past the final time of the reference.
+        REQUIRE(ms->get_conjunctions().size() >= ref_conj.size());
+        REQUIRE(std::equal(ref_conj.begin(), ref_conj.end(), ms->get_conjunctions().begin(), conj_equal));
+
+        // The per-tier counters are still updated.
+        REQUIRE(s.get_conj_tier_counts()[0] + s.get_conj_tier_counts()[1] == ms->get_conjunctions().size());
+
+        ms->clear();
+        REQUIRE(ms->get_conjunctions().empty());
+
+        // Counting sink.
+        sim s_cnt(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        auto cs = std::make_shared<counting_conj_sink>();
+        s_cnt.set_conj_sink(cs);
+        s_cnt.propagate_until(20.);
+
+        REQUIRE(s_cnt.get_conjunctions().empty());
+        REQUIRE(cs->get_n_conj() == ref_conj.size());
+        REQUIRE(cs->get_tier_counts().size() <= 2u);
+        for (decltype(cs->get_tier_counts().size()) t = 0; t < cs->get_tier_counts().size(); ++t) {
+            REQUIRE(cs->get_tier_counts()[t] == s_ref.get_conj_tier_counts()[t]);
+        }
+
+        cs->reset();
+        REQUIRE(cs->get_n_conj() == 0u);
+        REQUIRE(cs->get_tier_counts().empty());
+
+        // Callback sink: verify that the batches are time-ordered.
+        sim s_cb(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        std::vector<sim::conjunction> cb_conj;
+        s_cb.set_conj_sink(std::make_shared<callback_conj_sink>([&cb_conj](std::span<const sim::conjunction> cv) {
+            REQUIRE(!cv.empty());
+            REQUIRE(std::is_sorted(cv.begin(), cv.end(),
+                                   [](const auto &c1, const auto &c2) { return c1.time < c2.time; }));
+            REQUIRE((cb_conj.empty() || cb_conj.back().time <= cv.front().time));
+
+            cb_conj.insert(cb_conj.end(), cv.begin(), cv.end());
+        }));
+        s_cb.propagate_until(20.);
+
+        REQUIRE(cb_conj.size() == ref_conj.size());
+
+        // A throwing sink keeps the conjunctions in the sim.
+        sim s_th(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        s_th.set_conj_sink(std::make_shared<callback_conj_sink>(
+            [](std::span<const sim::conjunction>) { throw std::invalid_argument(""); }));
+        REQUIRE_THROWS_AS(s_th.propagate_until(20.), std::invalid_argument);
+        REQUIRE(!s_th.get_conjunctions().empty());
+        s_th.set_conj_sink({});
+        s_th.propagate_until(20.);
+        REQUIRE(s_th.get_conjunctions().size() == ref_conj.size());
+
+        // A sink failing once: the step is committed anyway, and the
+        // conjunctions are pushed again at the end of the next step.
+        sim s_once(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        bool fail = true;
+        std::vector<sim::conjunction> once_conj;
+        s_once.set_conj_sink(
+            std::make_shared<callback_conj_sink>([&fail, &once_conj](std::span<const sim::conjunction> cv) {
+                if (fail) {
+                    fail = false;
+                    throw std::invalid_argument("");
+                }
+
+                once_conj.insert(once_conj.end(), cv.begin(), cv.end());
+            }));
+        while (fail) {
+            const auto t0 = s_once.get_time();
+
+            s_once.step();
+            REQUIRE(s_once.get_time() > t0);
+        }
+        REQUIRE(!s_once.get_conjunctions().empty());
+        REQUIRE(s_once.get_output_errors().size() == 1u);
+        REQUIRE(s_once.get_output_errors()[0].component == "conjunction sink");
+        REQUIRE(s_once.get_output_errors()[0].time == s_once.get_time());
+        REQUIRE(s_once.get_output_errors()[0].count == 1u);
+        s_once.clear_output_errors();
+        REQUIRE(s_once.get_output_errors().empty());
+        REQUIRE(once_conj.empty());
+        s_once.propagate_until(20.);
+        REQUIRE(s_once.get_conjunctions().empty());
+        REQUIRE(once_conj.size() == ref_conj.size());
+        REQUIRE(std::equal(ref_conj.begin(), ref_conj.end(), once_conj.begin(), conj_equal));
+
+        // File sink.
+        {
+            sim s_file(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+            auto fs = std::make_shared<file_conj_sink>("cascade_conj_sink_test.bin");
+            s_file.set_conj_sink(fs);
+            s_file.propagate_until(20.);
+            fs->flush();
+
+            REQUIRE(fs->get_path() == "cascade_conj_sink_test.bin");
+            REQUIRE(fs->get_n_conj() == ref_conj.size());
+        }
+
+        std::vector<sim::conjunction> file_conj(ref_conj.size());
+        {
+            std::ifstream ifile("cascade_conj_sink_test.bin", std::ios::binary);
+            ifile.read(reinterpret_cast<char *>(file_conj.data()),
+                       static_cast<std::streamsize>(file_conj.size() * sizeof(sim::conjunction)));
+            REQUIRE(ifile);
+            REQUIRE(ifile.peek() == std::ifstream::traits_type::eof());
+        }
+        std::remove("cascade_conj_sink_test.bin");
+
+        REQUIRE(std::equal(ref_conj.begin(), ref_conj.end(), file_conj.begin(), conj_equal));
+
+        // Ring sink.
+        sim s_ring(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        auto rs = std::make_shared<ring_conj_sink>(4);
+        REQUIRE(rs->get_capacity() == 4u);
+        s_ring.set_conj_sink(rs);
+        s_ring.propagate_until(20.);
+
+        REQUIRE(rs->get_size() == 4u);
+        REQUIRE(rs->get_n_dropped() == ref_conj.size() - 4u);
+
+        auto ring_conj = rs->pop_all();
+        REQUIRE(ring_conj.size() == 4u);
+        REQUIRE(rs->get_size() == 0u);
+        REQUIRE(std::equal(ring_conj.begin(), ring_conj.end(), ref_conj.begin(), conj_equal));
+    }
+}
+
+TEST_CASE("conj sink ring threads")
+{
+    // Push/pop from different threads.
+    ring_conj_sink rs(7);
+
+    const std::uint64_t n_tot = 100000;
+
+    std::vector<sim::conjunction> in(13);
+
+    std::uint64_t n_popped = 0, next_i = 0;
+    bool ordered = true;
+
+    std::thread consumer([&]() {
+        std::vector<sim::conjunction> out(5);
+
+        while (n_popped + rs.get_n_dropped() < n_tot) {
+            const auto n = rs.pop(out);
+
+            for (std::size_t k = 0; k < n; ++k) {
+                ordered = ordered && out[k].i >= next_i;
+                next_i = out[k].i + 1u;
+            }
+
+            n_popped += n;
+        }
+    });
+
+    for (std::uint64_t i = 0; i < n_tot; i += in.size()) {
+        const auto n = std::min<std::uint64_t>(in.size(), n_tot - i);
+
+        for (std::uint64_t k = 0; k < n; ++k) {
+            in[k].i = i + k;
+        }
+
+        rs.push(std::span<const sim::conjunction>(in.data(), n));
+    }
+
+    consumer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(n_popped + rs.get_n_dropped() == n_tot);
+    REQUIRE(rs.get_size() == 0u);
+}
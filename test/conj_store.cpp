@@ -0,0 +1,203 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+sim::conjunction make_conj(sim::size_type i, sim::size_type j, double time)
+{
+    sim::conjunction retval;
+    retval.i = i;
+    retval.j = j;
+    retval.id_i = i;
+    retval.id_j = j;
+    retval.time = time;
+
+    return retval;
+}
+
+} // namespace
+
+TEST_CASE("conj store api")
+{
+    const auto inf = std::numeric_limits<double>::infinity();
+
+    REQUIRE_THROWS_AS(conj_store(0.), std::invalid_argument);
+    REQUIRE_THROWS_AS(conj_store(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(conj_store(inf), std::invalid_argument);
+
+    conj_store cs(2.);
+    REQUIRE(cs.get_bucket_width() == 2.);
+    REQUIRE(cs.get_conjunctions().empty());
+    REQUIRE(cs.get_particle_conj_ids(0).empty());
+    REQUIRE(cs.get_time_range(-inf, inf).empty());
+
+    const std::vector<sim::conjunction> cv1 = {make_conj(0, 1, 1.), make_conj(1, 2, 1.5), make_conj(0, 2, 4.)};
+    cs.push(cv1);
+
+    REQUIRE(cs.get_conjunctions().size() == 3u);
+
+    auto ids = cs.get_particle_conj_ids(0);
+    REQUIRE(std::vector(ids.begin(), ids.end()) == std::vector<sim::size_type>{0, 2});
+    ids = cs.get_particle_conj_ids(2);
+    REQUIRE(std::vector(ids.begin(), ids.end()) == std::vector<sim::size_type>{1, 2});
+    REQUIRE(cs.get_particle_conj_ids(3).empty());
+
+    // Out-of-order and non-finite conjunctions.
+    std::vector<sim::conjunction> bad = {make_conj(0, 1, 3.)};
+    REQUIRE_THROWS_AS(cs.push(bad), std::invalid_argument);
+    bad[0].time = std::numeric_limits<double>::quiet_NaN();
+    REQUIRE_THROWS_AS(cs.push(bad), std::invalid_argument);
+    REQUIRE(cs.get_conjunctions().size() == 3u);
+
+    // Add more conjunctions, with empty buckets
+    // and a new particle.
+    const std::vector<sim::conjunction> cv2 = {make_conj(0, 1, 4.), make_conj(3, 4, 20.), make_conj(0, 4, 21.)};
+    cs.push(cv2);
+
+    ids = cs.get_particle_conj_ids(0);
+    REQUIRE(std::vector(ids.begin(), ids.end()) == std::vector<sim::size_type>{0, 2, 3, 5});
+    ids = cs.get_particle_conj_ids(4);
+    REQUIRE(std::vector(ids.begin(), ids.end()) == std::vector<sim::size_type>{4, 5});
+    REQUIRE(cs.get_pair_conj_ids(1, 0) == std::vector<sim::size_type>{0, 3});
+    REQUIRE(cs.get_pair_conj_ids(0, 4) == std::vector<sim::size_type>{5});
+    REQUIRE(cs.get_pair_conj_ids(1, 4).empty());
+
+    // Time range queries.
+    REQUIRE(cs.get_time_range_ids(-inf, inf) == std::pair<sim::size_type, sim::size_type>{0, 6});
+    REQUIRE(cs.get_time_range_ids(1., 4.) == std::pair<sim::size_type, sim::size_type>{0, 2});
+    REQUIRE(cs.get_time_range_ids(1.1, 4.1) == std::pair<sim::size_type, sim::size_type>{1, 4});
+    REQUIRE(cs.get_time_range_ids(5., 20.) == std::pair<sim::size_type, sim::size_type>{4, 4});
+    REQUIRE(cs.get_time_range_ids(5., 20.5) == std::pair<sim::size_type, sim::size_type>{4, 5});
+    REQUIRE(cs.get_time_range_ids(21., 1.) == std::pair<sim::size_type, sim::size_type>{5, 5});
+    REQUIRE(cs.get_time_range_ids(22., inf) == std::pair<sim::size_type, sim::size_type>{6, 6});
+    REQUIRE_THROWS_AS(cs.get_time_range(std::numeric_limits<double>::quiet_NaN(), 1.), std::invalid_argument);
+
+    const auto tr = cs.get_time_range(1.1, 4.1);
+    REQUIRE(tr.size() == 3u);
+    REQUIRE(tr[0].time == 1.5);
+    REQUIRE(tr[2].time == 4.);
+
+    // The conjunctions are indexed via the particle ids.
+    auto c = make_conj(0, 1, 30.);
+    c.id_i = 7;
+    c.id_j = 5;
+    cs.push(std::vector<sim::conjunction>{c});
+    REQUIRE(cs.get_conjunctions().back().i == 0u);
+    REQUIRE(cs.get_conjunctions().back().j == 1u);
+    ids = cs.get_particle_conj_ids(5);
+    REQUIRE(std::vector(ids.begin(), ids.end()) == std::vector<sim::size_type>{6});
+    REQUIRE(cs.get_pair_conj_ids(5, 7) == std::vector<sim::size_type>{6});
+    REQUIRE(cs.get_pair_conj_ids(0, 1) == std::vector<sim::size_type>{0, 3});
+    REQUIRE(cs.get_particle_conj_ids(std::numeric_limits<std::uint64_t>::max()).empty());
+
+    // Incremental updates of the per-particle index. The lists
+    // fetched before an update are not modified by the update.
+    auto old_ptr = cs._get_adj_ids_ptr(0);
+    REQUIRE(old_ptr);
+    const auto old_ids = *old_ptr;
+    REQUIRE(!cs._get_adj_ids_ptr(6));
+    REQUIRE(!cs._get_adj_ids_ptr(100));
+
+    std::vector<sim::size_type> ids_0(old_ids), ids_8;
+    for (auto k = 0; k < 100; ++k) {
+        c = make_conj(0, 1, 31. + k);
+        c.id_j = 8;
+        cs.push(std::vector<sim::conjunction>{c, c});
+
+        const auto n = cs.get_conjunctions().size();
+        ids_0.insert(ids_0.end(), {n - 2u, n - 1u});
+        ids_8.insert(ids_8.end(), {n - 2u, n - 1u});
+
+        ids = cs.get_particle_conj_ids(0);
+        REQUIRE(std::vector(ids.begin(), ids.end()) == ids_0);
+        ids = cs.get_particle_conj_ids(8);
+        REQUIRE(std::vector(ids.begin(), ids.end()) == ids_8);
+    }
+
+    REQUIRE(std::equal(old_ids.begin(), old_ids.end(), old_ptr->begin(), old_ptr->begin() + old_ids.size()));
+    REQUIRE(cs.get_pair_conj_ids(8, 0) == ids_8);
+}
+
+TEST_CASE("conj store sim")
+{
+    // Add a particle on a far away circular
+    // orbit in front of the polar particles.
+    auto state = polar_state;
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    state.insert(state.begin(), far.begin(), far.end());
+
+    sim s_ref(polar_state, 0.23, kw::conj_thresh = psize * 100000000);
+    s_ref.propagate_until(20.);
+    const auto &ref_conj = s_ref.get_conjunctions();
+    REQUIRE(ref_conj.size() == 6u);
+
+    sim s(state, 0.23, kw::conj_thresh = psize * 100000000);
+    auto cs = std::make_shared<conj_store>(.5);
+    s.set_conj_sink(cs);
+    s.propagate_until(10.);
+
+    // Remove the far away particle: the ids
+    // of the other particles do not change.
+    const auto n_before = cs->get_conjunctions().size();
+    s.remove_particles({0});
+
+    s.propagate_until(20.);
+
+    const auto &conj = cs->get_conjunctions();
+    REQUIRE(conj.size() == ref_conj.size());
+    for (decltype(conj.size()) k = 0; k < conj.size(); ++k) {
+        REQUIRE(conj[k].id_i == 1u);
+        REQUIRE(conj[k].id_j == 2u);
+        REQUIRE(conj[k].i == (k < n_before ? 1u : 0u));
+        REQUIRE(conj[k].j == (k < n_before ? 2u : 1u));
+        REQUIRE(conj[k].time == Approx(ref_conj[k].time).epsilon(1e-12));
+    }
+
+    REQUIRE(cs->get_particle_conj_ids(0).empty());
+    REQUIRE(cs->get_particle_conj_ids(1).size() == 6u);
+    REQUIRE(cs->get_pair_conj_ids(2, 1).size() == 6u);
+
+    const auto tr = cs->get_time_range(conj[2].time, conj[4].time);
+    REQUIRE(tr.size() == 2u);
+    REQUIRE(tr.data() == conj.data() + 2);
+}
@@ -0,0 +1,198 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+const auto max_thresh = psize * 100000000;
+
+TEST_CASE("conj tiers api")
+{
+    sim s(polar_state, 0.23);
+
+    REQUIRE(s.get_conj_thresh() == 0);
+    REQUIRE(s.get_conj_tiers().empty());
+    REQUIRE(s.get_conj_tier_counts().empty());
+
+    s.set_conj_thresh(1.);
+    REQUIRE(s.get_conj_tiers() == std::vector{1.});
+    REQUIRE(s.get_conj_tier_counts() == std::vector<sim::size_type>{0});
+
+    s.set_conj_tiers({.1, .5, 2.});
+    REQUIRE(s.get_conj_thresh() == 2.);
+    REQUIRE(s.get_conj_tier_counts() == std::vector<sim::size_type>{0, 0, 0});
+
+    s.set_conj_thresh(0.);
+    REQUIRE(s.get_conj_tiers().empty());
+    REQUIRE(s.get_conj_tier_counts().empty());
+
+    REQUIRE_THROWS_AS(s.set_conj_tiers({.1, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_tiers({.5, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_tiers({0., .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_tiers({-1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_tiers({std::numeric_limits<double>::infinity()}), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.set_conj_thresh(-1.), std::invalid_argument);
+    REQUIRE(s.get_conj_tiers().empty());
+
+    REQUIRE_THROWS_AS(sim(polar_state, 0.23, kw::conj_thresh = std::vector{1., .5}), std::invalid_argument);
+
+    sim s2(polar_state, 0.23, kw::conj_thresh = std::vector{.1, .2});
+    REQUIRE(s2.get_conj_tiers() == std::vector{.1, .2});
+    REQUIRE(s2.get_conj_thresh() == .2);
+}
+
+TEST_CASE("conj tiers")
+{
+    const std::vector<double> tiers = {max_thresh / 10, max_thresh / 2, max_thresh};
+
+    for (auto n_par_ct : {1u, 3u}) {
+        // Reference simulation with a single threshold.
+        sim s_ref(polar_state, 0.23, kw::conj_thresh = max_thresh, kw::n_par_ct = n_par_ct);
+        s_ref.propagate_until(20.);
+
+        const auto &ref_conj = s_ref.get_conjunctions();
+        REQUIRE(!ref_conj.empty());
+        REQUIRE(s_ref.get_conj_tier_counts() == std::vector<sim::size_type>{ref_conj.size()});
+
+        for (const auto &c : ref_conj) {
+            REQUIRE(c.tier == 0u);
+        }
+
+        // Simulation with multiple tiers.
+        sim s(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct);
+        s.propagate_until(20.);
+
+        const auto &conj = s.get_conjunctions();
+        REQUIRE(conj.size() == ref_conj.size());
+
+        std::vector<sim::size_type> counts(tiers.size());
+        for (decltype(conj.size()) k = 0; k < conj.size(); ++k) {
+            REQUIRE(conj[k].time == ref_conj[k].time);
+            REQUIRE(conj[k].dist == ref_conj[k].dist);
+
+            const auto tier = conj[k].tier;
+            REQUIRE(tier < tiers.size());
+            REQUIRE(conj[k].dist < tiers[tier]);
+            if (tier > 0u) {
+                REQUIRE(conj[k].dist >= tiers[tier - 1u]);
+            }
+
+            ++counts[tier];
+        }
+
+        REQUIRE(s.get_conj_tier_counts() == counts);
+
+        // Copy semantics and reset.
+        auto s2 = s;
+        REQUIRE(s2.get_conj_tier_counts() == counts);
+
+        s.reset_conjunctions();
+        REQUIRE(s.get_conj_tier_counts() == std::vector<sim::size_type>(tiers.size()));
+
+        // Tier-aware aggregation.
+        sim s_aggr(polar_state, 0.23, kw::conj_thresh = tiers, kw::n_par_ct = n_par_ct,
+                   kw::conj_aggr = conj_aggr_mode::window, kw::conj_aggr_window = 100.);
+        s_aggr.propagate_until(20.);
+        s_aggr.flush_conjunctions();
+
+        const auto &aggr_conj = s_aggr.get_conjunctions();
+
+        std::vector<sim::size_type> aggr_counts(tiers.size()), n_min(tiers.size());
+        for (const auto &c : aggr_conj) {
+            ++aggr_counts[c.tier];
+            n_min[c.tier] += c.n_min;
+
+            REQUIRE(c.time_under > 0);
+
+            // The closest approach in the tier.
+            auto min_dist = std::numeric_limits<double>::infinity();
+            for (const auto &rc : conj) {
+                if (rc.tier == c.tier) {
+                    min_dist = std::min(min_dist, rc.dist);
+                }
+            }
+            REQUIRE(c.dist == min_dist);
+        }
+
+        // There is a single window and a single pair, thus
+        // there must be one record per non-empty tier.
+        for (decltype(tiers.size()) t = 0; t < tiers.size(); ++t) {
+            REQUIRE(aggr_counts[t] == static_cast<sim::size_type>(counts[t] > 0u));
+            REQUIRE(n_min[t] == counts[t]);
+        }
+
+        REQUIRE(s_aggr.get_conj_tier_counts() == aggr_counts);
+    }
+}
+
+// Conjunctions detected after an interrupt within the
+// same superstep are discarded, and they must not be
+// accounted for in the per-tier counters.
+TEST_CASE("conj tiers interrupt")
+{
+    const std::vector<double> tiers = {max_thresh / 10, max_thresh / 2, max_thresh};
+
+    // Add a particle on a hyperbolic trajectory
+    // crossing the exit radius midway through the superstep.
+    auto state = polar_state;
+    state.insert(state.end(), {2., 0., 0., 1.5, 0., 0., psize});
+
+    // Reference simulation without the exiting particle.
+    sim s_ref(polar_state, 10., kw::conj_thresh = tiers);
+    REQUIRE(s_ref.step() == outcome::success);
+
+    sim s(state, 10., kw::conj_thresh = tiers, kw::exit_radius = 10.);
+    REQUIRE(s.step() == outcome::exit);
+    REQUIRE(std::get<1>(*s.get_interrupt_info()) == 2u);
+
+    const auto t_exit = s.get_time();
+    REQUIRE(t_exit < 10.);
+
+    // Make sure that some conjunctions were discarded.
+    const auto &ref_conj = s_ref.get_conjunctions();
+    REQUIRE(std::any_of(ref_conj.begin(), ref_conj.end(), [t_exit](const auto &c) { return c.time >= t_exit; }));
+
+    const auto &conj = s.get_conjunctions();
+    REQUIRE(!conj.empty());
+
+    std::vector<sim::size_type> counts(tiers.size());
+    for (const auto &c : conj) {
+        REQUIRE(c.time < t_exit);
+        ++counts[c.tier];
+    }
+
+    REQUIRE(s.get_conj_tier_counts() == counts);
+}
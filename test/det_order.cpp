@@ -0,0 +1,116 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+#include "keputils.hpp"
+
+using namespace cascade;
+using namespace cascade_test;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+TEST_CASE("det order api")
+{
+    REQUIRE(sim(polar_state, 0.23).get_det_order() == 0u);
+    REQUIRE(sim(polar_state, 0.23, kw::det_order = 6u).get_det_order() == 6u);
+
+    {
+        sim s(polar_state, 0.23, kw::det_order = 6u);
+        auto s2 = s;
+        REQUIRE(s2.get_det_order() == 6u);
+    }
+
+    REQUIRE_THROWS_AS(sim(polar_state, 0.23, kw::det_order = 1u), std::invalid_argument);
+
+    // A detection order not less than the order of
+    // the integrator disables the economisation.
+    sim s(polar_state, 0.23, kw::det_order = 1000u, kw::conj_thresh = psize * 100);
+    REQUIRE(s.get_det_order() == 1000u);
+    s.propagate_until(2.);
+    REQUIRE(s.get_conjunctions().size() == 1u);
+}
+
+// Check that the results of a simulation do not depend on the detection order.
+// NOTE: the root finding intervals on the Taylor polynomials are restricted via
+// the economised polynomials, which changes the translations of the polynomials
+// and thus, very slightly, the conjunction times and distances.
+TEST_CASE("det order consistency")
+{
+    std::mt19937 rng;
+
+    std::uniform_real_distribution<double> a_dist(1.02, 1.05), e_dist(0., 0.02), i_dist(0., 0.05),
+        ang_dist(0., 2 * boost::math::constants::pi<double>());
+
+    std::vector<double> state;
+
+    const auto nparts = 2000ull;
+
+    for (auto i = 0ull; i < nparts; ++i) {
+        auto [r, v] = kep_to_cart<double>({a_dist(rng), e_dist(rng), i_dist(rng), ang_dist(rng), ang_dist(rng),
+                                           ang_dist(rng)},
+                                          1.);
+
+        state.insert(state.end(), {r[0], r[1], r[2], v[0], v[1], v[2], 1e-5});
+    }
+
+    for (auto n_par_ct : {1u, 3u}) {
+        sim s_ref(state, 0.23, kw::n_par_ct = n_par_ct, kw::conj_thresh = 1e-3);
+
+        for (auto det_order : {2u, 4u, 8u}) {
+            sim s(state, 0.23, kw::n_par_ct = n_par_ct, kw::conj_thresh = 1e-3, kw::det_order = det_order);
+
+            // NOTE: at the first iteration, s_ref is propagated.
+            if (det_order == 2u) {
+                REQUIRE(s_ref.propagate_until(1.) == s.propagate_until(1.));
+            } else {
+                REQUIRE(s.propagate_until(1.) != outcome::err_nf_state);
+            }
+
+            REQUIRE(!s_ref.get_conjunctions().empty());
+            REQUIRE(s.get_time() == s_ref.get_time());
+            REQUIRE(s.get_interrupt_info() == s_ref.get_interrupt_info());
+            REQUIRE(s.get_conjunctions().size() == s_ref.get_conjunctions().size());
+
+            for (decltype(s.get_conjunctions().size()) k = 0; k < s.get_conjunctions().size(); ++k) {
+                const auto &c = s.get_conjunctions()[k];
+                const auto &c_ref = s_ref.get_conjunctions()[k];
+
+                REQUIRE(c.i == c_ref.i);
+                REQUIRE(c.j == c_ref.j);
+                REQUIRE(std::abs(c.time - c_ref.time) < 1e-10);
+                REQUIRE(std::abs(c.dist - c_ref.dist) <= 1e-10 * c_ref.dist);
+            }
+        }
+    }
+}
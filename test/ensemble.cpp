@@ -0,0 +1,154 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/ensemble.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+TEST_CASE("ensemble api")
+{
+    REQUIRE(ensemble{}.get_size() == 0u);
+    REQUIRE(ensemble{}.get_summaries().empty());
+
+    const sim proto(polar_state, 0.23);
+
+    REQUIRE_THROWS_AS(ensemble(proto, {polar_state, polar_state}, std::vector<std::vector<double>>(1)),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble(proto, {polar_state, {1., 2.}}), std::invalid_argument);
+
+    ensemble ens(proto, {polar_state, polar_state, {}});
+    REQUIRE(ens.get_size() == 3u);
+    REQUIRE(ens.get_summaries().size() == 3u);
+    REQUIRE(ens.get_member(0).get_state() == polar_state);
+    REQUIRE(ens.get_member(2).get_nparts() == 0u);
+    REQUIRE_THROWS_AS(ens.get_member(3), std::out_of_range);
+    REQUIRE_THROWS_AS(std::as_const(ens).get_member(3), std::out_of_range);
+}
+
+TEST_CASE("ensemble propagate")
+{
+    const sim proto({}, 0.23, kw::conj_thresh = psize * 100);
+
+    // Variant of the polar state in which the two particles collide.
+    auto coll_state = polar_state;
+    coll_state[6] = coll_state[13] = 1e-5;
+
+    // Single particle.
+    const std::vector<double> single_state(polar_state.begin(), polar_state.begin() + 7);
+
+    ensemble ens(proto, {polar_state, coll_state, single_state});
+
+    ens.propagate_until(2.);
+
+    // The members are propagated as independent sims.
+    sim ref(polar_state, 0.23, kw::conj_thresh = psize * 100);
+    REQUIRE(ref.propagate_until(2.) == outcome::time_limit);
+    REQUIRE(ens.get_member(0).get_state() == ref.get_state());
+    REQUIRE(ens.get_member(0).get_conjunctions().size() == ref.get_conjunctions().size());
+
+    const auto &sms = ens.get_summaries();
+
+    REQUIRE(sms[0].oc == outcome::time_limit);
+    REQUIRE(sms[0].n_collisions == 0u);
+    REQUIRE(sms[0].n_conjunctions == 1u);
+
+    // The colliding particles are removed and the propagation resumes.
+    REQUIRE(sms[1].oc == outcome::time_limit);
+    REQUIRE(sms[1].n_collisions == 1u);
+    REQUIRE(ens.get_member(1).get_nparts() == 0u);
+
+    REQUIRE(sms[2].oc == outcome::time_limit);
+    REQUIRE(sms[2].n_collisions == 0u);
+    REQUIRE(sms[2].n_conjunctions == 0u);
+
+    for (ensemble::size_type i = 0; i < ens.get_size(); ++i) {
+        REQUIRE(ens.get_member(i).get_time() == 2.);
+        REQUIRE(sms[i].n_reentries == 0u);
+        REQUIRE(sms[i].n_exits == 0u);
+    }
+
+    // Further propagation.
+    ens.propagate_until(3.);
+    REQUIRE(ens.get_member(0).get_time() == 3.);
+    REQUIRE(ens.get_summaries()[1].n_collisions == 1u);
+
+    REQUIRE(ens.get_member(1).get_time() == 3.);
+    REQUIRE_THROWS_AS(ens.propagate_until(1.), std::invalid_argument);
+
+    // Reentries.
+    // NOTE: the particle is on an eccentric orbit
+    // whose pericentre is below the reentry radius.
+    const sim proto_re({}, 0.23, kw::reentry_radius = .5);
+    auto re_state = single_state;
+    re_state[3] *= .5;
+    re_state[4] *= .5;
+    re_state[5] *= .5;
+    ensemble ens_re(proto_re, {re_state, single_state});
+
+    ens_re.propagate_until(2.);
+    REQUIRE(ens_re.get_summaries()[0].oc == outcome::time_limit);
+    REQUIRE(ens_re.get_summaries()[0].n_reentries == 1u);
+    REQUIRE(ens_re.get_member(0).get_nparts() == 0u);
+    REQUIRE(ens_re.get_summaries()[1].n_reentries == 0u);
+    REQUIRE(ens_re.get_member(1).get_nparts() == 1u);
+}
+
+// The conjunctions pushed to a sink must
+// be accounted for in the summaries.
+TEST_CASE("ensemble conj sink")
+{
+    const sim proto({}, 0.23, kw::conj_thresh = psize * 100);
+
+    ensemble ens(proto, {polar_state, polar_state});
+
+    auto store = std::make_shared<conj_store>();
+    ens.get_member(0).set_conj_sink(store);
+
+    ens.propagate_until(2.);
+
+    const auto &sms = ens.get_summaries();
+
+    REQUIRE(ens.get_member(0).get_conjunctions().empty());
+    REQUIRE(store->get_conjunctions().size() == 1u);
+    REQUIRE(sms[0].n_conjunctions == 1u);
+
+    REQUIRE(ens.get_member(1).get_conjunctions().size() == 1u);
+    REQUIRE(sms[1].n_conjunctions == 1u);
+
+    // Further propagation.
+    ens.propagate_until(4.);
+    REQUIRE(sms[0].n_conjunctions == store->get_conjunctions().size());
+    REQUIRE(sms[1].n_conjunctions == ens.get_member(1).get_conjunctions().size());
+}
@@ -0,0 +1,246 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <cascade/ephemeris.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *eph_path = "cascade_ephemeris_test.eph";
+
+// Check that the state of the particle at index pidx
+// in the reader at the time t matches the state of s.
+void check_state(const ephemeris_reader &r, const sim &s, sim::size_type pidx, double t)
+{
+    const auto st = r.get_state(pidx, t);
+
+    for (auto j = 0u; j < 6u; ++j) {
+        REQUIRE(std::abs(st[j] - s.get_state()[pidx * 7u + j]) <= 1e-13);
+    }
+}
+
+} // namespace
+
+TEST_CASE("ephemeris api")
+{
+    REQUIRE_THROWS_AS(ephemeris_writer("/this/path/does/not/exist.eph"), std::invalid_argument);
+    REQUIRE_THROWS_AS(ephemeris_reader("/this/path/does/not/exist.eph"), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(ephemeris_writer(eph_path, kw::cheby_tol = -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(ephemeris_writer(eph_path, kw::cheby_tol = std::numeric_limits<double>::infinity()),
+                      std::invalid_argument);
+
+    {
+        ephemeris_writer ew(eph_path);
+        REQUIRE(ew.get_path() == eph_path);
+        REQUIRE(ew.get_cheby_tol() == 0.);
+        REQUIRE(ew.get_n_blocks() == 0u);
+        REQUIRE(ew.get_n_bytes() == 16u);
+    }
+
+    // No blocks.
+    REQUIRE_THROWS_AS(ephemeris_reader(eph_path), std::invalid_argument);
+
+    std::remove(eph_path);
+}
+
+TEST_CASE("ephemeris sim")
+{
+    // Add a particle on a far away circular
+    // orbit in front of the polar particles.
+    auto state = polar_state;
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    state.insert(state.begin(), far.begin(), far.end());
+
+    sim s(state, 0.23);
+
+    auto ew = std::make_shared<ephemeris_writer>(eph_path);
+    s.set_ephemeris_writer(ew);
+    REQUIRE(s.get_ephemeris_writer() == ew);
+
+    // The writer is not copied.
+    REQUIRE(!sim(s).get_ephemeris_writer());
+
+    // Record the simulation at the end of each step.
+    std::vector<sim> sims{s};
+    for (auto i = 0; i < 5; ++i) {
+        s.step();
+        sims.push_back(s);
+    }
+    REQUIRE(ew->get_n_blocks() == 5u);
+
+    // Remove a particle and propagate up to a time
+    // which falls within a superstep.
+    s.remove_particles({1});
+    const auto t_rm = s.get_time();
+    s.propagate_until(t_rm + 0.5);
+    sims.push_back(s);
+    s.step();
+    sims.push_back(s);
+
+    ephemeris_reader r(eph_path);
+    REQUIRE(r.get_n_blocks() == ew->get_n_blocks());
+    REQUIRE(r.get_time_range().first == 0.);
+    REQUIRE(r.get_time_range().second == s.get_time());
+    REQUIRE(r.get_nparts(0.) == 3u);
+    REQUIRE(r.get_nparts(t_rm) == 2u);
+
+    // The particle ids.
+    REQUIRE(r.get_ids(0.) == std::vector<std::uint64_t>{0, 1, 2});
+    REQUIRE(r.get_ids(t_rm) == std::vector<std::uint64_t>{0, 2});
+    REQUIRE(r.id_to_index(2, 0.1) == 2u);
+    REQUIRE(r.id_to_index(2, t_rm + 0.1) == 1u);
+    REQUIRE(r.get_state_by_id(2, 0.1) == r.get_state(2, 0.1));
+    REQUIRE(r.get_state_by_id(2, t_rm + 0.1) == r.get_state(1, t_rm + 0.1));
+    REQUIRE_THROWS_AS(r.id_to_index(1, t_rm + 0.1), std::out_of_range);
+    REQUIRE_THROWS_AS(r.get_state_by_id(3, 0.1), std::out_of_range);
+
+    // The states at the end of the steps.
+    for (const auto &cur_s : sims) {
+        for (sim::size_type pidx = 0; pidx < cur_s.get_nparts(); ++pidx) {
+            check_state(r, cur_s, pidx, cur_s.get_time());
+        }
+    }
+
+    // The states at arbitrary times, compared with
+    // a propagation of the original simulation.
+    for (auto t : {0.1, 0.37, 0.5, sims[3].get_time() - 1e-3}) {
+        auto s_ref = sims[0];
+        s_ref.propagate_until(t);
+
+        for (sim::size_type pidx = 0; pidx < 3u; ++pidx) {
+            check_state(r, s_ref, pidx, t);
+        }
+
+        const auto all = r.get_states(t);
+        REQUIRE(all.size() == 18u);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(all[6u + j] == r.get_state(1, t)[j]);
+        }
+    }
+
+    // Batched queries.
+    {
+        const std::vector<sim::size_type> pidxs{0, 2, 1};
+        const std::vector<double> ts{0.1, 0.2, t_rm + 0.1};
+        std::vector<double> out(18);
+        r.get_states(pidxs, ts, out);
+
+        for (auto i = 0u; i < 3u; ++i) {
+            const auto st = r.get_state(pidxs[i], ts[i]);
+
+            for (auto j = 0u; j < 6u; ++j) {
+                REQUIRE(out[i * 6u + j] == st[j]);
+            }
+        }
+
+        REQUIRE_THROWS_AS(r.get_states(pidxs, std::vector{0.1}, out), std::invalid_argument);
+        REQUIRE_THROWS_AS(r.get_states(pidxs, ts, std::span(out.data(), 17)), std::invalid_argument);
+    }
+
+    // Invalid queries.
+    REQUIRE_THROWS_AS(r.get_state(0, -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(r.get_state(0, s.get_time() + 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(r.get_state(0, std::numeric_limits<double>::quiet_NaN()), std::invalid_argument);
+    REQUIRE_THROWS_AS(r.get_state(2, t_rm + 0.1), std::invalid_argument);
+
+    // The supersteps must be in chronological order. The failure
+    // is recorded, and the step is completed anyway.
+    s.set_time(0.);
+    REQUIRE(s.get_output_errors().empty());
+    s.step();
+    REQUIRE(s.get_time() > 0.);
+    REQUIRE(s.get_output_errors().size() == 1u);
+    REQUIRE(s.get_output_errors()[0].component == "ephemeris writer");
+    REQUIRE(s.get_output_errors()[0].count == 1u);
+
+    std::remove(eph_path);
+}
+
+TEST_CASE("ephemeris cheby")
+{
+    const char *cheby_path = "cascade_ephemeris_cheby_test.eph";
+
+    auto state = polar_state;
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    state.insert(state.begin(), far.begin(), far.end());
+
+    // Run two identical simulations, archiving the Taylor
+    // coefficients and the Chebyshev series respectively.
+    sim s_t(state, 0.23), s_c(state, 0.23);
+
+    auto ew_t = std::make_shared<ephemeris_writer>(eph_path);
+    s_t.set_ephemeris_writer(ew_t);
+
+    const auto tol = 1e-10;
+    auto ew_c = std::make_shared<ephemeris_writer>(cheby_path, kw::cheby_tol = tol);
+    REQUIRE(ew_c->get_cheby_tol() == tol);
+    s_c.set_ephemeris_writer(ew_c);
+
+    for (auto i = 0; i < 5; ++i) {
+        s_t.step();
+        s_c.step();
+    }
+
+    // The Chebyshev archive is much smaller.
+    REQUIRE(ew_c->get_n_bytes() < ew_t->get_n_bytes() / 2u);
+
+    ephemeris_reader r_t(eph_path), r_c(cheby_path);
+    REQUIRE(r_c.get_n_blocks() == 5u);
+    REQUIRE(r_c.get_time_range() == r_t.get_time_range());
+
+    for (auto i = 0; i <= 1000; ++i) {
+        const auto t = s_t.get_time() * i / 1000.;
+
+        for (sim::size_type pidx = 0; pidx < 3u; ++pidx) {
+            const auto st_t = r_t.get_state(pidx, t);
+            const auto st_c = r_c.get_state(pidx, t);
+
+            // NOTE: the fitting error is measured only at a
+            // finite set of points, allow for some slack.
+            for (auto j = 0u; j < 3u; ++j) {
+                REQUIRE(std::abs(st_t[j] - st_c[j]) <= 2 * tol);
+            }
+        }
+    }
+
+    std::remove(eph_path);
+    std::remove(cheby_path);
+}
@@ -0,0 +1,132 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <cascade/io.hpp>
+#include <cascade/sim.hpp>
+#include <cascade/snapshot_writer.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *txt_path = "cascade_io_test.txt";
+const char *h5_path = "cascade_io_test.h5";
+
+} // namespace
+
+TEST_CASE("io load_text")
+{
+    REQUIRE_THROWS_AS(io::load_text("/this/path/does/not/exist.txt"), std::invalid_argument);
+
+    // Empty file.
+    std::ofstream(txt_path).close();
+    REQUIRE(io::load_text(txt_path).empty());
+
+    // Only whitespace.
+    std::ofstream(txt_path) << " \n\t\r\n ";
+    REQUIRE(io::load_text(txt_path).empty());
+
+    // Mixed separators.
+    std::ofstream(txt_path) << "1 +2\t-3e5\r\n\n 4.5  \n-inf";
+    REQUIRE(io::load_text(txt_path) == std::vector{1., 2., -3e5, 4.5, -std::numeric_limits<double>::infinity()});
+
+    // Invalid values.
+    std::ofstream(txt_path) << "1\n2\nfoo\n";
+    REQUIRE_THROWS_MATCHES(io::load_text(txt_path), std::invalid_argument,
+                           Catch::Message(fmt::format("Invalid floating-point value 'foo' detected at "
+                                                      "line 3 of the text file '{}'",
+                                                      txt_path)));
+    std::ofstream(txt_path) << "1.5x";
+    REQUIRE_THROWS_AS(io::load_text(txt_path), std::invalid_argument);
+
+    // Compare with the values read via iostreams from a file
+    // large enough to be split in multiple chunks.
+    std::vector<double> ref;
+    {
+        std::ofstream out(txt_path);
+        out.precision(17);
+
+        for (auto i = 0; i < 500000; ++i) {
+            ref.push_back(i / 3.);
+            out << ref.back() << '\n';
+        }
+    }
+    REQUIRE(io::load_text(txt_path) == ref);
+
+    // Construct a simulation from a text file.
+    {
+        std::ofstream out(txt_path);
+        out.precision(17);
+
+        for (auto x : polar_state) {
+            out << x << '\n';
+        }
+    }
+    sim s(io::load_text(txt_path), 0.23);
+    REQUIRE(s.get_state() == polar_state);
+
+    std::remove(txt_path);
+}
+
+TEST_CASE("io load_hdf5")
+{
+    // NOTE: use a snapshot writer to
+    // create the HDF5 file.
+    std::shared_ptr<snapshot_writer> sw;
+    try {
+        sw = std::make_shared<snapshot_writer>(h5_path);
+    } catch (const std::runtime_error &) {
+        // NOTE: cascade was built without HDF5 support.
+        REQUIRE_THROWS_AS(io::load_hdf5(h5_path, "/state"), std::runtime_error);
+
+        return;
+    }
+
+    sim s(polar_state, 0.23);
+    s.set_snapshot_writer(sw);
+    s.step();
+    sw->close();
+
+    REQUIRE(io::load_hdf5(h5_path, "/state") == s.get_state());
+    REQUIRE(io::load_hdf5(h5_path, "/time") == std::vector{s.get_time()});
+
+    REQUIRE_THROWS_AS(io::load_hdf5(h5_path, "/foo"), std::invalid_argument);
+    REQUIRE_THROWS_AS(io::load_hdf5("/this/path/does/not/exist.h5", "/state"), std::invalid_argument);
+
+    std::remove(h5_path);
+}
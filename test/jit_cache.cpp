@@ -0,0 +1,216 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <filesystem>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include <cascade/jit_cache.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *cache_dir = "cascade_jit_cache_test";
+
+auto n_entries()
+{
+    return std::distance(std::filesystem::directory_iterator(cache_dir), std::filesystem::directory_iterator{});
+}
+
+} // namespace
+
+TEST_CASE("jit cache")
+{
+    std::filesystem::remove_all(cache_dir);
+
+    const auto orig_max_size = jit_cache::get_max_size();
+
+    // Disabled cache.
+    jit_cache::set_dir("");
+    REQUIRE(jit_cache::get_dir().empty());
+    REQUIRE(jit_cache::get_size() == 0u);
+    sim(polar_state, 0.23);
+    REQUIRE(!std::filesystem::exists(cache_dir));
+
+    jit_cache::set_dir(cache_dir);
+    REQUIRE(jit_cache::get_dir() == cache_dir);
+
+    // The first construction populates the cache.
+    // NOTE: s1 is destroyed at the end of the scope, so that the
+    // compiled data is not kept alive in the in-memory registry.
+    std::optional<sim> s1;
+    s1.emplace(polar_state, 0.23, kw::conj_thresh = psize * 100);
+    REQUIRE(n_entries() == 1);
+    const auto size1 = jit_cache::get_size();
+    REQUIRE(size1 > 0u);
+
+    REQUIRE(s1->propagate_until(2.) == outcome::success);
+    const auto state1 = s1->get_state();
+    REQUIRE(s1->get_conjunctions().size() == 1u);
+    const auto conj1 = s1->get_conjunctions()[0];
+    s1.reset();
+    REQUIRE(jit_cache::get_registry_size() == 0u);
+
+    // The second construction loads from the cache.
+    {
+        sim s2(polar_state, 0.23, kw::conj_thresh = psize * 100);
+        REQUIRE(n_entries() == 1);
+        REQUIRE(jit_cache::get_size() == size1);
+        REQUIRE(jit_cache::get_registry_size() == 1u);
+
+        REQUIRE(s2.propagate_until(2.) == outcome::success);
+        REQUIRE(s2.get_state() == state1);
+        REQUIRE(s2.get_conjunctions().size() == 1u);
+        REQUIRE(s2.get_conjunctions()[0].time == conj1.time);
+        REQUIRE(s2.get_conjunctions()[0].dist == conj1.dist);
+
+        // Copies of sims loaded from the cache.
+        auto s3 = s2;
+        REQUIRE(s3.step() == s2.step());
+        REQUIRE(s3.get_state() == s2.get_state());
+    }
+
+    // Different settings result in different entries.
+    sim(polar_state, 0.23, kw::tol = 1e-12);
+    REQUIRE(n_entries() == 2);
+    sim(polar_state, 0.23, kw::exit_radius = 10.);
+    REQUIRE(n_entries() == 3);
+    sim(polar_state, 0.23, kw::det_order = 6u);
+    REQUIRE(n_entries() == 4);
+
+    // Eviction.
+    jit_cache::set_max_size(size1);
+    REQUIRE(jit_cache::get_max_size() == size1);
+    sim(polar_state, 0.23, kw::high_accuracy = true);
+    REQUIRE(jit_cache::get_size() <= size1);
+
+    jit_cache::clear();
+    REQUIRE(jit_cache::get_size() == 0u);
+    REQUIRE(n_entries() == 0);
+
+    // Corrupted entries are ignored and overwritten.
+    jit_cache::set_max_size(orig_max_size);
+    sim(polar_state, 0.23);
+    REQUIRE(n_entries() == 1);
+    for (const auto &e : std::filesystem::directory_iterator(cache_dir)) {
+        std::filesystem::resize_file(e.path(), 16);
+    }
+    sim s4(polar_state, 0.23);
+    REQUIRE(jit_cache::get_size() > 16u);
+    REQUIRE(s4.step() == outcome::success);
+
+    jit_cache::set_dir("");
+    std::filesystem::remove_all(cache_dir);
+}
+
+TEST_CASE("jit registry")
+{
+    jit_cache::set_dir("");
+
+    REQUIRE(jit_cache::get_registry_size() == 0u);
+
+    {
+        sim s1(polar_state, 0.23);
+        REQUIRE(jit_cache::get_registry_size() == 1u);
+
+        // Same setup, the compiled data is fetched from the registry.
+        sim s2(polar_state, 0.23, kw::conj_thresh = psize * 100);
+        REQUIRE(jit_cache::get_registry_size() == 1u);
+
+        // Different setup.
+        sim s3(polar_state, 0.23, kw::tol = 1e-12);
+        REQUIRE(jit_cache::get_registry_size() == 2u);
+
+        REQUIRE(s1.propagate_until(2.) == s2.propagate_until(2.));
+        REQUIRE(s1.get_state() == s2.get_state());
+        REQUIRE(s2.get_conjunctions().size() == 1u);
+
+        // Copies keep the entries alive.
+        auto s4 = s3;
+        s3 = sim(polar_state, 0.23);
+        REQUIRE(jit_cache::get_registry_size() == 2u);
+
+        s4 = s1;
+        REQUIRE(jit_cache::get_registry_size() == 1u);
+    }
+
+    REQUIRE(jit_cache::get_registry_size() == 0u);
+}
+
+// The narrow-phase kernels are compiled concurrently with the
+// integrators, using an order predicted from the tolerance.
+TEST_CASE("jit kernels order")
+{
+    jit_cache::set_dir("");
+
+    for (auto tol : {0., 1e-6, 1e-12}) {
+        sim s(polar_state, 0.23, kw::tol = tol, kw::conj_thresh = psize * 100);
+
+        REQUIRE(s.propagate_until(2.) == outcome::success);
+        REQUIRE(s.get_conjunctions().size() == 1u);
+    }
+}
+
+TEST_CASE("jit precompiled")
+{
+    std::filesystem::remove_all(cache_dir);
+
+    const auto orig_pdir = jit_cache::get_precompiled_dir();
+
+    // Populate the directory of the precompiled entries
+    // via the construction of an empty simulation.
+    jit_cache::set_precompiled_dir("");
+    jit_cache::set_dir(cache_dir);
+    sim({}, 0.23, kw::dyn = dynamics::kepler(2.));
+    REQUIRE(n_entries() == 1);
+    const auto mtime = std::filesystem::directory_iterator(cache_dir)->last_write_time();
+
+    jit_cache::set_dir("");
+    jit_cache::set_precompiled_dir(cache_dir);
+    REQUIRE(jit_cache::get_precompiled_dir() == cache_dir);
+
+    {
+        // The precompiled entry is used and it is not modified.
+        sim s(polar_state, 0.23, kw::dyn = dynamics::kepler(2.));
+        REQUIRE(n_entries() == 1);
+        REQUIRE(std::filesystem::directory_iterator(cache_dir)->last_write_time() == mtime);
+        REQUIRE(s.step() == outcome::success);
+
+        // Missing entries are not added.
+        sim(polar_state, 0.23, kw::dyn = dynamics::kepler(3.));
+        REQUIRE(n_entries() == 1);
+    }
+
+    jit_cache::set_precompiled_dir(orig_pdir);
+    std::filesystem::remove_all(cache_dir);
+}
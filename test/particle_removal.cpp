@@ -6,8 +6,13 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cmath>
+#include <cstdint>
 #include <initializer_list>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <variant>
 #include <vector>
 
 #include <boost/math/constants/constants.hpp>
@@ -20,6 +25,24 @@
 using namespace cascade;
 using namespace cascade_test;
 
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
 TEST_CASE("particle removal")
 {
     std::mt19937 rng;
@@ -73,3 +96,112 @@ TEST_CASE("particle removal")
         }
     }
 }
+
+TEST_CASE("particle ids")
+{
+    using Catch::Matchers::Message;
+
+    using ids_t = std::vector<std::uint64_t>;
+
+    // A particle on a far away circular orbit
+    // followed by the polar particles.
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    auto state = far;
+    state.insert(state.end(), polar_state.begin(), polar_state.end());
+
+    sim s(state, 0.23, kw::conj_thresh = psize * 100);
+    REQUIRE(s.get_ids() == ids_t{0, 1, 2});
+    REQUIRE(s.id_to_index(2) == 2u);
+
+    // The ids are preserved across removals.
+    s.remove_particles({0});
+    REQUIRE(s.get_ids() == ids_t{1, 2});
+    REQUIRE(s.id_to_index(2) == 1u);
+    REQUIRE_THROWS_MATCHES(s.id_to_index(0), std::out_of_range,
+                           Message("No particle with id 0 exists in the simulation"));
+
+    // The conjunctions record the ids of the particles.
+    REQUIRE(s.propagate_until(2.) == outcome::success);
+    REQUIRE(s.get_conjunctions().size() == 1u);
+    const auto &c = s.get_conjunctions()[0];
+    REQUIRE(c.id_i == s.get_ids()[c.i]);
+    REQUIRE(c.id_j == s.get_ids()[c.j]);
+
+    // New particles are assigned new ids, and the
+    // ids are never reused.
+    s.add_particles(far);
+    REQUIRE(s.get_ids() == ids_t{1, 2, 3});
+    s.remove_particles({2});
+    s.add_particles(far);
+    REQUIRE(s.get_ids() == ids_t{1, 2, 4});
+
+    // Copies preserve the ids.
+    REQUIRE(sim(s).get_ids() == s.get_ids());
+
+    s.set_new_state_pars(polar_state);
+    REQUIRE(s.get_ids() == ids_t{5, 6});
+
+    // Interrupt info in terms of ids.
+    REQUIRE(!s.get_interrupt_ids());
+
+    const std::vector<double> falling = {1., 0., 0., 0., 0., 0., 0.};
+    state = far;
+    state.insert(state.end(), falling.begin(), falling.end());
+
+    sim s2(state, 0.23, kw::reentry_radius = .5);
+    s2.remove_particles({0});
+    REQUIRE(s2.propagate_until(5.) == outcome::reentry);
+    REQUIRE(std::get<1>(*s2.get_interrupt_info()) == 0u);
+    REQUIRE(std::get<1>(*s2.get_interrupt_ids()) == 1u);
+
+    // The interrupt ids are not affected by the removal
+    // of the particles, and they survive copies and serialisation.
+    s2.remove_particles({0});
+    REQUIRE(std::get<1>(*s2.get_interrupt_ids()) == 1u);
+    REQUIRE(std::get<1>(*sim(s2).get_interrupt_ids()) == 1u);
+
+    std::stringstream ss;
+    s2.save_checkpoint(ss);
+    REQUIRE(std::get<1>(*sim::load_checkpoint(ss).get_interrupt_ids()) == 1u);
+}
+
+TEST_CASE("whitelist ids")
+{
+    using wl_t = sim::whitelist_t;
+    using id_wl_t = sim::id_whitelist_t;
+
+    const std::vector<double> far = {10., 0., 0., 0., std::sqrt(.1), 0., psize};
+    auto state = far;
+    state.insert(state.end(), polar_state.begin(), polar_state.end());
+
+    sim s(state, 0.23, kw::conj_thresh = psize * 100, kw::coll_whitelist_ids = id_wl_t{0, 2},
+          kw::conj_whitelist_ids = id_wl_t{1});
+    REQUIRE(s.get_coll_whitelist() == wl_t{0, 2});
+    REQUIRE(s.get_conj_whitelist() == wl_t{1});
+
+    // Invalid ids in the constructor.
+    REQUIRE_THROWS_AS(sim(state, 0.23, kw::coll_whitelist_ids = id_wl_t{3}), std::out_of_range);
+    REQUIRE_THROWS_AS(sim(state, 0.23, kw::conj_whitelist_ids = id_wl_t{3}), std::out_of_range);
+
+    // After a removal, the ids are converted to the new indices.
+    s.remove_particles({0});
+    REQUIRE(s.get_coll_whitelist() == wl_t{1});
+    REQUIRE(s.get_coll_whitelist_ids() == id_wl_t{2});
+    REQUIRE(s.get_conj_whitelist_ids() == id_wl_t{1});
+
+    s.set_coll_whitelist_ids({1, 2});
+    REQUIRE(s.get_coll_whitelist() == wl_t{0, 1});
+    s.set_conj_whitelist_ids({});
+    REQUIRE(s.get_conj_whitelist().empty());
+
+    // Invalid ids leave the whitelists unchanged.
+    REQUIRE_THROWS_AS(s.set_coll_whitelist_ids({0}), std::out_of_range);
+    REQUIRE(s.get_coll_whitelist() == wl_t{0, 1});
+    REQUIRE_THROWS_AS(s.set_conj_whitelist_ids({1, 0}), std::out_of_range);
+    REQUIRE(s.get_conj_whitelist().empty());
+
+    // The indices which do not refer to any
+    // particle are ignored by the getters.
+    s.set_coll_whitelist({0, 5});
+    REQUIRE(s.get_coll_whitelist_ids() == id_wl_t{1});
+}
@@ -0,0 +1,120 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "catch.hpp"
+#include "detail/rel_vel_sieve.hpp"
+
+using namespace cascade;
+
+// NOTE: the particles move on straight lines, represented
+// as polynomials of order 2 with a zero quadratic coefficient,
+// so that the bounds on the relative velocity are exact.
+constexpr std::uint32_t order = 2;
+
+// NOTE: the sieve is widened to account for rounding errors, thus
+// the bounds of the sub-intervals are checked with a small tolerance.
+constexpr double tol = 1e-12;
+
+// Helper to invoke the sieve on the position
+// polynomials of two particles.
+auto sieve(const std::array<std::array<double, 3>, 3> &pi, const std::array<std::array<double, 3>, 3> &pj,
+           double delta_i, double delta_j, double rf_int, double r)
+{
+    return detail::rel_vel_sieve({pi[0].data(), pi[1].data(), pi[2].data()},
+                                 {pj[0].data(), pj[1].data(), pj[2].data()}, delta_i, delta_j, rf_int, r, order);
+}
+
+// A stationary particle in the origin.
+const std::array<std::array<double, 3>, 3> origin = {{{0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+
+TEST_CASE("reject")
+{
+    // The particle j moves away from the origin
+    // along the x axis, starting from x = 10.
+    const std::array<std::array<double, 3>, 3> pj = {{{10., 1., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+
+    REQUIRE(!sieve(origin, pj, 0, 0, 1, 1));
+
+    // Same with translated polynomials.
+    REQUIRE(!sieve(origin, pj, .25, .25, 1, 1));
+
+    // No relative motion, at a distance larger than r.
+    const std::array<std::array<double, 3>, 3> pj_still = {{{10., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+    REQUIRE(!sieve(origin, pj_still, 0, 0, 1, 1));
+}
+
+TEST_CASE("keep")
+{
+    // The particle j moves from x = 2 towards the origin
+    // with speed 2, and it reaches x = 0.5 at t = 0.75.
+    const std::array<std::array<double, 3>, 3> pj = {{{2., -2., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+
+    auto res = sieve(origin, pj, 0, 0, 1, .5);
+    REQUIRE(res);
+    REQUIRE(res->first <= .75);
+    REQUIRE(res->first >= .75 - tol);
+    REQUIRE(res->second == 1.);
+
+    // Same with translated polynomials: at the beginning of the root
+    // finding interval j is at x = 1.5, and it reaches x = 0.5 at t = 0.5.
+    res = sieve(origin, pj, 0, .25, 1, .5);
+    REQUIRE(res);
+    REQUIRE(res->first <= .5);
+    REQUIRE(res->first >= .5 - tol);
+    REQUIRE(res->second == 1.);
+
+    // No relative motion, at a distance smaller than r.
+    const std::array<std::array<double, 3>, 3> pj_still = {{{.25, 0., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+    res = sieve(origin, pj_still, 0, 0, 1, .5);
+    REQUIRE(res);
+    REQUIRE(res->first == 0.);
+    REQUIRE(res->second == 1.);
+}
+
+TEST_CASE("near grazing")
+{
+    // Head-on approach: the particle j moves from x = 2 towards the origin
+    // with unit speed, and it reaches x = 1 at the end of the root
+    // finding interval. For straight-line head-on motion the sieve is
+    // exact up to rounding, thus it must keep the pair for r equal to or
+    // slightly larger than 1 and reject it for r slightly smaller than 1.
+    const std::array<std::array<double, 3>, 3> pj = {{{2., -1., 0.}, {0., 0., 0.}, {0., 0., 0.}}};
+
+    const auto eps = std::ldexp(1., -20);
+
+    auto res = sieve(origin, pj, 0, 0, 1, 1 + eps);
+    REQUIRE(res);
+    REQUIRE(res->first <= 1 - eps);
+    REQUIRE(res->first >= 1 - eps - tol);
+    REQUIRE(res->second == 1.);
+
+    res = sieve(origin, pj, 0, 0, 1, 1);
+    REQUIRE(res);
+    REQUIRE(res->first <= 1.);
+    REQUIRE(res->second == 1.);
+
+    REQUIRE(!sieve(origin, pj, 0, 0, 1, 1 - eps));
+
+    // Fly-by: the particle j moves along the line y = b with speed 2,
+    // from x = -1 to x = 1. The minimum distance b is reached at t = 0.5.
+    // The pair must be kept if r is slightly larger than b, and the
+    // sub-interval must contain the time of closest approach.
+    const auto b = 1e-3;
+    const std::array<std::array<double, 3>, 3> pj_fb = {{{-1., 2., 0.}, {b, 0., 0.}, {0., 0., 0.}}};
+
+    res = sieve(origin, pj_fb, 0, 0, 1, b * (1 + 1e-9));
+    REQUIRE(res);
+    REQUIRE(res->first <= .5);
+    REQUIRE(res->second >= .5);
+    REQUIRE(res->first >= 0.);
+    REQUIRE(res->second <= 1.);
+}
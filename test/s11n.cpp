@@ -0,0 +1,141 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <memory>
+#include <sstream>
+#include <variant>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <cascade/conj_sink.hpp>
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+TEST_CASE("sim s11n")
+{
+    sim s(polar_state, 0.23, kw::conj_thresh = std::vector{psize * 1000, psize * 100000000},
+          kw::conj_aggr = conj_aggr_mode::window, kw::conj_aggr_window = 5.,
+          kw::reentry_radius = std::vector{.1, .2, .3}, kw::coll_whitelist = sim::whitelist_t{0},
+          kw::screening_volume = screening_volume::ric_ellipsoid(1., 2., 3.), kw::n_par_ct = 3u, kw::det_order = 8u);
+
+    // NOTE: propagate so that there are both detected
+    // and pending aggregated conjunctions.
+    s.propagate_until(7.);
+    REQUIRE(!s.get_conjunctions().empty());
+    REQUIRE(s.get_n_pending_conjunctions() > 0u);
+
+    s.set_conj_sink(std::make_shared<counting_conj_sink>());
+
+    std::stringstream ss;
+    s.save_checkpoint(ss);
+
+    auto s2 = sim::load_checkpoint(ss);
+
+    REQUIRE(s2.get_state() == s.get_state());
+    REQUIRE(s2.get_pars() == s.get_pars());
+    REQUIRE(s2.get_ids() == s.get_ids());
+    REQUIRE(s2.get_time() == s.get_time());
+    REQUIRE(s2.get_ct() == s.get_ct());
+    REQUIRE(s2.get_n_par_ct() == 3u);
+    REQUIRE(s2.get_tol() == s.get_tol());
+    REQUIRE(s2.get_high_accuracy() == s.get_high_accuracy());
+    REQUIRE(s2.get_npars() == s.get_npars());
+    REQUIRE(std::get<1>(s2.get_reentry_radius()) == std::vector{.1, .2, .3});
+    REQUIRE(s2.get_conj_tiers() == s.get_conj_tiers());
+    REQUIRE(s2.get_conj_tier_counts() == s.get_conj_tier_counts());
+    REQUIRE(s2.get_conj_aggr() == conj_aggr_mode::window);
+    REQUIRE(s2.get_conj_aggr_window() == 5.);
+    REQUIRE(s2.get_n_pending_conjunctions() == s.get_n_pending_conjunctions());
+    REQUIRE(s2.get_coll_whitelist() == s.get_coll_whitelist());
+    REQUIRE(s2.get_conj_whitelist() == s.get_conj_whitelist());
+    REQUIRE(s2.get_screening_volume());
+    REQUIRE(s2.get_screening_volume()->get_bounding_radius() == 3.);
+    REQUIRE(s2.get_det_order() == 8u);
+    REQUIRE(s2.get_interrupt_info() == s.get_interrupt_info());
+
+    // The conjunction sink is not serialised.
+    REQUIRE(!s2.get_conj_sink());
+    s.set_conj_sink({});
+
+    // The restored simulation must evolve exactly as the original one.
+    s.propagate_until(20.);
+    s2.propagate_until(20.);
+
+    REQUIRE(s2.get_state() == s.get_state());
+    REQUIRE(s2.get_time() == s.get_time());
+    REQUIRE(s2.get_conjunctions().size() == s.get_conjunctions().size());
+    for (decltype(s.get_conjunctions().size()) k = 0; k < s.get_conjunctions().size(); ++k) {
+        REQUIRE(s2.get_conjunctions()[k].i == s.get_conjunctions()[k].i);
+        REQUIRE(s2.get_conjunctions()[k].j == s.get_conjunctions()[k].j);
+        REQUIRE(s2.get_conjunctions()[k].time == s.get_conjunctions()[k].time);
+        REQUIRE(s2.get_conjunctions()[k].n_min == s.get_conjunctions()[k].n_min);
+    }
+
+    // Loading into an existing simulation.
+    {
+        std::stringstream ss2;
+        {
+            boost::archive::binary_oarchive oa(ss2);
+            oa << s;
+        }
+
+        sim s3(polar_state, 0.5);
+        {
+            boost::archive::binary_iarchive ia(ss2);
+            ia >> s3;
+        }
+
+        REQUIRE(s3.get_state() == s.get_state());
+        REQUIRE(s3.get_ct() == s.get_ct());
+        REQUIRE(s3.get_conjunctions().size() == s.get_conjunctions().size());
+    }
+
+    // The whitelist indices which do not refer to any
+    // particle are not serialised. The detected conjunctions
+    // may refer to the tiers preceding a change of tiers.
+    {
+        s.set_coll_whitelist({0, s.get_nparts()});
+        s.set_conj_thresh(psize * 1000);
+
+        std::stringstream ss2;
+        s.save_checkpoint(ss2);
+
+        auto s3 = sim::load_checkpoint(ss2);
+
+        REQUIRE(s3.get_coll_whitelist() == sim::whitelist_t{0});
+        REQUIRE(s3.get_conj_tiers() == std::vector{psize * 1000});
+        REQUIRE(s3.get_conjunctions().size() == s.get_conjunctions().size());
+    }
+
+    // Invalid archive.
+    std::stringstream bad("hello world");
+    REQUIRE_THROWS(sim::load_checkpoint(bad));
+}
@@ -0,0 +1,171 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sum_sq.hpp>
+
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+namespace hy = heyoka;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+const auto a = psize * 100000000;
+
+TEST_CASE("screening volume api")
+{
+    auto [dx, dy, dz, x, hx] = hy::make_vars("dx", "dy", "dz", "x", "hx");
+
+    REQUIRE_THROWS_AS(screening_volume({}, 1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume({dx - 1.}, 0.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume({dx - 1.}, -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume({dx - 1.}, std::numeric_limits<double>::infinity()), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume({dx - hy::par[0]}, 1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume({dx - hx}, 1.), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(screening_volume::ric_ellipsoid(0., 1., 1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume::ric_box(1., -1., 1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(screening_volume::ric_box(1., 1., std::numeric_limits<double>::quiet_NaN()),
+                      std::invalid_argument);
+
+    const screening_volume sv({dx - x, dy + dz}, 2.);
+    REQUIRE(sv.get_predicates().size() == 2u);
+    REQUIRE(sv.get_bounding_radius() == 2.);
+
+    REQUIRE(screening_volume::ric_ellipsoid(1., 2., 3.).get_predicates().size() == 1u);
+    REQUIRE(screening_volume::ric_ellipsoid(1., 2., 3.).get_bounding_radius() == 3.);
+    REQUIRE(screening_volume::ric_box(1., 2., 3.).get_predicates().size() == 3u);
+    REQUIRE(screening_volume::ric_box(1., 2., 3.).get_bounding_radius() == std::sqrt(14.));
+
+    sim s(polar_state, 0.23);
+    REQUIRE(!s.get_screening_volume());
+
+    sim s2(polar_state, 0.23, kw::conj_thresh = 1., kw::screening_volume = sv);
+    REQUIRE(s2.get_screening_volume());
+    REQUIRE(s2.get_screening_volume()->get_bounding_radius() == 2.);
+
+    // Copy semantics.
+    auto s3 = s2;
+    REQUIRE(s3.get_screening_volume());
+    REQUIRE(s3.get_screening_volume()->get_predicates().size() == 2u);
+}
+
+TEST_CASE("screening volume")
+{
+    auto [dx, dy, dz] = hy::make_vars("dx", "dy", "dz");
+
+    for (auto n_par_ct : {1u, 3u}) {
+        // Reference simulation without screening volume.
+        sim s_ref(polar_state, 0.23, kw::conj_thresh = a, kw::n_par_ct = n_par_ct);
+        s_ref.propagate_until(20.);
+
+        const auto &ref_conj = s_ref.get_conjunctions();
+        REQUIRE(ref_conj.size() == 6u);
+
+        // A spherical screening volume, either as a RIC ellipsoid with equal
+        // semi-axes or via a custom predicate, must produce the same
+        // conjunctions as the reference, even if the conjunction threshold is larger.
+        for (const auto &sv : {screening_volume::ric_ellipsoid(a, a, a),
+                               screening_volume({hy::sum_sq({dx, dy, dz}) - a * a}, a)}) {
+            sim s(polar_state, 0.23, kw::conj_thresh = 2 * a, kw::n_par_ct = n_par_ct, kw::screening_volume = sv);
+            s.propagate_until(20.);
+
+            const auto &conj = s.get_conjunctions();
+            REQUIRE(conj.size() == ref_conj.size());
+
+            for (decltype(conj.size()) k = 0; k < conj.size(); ++k) {
+                REQUIRE(conj[k].time == ref_conj[k].time);
+                REQUIRE(conj[k].dist == ref_conj[k].dist);
+            }
+        }
+
+        // A box containing the sphere must detect a superset of the conjunctions.
+        sim s_box(polar_state, 0.23, kw::conj_thresh = 2 * a, kw::n_par_ct = n_par_ct,
+                  kw::screening_volume = screening_volume::ric_box(a, a, a));
+        s_box.propagate_until(20.);
+
+        const auto &box_conj = s_box.get_conjunctions();
+        REQUIRE(box_conj.size() >= ref_conj.size());
+
+        for (const auto &rc : ref_conj) {
+            REQUIRE(std::any_of(box_conj.begin(), box_conj.end(),
+                                [&rc](const auto &c) { return c.time == rc.time && c.dist == rc.dist; }));
+        }
+
+        // A non-spherical volume which contains only the points at which the
+        // distance between the particles is increasing (i.e., where the dot product
+        // of the relative position and velocity exceeds a positive value). The distance
+        // minima are outside the volume, and the conjunctions are instead detected when
+        // the secondary enters the volume, shortly after each minimum.
+        {
+            auto [dvx, dvy, dvz] = hy::make_vars("dvx", "dvy", "dvz");
+
+            const auto rv_min = 1e-2;
+
+            sim s_rv(polar_state, 0.23, kw::conj_thresh = a, kw::n_par_ct = n_par_ct,
+                     kw::screening_volume = screening_volume({rv_min - (dx * dvx + dy * dvy + dz * dvz)}, a));
+            s_rv.propagate_until(20.);
+
+            const auto &rv_conj = s_rv.get_conjunctions();
+            REQUIRE(rv_conj.size() == ref_conj.size());
+
+            for (decltype(rv_conj.size()) k = 0; k < rv_conj.size(); ++k) {
+                REQUIRE(rv_conj[k].time > ref_conj[k].time);
+                REQUIRE(rv_conj[k].dist > ref_conj[k].dist);
+
+                // The conjunctions are on the boundary of the volume.
+                const auto &st_i = rv_conj[k].state_i;
+                const auto &st_j = rv_conj[k].state_j;
+                double rv = 0;
+                for (auto c = 0u; c < 3u; ++c) {
+                    rv += (st_j[c] - st_i[c]) * (st_j[c + 3u] - st_i[c + 3u]);
+                }
+                REQUIRE(std::abs(rv - rv_min) < 1e-6);
+            }
+        }
+
+        // Screening volumes in aggregation mode.
+        sim s_aggr(polar_state, 0.23, kw::conj_thresh = 2 * a, kw::n_par_ct = n_par_ct,
+                   kw::screening_volume = screening_volume::ric_ellipsoid(a, a, a),
+                   kw::conj_aggr = conj_aggr_mode::superstep);
+        s_aggr.propagate_until(20.);
+
+        REQUIRE(s_aggr.get_conjunctions().size() == ref_conj.size());
+        for (const auto &c : s_aggr.get_conjunctions()) {
+            REQUIRE(c.time_under > 0);
+            REQUIRE(c.time_under <= 0.23 * n_par_ct * (1 + 1e-12));
+        }
+    }
+}
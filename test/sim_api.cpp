@@ -403,6 +403,100 @@ TEST_CASE("set new state pars")
     }
 }
 
+TEST_CASE("incremental particles")
+{
+    using Catch::Matchers::Message;
+
+    auto dyn = dynamics::kepler();
+    dyn[0].second += heyoka::par[1];
+
+    std::vector st = {.1, .1, .1, .1, .1, .1, .1, .2, .2, .2, .2, .2, .2, .2};
+    std::vector pars = {.3, .3, .4, .4};
+
+    sim s(st, .5, kw::dyn = dyn, kw::pars = pars, kw::exit_radius = 10.);
+
+    // Addition.
+    s.add_particles(std::vector{.3, .3, .3, .3, .3, .3, .3}, std::vector{.5, .5});
+    REQUIRE(s.get_nparts() == 3u);
+    REQUIRE(s.get_state()
+            == std::vector{.1, .1, .1, .1, .1, .1, .1, .2, .2, .2, .2, .2, .2, .2, .3, .3, .3, .3, .3, .3, .3});
+    REQUIRE(s.get_pars() == std::vector{.3, .3, .4, .4, .5, .5});
+
+    // Zero-initialised pars.
+    s.add_particles(std::vector{.4, .4, .4, .4, .4, .4, .4});
+    REQUIRE(s.get_nparts() == 4u);
+    REQUIRE(s.get_pars() == std::vector{.3, .3, .4, .4, .5, .5, 0., 0.});
+
+    // Only the new rows are validated, and they are
+    // identified by the indices they would be assigned.
+    REQUIRE_THROWS_MATCHES(s.add_particles(std::vector{.1, .1, .1, .1, .1, .1, .1, 20., .1, .1, .1, .1, .1, .1}),
+                           std::invalid_argument, Message("The particle at index 5 is outside the exit radius 10"));
+    REQUIRE_THROWS_MATCHES(s.add_particles(std::vector{.1, .1, .1, .1, .1, .1, .1}, std::vector{.1}),
+                           std::invalid_argument,
+                           Message("The input array of parameter values must have shape (1, 2), "
+                                   "but instead its flattened size is 1"));
+    REQUIRE(s.get_nparts() == 4u);
+
+    // Update.
+    s.update_particles(std::vector<sim::size_type>{3, 0},
+                       std::vector{.5, .5, .5, .5, .5, .5, .5, .6, .6, .6, .6, .6, .6, .6},
+                       std::vector{.7, .7, .8, .8});
+    REQUIRE(s.get_state()
+            == std::vector{.6, .6, .6, .6, .6, .6, .6, .2, .2, .2, .2, .2, .2, .2,
+                           .3, .3, .3, .3, .3, .3, .3, .5, .5, .5, .5, .5, .5, .5});
+    REQUIRE(s.get_pars() == std::vector{.8, .8, .4, .4, .5, .5, .7, .7});
+
+    // Update of the state only.
+    s.update_particles(std::vector<sim::size_type>{1}, std::vector{.1, .1, .1, .1, .1, .1, .1});
+    REQUIRE(s.get_pars() == std::vector{.8, .8, .4, .4, .5, .5, .7, .7});
+
+    REQUIRE_THROWS_MATCHES(s.update_particles(std::vector<sim::size_type>{2}, std::vector{.1, .1, .1, .1, .1, .1, -1.}),
+                           std::invalid_argument,
+                           Message("An invalid particle size of -1 was detected for the particle at index 2"));
+    REQUIRE_THROWS_MATCHES(s.update_particles(std::vector<sim::size_type>{4}, std::vector{.1, .1, .1, .1, .1, .1, .1}),
+                           std::invalid_argument,
+                           Message("Cannot update the particle at index 4 in a simulation with 4 particle(s)"));
+    REQUIRE_THROWS_MATCHES(s.update_particles(std::vector<sim::size_type>{1, 2},
+                                              std::vector{.1, .1, .1, .1, .1, .1, .1}),
+                           std::invalid_argument,
+                           Message("The input state vector must have shape (2, 7), but instead its "
+                                   "flattened size is 7"));
+    REQUIRE(s.get_state()[7u * 2u + 6u] == .3);
+
+    // Removal while the state/pars vectors are shared.
+    auto st_ptr = s._get_state_ptr();
+    const auto orig_state = *st_ptr;
+    s.remove_particles({0, 2});
+    REQUIRE(*st_ptr == orig_state);
+    REQUIRE(s.get_state() == std::vector{.1, .1, .1, .1, .1, .1, .1, .5, .5, .5, .5, .5, .5, .5});
+    REQUIRE(s.get_pars() == std::vector{.4, .4, .7, .7});
+
+    // Addition while the state/pars vectors are shared.
+    st_ptr = s._get_state_ptr();
+    s.add_particles(std::vector{.2, .2, .2, .2, .2, .2, .2});
+    REQUIRE(st_ptr->size() == 14u);
+    REQUIRE(s.get_nparts() == 3u);
+
+    // In-place removal.
+    st_ptr.reset();
+    s.remove_particles({1});
+    REQUIRE(s.get_state() == std::vector{.1, .1, .1, .1, .1, .1, .1, .2, .2, .2, .2, .2, .2, .2});
+    REQUIRE(s.get_pars() == std::vector{.4, .4, 0., 0.});
+}
+
+// The whitelists and the pending aggregated
+// conjunctions are renumbered upon particle removal.
+TEST_CASE("remove particles renumbering")
+{
+    std::vector st = {.1, .1, .1, .1, .1, .1, .1, .2, .2, .2, .2, .2, .2, .2, .3, .3, .3, .3, .3, .3, .3};
+
+    sim s(st, .5, kw::coll_whitelist = sim::whitelist_t{0, 2}, kw::conj_whitelist = sim::whitelist_t{1, 2});
+
+    s.remove_particles({1});
+    REQUIRE(s.get_coll_whitelist() == sim::whitelist_t{0, 1});
+    REQUIRE(s.get_conj_whitelist() == sim::whitelist_t{1});
+}
+
 TEST_CASE("ct api")
 {
     using Catch::Matchers::Message;
@@ -453,3 +547,20 @@ TEST_CASE("min coll radius api")
         s.set_min_coll_radius(-1.), std::invalid_argument,
         Message("The minimum collisional radius cannot be NaN or negative, but the invalid value -1 was provided"));
 }
+
+TEST_CASE("simple earth api")
+{
+    // Without perturbations, the Earth dynamics is Keplerian.
+    REQUIRE(dynamics::simple_earth(false, false, false, false, false, false, false)
+            == dynamics::kepler(3.986004407799724e5 * 1e9));
+
+    // The drag and the SRP introduce one parameter each.
+    REQUIRE(sim(std::vector<double>{}, 1., kw::dyn = dynamics::simple_earth()).get_npars() == 1u);
+    REQUIRE(sim(std::vector<double>{}, 1., kw::dyn = dynamics::simple_earth(true, true, true, true, true, true, true))
+                .get_npars()
+            == 2u);
+    REQUIRE(
+        sim(std::vector<double>{}, 1., kw::dyn = dynamics::simple_earth(true, false, true, true, false, true, false))
+            .get_npars()
+        == 1u);
+}
@@ -0,0 +1,199 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <hdf5.h>
+
+#include <cascade/sim.hpp>
+#include <cascade/snapshot_writer.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+namespace
+{
+
+const char *snap_path = "cascade_snapshot_writer_test.h5";
+
+// Read the content of a dataset, returning
+// an empty vector if the dataset does not exist.
+std::vector<double> read_dataset(const char *name)
+{
+    const auto file = H5Fopen(snap_path, H5F_ACC_RDONLY, H5P_DEFAULT);
+    REQUIRE(file >= 0);
+
+    std::vector<double> retval;
+
+    if (H5Lexists(file, name, H5P_DEFAULT) > 0) {
+        const auto ds = H5Dopen2(file, name, H5P_DEFAULT);
+        const auto space = H5Dget_space(ds);
+        const auto n = H5Sget_simple_extent_npoints(space);
+
+        retval.resize(static_cast<std::vector<double>::size_type>(n));
+        if (n > 0) {
+            REQUIRE(H5Dread(ds, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, retval.data()) >= 0);
+        }
+
+        H5Sclose(space);
+        H5Dclose(ds);
+    }
+
+    H5Fclose(file);
+
+    return retval;
+}
+
+} // namespace
+
+TEST_CASE("snapshot writer api")
+{
+    REQUIRE_THROWS_AS(snapshot_writer(snap_path, kw::compression = 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(snapshot_writer(snap_path, kw::queue_size = 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(snapshot_writer(snap_path, kw::snap_times = {1., std::numeric_limits<double>::infinity()}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(snapshot_writer(""), std::invalid_argument);
+
+    {
+        snapshot_writer sw(snap_path, kw::snap_every = 0, kw::snap_times = {3., 1., 3.}, kw::compression = 4,
+                           kw::queue_size = 1);
+        REQUIRE(sw.get_path() == snap_path);
+        REQUIRE(sw.get_snap_every() == 0u);
+        REQUIRE(sw.get_snap_times() == std::vector{1., 3.});
+        REQUIRE(sw.get_compression() == 4u);
+        REQUIRE(sw.get_queue_size() == 1u);
+
+        // Invalid snapshots.
+        REQUIRE_THROWS_AS(sw.submit(0., std::vector<double>{}, std::vector<double>{}), std::invalid_argument);
+        REQUIRE_THROWS_AS(sw.submit(0., std::vector<double>(8), std::vector<double>{}), std::invalid_argument);
+        REQUIRE_THROWS_AS(sw.submit(0., std::vector<double>(14), std::vector<double>(3)), std::invalid_argument);
+
+        for (auto i = 0; i < 10; ++i) {
+            sw.submit(i, std::vector<double>(14, i), std::vector<double>(4, -i));
+        }
+
+        // The shape cannot change.
+        REQUIRE_THROWS_AS(sw.submit(0., std::vector<double>(21), std::vector<double>(6)), std::invalid_argument);
+
+        sw.flush();
+        REQUIRE(sw.get_n_snapshots() == 10u);
+
+        sw.close();
+        REQUIRE_THROWS_AS(sw.submit(0., std::vector<double>(14), std::vector<double>{}), std::invalid_argument);
+    }
+
+    const auto times = read_dataset("time");
+    const auto state = read_dataset("state");
+    const auto pars = read_dataset("pars");
+
+    REQUIRE(times.size() == 10u);
+    REQUIRE(state.size() == 140u);
+    REQUIRE(pars.size() == 40u);
+
+    for (auto i = 0u; i < 10u; ++i) {
+        REQUIRE(times[i] == i);
+        REQUIRE(state[i * 14u] == i);
+        REQUIRE(state[i * 14u + 13u] == i);
+        REQUIRE(pars[i * 4u + 3u] == -static_cast<double>(i));
+    }
+
+    std::remove(snap_path);
+}
+
+TEST_CASE("snapshot writer sim")
+{
+    sim s(polar_state, 0.23);
+
+    // Take a step to determine the superstep size.
+    s.step();
+    const auto dt = s.get_time();
+
+    auto sw = std::make_shared<snapshot_writer>(snap_path, kw::snap_every = 2,
+                                                kw::snap_times = {0., dt * 1.5, dt * 2.5, dt * 100});
+    s.set_snapshot_writer(sw);
+    REQUIRE(s.get_snapshot_writer() == sw);
+
+    // The writer is not copied.
+    auto s2 = s;
+    REQUIRE(!s2.get_snapshot_writer());
+
+    // Reference states.
+    std::vector<std::vector<double>> ref_states;
+    {
+        // NOTE: the snapshot times preceding the beginning
+        // of the first step are discarded.
+        auto s_ref = s2;
+        s_ref.propagate_until(dt * 1.5);
+        ref_states.push_back(s_ref.get_state());
+
+        s_ref = s2;
+        s_ref.propagate_until(dt * 2.5);
+        ref_states.push_back(s_ref.get_state());
+
+        s_ref = s2;
+        s_ref.step();
+        s_ref.step();
+        ref_states.push_back(s_ref.get_state());
+
+        s_ref = s2;
+        s_ref.step();
+        s_ref.step();
+        s_ref.step();
+        s_ref.step();
+        ref_states.push_back(s_ref.get_state());
+    }
+
+    for (auto i = 0; i < 4; ++i) {
+        s.step();
+    }
+
+    sw->close();
+    REQUIRE(sw->get_n_snapshots() == 4u);
+
+    const auto times = read_dataset("time");
+    const auto state = read_dataset("state");
+    REQUIRE(read_dataset("pars").empty());
+
+    REQUIRE(times.size() == 4u);
+    REQUIRE(times[0] == dt * 1.5);
+    REQUIRE(times[1] == dt * 2.5);
+    REQUIRE(times[2] == Approx(dt * 3).epsilon(1e-14));
+    REQUIRE(times[3] == Approx(dt * 5).epsilon(1e-14));
+
+    REQUIRE(state.size() == 4u * 14u);
+    for (auto i = 0u; i < 4u; ++i) {
+        for (auto j = 0u; j < 14u; ++j) {
+            REQUIRE(state[i * 14u + j] == Approx(ref_states[i][j]).epsilon(1e-14).margin(1e-15));
+        }
+    }
+
+    std::remove(snap_path);
+}
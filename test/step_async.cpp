@@ -0,0 +1,95 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <cascade/sim.hpp>
+
+#include "catch.hpp"
+
+using namespace cascade;
+
+// NOTE: initial conditions corresponding to
+// 2 particles with polar conjunctions.
+const auto psize = 1.57e-8;
+const std::vector<double> polar_state = {0.3342377271241684,
+                                         0.942488801930755,
+                                         0.0,
+                                         0.009424730938644767,
+                                         -0.003342321565239028,
+                                         0.9999500004176654,
+                                         psize,
+                                         -0.15179985849820377,
+                                         -0.988411251938142,
+                                         0.0,
+                                         6.052273379648475e-17,
+                                         -9.295060541060909e-18,
+                                         1.000000000001,
+                                         psize};
+
+TEST_CASE("step async")
+{
+    sim s(polar_state, 0.23, kw::conj_thresh = psize * 100);
+    sim ref(polar_state, 0.23, kw::conj_thresh = psize * 100);
+
+    REQUIRE(!s.async_running());
+    REQUIRE(!s.get_async_snapshot());
+
+    auto fut = s.step_async();
+
+    // The snapshot contains the data at the launch of the step.
+    REQUIRE(s.get_async_snapshot());
+    REQUIRE(s.get_async_snapshot()->time == 0.);
+    REQUIRE(*s.get_async_snapshot()->state == polar_state);
+    REQUIRE(s.get_async_snapshot()->pars->empty());
+
+    REQUIRE(fut.get() == ref.step());
+    REQUIRE(!s.async_running());
+    REQUIRE(s.get_time() == ref.get_time());
+    REQUIRE(s.get_state() == ref.get_state());
+
+    const auto t1 = s.get_time();
+
+    // Propagation.
+    auto fut2 = s.propagate_until_async(2.);
+    s.wait_async();
+    REQUIRE(!s.async_running());
+    REQUIRE(fut2.get() == ref.propagate_until(2.));
+    REQUIRE(s.get_state() == ref.get_state());
+    REQUIRE(s.get_conjunctions().size() == ref.get_conjunctions().size());
+    REQUIRE(s.get_async_snapshot()->time == t1);
+
+    // Errors are reported via the future.
+    REQUIRE_THROWS_AS(s.propagate_until_async(1.).get(), std::invalid_argument);
+
+    // Launching an operation while another one is running.
+    auto fut3 = s.propagate_until_async(10.);
+    if (s.async_running()) {
+        REQUIRE_THROWS_AS(s.step_async(), std::invalid_argument);
+    }
+
+    // Copying and moving wait for the completion of the operation.
+    auto s2 = s;
+    REQUIRE(!s.async_running());
+    REQUIRE(fut3.get() == outcome::time_limit);
+    REQUIRE(s2.get_time() == 10.);
+
+    auto fut4 = s.step_async();
+    auto s3 = std::move(s);
+    REQUIRE(fut4.get() == s2.step());
+    REQUIRE(s3.get_state() == s2.get_state());
+
+    // Destruction waits for the completion of the operation.
+    std::optional<sim> s4(s3);
+    auto fut5 = s4->propagate_until_async(20.);
+    s4.reset();
+    REQUIRE(fut5.get() == outcome::time_limit);
+}
@@ -0,0 +1,91 @@
+// Copyright 2023 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the cascade library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// This program generates the precompiled entries of the JIT cache
+// for the standard dynamics (see the CASCADE_PRECOMPILE_JIT option
+// in the build system). Usage:
+//
+// cascade_jit_precompile <output directory>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <cascade/jit_cache.hpp>
+#include <cascade/sim.hpp>
+
+namespace
+{
+
+// Constants from cascade::dynamics::simple_earth().
+constexpr double GMe_SI = 3.986004407799724e5 * 1e9;
+constexpr double Re_SI = 6378.1363 * 1000;
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    using namespace cascade;
+
+    if (argc != 2) {
+        std::cerr << "Usage: cascade_jit_precompile <output directory>" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path out_dir(argv[1]);
+
+    // NOTE: start from an empty directory, so that
+    // stale entries are not installed.
+    std::filesystem::remove_all(out_dir);
+
+    jit_cache::set_dir(out_dir.string());
+    jit_cache::set_precompiled_dir("");
+    jit_cache::set_max_size(std::numeric_limits<std::uintmax_t>::max());
+
+    // NOTE: the order of the integrators depends on the tolerance, while
+    // the batch size is the recommended SIMD size of the host machine.
+    const auto tols = {0., 1e-12, 1e-9};
+
+    // Keplerian dynamics in normalised units, without events.
+    for (auto tol : tols) {
+        // NOTE: the construction of an empty simulation
+        // populates the cache with the compiled code.
+        sim({}, 1., kw::dyn = dynamics::kepler(), kw::tol = tol);
+    }
+
+    // The Earth dynamics in SI units. The event equations are part of
+    // the compiled code, thus we precompile the common setups: no events,
+    // reentry on the surface and at 150km of altitude (with and without
+    // an exit radius beyond the geostationary ring).
+    // NOTE: the exit radius is disabled when set to zero.
+    const auto reentry_exit = {std::pair{0., 0.}, std::pair{Re_SI, 0.}, std::pair{Re_SI + 150000., 0.},
+                               std::pair{Re_SI, 5e7}, std::pair{Re_SI + 150000., 5e7}};
+
+    // NOTE: the dynamics is built via the same function used by
+    // cascade.dynamics.simple_earth() in Python, so that the precompiled
+    // entries are found by the Python simulations.
+    for (const auto &dyn : {dynamics::kepler(GMe_SI),
+                            // J2 only.
+                            dynamics::simple_earth(true, false, false, false, false, false, false),
+                            // The default setup (J2, C22/S22 and drag).
+                            dynamics::simple_earth()}) {
+        for (auto tol : tols) {
+            for (const auto &[r_reentry, r_exit] : reentry_exit) {
+                sim({}, 1., kw::dyn = dyn, kw::tol = tol, kw::reentry_radius = r_reentry, kw::exit_radius = r_exit);
+            }
+        }
+    }
+
+    std::cout << "Precompiled JIT cache entries written to " << out_dir.string() << " ("
+              << jit_cache::get_size() << " bytes)" << std::endl;
+}